@@ -6,67 +6,59 @@
 namespace lox {
 
 std::string AstPrinter::print(const AbstractExpressionRef<std::string> &expr) {
-    return expr->accept(
-        std::static_pointer_cast<Visitor<std::string>>(shared_from_this()));
+    return visitExpr(*expr);
 }
 
-std::string
-AstPrinter::visitLiteralExpr(LiteralExpressionRef<std::string> expr) {
-    auto value = expr->getValue();
+std::string AstPrinter::visitLiteralExpr(LiteralExpression<std::string> &expr) {
+    const auto &value = expr.getValue();
     if (value == "")
         return "nil";
     return value;
 }
 
-std::string AstPrinter::visitBinaryExpr(BinaryExpressionRef<std::string> expr) {
+std::string AstPrinter::visitBinaryExpr(BinaryExpression<std::string> &expr) {
     std::string res = "(";
-    auto lexeme = expr->getOperation()->getLexeme();
+    auto lexeme = expr.getOperation().getLexeme();
     res += lexeme;
-    auto left = expr->getLeftExpr()->accept(
-        std::static_pointer_cast<Visitor<std::string>>(shared_from_this()));
-    auto right = expr->getRightExpr()->accept(
-        std::static_pointer_cast<Visitor<std::string>>(shared_from_this()));
+    auto left = visitExpr(*expr.getLeftExpr());
+    auto right = visitExpr(*expr.getRightExpr());
     res += " " + left + " " + right + ")";
     return res;
 }
 
-std::string AstPrinter::visitUnaryExpr(UnaryExpressionRef<std::string> expr) {
+std::string AstPrinter::visitUnaryExpr(UnaryExpression<std::string> &expr) {
     std::string res = "(";
-    auto lexeme = expr->getOperation()->getLexeme();
+    auto lexeme = expr.getOperation().getLexeme();
     res += lexeme + " ";
-    auto right = expr->getRightExpr()->accept(
-        std::static_pointer_cast<Visitor<std::string>>(shared_from_this()));
+    auto right = visitExpr(*expr.getRightExpr());
     res += right;
     res += ")";
     return res;
 }
 
 std::string
-AstPrinter::visitGroupingExpr(GroupingExpressionRef<std::string> expr) {
+AstPrinter::visitGroupingExpr(GroupingExpression<std::string> &expr) {
     std::string res = "(group ";
-    auto exp = expr->getExpr()->accept(
-        std::static_pointer_cast<Visitor<std::string>>(shared_from_this()));
+    auto exp = visitExpr(*expr.getExpr());
     res += exp;
     res += ")";
     return res;
 }
 
-std::string
-AstPrinter::visitVariableExpr(VariableExpressionRef<std::string> expr) {
+std::string AstPrinter::visitVariableExpr(VariableExpression<std::string> &) {
     return "";
 }
 
 std::string
-AstPrinter::visitAssignmentExpr(AssignmentExpressionRef<std::string> expr) {
+AstPrinter::visitAssignmentExpr(AssignmentExpression<std::string> &) {
     return "";
 }
 
-std::string
-AstPrinter::visitLogicalExpr(LogicalExpressionRef<std::string> expr) {
+std::string AstPrinter::visitLogicalExpr(LogicalExpression<std::string> &) {
     return "";
 }
 
-std::string AstPrinter::visitCallExpr(CallExpressionRef<std::string> expr) {
+std::string AstPrinter::visitCallExpr(CallExpression<std::string> &) {
     return "";
 }
 
@@ -0,0 +1,101 @@
+#include "Interpreter/BatchRunner.h"
+#include "Interpreter/ThreadPool.h"
+
+#include <algorithm>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <thread>
+
+namespace lox {
+
+auto BatchJob::fromFile(std::string path) -> BatchJob {
+    BatchJob job;
+    job.name = std::move(path);
+    job.isFile = true;
+    return job;
+}
+
+auto BatchJob::fromSource(std::string name, std::string source) -> BatchJob {
+    BatchJob job;
+    job.name = std::move(name);
+    job.source = std::move(source);
+    return job;
+}
+
+auto BatchJob::fromProgram(std::string name, ProgramRef program)
+    -> BatchJob {
+    BatchJob job;
+    job.name = std::move(name);
+    job.program = std::move(program);
+    return job;
+}
+
+auto BatchRunner::runOne(const BatchJob &job, const SnapshotRef &prelude)
+    -> BatchResult {
+    BatchResult result;
+    result.name = job.name;
+
+    std::string fileSource;
+    if (job.isFile) {
+        std::ifstream file(job.name);
+        if (!file) {
+            result.status = Isolate::Status::COMPILE_ERROR;
+            result.exitCode = 66;
+            result.errors = "Failed to open file: " + job.name + "\n";
+            return result;
+        }
+        std::stringstream buffer;
+        buffer << file.rdbuf();
+        fileSource = buffer.str();
+    }
+
+    std::ostringstream out, err;
+    {
+        auto isolate = prelude != nullptr
+                           ? std::make_unique<Isolate>(prelude, out, err)
+                           : std::make_unique<Isolate>(out, err);
+        if (job.program != nullptr) {
+            result.status = isolate->run(job.program);
+        } else {
+            result.status =
+                isolate->run(job.isFile ? fileSource : job.source);
+        }
+    }
+    switch (result.status) {
+    case Isolate::Status::COMPILE_ERROR:
+        result.exitCode = 65;
+        break;
+    case Isolate::Status::RUNTIME_ERROR:
+        result.exitCode = 70;
+        break;
+    default:
+        result.exitCode = 0;
+        break;
+    }
+    result.output = out.str();
+    result.errors = err.str();
+    return result;
+}
+
+auto BatchRunner::run(const std::vector<BatchJob> &jobs)
+    -> std::vector<BatchResult> {
+    std::vector<BatchResult> results(jobs.size());
+    if (jobs.empty()) {
+        return results;
+    }
+    auto workers = m_workers;
+    ThreadPool pool(std::min(workers == 0 ? std::thread::hardware_concurrency()
+                                          : workers,
+                             jobs.size()));
+    for (std::size_t i = 0; i < jobs.size(); i++) {
+        // 每个任务只写自己的槽位，结果天然按输入顺序排列
+        pool.submit([this, &jobs, &results, i] {
+            results[i] = runOne(jobs[i], m_prelude);
+        });
+    }
+    pool.wait();
+    return results;
+}
+
+} // namespace lox
@@ -0,0 +1,636 @@
+#include "Interpreter/Bytecode.h"
+#include "Interpreter/Interpreter.h"
+#include "Interpreter/RuntimeError.h"
+#include "Interpreter/Vm.h"
+#include "Runtime/StackProbe.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace lox {
+
+auto opcodeName(OpCode op) -> const char * {
+    static const char *const names[] = {
+#define LOX_OPCODE_NAME(name) #name,
+        LOX_OPCODES(LOX_OPCODE_NAME)
+#undef LOX_OPCODE_NAME
+    };
+    return names[static_cast<int>(op)];
+}
+
+auto Chunk::run(Interpreter &interpreter, EnvironmentRef env,
+                Object &result) const -> bool {
+    return interpreter.getVm().run(*this, std::move(env), result);
+}
+
+// 延迟解析的函数还没有调用过时没有字节码
+static auto disassembleCode(const FunctionCodeRef &code) -> std::string {
+    if (auto *chunk = dynamic_cast<const Chunk *>(code.get()))
+        return chunk->disassemble();
+    return "(not compiled)\n";
+}
+
+auto Chunk::disassemble() const -> std::string {
+    std::string text;
+    for (std::size_t i = 0; i < code.size(); i++) {
+        auto &instruction = code[i];
+        char line[96];
+        std::snprintf(line, sizeof(line), "%04zu %-28s %d %d %d\n", i,
+                      opcodeName(instruction.op), instruction.a, instruction.b,
+                      instruction.c);
+        text += line;
+    }
+    for (auto &function : functions) {
+        text += "fun " + function.declaration->getName().getLexeme() + ":\n";
+        text += disassembleCode(function.code);
+    }
+    for (auto &klass : classes) {
+        for (auto &[method, code] : klass.methods) {
+            text += "method " + klass.name.getLexeme() + "." +
+                    method->getName().getLexeme() + ":\n";
+            text += disassembleCode(code);
+        }
+    }
+    return text;
+}
+
+static auto isJump(OpCode op) -> bool {
+    switch (op) {
+    case OpCode::JUMP:
+    case OpCode::JUMP_IF_FALSE:
+    case OpCode::JUMP_IF_FALSE_KEEP:
+    case OpCode::JUMP_IF_TRUE_KEEP:
+    case OpCode::JUMP_UNLESS_LESS:
+    case OpCode::JUMP_UNLESS_LESS_EQUAL:
+    case OpCode::JUMP_UNLESS_GREATER:
+    case OpCode::JUMP_UNLESS_GREATER_EQUAL:
+    case OpCode::JUMP_UNLESS_EQUAL:
+    case OpCode::JUMP_UNLESS_NOT_EQUAL:
+    case OpCode::JUMP_UNLESS_LESS_K:
+    case OpCode::JUMP_UNLESS_LESS_EQUAL_K:
+    case OpCode::JUMP_UNLESS_GREATER_K:
+    case OpCode::JUMP_UNLESS_GREATER_EQUAL_K:
+        return true;
+    default:
+        return false;
+    }
+}
+
+// 指令对操作数栈深度的影响
+static auto stackEffect(const Instruction &instruction) -> int {
+    switch (instruction.op) {
+    case OpCode::CONSTANT:
+    case OpCode::NIL:
+    case OpCode::TRUE:
+    case OpCode::FALSE:
+    case OpCode::GET_LOCAL:
+    case OpCode::GET_GLOBAL:
+    case OpCode::GET_SUPER:
+    case OpCode::IMPORT:
+    case OpCode::ADD_LOCALS:
+        return 1;
+    case OpCode::POP:
+    case OpCode::DEFINE:
+    case OpCode::SET_PROPERTY:
+    case OpCode::ADD:
+    case OpCode::SUBTRACT:
+    case OpCode::MULTIPLY:
+    case OpCode::DIVIDE:
+    case OpCode::LESS:
+    case OpCode::LESS_EQUAL:
+    case OpCode::GREATER:
+    case OpCode::GREATER_EQUAL:
+    case OpCode::EQUAL:
+    case OpCode::NOT_EQUAL:
+    case OpCode::PRINT:
+    case OpCode::JUMP_IF_FALSE:
+    case OpCode::RETURN:
+    case OpCode::JUMP_UNLESS_LESS_K:
+    case OpCode::JUMP_UNLESS_LESS_EQUAL_K:
+    case OpCode::JUMP_UNLESS_GREATER_K:
+    case OpCode::JUMP_UNLESS_GREATER_EQUAL_K:
+        return -1;
+    case OpCode::JUMP_UNLESS_LESS:
+    case OpCode::JUMP_UNLESS_LESS_EQUAL:
+    case OpCode::JUMP_UNLESS_GREATER:
+    case OpCode::JUMP_UNLESS_GREATER_EQUAL:
+    case OpCode::JUMP_UNLESS_EQUAL:
+    case OpCode::JUMP_UNLESS_NOT_EQUAL:
+        return -2;
+    case OpCode::CALL:
+    case OpCode::TAIL_CALL:
+    case OpCode::INVOKE:
+        return -instruction.b;
+    case OpCode::CLASS:
+        return -instruction.b;
+    default:
+        return 0;
+    }
+}
+
+// 按 Resolver 的作用域结构把 AST 降低成字节码，每个函数体一个 Chunk
+class ChunkBuilder {
+  public:
+    explicit ChunkBuilder(bool superinstructions)
+        : m_superinstructions(superinstructions),
+          m_chunk(std::make_shared<Chunk>()) {}
+
+    auto build(const std::vector<StmtRef> &statements) -> ChunkRef {
+        for (auto &stmt : statements) {
+            statement(stmt);
+        }
+        emit(OpCode::END);
+        m_chunk->maxStack = m_maxDepth;
+        if (m_superinstructions)
+            BytecodeCompiler::optimize(m_chunk->code);
+        if (auto *table = Vm::dispatchTable()) {
+            for (auto &instruction : m_chunk->code) {
+                instruction.target = table[static_cast<int>(instruction.op)];
+            }
+        }
+        return m_chunk;
+    }
+
+  private:
+    auto emit(OpCode op, int a = 0, int b = 0, int c = 0) -> int {
+        Instruction instruction;
+        instruction.op = op;
+        instruction.a = a;
+        instruction.b = b;
+        instruction.c = c;
+        m_depth += stackEffect(instruction);
+        m_maxDepth = std::max(m_maxDepth, m_depth);
+        m_chunk->code.push_back(instruction);
+        return static_cast<int>(m_chunk->code.size()) - 1;
+    }
+
+    // 跳转目标在生成之后回填
+    auto patch(int jump) -> void {
+        m_chunk->code[jump].a = static_cast<int>(m_chunk->code.size());
+    }
+
+    auto constant(Object value) -> int {
+        m_chunk->constants.push_back(std::move(value));
+        return static_cast<int>(m_chunk->constants.size()) - 1;
+    }
+
+    auto token(const SourceToken &token) -> int {
+        m_chunk->tokens.push_back(token);
+        return static_cast<int>(m_chunk->tokens.size()) - 1;
+    }
+
+    auto name(const std::string &name) -> int {
+        m_chunk->names.push_back(name);
+        return static_cast<int>(m_chunk->names.size()) - 1;
+    }
+
+    auto local(int depth, const std::string &name) -> int {
+        auto key = std::make_pair(depth, name);
+        auto iter = m_locals.find(key);
+        if (iter != m_locals.end())
+            return iter->second;
+        m_chunk->locals.push_back({depth, name});
+        int index = static_cast<int>(m_chunk->locals.size()) - 1;
+        m_locals.emplace(std::move(key), index);
+        return index;
+    }
+
+    auto body(const std::vector<StmtRef> &statements) -> ChunkRef {
+        return ChunkBuilder(m_superinstructions).build(statements);
+    }
+
+    // 延迟解析的函数体在第一次调用时才解析和编译
+    auto body(const FunStmtRef &fun) -> FunctionCodeRef {
+        if (fun->isLazy()) {
+            return std::make_shared<LazyFunctionCode>(
+                [fun, superinstructions = m_superinstructions] {
+                    return ChunkBuilder(superinstructions)
+                        .build(fun->getBody());
+                });
+        }
+        return body(fun->getBody());
+    }
+
+    auto statement(const StmtRef &stmt) -> void {
+        if (auto expr = std::dynamic_pointer_cast<ExpressionStmt>(stmt)) {
+            expression(expr->getExpr());
+            emit(OpCode::POP);
+        } else if (auto print = std::dynamic_pointer_cast<PrintStmt>(stmt)) {
+            expression(print->getExpr());
+            emit(OpCode::PRINT);
+        } else if (auto var = std::dynamic_pointer_cast<VarStmt>(stmt)) {
+            expression(var->getInitExpr());
+            emit(OpCode::DEFINE, name(var->getName().getLexeme()));
+        } else if (auto block = std::dynamic_pointer_cast<BlockStmt>(stmt)) {
+            emit(OpCode::PUSH_SCOPE);
+            for (auto &inner : block->getStmt()) {
+                statement(inner);
+            }
+            emit(OpCode::POP_SCOPE);
+        } else if (auto branch = std::dynamic_pointer_cast<IfStmt>(stmt)) {
+            ifStatement(branch);
+        } else if (auto loop = std::dynamic_pointer_cast<WhileStmt>(stmt)) {
+            auto start = static_cast<int>(m_chunk->code.size());
+            expression(loop->getCondition());
+            auto exit = emit(OpCode::JUMP_IF_FALSE);
+            statement(loop->getBody());
+            emit(OpCode::JUMP, start);
+            patch(exit);
+        } else if (auto fun = std::dynamic_pointer_cast<FunStmt>(stmt)) {
+            m_chunk->functions.push_back({fun, body(fun)});
+            emit(OpCode::FUNCTION,
+                 static_cast<int>(m_chunk->functions.size()) - 1);
+        } else if (auto ret = std::dynamic_pointer_cast<ReturnStmt>(stmt)) {
+            expression(ret->getValue());
+            emit(OpCode::RETURN);
+        } else if (auto klass = std::dynamic_pointer_cast<ClassStmt>(stmt)) {
+            Chunk::Class proto;
+            proto.name = klass->getName();
+            if (klass->getSuper() != nullptr) {
+                proto.superName = klass->getSuper()->getName();
+                expression(klass->getSuper());
+            }
+            for (auto &method : klass->getMethods()) {
+                proto.methods.emplace_back(method, body(method));
+            }
+            m_chunk->classes.push_back(std::move(proto));
+            emit(OpCode::CLASS, static_cast<int>(m_chunk->classes.size()) - 1,
+                 klass->getSuper() != nullptr ? 1 : 0);
+        } else if (auto import = std::dynamic_pointer_cast<ImportStmt>(stmt)) {
+            m_chunk->imports.push_back(import);
+            emit(OpCode::IMPORT, static_cast<int>(m_chunk->imports.size()) - 1);
+            emit(OpCode::DEFINE, name(import->getName().getLexeme()));
+        } else {
+            throw std::logic_error("BytecodeCompiler: unsupported statement");
+        }
+    }
+
+    // else if 链在循环里编译，各个分支结束时都跳到整条链的后面
+    auto ifStatement(IfStmtRef branch) -> void {
+        std::vector<int> exits;
+        StmtRef next = branch;
+        for (; branch != nullptr;
+             branch = std::dynamic_pointer_cast<IfStmt>(next)) {
+            expression(branch->getCondition());
+            auto skipThen = emit(OpCode::JUMP_IF_FALSE);
+            statement(branch->getThen());
+            next = branch->getElse();
+            if (next == nullptr) {
+                patch(skipThen);
+                break;
+            }
+            exits.push_back(emit(OpCode::JUMP));
+            patch(skipThen);
+        }
+        if (branch == nullptr)
+            statement(next);
+        for (auto exit : exits)
+            patch(exit);
+    }
+
+    // 求值没有副作用、也不会出错的表达式，可以和属性查找交换顺序
+    static auto isPure(const AbstractExpressionRef<Object> &expr) -> bool {
+        if (std::dynamic_pointer_cast<LiteralExpression<Object>>(expr) ||
+            std::dynamic_pointer_cast<ThisExpression<Object>>(expr))
+            return true;
+        if (auto var =
+                std::dynamic_pointer_cast<VariableExpression<Object>>(expr))
+            return var->getDepth() >= 0;
+        if (auto group =
+                std::dynamic_pointer_cast<GroupingExpression<Object>>(expr))
+            return isPure(group->getExpr());
+        return false;
+    }
+
+    // expr 为空时（没有初始值的 var、没有返回值的 return）压入 nil
+    auto expression(const AbstractExpressionRef<Object> &expr) -> void {
+        // 语法树的高度不受 Parser 限制，原生栈快用完时报告错误
+        if (expr != nullptr && stackExhausted()) {
+            if (auto *where = exprToken(*expr))
+                throw RuntimeError(*where, "Too much nesting.");
+        }
+        if (expr == nullptr) {
+            emit(OpCode::NIL);
+        } else if (auto literal =
+                       std::dynamic_pointer_cast<LiteralExpression<Object>>(
+                           expr)) {
+            auto value = literal->getValue();
+            if (value.getType() == Object::Object_nil)
+                emit(OpCode::NIL);
+            else if (value.getType() == Object::Object_bool)
+                emit(value.getBool() ? OpCode::TRUE : OpCode::FALSE);
+            else
+                emit(OpCode::CONSTANT, constant(value));
+        } else if (auto group =
+                       std::dynamic_pointer_cast<GroupingExpression<Object>>(
+                           expr)) {
+            expression(group->getExpr());
+        } else if (auto unary =
+                       std::dynamic_pointer_cast<UnaryExpression<Object>>(
+                           expr)) {
+            expression(unary->getRightExpr());
+            if (unary->getOperation().getType() == MINUS)
+                emit(OpCode::NEGATE, 0, 0, token(unary->getOperation()));
+            else
+                emit(OpCode::NOT);
+        } else if (auto binary =
+                       std::dynamic_pointer_cast<BinaryExpression<Object>>(
+                           expr)) {
+            binaryChain(binary);
+        } else if (auto var =
+                       std::dynamic_pointer_cast<VariableExpression<Object>>(
+                           expr)) {
+            variable(var->getName(), var->getDepth());
+        } else if (auto self =
+                       std::dynamic_pointer_cast<ThisExpression<Object>>(
+                           expr)) {
+            variable(self->getKeyword(), self->getDepth());
+        } else if (auto assign =
+                       std::dynamic_pointer_cast<AssignmentExpression<Object>>(
+                           expr)) {
+            expression(assign->getValue());
+            if (assign->getDepth() >= 0) {
+                emit(OpCode::SET_LOCAL, local(assign->getDepth(),
+                                              assign->getName().getLexeme()));
+            } else {
+                emit(OpCode::SET_GLOBAL, token(assign->getName()));
+            }
+        } else if (auto logical =
+                       std::dynamic_pointer_cast<LogicalExpression<Object>>(
+                           expr)) {
+            logicalChain(logical);
+        } else if (auto call =
+                       std::dynamic_pointer_cast<CallExpression<Object>>(expr)) {
+            callExpression(call);
+        } else if (auto get =
+                       std::dynamic_pointer_cast<GetExpression<Object>>(expr)) {
+            expression(get->getObject());
+            emit(OpCode::GET_PROPERTY, token(get->getName()));
+        } else if (auto set =
+                       std::dynamic_pointer_cast<SetExpression<Object>>(expr)) {
+            // 先确认对象是实例再对右边求值，与解释器的顺序一致
+            auto name = token(set->getName());
+            expression(set->getObject());
+            emit(OpCode::CHECK_FIELDS, name);
+            expression(set->getValue());
+            emit(OpCode::SET_PROPERTY, name);
+        } else if (auto super =
+                       std::dynamic_pointer_cast<SuperExpression<Object>>(
+                           expr)) {
+            emit(OpCode::GET_SUPER, local(super->getDepth(), "super"),
+                 local(super->getDepth() - 1, "this"),
+                 token(super->getMethod()));
+        } else {
+            throw std::logic_error("BytecodeCompiler: unsupported expression");
+        }
+    }
+
+    // 左结合的运算链 a + b - c … 在循环里编译：先是最里面的左操作数，
+    // 再依次是各个右操作数和运算。生成的代码与递归编译的相同
+    auto binaryChain(BinaryExpressionRef<Object> binary) -> void {
+        std::vector<BinaryExpressionRef<Object>> spine;
+        for (; binary != nullptr;
+             binary = std::dynamic_pointer_cast<BinaryExpression<Object>>(
+                 binary->getLeftExpr())) {
+            spine.push_back(binary);
+        }
+        expression(spine.back()->getLeftExpr());
+        for (auto iter = spine.rbegin(); iter != spine.rend(); ++iter) {
+            expression((*iter)->getRightExpr());
+            emit(binaryOp((*iter)->getOperation().getType()), 0, 0,
+                 token((*iter)->getOperation()));
+        }
+    }
+
+    // a or b and c … 同样在循环里编译
+    auto logicalChain(LogicalExpressionRef<Object> logical) -> void {
+        std::vector<LogicalExpressionRef<Object>> spine;
+        for (; logical != nullptr;
+             logical = std::dynamic_pointer_cast<LogicalExpression<Object>>(
+                 logical->getLeftExpr())) {
+            spine.push_back(logical);
+        }
+        expression(spine.back()->getLeftExpr());
+        for (auto iter = spine.rbegin(); iter != spine.rend(); ++iter) {
+            auto skip = emit((*iter)->getOperation().getType() == OR
+                                 ? OpCode::JUMP_IF_TRUE_KEEP
+                                 : OpCode::JUMP_IF_FALSE_KEEP);
+            emit(OpCode::POP);
+            expression((*iter)->getRightExpr());
+            patch(skip);
+        }
+    }
+
+    // 方法调用的参数没有副作用时，属性查找可以推迟到参数求值之后，
+    // 选择 INVOKE 一次完成查找和调用
+    auto callExpression(const CallExpressionRef<Object> &call) -> void {
+        auto args = call->getArgs();
+        auto get = std::dynamic_pointer_cast<GetExpression<Object>>(
+            call->getCallee());
+        // 尾调用不合并成 INVOKE，留给 TAIL_CALL 处理
+        bool invoke = m_superinstructions && get != nullptr &&
+                      !call->isTailCall() &&
+                      std::all_of(args.begin(), args.end(), isPure);
+        if (invoke) {
+            expression(get->getObject());
+        } else {
+            expression(call->getCallee());
+        }
+        for (auto &arg : args) {
+            expression(arg);
+        }
+        auto argc = static_cast<int>(args.size());
+        if (invoke) {
+            emit(OpCode::INVOKE, token(get->getName()), argc,
+                 token(call->getParen()));
+        } else {
+            emit(call->isTailCall() ? OpCode::TAIL_CALL : OpCode::CALL, 0, argc,
+                 token(call->getParen()));
+        }
+    }
+
+    auto variable(const SourceToken &name, int depth) -> void {
+        if (depth >= 0) {
+            emit(OpCode::GET_LOCAL, local(depth, name.getLexeme()));
+        } else {
+            emit(OpCode::GET_GLOBAL, token(name));
+        }
+    }
+
+    static auto binaryOp(TokenType type) -> OpCode {
+        switch (type) {
+        case PLUS:
+            return OpCode::ADD;
+        case MINUS:
+            return OpCode::SUBTRACT;
+        case STAR:
+            return OpCode::MULTIPLY;
+        case SLASH:
+            return OpCode::DIVIDE;
+        case LESS:
+            return OpCode::LESS;
+        case LESS_EQUAL:
+            return OpCode::LESS_EQUAL;
+        case GREATER:
+            return OpCode::GREATER;
+        case GREATER_EQUAL:
+            return OpCode::GREATER_EQUAL;
+        case EQUAL_EQUAL:
+            return OpCode::EQUAL;
+        default:
+            return OpCode::NOT_EQUAL;
+        }
+    }
+
+    bool m_superinstructions;
+    std::shared_ptr<Chunk> m_chunk;
+    std::map<std::pair<int, std::string>, int> m_locals;
+    int m_depth = 0;
+    int m_maxDepth = 0;
+};
+
+auto BytecodeCompiler::compile(const std::vector<StmtRef> &statements,
+                               bool superinstructions) -> ChunkRef {
+    return ChunkBuilder(superinstructions).build(statements);
+}
+
+// 把 op 与常量右操作数合并后的超级指令，没有对应的返回 END
+static auto withConstant(OpCode op) -> OpCode {
+    switch (op) {
+    case OpCode::ADD:
+        return OpCode::ADD_K;
+    case OpCode::SUBTRACT:
+        return OpCode::SUBTRACT_K;
+    case OpCode::MULTIPLY:
+        return OpCode::MULTIPLY_K;
+    case OpCode::DIVIDE:
+        return OpCode::DIVIDE_K;
+    case OpCode::LESS:
+        return OpCode::LESS_K;
+    case OpCode::LESS_EQUAL:
+        return OpCode::LESS_EQUAL_K;
+    case OpCode::GREATER:
+        return OpCode::GREATER_K;
+    case OpCode::GREATER_EQUAL:
+        return OpCode::GREATER_EQUAL_K;
+    default:
+        return OpCode::END;
+    }
+}
+
+// 比较之后紧跟条件跳转时合并成的超级指令，没有对应的返回 END
+static auto compareAndJump(OpCode op) -> OpCode {
+    switch (op) {
+    case OpCode::LESS:
+        return OpCode::JUMP_UNLESS_LESS;
+    case OpCode::LESS_EQUAL:
+        return OpCode::JUMP_UNLESS_LESS_EQUAL;
+    case OpCode::GREATER:
+        return OpCode::JUMP_UNLESS_GREATER;
+    case OpCode::GREATER_EQUAL:
+        return OpCode::JUMP_UNLESS_GREATER_EQUAL;
+    case OpCode::EQUAL:
+        return OpCode::JUMP_UNLESS_EQUAL;
+    case OpCode::NOT_EQUAL:
+        return OpCode::JUMP_UNLESS_NOT_EQUAL;
+    case OpCode::LESS_K:
+        return OpCode::JUMP_UNLESS_LESS_K;
+    case OpCode::LESS_EQUAL_K:
+        return OpCode::JUMP_UNLESS_LESS_EQUAL_K;
+    case OpCode::GREATER_K:
+        return OpCode::JUMP_UNLESS_GREATER_K;
+    case OpCode::GREATER_EQUAL_K:
+        return OpCode::JUMP_UNLESS_GREATER_EQUAL_K;
+    default:
+        return OpCode::END;
+    }
+}
+
+auto BytecodeCompiler::optimize(std::vector<Instruction> &code) -> void {
+    std::vector<bool> isTarget(code.size(), false);
+    for (auto &instruction : code) {
+        if (isJump(instruction.op))
+            isTarget[instruction.a] = true;
+    }
+
+    // 每条新指令从哪条旧指令开始；被合并进前一条的指令不能是跳转目标
+    std::vector<Instruction> out;
+    std::vector<bool> outTarget;
+    std::vector<int> newIndex(code.size(), 0);
+    auto mergeable = [&](std::size_t count) {
+        if (out.size() < count)
+            return false;
+        for (auto i = out.size() - count + 1; i < out.size(); i++) {
+            if (outTarget[i])
+                return false;
+        }
+        return true;
+    };
+    auto replaceTail = [&](std::size_t count, Instruction fused) {
+        bool target = outTarget[out.size() - count];
+        out.resize(out.size() - count);
+        outTarget.resize(outTarget.size() - count);
+        out.push_back(fused);
+        outTarget.push_back(target);
+    };
+
+    for (std::size_t i = 0; i < code.size(); i++) {
+        newIndex[i] = static_cast<int>(out.size());
+        out.push_back(code[i]);
+        outTarget.push_back(isTarget[i]);
+
+        // 合并可能连锁发生，例如 CONSTANT LESS JUMP_IF_FALSE
+        for (bool changed = true; changed;) {
+            changed = false;
+            auto n = out.size();
+            auto &last = out[n - 1];
+            if (last.op == OpCode::ADD && mergeable(3) &&
+                out[n - 3].op == OpCode::GET_LOCAL &&
+                out[n - 2].op == OpCode::GET_LOCAL) {
+                Instruction fused = last;
+                fused.op = OpCode::ADD_LOCALS;
+                fused.a = out[n - 3].a;
+                fused.b = out[n - 2].a;
+                replaceTail(3, fused);
+                changed = true;
+            } else if (withConstant(last.op) != OpCode::END && mergeable(2) &&
+                       out[n - 2].op == OpCode::CONSTANT) {
+                Instruction fused = last;
+                fused.op = withConstant(last.op);
+                fused.a = out[n - 2].a;
+                replaceTail(2, fused);
+                changed = true;
+            } else if (last.op == OpCode::JUMP_IF_FALSE && mergeable(2) &&
+                       compareAndJump(out[n - 2].op) != OpCode::END) {
+                Instruction fused = out[n - 2];
+                fused.op = compareAndJump(fused.op);
+                fused.b = fused.a; // 带常量的比较把常量下标移到 b
+                fused.a = last.a;
+                replaceTail(2, fused);
+                changed = true;
+            } else if (last.op == OpCode::CALL && last.b == 0 && mergeable(2) &&
+                       out[n - 2].op == OpCode::GET_PROPERTY) {
+                Instruction fused = last;
+                fused.op = OpCode::INVOKE;
+                fused.a = out[n - 2].a;
+                replaceTail(2, fused);
+                changed = true;
+            }
+        }
+        // 被合并的指令下标指向合并后的指令，只有跳转目标会被用到
+        newIndex[i] = std::min(newIndex[i], static_cast<int>(out.size()) - 1);
+    }
+
+    for (auto &instruction : out) {
+        if (isJump(instruction.op))
+            instruction.a = newIndex[instruction.a];
+    }
+    code = std::move(out);
+}
+
+} // namespace lox
@@ -0,0 +1,825 @@
+#include "Interpreter/ClosureCompiler.h"
+#include "Interpreter/Interpreter.h"
+#include "Interpreter/LoxClass.h"
+#include "Interpreter/LoxFunction.h"
+#include "Interpreter/LoxInstance.h"
+#include "Interpreter/RuntimeError.h"
+#include "Runtime/StackProbe.h"
+
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace lox {
+
+namespace closure {
+
+// 一次函数调用（或一次顶层运行）的执行状态
+struct Frame {
+    Interpreter &interpreter;
+    EnvironmentRef env;
+    Object &result; // return 语句的返回值
+};
+
+// 节点的虚析构只用于释放，求值总是直接调用 eval 指向的函数
+struct ExprNode {
+    using Eval = Object (*)(const ExprNode &node, Frame &frame);
+    explicit ExprNode(Eval eval) : eval(eval) {}
+    virtual ~ExprNode() = default;
+    Eval eval;
+};
+using ExprNodePtr = std::unique_ptr<ExprNode>;
+
+// exec 返回 true 表示执行了 return 语句，外层应立即停止执行
+struct StmtNode {
+    using Exec = bool (*)(const StmtNode &node, Frame &frame);
+    explicit StmtNode(Exec exec) : exec(exec) {}
+    virtual ~StmtNode() = default;
+    Exec exec;
+};
+using StmtNodePtr = std::unique_ptr<StmtNode>;
+
+inline auto evaluate(const ExprNodePtr &node, Frame &frame) -> Object {
+    return node->eval(*node, frame);
+}
+
+inline auto execute(const StmtNodePtr &node, Frame &frame) -> bool {
+    return node->exec(*node, frame);
+}
+
+inline auto executeAll(const std::vector<StmtNodePtr> &nodes, Frame &frame)
+    -> bool {
+    for (auto &node : nodes) {
+        if (execute(node, frame))
+            return true;
+    }
+    return false;
+}
+
+inline auto isTruthy(Object &value) -> bool {
+    if (value.getType() == Object::Object_nil)
+        return false;
+    if (value.getType() == Object::Object_bool)
+        return value.getBool();
+    return true;
+}
+
+inline auto resolve(Frame &frame, int depth, bool write) -> Environment * {
+    return frame.interpreter.localScope(frame.env.get(), depth, write);
+}
+
+static const std::string kThis = "this";
+static const std::string kSuper = "super";
+
+/*******************************************************************/
+/*                Expression    */
+/*******************************************************************/
+
+struct Literal : ExprNode {
+    using ExprNode::ExprNode;
+    Object value;
+};
+
+static auto evalLiteral(const ExprNode &node, Frame &) -> Object {
+    return static_cast<const Literal &>(node).value;
+}
+
+struct Unary : ExprNode {
+    using ExprNode::ExprNode;
+    SourceToken operation;
+    ExprNodePtr right;
+};
+
+static auto evalNegate(const ExprNode &node, Frame &frame) -> Object {
+    auto &unary = static_cast<const Unary &>(node);
+    auto right = evaluate(unary.right, frame);
+    if (right.getType() != Object::Object_num)
+        throw RuntimeError(unary.operation, "Operand must be a number.");
+    return Object::make_num_obj(-right.getNum());
+}
+
+static auto evalNot(const ExprNode &node, Frame &frame) -> Object {
+    auto right = evaluate(static_cast<const Unary &>(node).right, frame);
+    return Object::make_bool_obj(!isTruthy(right));
+}
+
+struct Binary : ExprNode {
+    using ExprNode::ExprNode;
+    SourceToken operation;
+    ExprNodePtr left;
+    ExprNodePtr right;
+};
+
+// 每个运算符一个运算函数，编译时按运算符选定，执行时不再分支
+template <TokenType Op>
+static auto applyBinary(const Object &left, const Object &right,
+                        const SourceToken &operation, Frame &frame)
+    -> Object {
+    if constexpr (Op == EQUAL_EQUAL) {
+        return Object::make_bool_obj(frame.interpreter.isEqual(left, right));
+    } else if constexpr (Op == BANG_EQUAL) {
+        return Object::make_bool_obj(!frame.interpreter.isEqual(left, right));
+    } else if constexpr (Op == PLUS) {
+        if (left.getType() == Object::Object_num &&
+            right.getType() == Object::Object_num) {
+            return Object::make_num_obj(left.getNum() + right.getNum());
+        }
+        if (left.getType() == Object::Object_str &&
+            right.getType() == Object::Object_str) {
+            return Object::make_str_obj(
+                LoxString::concat(left.getString(), right.getString()));
+        }
+        throw RuntimeError(operation,
+                           "Operands must be two numbers or two strings.");
+    } else {
+        if (left.getType() != Object::Object_num ||
+            right.getType() != Object::Object_num) {
+            throw RuntimeError(operation, "Operand must be a number.");
+        }
+        double a = left.getNum();
+        double b = right.getNum();
+        if constexpr (Op == MINUS)
+            return Object::make_num_obj(a - b);
+        else if constexpr (Op == STAR)
+            return Object::make_num_obj(a * b);
+        else if constexpr (Op == SLASH)
+            return Object::make_num_obj(a / b);
+        else if constexpr (Op == GREATER)
+            return Object::make_bool_obj(a > b);
+        else if constexpr (Op == GREATER_EQUAL)
+            return Object::make_bool_obj(a >= b);
+        else if constexpr (Op == LESS)
+            return Object::make_bool_obj(a < b);
+        else
+            return Object::make_bool_obj(a <= b);
+    }
+}
+
+template <TokenType Op>
+static auto evalBinary(const ExprNode &node, Frame &frame) -> Object {
+    auto &binary = static_cast<const Binary &>(node);
+    auto left = evaluate(binary.left, frame);
+    auto right = evaluate(binary.right, frame);
+    return applyBinary<Op>(left, right, binary.operation, frame);
+}
+
+// 左结合的运算链 a + b - c …：先求第一个操作数，再依次与后面的操作数
+// 运算。编译和执行都是循环，链再长也不加深原生栈
+struct BinaryChain : ExprNode {
+    using ExprNode::ExprNode;
+    using Apply = Object (*)(const Object &left, const Object &right,
+                             const SourceToken &operation, Frame &frame);
+    struct Step {
+        Apply apply;
+        SourceToken operation;
+        ExprNodePtr right;
+    };
+    ExprNodePtr first;
+    std::vector<Step> steps;
+};
+
+static auto evalBinaryChain(const ExprNode &node, Frame &frame) -> Object {
+    auto &chain = static_cast<const BinaryChain &>(node);
+    auto value = evaluate(chain.first, frame);
+    for (auto &step : chain.steps) {
+        auto right = evaluate(step.right, frame);
+        value = step.apply(value, right, step.operation, frame);
+    }
+    return value;
+}
+
+static auto evalNil(const ExprNode &, Frame &) -> Object {
+    return Object::make_nil_obj();
+}
+
+// 局部变量（包括 this）：作用域距离和名字在编译时确定
+struct Local : ExprNode {
+    using ExprNode::ExprNode;
+    int depth;
+    std::string name;
+};
+
+static auto evalLocal(const ExprNode &node, Frame &frame) -> Object {
+    auto &local = static_cast<const Local &>(node);
+    return **resolve(frame, local.depth, false)->findLocal(local.name);
+}
+
+struct Global : ExprNode {
+    using ExprNode::ExprNode;
+    SourceToken name;
+};
+
+static auto evalGlobal(const ExprNode &node, Frame &frame) -> Object {
+    return *frame.interpreter.globals->get(static_cast<const Global &>(node).name);
+}
+
+struct Assign : ExprNode {
+    using ExprNode::ExprNode;
+    int depth;
+    SourceToken name;
+    ExprNodePtr value;
+};
+
+static auto evalAssignLocal(const ExprNode &node, Frame &frame) -> Object {
+    auto &assign = static_cast<const Assign &>(node);
+    auto value = evaluate(assign.value, frame);
+    resolve(frame, assign.depth, true)
+        ->define(assign.name.getLexeme(), std::make_shared<Object>(value));
+    return value;
+}
+
+static auto evalAssignGlobal(const ExprNode &node, Frame &frame) -> Object {
+    auto &assign = static_cast<const Assign &>(node);
+    auto value = evaluate(assign.value, frame);
+    frame.interpreter.globals->assign(assign.name,
+                                      std::make_shared<Object>(value));
+    return value;
+}
+
+struct Logical : ExprNode {
+    using ExprNode::ExprNode;
+    ExprNodePtr left;
+    ExprNodePtr right;
+};
+
+static auto evalOr(const ExprNode &node, Frame &frame) -> Object {
+    auto &logical = static_cast<const Logical &>(node);
+    auto left = evaluate(logical.left, frame);
+    if (isTruthy(left))
+        return left;
+    return evaluate(logical.right, frame);
+}
+
+static auto evalAnd(const ExprNode &node, Frame &frame) -> Object {
+    auto &logical = static_cast<const Logical &>(node);
+    auto left = evaluate(logical.left, frame);
+    if (!isTruthy(left))
+        return left;
+    return evaluate(logical.right, frame);
+}
+
+// 左结合的 a or b and c …，与 BinaryChain 一样在循环里求值。
+// 到目前为止的结果已经决定了这一步（or 遇到真值，and 遇到假值）时
+// 保留它，否则对右边求值
+struct LogicalChain : ExprNode {
+    using ExprNode::ExprNode;
+    struct Step {
+        bool isOr;
+        ExprNodePtr right;
+    };
+    ExprNodePtr first;
+    std::vector<Step> steps;
+};
+
+static auto evalLogicalChain(const ExprNode &node, Frame &frame) -> Object {
+    auto &chain = static_cast<const LogicalChain &>(node);
+    auto value = evaluate(chain.first, frame);
+    for (auto &step : chain.steps) {
+        if (isTruthy(value) != step.isOr)
+            value = evaluate(step.right, frame);
+    }
+    return value;
+}
+
+struct Call : ExprNode {
+    using ExprNode::ExprNode;
+    ExprNodePtr callee;
+    std::vector<ExprNodePtr> arguments;
+    SourceToken paren;
+};
+
+template <bool Tail>
+static auto evalCall(const ExprNode &node, Frame &frame) -> Object {
+    auto &call = static_cast<const Call &>(node);
+    auto callee = evaluate(call.callee, frame);
+    std::vector<ObjectRef> arguments;
+    arguments.reserve(call.arguments.size());
+    for (auto &arg : call.arguments) {
+        arguments.push_back(std::make_shared<Object>(evaluate(arg, frame)));
+    }
+    if constexpr (Tail) {
+        return frame.interpreter.tailCall(std::move(callee),
+                                          std::move(arguments), call.paren);
+    }
+    return frame.interpreter.callValue(std::move(callee), std::move(arguments),
+                                       call.paren);
+}
+
+struct Get : ExprNode {
+    using ExprNode::ExprNode;
+    ExprNodePtr object;
+    SourceToken name;
+};
+
+static auto evalGet(const ExprNode &node, Frame &frame) -> Object {
+    auto &get = static_cast<const Get &>(node);
+    return frame.interpreter.getProperty(evaluate(get.object, frame), get.name);
+}
+
+struct Set : ExprNode {
+    using ExprNode::ExprNode;
+    ExprNodePtr object;
+    ExprNodePtr value;
+    SourceToken name;
+};
+
+static auto evalSet(const ExprNode &node, Frame &frame) -> Object {
+    auto &set = static_cast<const Set &>(node);
+    auto object = evaluate(set.object, frame);
+    if (object.getType() != Object::Object_instance)
+        throw RuntimeError(set.name, "Only instances have fields.");
+    auto value = evaluate(set.value, frame);
+    frame.interpreter.localCopy(object.getInstance(), true)
+        ->set(set.name, std::make_shared<Object>(value));
+    return value;
+}
+
+struct Super : ExprNode {
+    using ExprNode::ExprNode;
+    int depth;
+    SourceToken method;
+};
+
+static auto evalSuper(const ExprNode &node, Frame &frame) -> Object {
+    auto &super = static_cast<const Super &>(node);
+    auto superclass =
+        (*resolve(frame, super.depth, false)->findLocal(kSuper))->getClass();
+    auto instance =
+        (*resolve(frame, super.depth - 1, false)->findLocal(kThis))
+            ->getInstance();
+    auto method = superclass->findMethod(super.method.getLexeme());
+    if (method == nullptr) {
+        throw RuntimeError(super.method, "Undefined property '" +
+                                             super.method.getLexeme() + "'.");
+    }
+    return Object::make_fun_obj(method->bind(instance));
+}
+
+/*******************************************************************/
+/*         Statements      */
+/*******************************************************************/
+
+struct ExpressionStatement : StmtNode {
+    using StmtNode::StmtNode;
+    ExprNodePtr expr;
+};
+
+static auto execExpression(const StmtNode &node, Frame &frame) -> bool {
+    evaluate(static_cast<const ExpressionStatement &>(node).expr, frame);
+    return false;
+}
+
+static auto execPrint(const StmtNode &node, Frame &frame) -> bool {
+    frame.interpreter.print(
+        evaluate(static_cast<const ExpressionStatement &>(node).expr, frame));
+    return false;
+}
+
+struct Var : StmtNode {
+    using StmtNode::StmtNode;
+    std::string name;
+    ExprNodePtr initializer;
+};
+
+static auto execVar(const StmtNode &node, Frame &frame) -> bool {
+    auto &var = static_cast<const Var &>(node);
+    frame.env->define(var.name, std::make_shared<Object>(
+                                    evaluate(var.initializer, frame)));
+    return false;
+}
+
+struct Block : StmtNode {
+    using StmtNode::StmtNode;
+    std::vector<StmtNodePtr> statements;
+};
+
+// 进入新的作用域，离开（包括异常离开）时恢复外层环境
+class ScopeGuard {
+  public:
+    explicit ScopeGuard(Frame &frame)
+        : m_frame(frame), m_saved(frame.env) {
+        frame.env = std::make_shared<Environment>(m_saved);
+    }
+    ~ScopeGuard() { m_frame.env = std::move(m_saved); }
+
+  private:
+    Frame &m_frame;
+    EnvironmentRef m_saved;
+};
+
+static auto execBlock(const StmtNode &node, Frame &frame) -> bool {
+    ScopeGuard scope(frame);
+    return executeAll(static_cast<const Block &>(node).statements, frame);
+}
+
+// if 和后面的各个 else if 放在一个节点里，依次检查条件
+struct If : StmtNode {
+    using StmtNode::StmtNode;
+    struct Branch {
+        ExprNodePtr condition;
+        StmtNodePtr body;
+    };
+    std::vector<Branch> branches;
+    StmtNodePtr elseBranch;
+};
+
+static auto execIf(const StmtNode &node, Frame &frame) -> bool {
+    auto &chain = static_cast<const If &>(node);
+    for (auto &branch : chain.branches) {
+        auto condition = evaluate(branch.condition, frame);
+        if (isTruthy(condition))
+            return execute(branch.body, frame);
+    }
+    if (chain.elseBranch != nullptr)
+        return execute(chain.elseBranch, frame);
+    return false;
+}
+
+struct While : StmtNode {
+    using StmtNode::StmtNode;
+    ExprNodePtr condition;
+    StmtNodePtr body;
+};
+
+static auto execWhile(const StmtNode &node, Frame &frame) -> bool {
+    auto &loop = static_cast<const While &>(node);
+    for (;;) {
+        auto condition = evaluate(loop.condition, frame);
+        if (!isTruthy(condition))
+            return false;
+        if (execute(loop.body, frame))
+            return true;
+    }
+}
+
+struct Function : StmtNode {
+    using StmtNode::StmtNode;
+    FunStmtRef declaration;
+    FunctionCodeRef body;
+};
+
+static auto execFunction(const StmtNode &node, Frame &frame) -> bool {
+    auto &fun = static_cast<const Function &>(node);
+    auto function = std::make_shared<LoxFunction>(fun.declaration, frame.env,
+                                                  false, fun.body);
+    frame.env->define(fun.declaration->getName().getLexeme(),
+                      std::make_shared<Object>(Object::make_fun_obj(function)));
+    return false;
+}
+
+struct Return : StmtNode {
+    using StmtNode::StmtNode;
+    ExprNodePtr value;
+};
+
+static auto execReturn(const StmtNode &node, Frame &frame) -> bool {
+    frame.result = evaluate(static_cast<const Return &>(node).value, frame);
+    return true;
+}
+
+struct Class : StmtNode {
+    using StmtNode::StmtNode;
+    SourceToken name;
+    SourceToken superName;
+    ExprNodePtr superclass; // 没有父类时为空
+    std::vector<std::pair<FunStmtRef, FunctionCodeRef>> methods;
+};
+
+static auto execClass(const StmtNode &node, Frame &frame) -> bool {
+    auto &klass = static_cast<const Class &>(node);
+    ObjectRef superclass = nullptr;
+    if (klass.superclass != nullptr) {
+        superclass = std::make_shared<Object>(evaluate(klass.superclass, frame));
+    }
+    frame.interpreter.defineClass(frame.env, klass.name, superclass,
+                                  klass.superName, klass.methods);
+    return false;
+}
+
+struct Import : StmtNode {
+    using StmtNode::StmtNode;
+    ImportStmtRef stmt;
+};
+
+static auto execImport(const StmtNode &node, Frame &frame) -> bool {
+    auto &import = static_cast<const Import &>(node);
+    auto module = frame.interpreter.importModule(*import.stmt);
+    frame.env->define(import.stmt->getName().getLexeme(),
+                      std::make_shared<Object>(std::move(module)));
+    return false;
+}
+
+} // namespace closure
+
+class CompiledBody : public FunctionCode {
+  public:
+    auto run(Interpreter &interpreter, EnvironmentRef env, Object &result) const
+        -> bool override {
+        closure::Frame frame{interpreter, std::move(env), result};
+        return closure::executeAll(statements, frame);
+    }
+
+    std::vector<closure::StmtNodePtr> statements;
+};
+
+using namespace closure;
+
+// 编译只发生一次，这里用 dynamic_pointer_cast 判断节点类型即可
+class NodeCompiler {
+  public:
+    static auto body(const std::vector<StmtRef> &statements)
+        -> FunctionCodeRef {
+        auto compiled = std::make_shared<CompiledBody>();
+        compiled->statements = block(statements);
+        return compiled;
+    }
+
+    // 延迟解析的函数体在第一次调用时才解析和编译
+    static auto body(const FunStmtRef &fun) -> FunctionCodeRef {
+        if (fun->isLazy()) {
+            return std::make_shared<LazyFunctionCode>(
+                [fun] { return body(fun->getBody()); });
+        }
+        return body(fun->getBody());
+    }
+
+  private:
+    template <class Node, class Fn>
+    static auto make(Fn fn) -> std::unique_ptr<Node> {
+        return std::make_unique<Node>(fn);
+    }
+
+    static auto block(const std::vector<StmtRef> &statements)
+        -> std::vector<StmtNodePtr> {
+        std::vector<StmtNodePtr> nodes;
+        nodes.reserve(statements.size());
+        for (auto &stmt : statements) {
+            nodes.push_back(statement(stmt));
+        }
+        return nodes;
+    }
+
+    static auto statement(const StmtRef &stmt) -> StmtNodePtr {
+        if (auto expr = std::dynamic_pointer_cast<ExpressionStmt>(stmt)) {
+            auto node = make<ExpressionStatement>(execExpression);
+            node->expr = expression(expr->getExpr());
+            return node;
+        }
+        if (auto print = std::dynamic_pointer_cast<PrintStmt>(stmt)) {
+            auto node = make<ExpressionStatement>(execPrint);
+            node->expr = expression(print->getExpr());
+            return node;
+        }
+        if (auto var = std::dynamic_pointer_cast<VarStmt>(stmt)) {
+            auto node = make<Var>(execVar);
+            node->name = var->getName().getLexeme();
+            node->initializer = expression(var->getInitExpr());
+            return node;
+        }
+        if (auto block = std::dynamic_pointer_cast<BlockStmt>(stmt)) {
+            auto node = make<Block>(execBlock);
+            node->statements = NodeCompiler::block(block->getStmt());
+            return node;
+        }
+        if (auto branch = std::dynamic_pointer_cast<IfStmt>(stmt)) {
+            auto node = make<If>(execIf);
+            StmtRef next = branch;
+            while (auto elseIf = std::dynamic_pointer_cast<IfStmt>(next)) {
+                node->branches.push_back({expression(elseIf->getCondition()),
+                                          statement(elseIf->getThen())});
+                next = elseIf->getElse();
+            }
+            if (next != nullptr)
+                node->elseBranch = statement(next);
+            return node;
+        }
+        if (auto loop = std::dynamic_pointer_cast<WhileStmt>(stmt)) {
+            auto node = make<While>(execWhile);
+            node->condition = expression(loop->getCondition());
+            node->body = statement(loop->getBody());
+            return node;
+        }
+        if (auto fun = std::dynamic_pointer_cast<FunStmt>(stmt)) {
+            auto node = make<Function>(execFunction);
+            node->declaration = fun;
+            node->body = body(fun);
+            return node;
+        }
+        if (auto ret = std::dynamic_pointer_cast<ReturnStmt>(stmt)) {
+            auto node = make<Return>(execReturn);
+            node->value = expression(ret->getValue());
+            return node;
+        }
+        if (auto klass = std::dynamic_pointer_cast<ClassStmt>(stmt)) {
+            auto node = make<Class>(execClass);
+            node->name = klass->getName();
+            if (klass->getSuper() != nullptr) {
+                node->superName = klass->getSuper()->getName();
+                node->superclass = expression(klass->getSuper());
+            }
+            for (auto &method : klass->getMethods()) {
+                node->methods.emplace_back(method, body(method));
+            }
+            return node;
+        }
+        if (auto import = std::dynamic_pointer_cast<ImportStmt>(stmt)) {
+            auto node = make<Import>(execImport);
+            node->stmt = import;
+            return node;
+        }
+        throw std::logic_error("ClosureCompiler: unsupported statement");
+    }
+
+    // expr 为空时（没有初始值的 var、没有返回值的 return）求值为 nil
+    static auto expression(const AbstractExpressionRef<Object> &expr)
+        -> ExprNodePtr {
+        if (expr == nullptr)
+            return make<ExprNode>(evalNil);
+        // 语法树的高度不受 Parser 限制，原生栈快用完时报告错误
+        if (stackExhausted()) {
+            if (auto *where = exprToken(*expr))
+                throw RuntimeError(*where, "Too much nesting.");
+        }
+        if (auto literal =
+                std::dynamic_pointer_cast<LiteralExpression<Object>>(expr)) {
+            auto node = make<Literal>(evalLiteral);
+            node->value = literal->getValue();
+            return node;
+        }
+        if (auto group =
+                std::dynamic_pointer_cast<GroupingExpression<Object>>(expr)) {
+            return expression(group->getExpr());
+        }
+        if (auto unary =
+                std::dynamic_pointer_cast<UnaryExpression<Object>>(expr)) {
+            auto node = make<Unary>(
+                unary->getOperation().getType() == MINUS ? evalNegate
+                                                          : evalNot);
+            node->operation = unary->getOperation();
+            node->right = expression(unary->getRightExpr());
+            return node;
+        }
+        if (auto binary =
+                std::dynamic_pointer_cast<BinaryExpression<Object>>(expr)) {
+            if (binary->getLeftExpr()->kind() == ExprKind::Binary)
+                return binaryChain(binary);
+            auto node = make<Binary>(binaryOp(binary->getOperation()).eval);
+            node->operation = binary->getOperation();
+            node->left = expression(binary->getLeftExpr());
+            node->right = expression(binary->getRightExpr());
+            return node;
+        }
+        if (auto var =
+                std::dynamic_pointer_cast<VariableExpression<Object>>(expr)) {
+            return variable(var->getName(), var->getDepth());
+        }
+        if (auto self = std::dynamic_pointer_cast<ThisExpression<Object>>(expr)) {
+            return variable(self->getKeyword(), self->getDepth());
+        }
+        if (auto assign =
+                std::dynamic_pointer_cast<AssignmentExpression<Object>>(expr)) {
+            auto node = make<Assign>(assign->getDepth() >= 0 ? evalAssignLocal
+                                                             : evalAssignGlobal);
+            node->depth = assign->getDepth();
+            node->name = assign->getName();
+            node->value = expression(assign->getValue());
+            return node;
+        }
+        if (auto logical =
+                std::dynamic_pointer_cast<LogicalExpression<Object>>(expr)) {
+            if (logical->getLeftExpr()->kind() == ExprKind::Logical)
+                return logicalChain(logical);
+            auto node = make<Logical>(
+                logical->getOperation().getType() == OR ? evalOr : evalAnd);
+            node->left = expression(logical->getLeftExpr());
+            node->right = expression(logical->getRightExpr());
+            return node;
+        }
+        if (auto call =
+                std::dynamic_pointer_cast<CallExpression<Object>>(expr)) {
+            auto node = make<Call>(call->isTailCall() ? evalCall<true>
+                                                      : evalCall<false>);
+            node->callee = expression(call->getCallee());
+            for (auto &arg : call->getArgs()) {
+                node->arguments.push_back(expression(arg));
+            }
+            node->paren = call->getParen();
+            return node;
+        }
+        if (auto get = std::dynamic_pointer_cast<GetExpression<Object>>(expr)) {
+            auto node = make<Get>(evalGet);
+            node->object = expression(get->getObject());
+            node->name = get->getName();
+            return node;
+        }
+        if (auto set = std::dynamic_pointer_cast<SetExpression<Object>>(expr)) {
+            auto node = make<Set>(evalSet);
+            node->object = expression(set->getObject());
+            node->value = expression(set->getValue());
+            node->name = set->getName();
+            return node;
+        }
+        if (auto super =
+                std::dynamic_pointer_cast<SuperExpression<Object>>(expr)) {
+            auto node = make<Super>(evalSuper);
+            node->depth = super->getDepth();
+            node->method = super->getMethod();
+            return node;
+        }
+        throw std::logic_error("ClosureCompiler: unsupported expression");
+    }
+
+    static auto variable(const SourceToken &name, int depth) -> ExprNodePtr {
+        if (depth < 0) {
+            auto node = make<Global>(evalGlobal);
+            node->name = name;
+            return node;
+        }
+        auto node = make<Local>(evalLocal);
+        node->depth = depth;
+        node->name = name.getLexeme();
+        return node;
+    }
+
+    // 沿左链收集运算，从最里面的一个开始编译
+    static auto binaryChain(BinaryExpressionRef<Object> binary)
+        -> ExprNodePtr {
+        std::vector<BinaryExpressionRef<Object>> spine;
+        for (; binary != nullptr;
+             binary = std::dynamic_pointer_cast<BinaryExpression<Object>>(
+                 binary->getLeftExpr())) {
+            spine.push_back(binary);
+        }
+        auto node = make<BinaryChain>(evalBinaryChain);
+        node->first = expression(spine.back()->getLeftExpr());
+        for (auto iter = spine.rbegin(); iter != spine.rend(); ++iter) {
+            auto &operation = (*iter)->getOperation();
+            node->steps.push_back({binaryOp(operation).apply, operation,
+                                   expression((*iter)->getRightExpr())});
+        }
+        return node;
+    }
+
+    static auto logicalChain(LogicalExpressionRef<Object> logical)
+        -> ExprNodePtr {
+        std::vector<LogicalExpressionRef<Object>> spine;
+        for (; logical != nullptr;
+             logical = std::dynamic_pointer_cast<LogicalExpression<Object>>(
+                 logical->getLeftExpr())) {
+            spine.push_back(logical);
+        }
+        auto node = make<LogicalChain>(evalLogicalChain);
+        node->first = expression(spine.back()->getLeftExpr());
+        for (auto iter = spine.rbegin(); iter != spine.rend(); ++iter) {
+            node->steps.push_back(
+                {(*iter)->getOperation().getType() == OR,
+                 expression((*iter)->getRightExpr())});
+        }
+        return node;
+    }
+
+    struct BinaryOp {
+        ExprNode::Eval eval;
+        BinaryChain::Apply apply;
+    };
+
+    template <TokenType Op> static auto binaryOp() -> BinaryOp {
+        return {evalBinary<Op>, applyBinary<Op>};
+    }
+
+    static auto binaryOp(const SourceToken &operation) -> BinaryOp {
+        switch (operation.getType()) {
+        case PLUS:
+            return binaryOp<PLUS>();
+        case MINUS:
+            return binaryOp<MINUS>();
+        case STAR:
+            return binaryOp<STAR>();
+        case SLASH:
+            return binaryOp<SLASH>();
+        case GREATER:
+            return binaryOp<GREATER>();
+        case GREATER_EQUAL:
+            return binaryOp<GREATER_EQUAL>();
+        case LESS:
+            return binaryOp<LESS>();
+        case LESS_EQUAL:
+            return binaryOp<LESS_EQUAL>();
+        case EQUAL_EQUAL:
+            return binaryOp<EQUAL_EQUAL>();
+        case BANG_EQUAL:
+            return binaryOp<BANG_EQUAL>();
+        default:
+            throw std::logic_error("ClosureCompiler: unsupported operator");
+        }
+    }
+};
+
+auto ClosureCompiler::compile(const std::vector<StmtRef> &statements)
+    -> FunctionCodeRef {
+    return NodeCompiler::body(statements);
+}
+
+} // namespace lox
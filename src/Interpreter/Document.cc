@@ -0,0 +1,403 @@
+#include "Interpreter/Document.h"
+#include "Interpreter/Parser.h"
+#include "Interpreter/Resolver.h"
+#include "Interpreter/Tokentype.h"
+
+#include <algorithm>
+#include <sstream>
+
+namespace lox {
+
+namespace {
+
+// 语法树按值保存 token（SourceToken），不随段里的 token 一起平移，
+// 要单独走一遍。段的语法树只属于这个 Document，所以可以就地修改
+class LineShifter : public ExprVisitor<LineShifter, Object>,
+                    public StmtVisitor<LineShifter> {
+  public:
+    explicit LineShifter(int delta) : m_delta(delta) {}
+
+    auto shift(const SourceToken &token) -> void {
+        const_cast<SourceToken &>(token).shiftLine(m_delta);
+    }
+    // 左结合的链在循环里走（见 leftOperand），各个 visit 不再访问左边
+    auto expr(const AbstractExpressionRef<Object> &expr) -> void {
+        for (auto *node = expr.get(); node != nullptr;) {
+            visitExpr(*node);
+            auto *left = leftOperand(*node);
+            node = left != nullptr ? left->get() : nullptr;
+        }
+    }
+    auto stmt(const StmtRef &stmt) -> void {
+        if (stmt != nullptr)
+            visitStmt(*stmt);
+    }
+
+    auto visitBinaryExpr(BinaryExpression<Object> &expr) -> void {
+        this->expr(expr.getRightExpr());
+        shift(expr.getOperation());
+    }
+    auto visitUnaryExpr(UnaryExpression<Object> &expr) -> void {
+        this->expr(expr.getRightExpr());
+        shift(expr.getOperation());
+    }
+    auto visitLiteralExpr(LiteralExpression<Object> &) -> void {}
+    auto visitGroupingExpr(GroupingExpression<Object> &expr) -> void {
+        this->expr(expr.getExpr());
+    }
+    auto visitVariableExpr(VariableExpression<Object> &expr) -> void {
+        shift(expr.getName());
+    }
+    auto visitAssignmentExpr(AssignmentExpression<Object> &expr) -> void {
+        this->expr(expr.getValue());
+        shift(expr.getName());
+    }
+    auto visitLogicalExpr(LogicalExpression<Object> &expr) -> void {
+        this->expr(expr.getRightExpr());
+        shift(expr.getOperation());
+    }
+    auto visitCallExpr(CallExpression<Object> &expr) -> void {
+        for (auto &argument : expr.getArgs())
+            this->expr(argument);
+        shift(expr.getParen());
+    }
+    auto visitGetExpr(GetExpression<Object> &expr) -> void {
+        shift(expr.getName());
+    }
+    auto visitSetExpr(SetExpression<Object> &expr) -> void {
+        this->expr(expr.getValue());
+        shift(expr.getName());
+    }
+    auto visitThisExpr(ThisExpression<Object> &expr) -> void {
+        shift(expr.getKeyword());
+    }
+    auto visitSuperExpr(SuperExpression<Object> &expr) -> void {
+        shift(expr.getKey());
+        shift(expr.getMethod());
+    }
+
+    auto visitExpressionStmt(ExpressionStmt &stmt) -> void {
+        expr(stmt.getExpr());
+    }
+    auto visitPrintStmt(PrintStmt &stmt) -> void { expr(stmt.getExpr()); }
+    auto visitVarStmt(VarStmt &stmt) -> void {
+        expr(stmt.getInitExpr());
+        shift(stmt.getName());
+    }
+    auto visitBlockStmt(BlockStmt &stmt) -> void {
+        for (auto &statement : stmt.getStmt())
+            this->stmt(statement);
+    }
+    auto visitIfStmt(IfStmt &stmt) -> void {
+        auto *branch = &stmt;
+        while (true) {
+            expr(branch->getCondition());
+            this->stmt(branch->getThen());
+            auto &next = branch->getElse();
+            if (next == nullptr || next->kind() != StmtKind::If) {
+                this->stmt(next);
+                break;
+            }
+            branch = static_cast<IfStmt *>(next.get());
+        }
+    }
+    auto visitWhileStmt(WhileStmt &stmt) -> void {
+        expr(stmt.getCondition());
+        this->stmt(stmt.getBody());
+    }
+    // Document 的 Parser 不延迟解析函数体
+    auto visitFunStmt(FunStmt &stmt) -> void {
+        shift(stmt.getName());
+        for (auto &param : stmt.getParams())
+            shift(param);
+        for (auto &statement : stmt.getBody())
+            this->stmt(statement);
+    }
+    auto visitReturnStmt(ReturnStmt &stmt) -> void {
+        expr(stmt.getValue());
+        shift(stmt.getKeyword());
+    }
+    auto visitClassStmt(ClassStmt &stmt) -> void {
+        shift(stmt.getName());
+        if (stmt.getSuper() != nullptr)
+            expr(stmt.getSuper());
+        for (auto &method : stmt.getMethods())
+            visitStmt(*method);
+    }
+    auto visitImportStmt(ImportStmt &stmt) -> void {
+        shift(stmt.getKeyword());
+        shift(stmt.getName());
+    }
+
+  private:
+    int m_delta;
+};
+
+} // namespace
+
+Document::Document(std::string source, std::string fileName)
+    : m_source(std::move(source)), m_fileName(std::move(fileName)) {
+    update(0, 0, static_cast<int>(m_source.size()));
+}
+
+auto Document::edit(std::size_t offset, std::size_t length,
+                    const std::string &text) -> void {
+    offset = std::min(offset, m_source.size());
+    length = std::min(length, m_source.size() - offset);
+    auto removed = std::count(m_source.begin() + offset,
+                              m_source.begin() + offset + length, '\n');
+    auto added = std::count(text.begin(), text.end(), '\n');
+    m_source.replace(offset, length, text);
+    auto begin = static_cast<int>(offset);
+    auto oldEnd = static_cast<int>(offset + length);
+    auto newEnd = static_cast<int>(offset + text.size());
+    auto delta = newEnd - oldEnd;
+    auto lineDelta = static_cast<int>(added - removed);
+
+    // 编辑位置所在的段，和它的前一段：前一段解析到最后时看过这一段的
+    // 第一个 token
+    auto containing = static_cast<std::size_t>(
+        std::upper_bound(m_segments.begin(), m_segments.end(), begin,
+                         [](int pos, const Segment &segment) {
+                             return pos < segment.begin;
+                         }) -
+        m_segments.begin());
+    auto first = containing <= 1 ? 0 : containing - 2;
+    // 开头在被替换的部分之后的段原样平移，其余的段都要重新扫描
+    auto kept = static_cast<std::size_t>(
+        std::lower_bound(m_segments.begin() + first, m_segments.end(), oldEnd,
+                         [](const Segment &segment, int pos) {
+                             return segment.begin < pos;
+                         }) -
+        m_segments.begin());
+    for (auto i = kept; i < m_segments.size(); i++) {
+        m_segments[i].begin += delta;
+        m_segments[i].line += lineDelta;
+        m_segments[i].shift += lineDelta;
+    }
+    // 编辑结束的那一行后面的 token 列号也变了
+    auto lineEnd = m_source.find('\n', newEnd);
+    auto minStop = lineEnd == std::string::npos
+                       ? static_cast<int>(m_source.size())
+                       : static_cast<int>(lineEnd) + 1;
+    update(first, kept, minStop);
+}
+
+auto Document::update(std::size_t first, std::size_t kept, int minStop)
+    -> void {
+    auto start = first == 0 ? 0 : m_segments[first].begin;
+    auto line = first == 0 ? 1 : m_segments[first].line;
+    // 扫描到某个保留下来的段的开头为止，它和后面的段不用重新扫描
+    auto stop = m_segments.size();
+    auto candidate = kept;
+    auto rescan = Scanner::rescan(m_source, start, line, [&](int offset) {
+        while (candidate < m_segments.size() &&
+               m_segments[candidate].begin < offset)
+            candidate++;
+        if (offset < minStop || candidate == m_segments.size() ||
+            m_segments[candidate].begin != offset)
+            return false;
+        stop = candidate;
+        return true;
+    });
+    m_rescanned = static_cast<std::size_t>(rescan.end - start);
+
+    // 交给 Parser 的 token：先是重新扫描的，再按需接上保留下来的段
+    struct Item {
+        TokenRef token;
+        int offset;
+    };
+    std::vector<Item> stream;
+    for (std::size_t i = 0; i < rescan.tokens.size(); i++) {
+        stream.push_back({std::move(rescan.tokens[i]), rescan.offsets[i]});
+    }
+    auto errors = std::move(rescan.errors);
+    if (stop == m_segments.size()) {
+        // 扫描到了末尾
+        auto end = static_cast<int>(m_source.size());
+        auto newline = m_source.rfind('\n', end == 0 ? 0 : end - 1);
+        auto lineStart = newline == std::string::npos || end == 0
+                             ? 0
+                             : static_cast<int>(newline) + 1;
+        auto lines = static_cast<int>(
+            std::count(m_source.begin() + start, m_source.end(), '\n'));
+        stream.push_back({std::make_shared<Token>(EOF_TOKEN, "", nullptr,
+                                                  line + lines,
+                                                  end - lineStart + 1),
+                          end});
+    }
+    // 拉进来的段在 stream 中开始的位置
+    std::vector<std::pair<std::size_t, std::size_t>> pulled;
+    auto next = stop;
+    std::size_t position = 0;
+    auto source = [&]() -> TokenRef {
+        if (position == stream.size() && next < m_segments.size()) {
+            auto &segment = m_segments[next];
+            settle(segment);
+            pulled.emplace_back(stream.size(), next);
+            for (std::size_t i = 0; i < segment.tokens.size(); i++) {
+                stream.push_back(
+                    {segment.tokens[i], segment.begin + segment.offsets[i]});
+            }
+            // 第一段之前的错误已经重新扫描过了
+            for (auto error : segment.scanErrors) {
+                if (error.offset < 0)
+                    continue;
+                error.offset += segment.begin;
+                errors.push_back(std::move(error));
+            }
+            next++;
+        }
+        // Parser 不会越过 EOF_TOKEN
+        auto index = std::min(position, stream.size() - 1);
+        position = index + 1;
+        return stream[index].token;
+    };
+
+    std::ostringstream ignored;
+    ErrorReporter reporter(ignored);
+    reporter.setFileName(m_fileName);
+    Parser parser(source, &reporter);
+    std::vector<Segment> segments;
+    auto resume = m_segments.size();
+    std::size_t begin = 0;
+    std::size_t pulledIndex = 0;
+    m_reparsed = 0;
+    while (true) {
+        auto token = parser.peek();
+        while (pulledIndex < pulled.size() && pulled[pulledIndex].first < begin)
+            pulledIndex++;
+        if (pulledIndex < pulled.size() && pulled[pulledIndex].first == begin) {
+            // 又回到了一个保留下来的段的开头，后面的解析结果不会变
+            resume = pulled[pulledIndex].second;
+            break;
+        }
+        Segment segment;
+        segment.begin = stream[begin].offset;
+        // 跨行的字符串记在结束的行上
+        auto lexeme = token->getLexeme();
+        segment.line = token->getLine() -
+                       static_cast<int>(
+                           std::count(lexeme.begin(), lexeme.end(), '\n'));
+        auto atEnd = token->getType() == EOF_TOKEN;
+        auto end = begin + 1;
+        if (!atEnd) {
+            auto reported = reporter.getDiagnostics().size();
+            parser.next(segment.stmt);
+            // 有语法错误的声明里可能有空的语句，不解析变量
+            if (reporter.getDiagnostics().size() == reported)
+                Resolver(reporter).resolve(segment.stmt);
+            auto &diagnostics = reporter.getDiagnostics();
+            segment.diagnostics.assign(diagnostics.begin() + reported,
+                                       diagnostics.end());
+            auto following = parser.peek();
+            while (stream[end].token != following)
+                end++;
+        }
+        for (auto i = begin; i < end; i++) {
+            segment.tokens.push_back(stream[i].token);
+            segment.offsets.push_back(stream[i].offset - segment.begin);
+        }
+        segments.push_back(std::move(segment));
+        if (atEnd)
+            break;
+        m_reparsed++;
+        begin = end;
+    }
+
+    // 扫描错误归到它所在的段；在第一段之前的归到第一段
+    auto resumeBegin = static_cast<int>(m_source.size()) + 1;
+    if (resume < m_segments.size()) {
+        auto &kept = m_segments[resume].scanErrors;
+        resumeBegin = m_segments[resume].begin;
+        kept.erase(std::remove_if(kept.begin(), kept.end(),
+                                  [](const Scanner::ChunkError &error) {
+                                      return error.offset < 0;
+                                  }),
+                   kept.end());
+    }
+    for (auto &error : errors) {
+        if (error.offset >= resumeBegin)
+            continue;
+        Segment *owner = nullptr;
+        auto iter = std::upper_bound(segments.begin(), segments.end(),
+                                     error.offset,
+                                     [](int pos, const Segment &segment) {
+                                         return pos < segment.begin;
+                                     });
+        if (iter != segments.begin())
+            owner = &*(iter - 1);
+        else if (first > 0)
+            owner = &m_segments[first - 1];
+        else if (!segments.empty())
+            owner = &segments.front();
+        else
+            owner = &m_segments[resume];
+        // 保留下来的段的错误可能在后面
+        error.offset -= owner->begin;
+        auto at = std::upper_bound(
+            owner->scanErrors.begin(), owner->scanErrors.end(), error.offset,
+            [](int offset, const Scanner::ChunkError &other) {
+                return offset < other.offset;
+            });
+        owner->scanErrors.insert(at, std::move(error));
+    }
+
+    m_segments.erase(m_segments.begin() + first, m_segments.begin() + resume);
+    m_segments.insert(m_segments.begin() + first,
+                      std::make_move_iterator(segments.begin()),
+                      std::make_move_iterator(segments.end()));
+}
+
+auto Document::settle(Segment &segment) -> void {
+    if (segment.shift == 0)
+        return;
+    for (auto &token : segment.tokens) {
+        token->shiftLine(segment.shift);
+    }
+    LineShifter(segment.shift).stmt(segment.stmt);
+    for (auto &error : segment.scanErrors) {
+        error.line += segment.shift;
+    }
+    for (auto &diagnostic : segment.diagnostics) {
+        diagnostic.line += segment.shift;
+    }
+    segment.shift = 0;
+}
+
+auto Document::getDiagnostics() const -> std::vector<Diagnostic> {
+    std::vector<Diagnostic> diagnostics;
+    for (auto &segment : m_segments) {
+        for (auto &error : segment.scanErrors) {
+            diagnostics.push_back({m_fileName, error.line + segment.shift,
+                                   error.column, error.message});
+        }
+        for (auto diagnostic : segment.diagnostics) {
+            diagnostic.line += segment.shift;
+            diagnostics.push_back(std::move(diagnostic));
+        }
+    }
+    return diagnostics;
+}
+
+auto Document::getStatements() -> std::vector<StmtRef> {
+    std::vector<StmtRef> statements;
+    for (auto &segment : m_segments) {
+        settle(segment);
+        if (segment.tokens.back()->getType() != EOF_TOKEN)
+            statements.push_back(segment.stmt);
+    }
+    return statements;
+}
+
+auto Document::getTokens() -> std::vector<TokenRef> {
+    std::vector<TokenRef> tokens;
+    for (auto &segment : m_segments) {
+        settle(segment);
+        tokens.insert(tokens.end(), segment.tokens.begin(),
+                      segment.tokens.end());
+    }
+    return tokens;
+}
+
+} // namespace lox
@@ -9,46 +9,82 @@ Environment::Environment() { m_enclosing = nullptr; }
 
 Environment::Environment(EnvironmentRef enclosing) { m_enclosing = enclosing; }
 
-auto Environment::define(std::string name, ObjectRef value) -> void {
-    m_values.insert({name, value});
+auto Environment::define(const std::string &name, ObjectRef value) -> void {
+    m_values[name] = std::move(value);
+    m_version++;
 }
 
-auto Environment::get(TokenRef name) -> ObjectRef {
-    if (m_values.find(name->getLexeme()) != m_values.end()) {
-        return m_values.at(name->getLexeme());
+auto Environment::find(const std::string &name) -> ObjectRef {
+    for (auto *env = this; env != nullptr; env = env->m_enclosing.get()) {
+        auto iter = env->m_values.find(name);
+        if (iter != env->m_values.end())
+            return iter->second;
+    }
+    return nullptr;
+}
+
+auto Environment::get(const SourceToken &name) -> ObjectRef {
+    if (m_values.find(name.getLexeme()) != m_values.end()) {
+        return m_values.at(name.getLexeme());
     }
     if (m_enclosing != nullptr)
         return m_enclosing->get(name);
-    throw RuntimeError(name, "Undefined variable '" + name->getLexeme() + "'.");
+    throw RuntimeError(name, "Undefined variable '" + name.getLexeme() + "'.");
 }
 
-auto Environment::getAt(int distance, std::string name) -> ObjectRef {
-    return ancestor(distance)->m_values[name];
+auto Environment::getAt(int distance, const std::string &name)
+    -> ObjectRef {
+    auto &values = ancestor(distance)->m_values;
+    auto iter = values.find(name);
+    return iter != values.end() ? iter->second : nullptr;
 }
 
-auto Environment::assign(TokenRef name, ObjectRef value) -> void {
-    if (m_values.find(name->getLexeme()) != m_values.end()) {
-        m_values.insert({name->getLexeme(), value});
+auto Environment::assign(const SourceToken &name, ObjectRef value) -> void {
+    auto iter = m_values.find(name.getLexeme());
+    if (iter != m_values.end()) {
+        iter->second = value;
+        m_version++;
+        return;
+    }
+    if (m_enclosing != nullptr && m_enclosing->isFrozen()) {
+        // 快照中的全局变量：确认存在后在本层遮盖它，快照本身不变
+        m_enclosing->get(name);
+        m_values[name.getLexeme()] = value;
+        m_version++;
         return;
     }
     if (m_enclosing != nullptr) {
         m_enclosing->assign(name, value);
         return;
     }
-    throw RuntimeError(name, "Undefined variable '" + name->getLexeme() + "'.");
+    throw RuntimeError(name, "Undefined variable '" + name.getLexeme() + "'.");
+}
+
+auto Environment::assignAt(int distance, const SourceToken &name,
+                           ObjectRef value) -> void {
+    auto env = ancestor(distance);
+    env->m_values[name.getLexeme()] = value;
+    env->m_version++;
+}
+
+auto Environment::clear() -> void {
+    m_values.clear();
+    m_enclosing = nullptr;
+    m_version++;
 }
 
-auto Environment::assignAt(int distance, TokenRef name, ObjectRef value)
-    -> void {
-    ancestor(distance)->m_values[name->getLexeme()] = value;
+auto Environment::copy() -> EnvironmentRef {
+    auto env = std::make_shared<Environment>(m_enclosing);
+    env->m_values = m_values;
+    return env;
 }
 
 auto Environment::ancestor(int distance) -> EnvironmentRef {
-    EnvironmentRef environment = shared_from_this();
+    auto *environment = this;
     for (int i = 0; i < distance; i++) {
-        environment = environment->getEnclosing();
+        environment = environment->m_enclosing.get();
     }
-    return environment;
+    return environment->shared_from_this();
 }
 
 } // namespace lox
@@ -0,0 +1,49 @@
+#include "Interpreter/ErrorReporter.h"
+#include "Interpreter/Tokentype.h"
+
+namespace lox {
+
+auto ErrorReporter::report(int line, int column, const std::string &where,
+                           const std::string &message) -> void {
+    m_hadError = true;
+    if (reachedMaxErrors())
+        return;
+    m_diagnostics.push_back({m_fileName, line, column, message});
+    // 有很多错误时每条都刷新输出流的开销很大；std::cerr 本来就不缓冲
+    if (!m_fileName.empty())
+        *m_err << m_fileName << ": ";
+    *m_err << "[line " << line << "] Error" << where << ": " << message
+           << '\n';
+}
+
+auto ErrorReporter::error(int line, const std::string &message, int column)
+    -> void {
+    report(line, column, "", message);
+}
+
+auto ErrorReporter::error(const SourceToken &token, const std::string &message)
+    -> void {
+    if (token.getType() == TokenType::EOF_TOKEN) {
+        report(token.getLine(), token.getColumn(), " at end", message);
+    } else {
+        report(token.getLine(), token.getColumn(),
+               " at '" + token.getLexeme() + "'", message);
+    }
+}
+
+auto ErrorReporter::runtimeError(RuntimeError &error) -> void {
+    *m_err << error.getMessage() << "\n[line " << error.getToken().getLine()
+           << "]" << std::endl;
+    m_hadRuntimeError = true;
+}
+
+auto ErrorReporter::forward(const std::string &text, const ErrorReporter &from)
+    -> void {
+    *m_err << text << std::flush;
+    m_diagnostics.insert(m_diagnostics.end(), from.m_diagnostics.begin(),
+                         from.m_diagnostics.end());
+    m_hadError = m_hadError || from.m_hadError;
+    m_hadRuntimeError = m_hadRuntimeError || from.m_hadRuntimeError;
+}
+
+} // namespace lox
@@ -1,95 +1,166 @@
 #include "Interpreter/Interpreter.h"
+#include "Interpreter/Bytecode.h"
+#include "Interpreter/ClosureCompiler.h"
 #include "Interpreter/Environment.h"
-#include "Interpreter/Lox.h"
 #include "Interpreter/LoxCallable.h"
 #include "Interpreter/LoxFunction.h"
 #include "Interpreter/LoxInstance.h"
+#include "Interpreter/LoxString.h"
 #include "Interpreter/Object.h"
-#include "Interpreter/Return.h"
+#include "Interpreter/Resolver.h"
 #include "Interpreter/RuntimeError.h"
+#include "Runtime/StackProbe.h"
 
 #include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
 #include <iostream>
 #include <memory>
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
+#include <utility>
 
 namespace lox {
 
-static Lox lox;
-Interpreter::Interpreter() {}
+Interpreter::Interpreter(std::ostream &out, ErrorReporter *reporter,
+                         EnvironmentRef base)
+    : m_out(&out),
+      m_reporter(reporter != nullptr ? reporter : &m_ownReporter) {
+    globals = std::make_shared<Environment>(base);
+    m_env = globals;
+    const char *mode = std::getenv("LOX_EXEC");
+    if (mode != nullptr && std::strcmp(mode, "closure") == 0)
+        m_mode = ExecutionMode::Closure;
+    else if (mode != nullptr && std::strcmp(mode, "bytecode") == 0)
+        m_mode = ExecutionMode::Bytecode;
+}
+
+Interpreter::~Interpreter() { clearHeap(); }
 
 /*******************************************************************/
 /*                Expression    */
 /*******************************************************************/
 
-auto Interpreter::visitLiteralExpr(LiteralExpressionRef<Object> expr)
-    -> Object {
-    return expr->getValue();
-}
-
-auto Interpreter::visitGroupingExpr(GroupingExpressionRef<Object> expr)
-    -> Object {
-    return evaluate(expr->getExpr());
-}
-
-auto Interpreter::visitUnaryExpr(UnaryExpressionRef<Object> expr) -> Object {
-    auto right = evaluate(expr->getRightExpr());
-    switch (expr->getOperation()->getType()) {
-    case MINUS:
-        return Object::make_num_obj(-stod(right.toString()));
-    case BANG:
-        return Object::make_bool_obj(!isTruthy(right));
-    default:
-        return Object::make_nil_obj();
+// 沿着最先求值的子表达式一路向下：其余的子表达式以及拿到子表达式的值
+// 之后要做的事按相反的顺序压进任务栈，叶子的值直接压进值栈
+auto Interpreter::evaluate(const AbstractExpression<Object> *expr) -> void {
+    using Op = Task::Op;
+    for (;;) {
+        switch (expr->kind()) {
+        case ExprKind::Literal:
+            m_values.push_back(
+                static_cast<const LiteralExpression<Object> *>(expr)
+                    ->getValue());
+            return;
+        case ExprKind::Grouping:
+            expr = static_cast<const GroupingExpression<Object> *>(expr)
+                       ->getExpr()
+                       .get();
+            continue;
+        case ExprKind::Unary:
+            push(Op::Unary, expr);
+            expr = static_cast<const UnaryExpression<Object> *>(expr)
+                       ->getRightExpr()
+                       .get();
+            continue;
+        case ExprKind::Binary: {
+            auto *binary = static_cast<const BinaryExpression<Object> *>(expr);
+            push(Op::Binary, binary);
+            push(Op::Evaluate, binary->getRightExpr().get());
+            expr = binary->getLeftExpr().get();
+            continue;
+        }
+        case ExprKind::Variable: {
+            auto *variable =
+                static_cast<const VariableExpression<Object> *>(expr);
+            m_values.push_back(lookUpVariable(variable->getName(), *variable));
+            return;
+        }
+        case ExprKind::This:
+            m_values.push_back(lookUpVariable(
+                static_cast<const ThisExpression<Object> *>(expr)->getKeyword(),
+                *expr));
+            return;
+        case ExprKind::Assignment:
+            push(Op::Assign, expr);
+            expr = static_cast<const AssignmentExpression<Object> *>(expr)
+                       ->getValue()
+                       .get();
+            continue;
+        case ExprKind::Logical:
+            push(Op::Logical, expr);
+            expr = static_cast<const LogicalExpression<Object> *>(expr)
+                       ->getLeftExpr()
+                       .get();
+            continue;
+        case ExprKind::Call: {
+            auto *call = static_cast<const CallExpression<Object> *>(expr);
+            push(Op::Call, call);
+            const auto &args = call->getArgs();
+            for (auto arg = args.rbegin(); arg != args.rend(); ++arg) {
+                push(Op::Evaluate, arg->get());
+            }
+            expr = call->getCallee().get();
+            continue;
+        }
+        case ExprKind::Get:
+            push(Op::Get, expr);
+            expr = static_cast<const GetExpression<Object> *>(expr)
+                       ->getObject()
+                       .get();
+            continue;
+        case ExprKind::Set:
+            push(Op::SetObject, expr);
+            expr = static_cast<const SetExpression<Object> *>(expr)
+                       ->getObject()
+                       .get();
+            continue;
+        case ExprKind::Super:
+            m_values.push_back(superMethod(
+                *static_cast<const SuperExpression<Object> *>(expr)));
+            return;
+        }
     }
 }
 
-auto Interpreter::visitBinaryExpr(BinaryExpressionRef<Object> expr) -> Object {
-    auto left = evaluate(expr->getLeftExpr());
-    auto right = evaluate(expr->getRightExpr());
-    auto opt = expr->getOperation();
-    bool result_bool = false;
-    std::string result_str = "";
-    double result_num = 0;
-    switch (expr->getOperation()->getType()) {
+auto Interpreter::binary(const BinaryExpression<Object> &expr,
+                         const Object &left, const Object &right) -> Object {
+    const auto &opt = expr.getOperation();
+    switch (opt.getType()) {
     case GREATER:
         checkNumberOperands(opt, left, right);
-        result_bool = left.getNum() > right.getNum();
-        return Object::make_bool_obj(result_bool);
+        return Object::make_bool_obj(left.getNum() > right.getNum());
     case GREATER_EQUAL:
         checkNumberOperands(opt, left, right);
-        result_bool = left.getNum() >= right.getNum();
-        return Object::make_bool_obj(result_bool);
+        return Object::make_bool_obj(left.getNum() >= right.getNum());
     case LESS:
         checkNumberOperands(opt, left, right);
-        result_bool = left.getNum() < right.getNum();
-        return Object::make_bool_obj(result_bool);
+        return Object::make_bool_obj(left.getNum() < right.getNum());
     case LESS_EQUAL:
         checkNumberOperands(opt, left, right);
-        result_bool = left.getNum() <= right.getNum();
-        return Object::make_bool_obj(result_bool);
+        return Object::make_bool_obj(left.getNum() <= right.getNum());
     case MINUS:
         checkNumberOperands(opt, left, right);
-        result_num = left.getNum() - right.getNum();
-        return Object::make_num_obj(result_num);
+        return Object::make_num_obj(left.getNum() - right.getNum());
     case PLUS:
         if (left.getType() == Object::Object_num &&
             right.getType() == Object::Object_num) {
             return Object::make_num_obj(left.getNum() + right.getNum());
         } else if (left.getType() == Object::Object_str &&
                    right.getType() == Object::Object_str) {
-            return Object::make_str_obj(left.getStr() + right.getStr());
+            return Object::make_str_obj(
+                LoxString::concat(left.getString(), right.getString()));
         }
         throw RuntimeError(opt, "Operands must be two numbers or two strings.");
     case SLASH:
         checkNumberOperands(opt, left, right);
-        result_num = left.getNum() / right.getNum();
-        return Object::make_num_obj(result_num);
+        return Object::make_num_obj(left.getNum() / right.getNum());
     case STAR:
         checkNumberOperands(opt, left, right);
-        result_num = left.getNum() * right.getNum();
-        return Object::make_num_obj(result_num);
+        return Object::make_num_obj(left.getNum() * right.getNum());
     case BANG_EQUAL:
         return Object::make_bool_obj(!isEqual(left, right));
     case EQUAL_EQUAL:
@@ -97,252 +168,586 @@ auto Interpreter::visitBinaryExpr(BinaryExpressionRef<Object> expr) -> Object {
     default:
         return Object::make_nil_obj();
     }
-    return Object::make_nil_obj();
 }
 
-auto Interpreter::visitVariableExpr(VariableExpressionRef<Object> expr)
-    -> Object {
-    // return *m_env->get(expr->getName()).get();
-    return lookUpVariable(expr->getName(), expr);
-}
-
-auto Interpreter::visitAssignmentExpr(AssignmentExpressionRef<Object> expr)
-    -> Object {
-    auto value = evaluate(expr->getValue());
-    auto valueRef = std::make_shared<Object>(value);
-
-    auto iter = m_locals.find(expr);
-    if (iter != m_locals.end()) {
-        m_env->assignAt(iter->second, expr->getName(), valueRef);
+// 检查 callee 可以用 argc 个参数调用
+static auto checkCallable(Object &callee, std::size_t argc,
+                          const SourceToken &paren) -> LoxCallableRef {
+    //  检查callee是否是LoxCallable类的对象
+    LoxCallableRef function;
+    if (callee.getType() == Object::Object_fun) {
+        function = callee.getFun();
+    } else if (callee.getType() == Object::Object_class) {
+        function = callee.getClass();
     } else {
-        globals->assign(expr->getName(), valueRef);
+        throw RuntimeError(paren, "Can only call functions and classes.");
     }
-    return value;
-}
 
-auto Interpreter::visitLogicalExpr(LogicalExpressionRef<Object> expr)
-    -> Object {
-    auto left = evaluate(expr->getLeftExpr());
-    if (expr->getOperation()->getType() == OR) {
-        if (isTruthy(left))
-            return left;
-    } else {
-        if (!isTruthy(left))
-            return left;
+    if (argc != (size_t)function->arity()) {
+        throw RuntimeError(paren, "Expected " +
+                                      std::to_string(function->arity()) +
+                                      " arguments but got " +
+                                      std::to_string(argc) + ".");
     }
-    return evaluate(expr->getRightExpr());
+    return function;
 }
 
-auto Interpreter::visitCallExpr(CallExpressionRef<Object> expr) -> Object {
-    auto callee = evaluate(expr->getCallee());
-    std::vector<ObjectRef> arguments;
-    for (auto arg : expr->getArgs()) {
-        arguments.push_back(std::make_shared<Object>(evaluate(arg)));
-    }
-    //  检查callee是否是LoxCallable类的对象
-    if (callee.getType() != Object::Object_fun) {
-        throw RuntimeError(expr->getParen(),
-                           "Can only call functions and classes.");
-    }
-
-    LoxCallableRef function;
+auto Interpreter::callValue(Object callee, std::vector<ObjectRef> arguments,
+                            const SourceToken &paren) -> Object {
+    auto function = checkCallable(callee, arguments.size(), paren);
+    return call(function, std::move(arguments), paren);
+}
 
-    if (arguments.size() != (size_t)function->arity()) {
-        throw RuntimeError(expr->getParen(),
-                           "Expected " + std::to_string(function->arity()) +
-                               " arguments but got " +
-                               std::to_string(arguments.size()) + ".");
+auto Interpreter::call(const LoxCallableRef &function,
+                       std::vector<ObjectRef> arguments,
+                       const SourceToken &paren) -> Object {
+    enterCall(paren);
+    try {
+        auto result = *function->call(shared_from_this(), std::move(arguments));
+        leaveCall();
+        return result;
+    } catch (...) {
+        leaveCall();
+        throw;
     }
-    return *function->call(shared_from_this(), arguments).get();
 }
 
-auto Interpreter::visitGetExpr(GetExpressionRef<Object> expr) -> Object {
-    auto obj = evaluate(expr->getObject());
-    if (obj.getType() == Object::Object_instance) {
-        auto name = expr->getName();
-        return *((obj.getInstance())->get(expr->getName())).get();
-        // return res;
+// 被调用者是按 AST 执行的 Lox 函数时压入调用帧（尾调用时替换当前帧），
+// 在同一个循环里接着执行函数体；其余的可调用对象就地完成调用
+auto Interpreter::invoke(const CallExpression<Object> &expr,
+                         std::size_t frames) -> void {
+    auto argc = expr.getArgs().size();
+    auto *callee = m_values.data() + m_values.size() - argc - 1;
+    const auto &paren = expr.getParen();
+    auto callable = checkCallable(*callee, argc, paren);
+    auto function = std::dynamic_pointer_cast<LoxFunction>(callable);
+    // 这次 execute 里没有调用帧时，尾调用只能交给外面的 LoxFunction::call
+    bool tail = expr.isTailCall() && m_frames.size() > frames;
+    if (function == nullptr || function->getCode() != nullptr ||
+        (expr.isTailCall() && !tail)) {
+        std::vector<ObjectRef> arguments;
+        arguments.reserve(argc);
+        for (auto *arg = callee + 1; arg != callee + 1 + argc; arg++) {
+            arguments.push_back(std::make_shared<Object>(std::move(*arg)));
+        }
+        auto target = std::move(*callee);
+        m_values.resize(m_values.size() - argc - 1);
+        auto result =
+            expr.isTailCall() && !tail
+                ? tailCall(std::move(target), std::move(arguments), paren)
+                : call(callable, std::move(arguments), paren);
+        m_values.push_back(std::move(result));
+        return;
+    }
+
+    // 延迟解析的函数体在这里第一次解析，出错时还没有进入调用
+    const auto &body = function->getDeclaration()->getBody();
+    if (!tail)
+        enterCall(paren);
+    double number;
+    if (!function->isInitializer() &&
+        m_jit.tryCall(*function, callee + 1, argc, number)) {
+        m_values.resize(m_values.size() - argc - 1);
+        if (tail) {
+            leave(Object::make_num_obj(number));
+        } else {
+            leaveCall();
+            m_values.push_back(Object::make_num_obj(number));
+        }
+        return;
     }
 
-    throw RuntimeError(expr->getName(), "Only instances have properties.");
+    auto env = std::make_shared<Environment>(function->getClosure());
+    const auto &params = function->getDeclaration()->getParams();
+    for (std::size_t i = 0; i < argc; i++) {
+        env->define(params[i].getLexeme(),
+                    std::make_shared<Object>(std::move(callee[1 + i])));
+    }
+    m_values.resize(m_values.size() - argc - 1);
+    if (tail) {
+        // 丢掉当前函数剩下的步骤，调用深度不变
+        auto &frame = m_frames.back();
+        m_tasks.resize(frame.tasks);
+        m_values.resize(frame.values);
+        m_envs.resize(frame.envs);
+        frame.function = std::move(function);
+    } else {
+        m_frames.push_back(Frame{std::move(function), std::move(m_env),
+                                 m_tasks.size(), m_values.size(),
+                                 m_envs.size()});
+    }
+    m_env = std::move(env);
+    push(Task::Op::Leave, nullptr);
+    push(Task::Op::Sequence, &body);
+}
+
+auto Interpreter::leave(Object value) -> void {
+    auto &frame = m_frames.back();
+    if (frame.function->isInitializer())
+        value = *frame.function->getClosure()->getAt(0, "this");
+    m_tasks.resize(frame.tasks);
+    m_values.resize(frame.values);
+    m_envs.resize(frame.envs);
+    m_env = std::move(frame.env);
+    m_frames.pop_back();
+    leaveCall();
+    m_values.push_back(std::move(value));
+}
+
+auto Interpreter::enterCall(const SourceToken &paren) -> void {
+    if (m_callDepth >= m_maxCallDepth || stackExhausted())
+        throw RuntimeError(paren, "Stack overflow.");
+    m_callDepth++;
+}
+
+auto Interpreter::tailCall(Object callee, std::vector<ObjectRef> arguments,
+                           const SourceToken &paren) -> Object {
+    auto callable = checkCallable(callee, arguments.size(), paren);
+    auto function = std::dynamic_pointer_cast<LoxFunction>(callable);
+    if (function == nullptr)
+        return call(callable, std::move(arguments), paren);
+    m_tailFunction = std::move(function);
+    m_tailArguments = std::move(arguments);
+    return Object::make_nil_obj();
 }
 
-auto Interpreter::visitSetExpr(SetExpressionRef<Object> expr) -> Object {
-    auto object = evaluate(expr->getObject());
+auto Interpreter::takeTailCall(LoxFunctionRef &function,
+                               std::vector<ObjectRef> &arguments) -> bool {
+    if (m_tailFunction == nullptr)
+        return false;
+    function = std::move(m_tailFunction);
+    arguments = std::move(m_tailArguments);
+    m_tailFunction = nullptr;
+    return true;
+}
 
-    if (!(object.getType() != Object::Object_instance)) {
-        throw RuntimeError(expr->getName(), "Only instances have fields.");
+auto Interpreter::getProperty(Object obj, const SourceToken &name) -> Object {
+    if (obj.getType() == Object::Object_instance) {
+        auto instance = obj.getInstance();
+        if (instance->isFrozen()) {
+            auto field = localCopy(instance, false)->findField(name.getLexeme());
+            if (field != nullptr)
+                return *field;
+        }
+        // 方法总是绑定到原对象上，保持 this 的同一性
+        return *instance->get(name);
     }
-    auto value = evaluate(expr->getValue());
-    auto value_obj = std::make_shared<Object>(value);
-    object.getInstance()->set(expr->getName(), value_obj);
-    return value;
-}
 
-auto Interpreter::evaluate(AbstractExpressionRef<Object> expr) -> Object {
-    return expr->accept(shared_from_this());
+    throw RuntimeError(name, "Only instances have properties.");
 }
 
-auto Interpreter::lookUpVariable(TokenRef name,
-                                 AbstractExpressionRef<Object> expr) -> Object {
-    auto iter = m_locals.find(expr);
-    if (iter != m_locals.end()) {
-        return *m_env->getAt(iter->second, name->getLexeme()).get();
+auto Interpreter::lookUpVariable(const SourceToken &name,
+                                 const AbstractExpression<Object> &expr)
+    -> Object {
+    auto depth = expr.getDepth();
+    if (depth >= 0) {
+        return *localCopy(m_env->ancestor(depth), false)
+                    ->getAt(0, name.getLexeme());
     } else {
         return *globals->get(name).get();
     }
 }
 
-auto Interpreter::visitThisExpr(ThisExpressionRef<Object> expr) -> Object {
-    return lookUpVariable(expr->getKeyword(), expr);
-}
-
-auto Interpreter::visitSuperExpr(SuperExpressionRef<Object> expr) -> Object {
-    auto distance = m_locals.at(expr);
+auto Interpreter::superMethod(const SuperExpression<Object> &expr) -> Object {
+    auto distance = expr.getDepth();
     auto superclass_obj = m_env->getAt(distance, "super");
     auto superclass = superclass_obj->getClass();
 
     auto instance_obj = m_env->getAt(distance - 1, "this");
     auto instance = instance_obj->getInstance();
 
-    auto method_obj = superclass->findMethod(expr->getMethod()->getLexeme());
+    auto method_obj = superclass->findMethod(expr.getMethod().getLexeme());
 
     if (method_obj == nullptr) {
-        throw RuntimeError(expr->getMethod(),
+        throw RuntimeError(expr.getMethod(),
                            "Undefined property '" +
-                               expr->getMethod()->getLexeme() + "'.");
+                               expr.getMethod().getLexeme() + "'.");
     }
 
     auto res = method_obj->bind(instance);
-    return Object::make_fun_obj(method_obj);
+    return Object::make_fun_obj(res);
 }
 
 /*******************************************************************/
 /*         Statements      */
 /*******************************************************************/
 
-auto Interpreter::visitExpressionStmt(ExpressionStmtRef stmt) -> void {
-    evaluate(stmt->getExpr());
-    return;
-}
-
-auto Interpreter::visitPrintStmt(PrintStmtRef stmt) -> void {
-    Object value = evaluate(stmt->getExpr());
-    std::cout << stringify(value) << std::endl;
-    return;
-}
-
-auto Interpreter::visitVarStmt(VarStmtRef stmt) -> void {
-    ObjectRef value = nullptr;
-    if (stmt->getInitExpr() != nullptr) {
-        value = std::make_shared<Object>(evaluate(stmt->getInitExpr()));
+auto Interpreter::execute(const StmtRef &stmt) -> void {
+    using Op = Task::Op;
+    switch (stmt->kind()) {
+    case StmtKind::Expression:
+        push(Op::Pop, nullptr);
+        evaluate(static_cast<const ExpressionStmt &>(*stmt).getExpr().get());
+        return;
+    case StmtKind::Print:
+        push(Op::Print, nullptr);
+        evaluate(static_cast<const PrintStmt &>(*stmt).getExpr().get());
+        return;
+    case StmtKind::Var: {
+        const auto &var = static_cast<const VarStmt &>(*stmt);
+        if (var.getInitExpr() == nullptr) {
+            m_env->define(var.getName().getLexeme(),
+                          std::make_shared<Object>(Object::make_nil_obj()));
+            return;
+        }
+        push(Op::Define, &var);
+        evaluate(var.getInitExpr().get());
+        return;
     }
-    m_env->define(stmt->getName()->getLexeme(), value);
-    return;
-}
-
-auto Interpreter::visitBlockStmt(BlockStmtRef stmt) -> void {
-    auto new_env = std::make_shared<Environment>(getEnvironment());
-    executeBlock(stmt->getStmt(), new_env);
-    return;
-}
-
-auto Interpreter::visitIfStmt(IfStmtRef stmt) -> void {
-    if (isTruthy(evaluate(stmt->getCondition()))) {
-        execute(stmt->getThen());
-    } else if (stmt->getElse() != nullptr) {
-        execute(stmt->getElse());
+    case StmtKind::Block:
+        m_envs.push_back(m_env);
+        m_env = std::make_shared<Environment>(m_env);
+        push(Op::RestoreEnv, nullptr);
+        push(Op::Sequence, &static_cast<const BlockStmt &>(*stmt).getStmt());
+        return;
+    case StmtKind::If:
+        push(Op::If, stmt.get());
+        evaluate(static_cast<const IfStmt &>(*stmt).getCondition().get());
+        return;
+    case StmtKind::While:
+        push(Op::While, stmt.get());
+        evaluate(static_cast<const WhileStmt &>(*stmt).getCondition().get());
+        return;
+    case StmtKind::Fun: {
+        auto declaration = std::static_pointer_cast<FunStmt>(stmt);
+        auto name = declaration->getName().getLexeme();
+        auto function =
+            std::make_shared<LoxFunction>(std::move(declaration), m_env, false);
+        m_env->define(name, std::make_shared<Object>(Object::make_fun_obj(
+                                std::move(function))));
+        return;
+    }
+    case StmtKind::Return: {
+        const auto &value = static_cast<const ReturnStmt &>(*stmt).getValue();
+        push(Op::Return, nullptr);
+        if (value != nullptr) {
+            evaluate(value.get());
+        } else {
+            m_values.push_back(Object::make_nil_obj());
+        }
+        return;
+    }
+    case StmtKind::Class: {
+        const auto &klass = static_cast<const ClassStmt &>(*stmt);
+        push(Op::Class, &klass);
+        if (klass.getSuper() != nullptr) {
+            evaluate(klass.getSuper().get());
+        } else {
+            m_values.emplace_back();
+        }
+        return;
+    }
+    case StmtKind::Import: {
+        const auto &import = static_cast<const ImportStmt &>(*stmt);
+        m_env->define(import.getName().getLexeme(),
+                      std::make_shared<Object>(importModule(import)));
+        return;
     }
-    return;
-}
-
-auto Interpreter::visitWhileStmt(WhileStmtRef stmt) -> void {
-    if (isTruthy(evaluate(stmt->getCondition()))) {
-        execute(stmt->getBody());
     }
-    return;
 }
 
-auto Interpreter::visitFunStmt(FunStmtRef stmt) -> void {
-    auto function = std::make_shared<LoxFunction>(stmt, m_env, false);
-    auto fun_obj =
-        Object::make_fun_obj(std::dynamic_pointer_cast<LoxCallable>(function));
-    auto fun_obj_ref = std::make_shared<Object>(fun_obj);
-    m_env->define(stmt->getName()->getLexeme(), fun_obj_ref);
-    return;
+auto Interpreter::execute(const std::vector<StmtRef> &statements,
+                          EnvironmentRef env, Object &result) -> bool {
+    using Op = Task::Op;
+    // 外层 execute 的任务、值、环境和调用帧在这些位置之下，不去动它们
+    auto tasks = m_tasks.size();
+    auto values = m_values.size();
+    auto envs = m_envs.size();
+    auto frames = m_frames.size();
+    auto caller = std::exchange(m_env, std::move(env));
+    auto finish = [&] {
+        m_tasks.resize(tasks);
+        m_values.resize(values);
+        m_envs.resize(envs);
+        m_env = std::move(caller);
+    };
+    try {
+        push(Op::Sequence, &statements);
+        while (m_tasks.size() > tasks) {
+            auto task = m_tasks.back();
+            m_tasks.pop_back();
+            switch (task.op) {
+            case Op::Evaluate:
+                evaluate(
+                    static_cast<const AbstractExpression<Object> *>(task.node));
+                break;
+            case Op::Sequence: {
+                const auto &sequence =
+                    *static_cast<const std::vector<StmtRef> *>(task.node);
+                if (task.index < sequence.size()) {
+                    push(Op::Sequence, &sequence, task.index + 1);
+                    execute(sequence[task.index]);
+                }
+                break;
+            }
+            case Op::RestoreEnv:
+                m_env = std::move(m_envs.back());
+                m_envs.pop_back();
+                break;
+            case Op::Leave:
+                leave(Object::make_nil_obj());
+                break;
+            case Op::Pop:
+                m_values.pop_back();
+                break;
+            case Op::Print:
+                print(pop());
+                break;
+            case Op::Define:
+                m_env->define(
+                    static_cast<const VarStmt *>(task.node)
+                        ->getName()
+                        .getLexeme(),
+                    std::make_shared<Object>(pop()));
+                break;
+            case Op::If: {
+                const auto &branch = *static_cast<const IfStmt *>(task.node);
+                if (isTruthy(pop())) {
+                    execute(branch.getThen());
+                } else if (branch.getElse() != nullptr) {
+                    execute(branch.getElse());
+                }
+                break;
+            }
+            case Op::While: {
+                const auto &loop = *static_cast<const WhileStmt *>(task.node);
+                if (isTruthy(pop())) {
+                    push(Op::While, &loop);
+                    push(Op::Evaluate, loop.getCondition().get());
+                    execute(loop.getBody());
+                }
+                break;
+            }
+            case Op::Return:
+                if (m_frames.size() > frames) {
+                    leave(pop());
+                    break;
+                }
+                result = pop();
+                finish();
+                return true;
+            case Op::Class: {
+                const auto &klass = *static_cast<const ClassStmt *>(task.node);
+                ObjectRef superclass = nullptr;
+                SourceToken superName;
+                auto value = pop();
+                if (klass.getSuper() != nullptr) {
+                    superclass = std::make_shared<Object>(std::move(value));
+                    superName = klass.getSuper()->getName();
+                }
+                std::vector<std::pair<FunStmtRef, FunctionCodeRef>> methods;
+                for (auto &method : klass.getMethods()) {
+                    methods.emplace_back(method, nullptr);
+                }
+                defineClass(m_env, klass.getName(), superclass, superName,
+                            methods);
+                break;
+            }
+            case Op::Unary: {
+                const auto &unary =
+                    *static_cast<const UnaryExpression<Object> *>(task.node);
+                auto &right = m_values.back();
+                if (unary.getOperation().getType() == MINUS) {
+                    checkNumberOperand(unary.getOperation(), right);
+                    right = Object::make_num_obj(-right.getNum());
+                } else {
+                    right = Object::make_bool_obj(!isTruthy(right));
+                }
+                break;
+            }
+            case Op::Binary: {
+                auto right = pop();
+                auto &left = m_values.back();
+                left = binary(
+                    *static_cast<const BinaryExpression<Object> *>(task.node),
+                    left, right);
+                break;
+            }
+            case Op::Logical: {
+                const auto &logical =
+                    *static_cast<const LogicalExpression<Object> *>(task.node);
+                // 左边的值已经决定结果时留在值栈上，否则换成右边的值
+                if (isTruthy(m_values.back()) ==
+                    (logical.getOperation().getType() == OR))
+                    break;
+                m_values.pop_back();
+                evaluate(logical.getRightExpr().get());
+                break;
+            }
+            case Op::Assign: {
+                const auto &assign =
+                    *static_cast<const AssignmentExpression<Object> *>(
+                        task.node);
+                auto valueRef = std::make_shared<Object>(m_values.back());
+                auto depth = assign.getDepth();
+                if (depth >= 0) {
+                    localCopy(m_env->ancestor(depth), true)
+                        ->assignAt(0, assign.getName(), valueRef);
+                } else {
+                    globals->assign(assign.getName(), valueRef);
+                }
+                break;
+            }
+            case Op::Call:
+                invoke(*static_cast<const CallExpression<Object> *>(task.node),
+                       frames);
+                break;
+            case Op::Get:
+                m_values.back() = getProperty(
+                    std::move(m_values.back()),
+                    static_cast<const GetExpression<Object> *>(task.node)
+                        ->getName());
+                break;
+            case Op::SetObject: {
+                const auto &set =
+                    *static_cast<const SetExpression<Object> *>(task.node);
+                if (m_values.back().getType() != Object::Object_instance)
+                    throw RuntimeError(set.getName(),
+                                       "Only instances have fields.");
+                push(Op::Set, &set);
+                evaluate(set.getValue().get());
+                break;
+            }
+            case Op::Set: {
+                auto value = pop();
+                localCopy(m_values.back().getInstance(), true)
+                    ->set(static_cast<const SetExpression<Object> *>(task.node)
+                              ->getName(),
+                          std::make_shared<Object>(value));
+                m_values.back() = std::move(value);
+                break;
+            }
+            }
+        }
+    } catch (...) {
+        while (m_frames.size() > frames) {
+            m_frames.pop_back();
+            leaveCall();
+        }
+        finish();
+        throw;
+    }
+    finish();
+    return false;
 }
 
-auto Interpreter::visitReturnStmt(ReturnStmtRef stmt) -> void {
-    Object value;
-    if (stmt->getValue() == nullptr) {
-        value = evaluate(stmt->getValue());
+auto Interpreter::print(Object value) -> void {
+    if (value.getType() == Object::Object_num) {
+        // 数字直接格式化到栈上的缓冲区，不经过 std::string
+        char buf[Object::kNumberBufferSize];
+        auto len = Object::formatNumber(value.getNum(), buf);
+        buf[len] = '\n';
+        m_out->write(buf, len + 1);
+        return;
+    }
+    if (value.getType() == Object::Object_str) {
+        auto text = value.getString()->view();
+        m_out->write(text.data(), text.size()) << '\n';
+        return;
     }
-    throw ReturnError(value);
+    *m_out << stringify(value) << '\n';
 }
 
-auto Interpreter::visitClassStmt(ClassStmtRef stmt) -> void {
-    ObjectRef superclass_obj = nullptr;
+auto Interpreter::importModule(const ImportStmt &stmt) -> Object {
+    // 执行过的 import 语句直接返回上次的结果，不再规范化路径（要访问文件系统）
+    auto site = m_importSites.find(&stmt);
+    if (site != m_importSites.end())
+        return *site->second.second;
 
-    if (stmt->getSuper() != nullptr) {
-        superclass_obj = std::make_shared<Object>(evaluate(stmt->getSuper()));
-        if (superclass_obj->getType() != Object::Object_class) {
-            throw RuntimeError(stmt->getSuper()->getName(),
-                               "Superclass must be a class.");
+    std::filesystem::path path = stmt.getPath();
+    if (path.is_relative()) {
+        path = m_moduleRoot.empty() ? std::filesystem::current_path() / path
+                                    : std::filesystem::path(m_moduleRoot) / path;
+    }
+    // 同一个文件经由不同的相对路径或符号链接导入时也只执行一次
+    std::error_code error;
+    auto canonical = std::filesystem::weakly_canonical(path, error);
+    auto key = error ? path.lexically_normal().string() : canonical.string();
+
+    auto iter = m_modules.find(key);
+    if (iter != m_modules.end()) {
+        if (iter->second.object == nullptr) {
+            throw RuntimeError(stmt.getKeyword(),
+                               "Circular import of module '" + key + "'.");
         }
+        m_importSites[&stmt] = {stmt.shared_from_this(), iter->second.object};
+        return *iter->second.object;
     }
-
-    m_env->define(stmt->getName()->getLexeme(), nullptr);
-
-    if (stmt->getSuper() != nullptr) {
-        m_env = std::make_shared<Environment>(m_env);
-        m_env->define(stmt->getName()->getLexeme(), nullptr);
+    std::string errors;
+    auto program = m_moduleCache->load(key, errors);
+    if (program == nullptr)
+        throw RuntimeError(stmt.getKeyword(), errors);
+
+    m_modules[key] = {program, nullptr};
+    auto env = std::make_shared<Environment>(globals);
+    // 顶层名字在模块开始执行时就已存在（见 Resolver::resolveModule），
+    // 执行到它们的声明之前值为 nil
+    for (auto &statement : program->getStatements()) {
+        if (auto name = Resolver::declaredName(statement))
+            env->define(name->getLexeme(), std::make_shared<Object>());
     }
-
-    std::unordered_map<std::string, LoxFunctionRef> methods;
-    for (auto &method : stmt->getMethods()) {
-        bool tmp = (method->getName()->getLexeme() == "init");
-        auto fun = std::make_shared<LoxFunction>(method, m_env, tmp);
-        methods.insert({method->getName()->getLexeme(), fun});
+    try {
+        executeModule(program->getStatements(), env);
+    } catch (...) {
+        m_modules.erase(key);
+        throw;
     }
-
     auto klass = std::make_shared<LoxClass>(
-        stmt->getName()->getLexeme(), superclass_obj->getClass(), methods);
-    auto klass_obj = Object::make_class_obj(klass);
-    auto klass_obj_ref = std::make_shared<Object>(klass_obj);
-
-    if (superclass_obj != nullptr) {
-        m_env = m_env->getEnclosing();
+        std::filesystem::path(key).stem().string(), nullptr,
+        std::unordered_map<std::string, LoxFunctionRef>{});
+    auto module = std::make_shared<LoxInstance>(klass, env);
+    auto object =
+        std::make_shared<Object>(Object::make_instance_obj(std::move(module)));
+    m_modules[key].object = object;
+    m_importSites[&stmt] = {stmt.shared_from_this(), object};
+    return *object;
+}
+
+auto Interpreter::executeModule(const std::vector<StmtRef> &statements,
+                                const EnvironmentRef &env) -> void {
+    Object result;
+    if (m_mode == ExecutionMode::Closure) {
+        ClosureCompiler::compile(statements)->run(*this, env, result);
+    } else if (m_mode == ExecutionMode::Bytecode) {
+        BytecodeCompiler::compile(statements, m_vm.superinstructions())
+            ->run(*this, env, result);
+    } else {
+        execute(statements, env, result);
     }
-
-    m_env->assign(stmt->getName(), klass_obj_ref);
-    return;
 }
 
-auto Interpreter::evaluate(StmtRef stmt) -> void {
-    stmt->accept(shared_from_this());
-}
+auto Interpreter::defineClass(
+    const EnvironmentRef &env, const SourceToken &name,
+    ObjectRef superclass_obj, const SourceToken &superName,
+    const std::vector<std::pair<FunStmtRef, FunctionCodeRef>> &methods)
+    -> void {
+    if (superclass_obj != nullptr &&
+        superclass_obj->getType() != Object::Object_class) {
+        throw RuntimeError(superName, "Superclass must be a class.");
+    }
 
-/*******************************************************************/
-/*         */
-/*******************************************************************/
+    env->define(name.getLexeme(), nullptr);
 
-auto Interpreter::execute(StmtRef stmt) -> void {
-    stmt->accept(shared_from_this());
-}
+    auto method_env = env;
+    if (superclass_obj != nullptr) {
+        method_env = std::make_shared<Environment>(env);
+        method_env->define("super", superclass_obj);
+    }
 
-auto Interpreter::executeBlock(std::vector<StmtRef> statements,
-                               EnvironmentRef env) -> void {
-    auto prev_env = getEnvironment();
-    m_env = env;
-    for (auto stmt : statements) {
-        execute(stmt);
-        m_env = prev_env;
+    std::unordered_map<std::string, LoxFunctionRef> functions;
+    for (auto &[method, code] : methods) {
+        auto method_name = method->getName().getLexeme();
+        auto fun = std::make_shared<LoxFunction>(method, method_env,
+                                                 method_name == "init", code);
+        functions.insert({method_name, fun});
     }
-}
 
-auto Interpreter::resolve(AbstractExpressionRef<Object> expr, int depth)
-    -> void {
-    m_locals.insert({expr, depth});
+    LoxClassRef superclass =
+        superclass_obj != nullptr ? superclass_obj->getClass() : nullptr;
+    auto klass =
+        std::make_shared<LoxClass>(name.getLexeme(), superclass, functions);
+    auto klass_obj = Object::make_class_obj(klass);
+    env->assign(name, std::make_shared<Object>(klass_obj));
 }
 
 /*******************************************************************/
@@ -373,7 +778,13 @@ auto Interpreter::isEqual(Object a, Object b) -> bool {
         case Object::Object_num:
             return a.getNum() == b.getNum();
         case Object::Object_str:
-            return a.getStr() == b.getStr();
+            return a.getString()->equals(*b.getString());
+        case Object::Object_fun:
+            return a.getFun() == b.getFun();
+        case Object::Object_class:
+            return a.getClass() == b.getClass();
+        case Object::Object_instance:
+            return a.getInstance() == b.getInstance();
         default:
             return false;
         }
@@ -381,13 +792,13 @@ auto Interpreter::isEqual(Object a, Object b) -> bool {
     return false;
 }
 
-auto Interpreter::checkNumberOperand(TokenRef operation, Object operand)
-    -> void {
+auto Interpreter::checkNumberOperand(const SourceToken &operation,
+                                     Object operand) -> void {
     if (operand.getType() == Object::Object_num)
         return;
     throw RuntimeError(operation, "Operand must be a number.");
 }
-auto Interpreter::checkNumberOperands(TokenRef operation, Object left,
+auto Interpreter::checkNumberOperands(const SourceToken &operation, Object left,
                                       Object right) -> void {
     if (left.getType() == Object::Object_num &&
         right.getType() == Object::Object_num)
@@ -397,33 +808,175 @@ auto Interpreter::checkNumberOperands(TokenRef operation, Object left,
 
 auto Interpreter::interpret(std::vector<StmtRef> statements) -> void {
     try {
-        for (auto statement : statements) {
-            execute(statement);
+        if (m_mode == ExecutionMode::Closure) {
+            // 每次运行编译一次；函数对象持有自己的那部分编译结果
+            Object result;
+            ClosureCompiler::compile(statements)->run(*this, m_env, result);
+            return;
+        }
+        if (m_mode == ExecutionMode::Bytecode) {
+            Object result;
+            BytecodeCompiler::compile(statements, m_vm.superinstructions())
+                ->run(*this, m_env, result);
+            return;
         }
-    } catch (RuntimeError error) {
-        lox.runtimeError(error);
+        Object result;
+        execute(statements, m_env, result);
+    } catch (RuntimeError &error) {
+        m_reporter->runtimeError(error);
     }
 }
 
-bool endsWith(std::string str, std::string suffix) {
-    if (str.length() < suffix.length()) {
-        return false;
+auto Interpreter::collectHeap(std::vector<EnvironmentRef> roots,
+                              std::vector<ObjectRef> values) -> Heap {
+    Heap heap;
+    std::unordered_set<const void *> seen;
+    std::vector<ObjectRef> pending = std::move(values);
+
+    // 冻结的对象属于快照，由快照自己负责
+    auto visitEnv = [&](const EnvironmentRef &env) {
+        if (env != nullptr && !env->isFrozen() && seen.insert(env.get()).second)
+            heap.envs.push_back(env);
+    };
+    for (auto &root : roots) {
+        visitEnv(root);
+    }
+    size_t nextEnv = 0;
+    while (nextEnv < heap.envs.size() || !pending.empty()) {
+        if (pending.empty()) {
+            auto env = heap.envs[nextEnv++];
+            for (auto &[name, value] : env->getValues()) {
+                pending.push_back(value);
+            }
+            visitEnv(env->getEnclosing());
+            continue;
+        }
+        auto obj = pending.back();
+        pending.pop_back();
+        if (obj == nullptr)
+            continue;
+        if (obj->getType() == Object::Object_str) {
+            auto str = obj->getString();
+            if (seen.insert(str.get()).second)
+                heap.strings.push_back(str);
+        } else if (obj->getType() == Object::Object_fun) {
+            auto fun = std::dynamic_pointer_cast<LoxFunction>(obj->getFun());
+            if (fun != nullptr)
+                visitEnv(fun->getClosure());
+        } else if (obj->getType() == Object::Object_class) {
+            auto klass = obj->getClass();
+            while (klass != nullptr && !klass->isFrozen() &&
+                   seen.insert(klass.get()).second) {
+                heap.classes.push_back(klass);
+                for (auto &[name, method] : klass->getMethods()) {
+                    visitEnv(method->getClosure());
+                }
+                klass = klass->getSuper();
+            }
+        } else if (obj->getType() == Object::Object_instance) {
+            auto instance = obj->getInstance();
+            if (!instance->isFrozen() && seen.insert(instance.get()).second) {
+                heap.instances.push_back(instance);
+                for (auto &[name, value] : instance->getFields()) {
+                    pending.push_back(value);
+                }
+                pending.push_back(std::make_shared<Object>(
+                    Object::make_class_obj(instance->getClass())));
+            }
+        }
     }
-    return str.substr(str.length() - suffix.length()) == suffix;
+    return heap;
+}
+
+auto Interpreter::clearHeap() -> void {
+    if (globals == nullptr)
+        return;
+    // 先收集所有可达对象，最后统一清空
+    std::vector<EnvironmentRef> roots{globals};
+    std::vector<ObjectRef> values;
+    for (auto &[frozen, env] : m_envCopies) {
+        roots.push_back(env);
+    }
+    for (auto &[frozen, instance] : m_instanceCopies) {
+        values.push_back(
+            std::make_shared<Object>(Object::make_instance_obj(instance)));
+    }
+    for (auto &[path, module] : m_modules) {
+        values.push_back(module.object);
+    }
+    auto heap = collectHeap(std::move(roots), std::move(values));
+    for (auto &env : heap.envs) {
+        env->clear();
+    }
+    for (auto &klass : heap.classes) {
+        klass->clear();
+    }
+    for (auto &instance : heap.instances) {
+        instance->clearFields();
+    }
+    m_envCopies.clear();
+    m_instanceCopies.clear();
+    m_modules.clear();
+    m_importSites.clear();
+}
+
+auto Interpreter::freezeHeap() -> Heap {
+    auto heap = collectHeap({globals});
+    for (auto &env : heap.envs) {
+        env->freeze();
+    }
+    for (auto &klass : heap.classes) {
+        klass->freeze();
+    }
+    for (auto &instance : heap.instances) {
+        instance->freeze();
+    }
+    // 展平后的字符串读取时不再修改自身，可以跨线程共享
+    for (auto &str : heap.strings) {
+        str->str();
+    }
+    return heap;
+}
+
+auto Interpreter::localScope(Environment *env, int depth, bool create)
+    -> Environment * {
+    for (int i = 0; i < depth; i++) {
+        env = env->getEnclosing().get();
+    }
+    if (env->isFrozen())
+        return localCopy(env->shared_from_this(), create).get();
+    return env;
+}
+
+auto Interpreter::localCopy(const EnvironmentRef &env, bool create)
+    -> EnvironmentRef {
+    if (!env->isFrozen())
+        return env;
+    auto iter = m_envCopies.find(env.get());
+    if (iter != m_envCopies.end())
+        return iter->second;
+    if (!create)
+        return env;
+    return m_envCopies[env.get()] = env->copy();
+}
+
+auto Interpreter::localCopy(const LoxInstanceRef &instance, bool create)
+    -> LoxInstanceRef {
+    if (!instance->isFrozen())
+        return instance;
+    auto iter = m_instanceCopies.find(instance.get());
+    if (iter != m_instanceCopies.end())
+        return iter->second;
+    if (!create)
+        return instance;
+    return m_instanceCopies[instance.get()] = instance->copy();
 }
 
 auto Interpreter::stringify(Object obj) -> std::string {
     if (obj.getType() == Object::Object_nil)
         return "nil";
-    if (obj.getType() == Object::Object_str) {
-        auto text = obj.toString();
-        std::string check_str = ".000000";
-        if (endsWith(text, check_str)) {
-            return text.erase(text.size() - check_str.size());
-        }
-        return text;
-    }
     return obj.toString();
 }
 
 } // namespace lox
+
@@ -0,0 +1,106 @@
+#include "Interpreter/Isolate.h"
+#include "Interpreter/Parser.h"
+#include "Interpreter/Resolver.h"
+#include "Interpreter/Scanner.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+
+namespace lox {
+
+static auto lazyParsingDefault() -> bool {
+    const char *value = std::getenv("LOX_LAZY_PARSE");
+    return value != nullptr &&
+           (std::strcmp(value, "on") == 0 || std::strcmp(value, "1") == 0);
+}
+
+Isolate::Isolate(std::ostream &out, std::ostream &err)
+    : m_out(&out), m_reporter(err), m_lazyParsing(lazyParsingDefault()) {
+    m_interpreter = std::make_shared<Interpreter>(out, &m_reporter);
+}
+
+Isolate::Isolate(SnapshotRef snapshot, std::ostream &out, std::ostream &err)
+    : m_out(&out), m_reporter(err), m_lazyParsing(lazyParsingDefault()),
+      m_snapshot(std::move(snapshot)) {
+    m_interpreter = std::make_shared<Interpreter>(out, &m_reporter,
+                                                  m_snapshot->getGlobals());
+}
+
+auto Isolate::run(const std::string &source) -> Status {
+    auto program =
+        Program::compile(source, m_reporter, &m_strings, m_lazyParsing);
+    if (program == nullptr)
+        return Status::COMPILE_ERROR;
+    return run(program);
+}
+
+auto Isolate::runFiles(const std::vector<SourceFile> &files) -> Status {
+    auto program = Program::compileFiles(files, m_reporter, &m_strings,
+                                         m_lazyParsing);
+    if (program == nullptr)
+        return Status::COMPILE_ERROR;
+    return run(program);
+}
+
+auto Isolate::run(const ProgramRef &program) -> Status {
+    m_reporter.reset();
+    // 快照只按程序和下标引用函数，没有声明函数的程序（REPL 里的大多数
+    // 输入）不必记录，内存不随会话历史增长。fork 出来的 Isolate 不能做快照
+    if (m_snapshot == nullptr && program->declaresFunctions() &&
+        (m_programs.empty() || m_programs.back() != program)) {
+        m_programs.push_back(program);
+    }
+    m_interpreter->interpret(program->getStatements());
+    if (m_reporter.hadRuntimeError())
+        return Status::RUNTIME_ERROR;
+    return Status::OK;
+}
+
+auto Isolate::runStream(std::istream &input) -> Status {
+    m_reporter.reset();
+    m_streamed = true;
+    Scanner scanner(input, &m_strings, &m_reporter);
+    Parser parser(scanner, &m_reporter);
+    parser.setLazyBodies(m_lazyParsing);
+    Resolver resolver(m_reporter);
+    StmtRef stmt;
+    while (parser.next(stmt)) {
+        if (m_reporter.hadError())
+            continue;
+        resolver.resolve(stmt);
+        if (m_reporter.hadError())
+            continue;
+        m_interpreter->interpret({std::move(stmt)});
+        stmt = nullptr;
+        if (m_reporter.hadRuntimeError())
+            return Status::RUNTIME_ERROR;
+    }
+    return m_reporter.hadError() ? Status::COMPILE_ERROR : Status::OK;
+}
+
+auto Isolate::snapshot() -> SnapshotRef {
+    if (m_snapshot != nullptr) {
+        throw std::logic_error("Cannot snapshot a forked isolate.");
+    }
+    if (m_streamed) {
+        throw std::logic_error("Cannot snapshot an isolate that ran a stream.");
+    }
+    // 快照按程序和下标引用函数，模块里的函数不在任何程序里
+    if (m_interpreter->hasImportedModules()) {
+        throw std::logic_error("Cannot snapshot an isolate that imported "
+                               "modules.");
+    }
+    auto globals = m_interpreter->getGlobals();
+    auto heap = m_interpreter->freezeHeap();
+    m_snapshot = std::make_shared<const Snapshot>(globals, std::move(heap),
+                                                  std::move(m_programs));
+    auto mode = m_interpreter->getExecutionMode();
+    m_interpreter = std::make_shared<Interpreter>(*m_out, &m_reporter,
+                                                  m_snapshot->getGlobals());
+    m_interpreter->setExecutionMode(mode);
+    return m_snapshot;
+}
+
+} // namespace lox
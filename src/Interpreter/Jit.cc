@@ -0,0 +1,722 @@
+#include "Interpreter/Jit.h"
+#include "Interpreter/Interpreter.h"
+#include "Interpreter/LoxFunction.h"
+#include "Runtime/StackProbe.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#if defined(__x86_64__) && (defined(__linux__) || defined(__APPLE__))
+#define LOX_JIT_X64 1
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace lox {
+
+// 放弃次数超过这个值的函数不再尝试机器码
+static constexpr int kMaxBailouts = 8;
+
+#ifdef LOX_JIT_X64
+
+namespace {
+
+// 最小的 x86-64 汇编器，只包含模板需要的指令
+class Assembler {
+  public:
+    struct Label {
+        std::ptrdiff_t pos = -1;
+        std::vector<std::size_t> patches;
+    };
+
+    // 条件码，与 0x0F 0x8x 形式的 jcc 对应
+    enum Cond : std::uint8_t {
+        B = 0x2,  // CF=1
+        AE = 0x3, // CF=0
+        E = 0x4,
+        NE = 0x5,
+        BE = 0x6, // CF=1 或 ZF=1
+        A = 0x7,  // CF=0 且 ZF=0
+        P = 0xA,  // 无序比较
+    };
+
+    auto code() const -> const std::vector<std::uint8_t> & { return m_code; }
+    auto size() const -> std::size_t { return m_code.size(); }
+
+    auto bytes(std::initializer_list<std::uint8_t> list) -> void {
+        m_code.insert(m_code.end(), list);
+    }
+    auto imm32(std::int32_t value) -> void {
+        for (int i = 0; i < 4; i++) {
+            m_code.push_back(static_cast<std::uint8_t>(value >> (8 * i)));
+        }
+    }
+    auto imm64(std::uint64_t value) -> void {
+        for (int i = 0; i < 8; i++) {
+            m_code.push_back(static_cast<std::uint8_t>(value >> (8 * i)));
+        }
+    }
+    auto patch32(std::size_t at, std::int32_t value) -> void {
+        std::memcpy(&m_code[at], &value, sizeof(value));
+    }
+
+    auto bind(Label &label) -> void {
+        label.pos = m_code.size();
+        for (auto at : label.patches) {
+            patch32(at, static_cast<std::int32_t>(label.pos - (at + 4)));
+        }
+        label.patches.clear();
+    }
+    auto jmp(Label &label) -> void {
+        bytes({0xE9});
+        target(label);
+    }
+    auto jcc(Cond cond, Label &label) -> void {
+        bytes({0x0F, static_cast<std::uint8_t>(0x80 | cond)});
+        target(label);
+    }
+
+    // movsd xmm0, [base + disp]，base 为 rbp / rdi / rsp
+    auto loadRbp(std::int32_t disp) -> void {
+        bytes({0xF2, 0x0F, 0x10, 0x85});
+        imm32(disp);
+    }
+    auto storeRbp(std::int32_t disp) -> void {
+        bytes({0xF2, 0x0F, 0x11, 0x85});
+        imm32(disp);
+    }
+    auto loadRdi(std::int32_t disp) -> void {
+        bytes({0xF2, 0x0F, 0x10, 0x87});
+        imm32(disp);
+    }
+    auto loadRsp(std::int32_t disp) -> void {
+        bytes({0xF2, 0x0F, 0x10, 0x84, 0x24});
+        imm32(disp);
+    }
+    auto storeRsp(std::int32_t disp) -> void {
+        bytes({0xF2, 0x0F, 0x11, 0x84, 0x24});
+        imm32(disp);
+    }
+    auto subRsp(std::int32_t value) -> void {
+        bytes({0x48, 0x81, 0xEC});
+        imm32(value);
+    }
+    auto addRsp(std::int32_t value) -> void {
+        bytes({0x48, 0x81, 0xC4});
+        imm32(value);
+    }
+    // 临时值按 16 字节压栈，保证任何时候调用 C++ 函数时栈都是对齐的
+    auto pushXmm0() -> void {
+        subRsp(16);
+        storeRsp(0);
+    }
+    auto popXmm0() -> void {
+        loadRsp(0);
+        addRsp(16);
+    }
+    auto movXmm1Xmm0() -> void { bytes({0xF2, 0x0F, 0x10, 0xC8}); }
+    // mov rax, imm64; movq xmm0/xmm1, rax
+    auto loadConst(double value, bool toXmm1 = false) -> void {
+        std::uint64_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        bytes({0x48, 0xB8});
+        imm64(bits);
+        bytes({0x66, 0x48, 0x0F, 0x6E,
+               static_cast<std::uint8_t>(toXmm1 ? 0xC8 : 0xC0)});
+    }
+
+  private:
+    auto target(Label &label) -> void {
+        if (label.pos >= 0) {
+            imm32(static_cast<std::int32_t>(label.pos - (m_code.size() + 4)));
+        } else {
+            label.patches.push_back(m_code.size());
+            imm32(0);
+        }
+    }
+
+    std::vector<std::uint8_t> m_code;
+};
+
+} // namespace
+
+// 把一个函数声明翻译成机器码。遇到子集之外的语法时返回 false。
+//
+// 寄存器约定：rbp 为帧指针，r12 保存结果指针，r13 保存 Jit*；
+// 表达式的值总是留在 xmm0，局部变量在 [rbp - 16 - 8 * (slot + 1)]。
+class JitCompiler {
+  public:
+    JitCompiler(Jit &jit, FunStmt &declaration)
+        : m_jit(jit), m_declaration(declaration) {}
+
+    auto compile() -> bool {
+        auto params = m_declaration.getParams();
+        // push rbp; mov rbp, rsp; push r12; push r13; sub rsp, frame
+        m_asm.bytes({0x55, 0x48, 0x89, 0xE5, 0x41, 0x54, 0x41, 0x55});
+        m_asm.bytes({0x48, 0x81, 0xEC});
+        auto framePatch = m_asm.size();
+        m_asm.imm32(0);
+        // mov r12, rsi; mov r13, rdx
+        m_asm.bytes({0x49, 0x89, 0xF4, 0x49, 0x89, 0xD5});
+
+        m_scopes.emplace_back();
+        for (std::size_t i = 0; i < params.size(); i++) {
+            auto slot = declare(params[i].getLexeme());
+            m_asm.loadRdi(static_cast<std::int32_t>(8 * i));
+            m_asm.storeRbp(slotOffset(slot));
+        }
+        m_asm.bind(m_body);
+        for (auto &stmt : m_declaration.getBody()) {
+            if (!emitStmt(stmt))
+                return false;
+        }
+        // 没有 return 时函数返回 nil，不是数字，交给解释器
+        m_asm.jmp(m_bailout);
+
+        m_asm.bind(m_return);
+        m_asm.bytes({0x31, 0xC0}); // xor eax, eax
+        m_asm.bind(m_epilogue);
+        // lea rsp, [rbp - 16]; pop r13; pop r12; pop rbp; ret
+        m_asm.bytes({0x48, 0x8D, 0x65, 0xF0, 0x41, 0x5D, 0x41, 0x5C, 0x5D,
+                     0xC3});
+        m_asm.bind(m_bailout);
+        m_asm.bytes({0xB8, 0x01, 0x00, 0x00, 0x00}); // mov eax, 1
+        m_asm.jmp(m_epilogue);
+
+        auto frame = (m_slots * 8 + 15) / 16 * 16;
+        m_asm.patch32(framePatch, static_cast<std::int32_t>(frame));
+        return true;
+    }
+
+    auto code() const -> const std::vector<std::uint8_t> & {
+        return m_asm.code();
+    }
+
+  private:
+    static auto slotOffset(int slot) -> std::int32_t {
+        return -16 - 8 * (slot + 1);
+    }
+
+    auto declare(const std::string &name) -> int {
+        auto slot = m_slots++;
+        m_scopes.back()[name] = slot;
+        return slot;
+    }
+
+    // 按 Resolver 算出的作用域距离找到局部变量的槽位；
+    // 函数之外的（闭包捕获的）变量不支持
+    auto lookup(const std::string &name, int depth) -> int {
+        if (depth < 0 || static_cast<std::size_t>(depth) >= m_scopes.size())
+            return -1;
+        auto &scope = m_scopes[m_scopes.size() - 1 - depth];
+        auto iter = scope.find(name);
+        return iter != scope.end() ? iter->second : -1;
+    }
+
+    // 语法树很高、原生栈快用完时放弃编译，这个函数留给解释器执行
+    auto emitStmt(const StmtRef &stmt) -> bool {
+        if (stackExhausted())
+            return false;
+        if (auto expr = std::dynamic_pointer_cast<ExpressionStmt>(stmt)) {
+            return emitNumber(expr->getExpr());
+        }
+        if (auto var = std::dynamic_pointer_cast<VarStmt>(stmt)) {
+            // 没有初始值的变量是 nil
+            if (var->getInitExpr() == nullptr ||
+                !emitNumber(var->getInitExpr()))
+                return false;
+            m_asm.storeRbp(slotOffset(declare(var->getName().getLexeme())));
+            return true;
+        }
+        if (auto block = std::dynamic_pointer_cast<BlockStmt>(stmt)) {
+            m_scopes.emplace_back();
+            for (auto &inner : block->getStmt()) {
+                if (!emitStmt(inner))
+                    return false;
+            }
+            m_scopes.pop_back();
+            return true;
+        }
+        if (auto branch = std::dynamic_pointer_cast<IfStmt>(stmt)) {
+            Assembler::Label elseLabel, end;
+            if (!emitBranch(branch->getCondition(), false, elseLabel) ||
+                !emitStmt(branch->getThen()))
+                return false;
+            m_asm.jmp(end);
+            m_asm.bind(elseLabel);
+            if (branch->getElse() != nullptr && !emitStmt(branch->getElse()))
+                return false;
+            m_asm.bind(end);
+            return true;
+        }
+        if (auto loop = std::dynamic_pointer_cast<WhileStmt>(stmt)) {
+            Assembler::Label top, exit;
+            m_asm.bind(top);
+            if (!emitBranch(loop->getCondition(), false, exit) ||
+                !emitStmt(loop->getBody()))
+                return false;
+            m_asm.jmp(top);
+            m_asm.bind(exit);
+            return true;
+        }
+        if (auto ret = std::dynamic_pointer_cast<ReturnStmt>(stmt)) {
+            if (ret->getValue() == nullptr) {
+                m_asm.jmp(m_bailout);
+                return true;
+            }
+            auto call = std::dynamic_pointer_cast<CallExpression<Object>>(
+                ret->getValue());
+            if (call != nullptr && call->isTailCall()) {
+                if (!emitCall(call, true))
+                    return false;
+            } else if (!emitNumber(ret->getValue())) {
+                return false;
+            }
+            m_asm.bytes({0xF2, 0x41, 0x0F, 0x11, 0x04, 0x24}); // [r12]
+            m_asm.jmp(m_return);
+            return true;
+        }
+        return false;
+    }
+
+    // 计算一个数字表达式，结果留在 xmm0
+    auto emitNumber(const AbstractExpressionRef<Object> &expr) -> bool {
+        if (stackExhausted())
+            return false;
+        if (auto literal =
+                std::dynamic_pointer_cast<LiteralExpression<Object>>(expr)) {
+            auto value = literal->getValue();
+            if (value.getType() != Object::Object_num)
+                return false;
+            m_asm.loadConst(value.getNum());
+            return true;
+        }
+        if (auto group =
+                std::dynamic_pointer_cast<GroupingExpression<Object>>(expr)) {
+            return emitNumber(group->getExpr());
+        }
+        if (auto var =
+                std::dynamic_pointer_cast<VariableExpression<Object>>(expr)) {
+            auto slot = lookup(var->getName().getLexeme(), var->getDepth());
+            if (slot < 0)
+                return false;
+            m_asm.loadRbp(slotOffset(slot));
+            return true;
+        }
+        if (auto assign =
+                std::dynamic_pointer_cast<AssignmentExpression<Object>>(expr)) {
+            auto slot =
+                lookup(assign->getName().getLexeme(), assign->getDepth());
+            if (slot < 0 || !emitNumber(assign->getValue()))
+                return false;
+            m_asm.storeRbp(slotOffset(slot));
+            return true;
+        }
+        if (auto unary =
+                std::dynamic_pointer_cast<UnaryExpression<Object>>(expr)) {
+            if (unary->getOperation().getType() != MINUS ||
+                !emitNumber(unary->getRightExpr()))
+                return false;
+            m_asm.loadConst(-0.0, true);
+            m_asm.bytes({0x66, 0x0F, 0x57, 0xC1}); // xorpd xmm0, xmm1
+            return true;
+        }
+        if (auto binary =
+                std::dynamic_pointer_cast<BinaryExpression<Object>>(expr)) {
+            std::uint8_t opcode;
+            switch (binary->getOperation().getType()) {
+            case PLUS:
+                opcode = 0x58;
+                break;
+            case MINUS:
+                opcode = 0x5C;
+                break;
+            case STAR:
+                opcode = 0x59;
+                break;
+            case SLASH:
+                opcode = 0x5E;
+                break;
+            default:
+                return false;
+            }
+            if (!emitOperands(binary))
+                return false;
+            m_asm.bytes({0xF2, 0x0F, opcode, 0xC1}); // op xmm0, xmm1
+            return true;
+        }
+        if (auto call = std::dynamic_pointer_cast<CallExpression<Object>>(expr)) {
+            return emitCall(call);
+        }
+        return false;
+    }
+
+    // 左操作数放在 xmm0，右操作数放在 xmm1
+    auto emitOperands(const BinaryExpressionRef<Object> &binary) -> bool {
+        if (!emitNumber(binary->getLeftExpr()))
+            return false;
+        m_asm.pushXmm0();
+        if (!emitNumber(binary->getRightExpr()))
+            return false;
+        m_asm.movXmm1Xmm0();
+        m_asm.popXmm0();
+        return true;
+    }
+
+    // 只支持调用全局函数；参数和返回值在栈上的数组里传递。
+    // tail 为 true 且调用点在运行时指向自身时，把参数写回参数槽后跳回开头
+    auto emitCall(const CallExpressionRef<Object> &call, bool tail = false)
+        -> bool {
+        auto callee =
+            std::dynamic_pointer_cast<VariableExpression<Object>>(
+                call->getCallee());
+        if (callee == nullptr || callee->getDepth() >= 0)
+            return false;
+        auto args = call->getArgs();
+        auto argc = static_cast<std::int32_t>(args.size());
+        auto area = (8 * (argc + 1) + 15) / 16 * 16;
+        m_asm.subRsp(area);
+        for (std::int32_t i = 0; i < argc; i++) {
+            if (!emitNumber(args[i]))
+                return false;
+            m_asm.storeRsp(8 * i);
+        }
+        auto site = m_jit.addCallSite(callee->getName().getLexeme(), argc);
+        if (tail && callee->getName().getLexeme() ==
+                        m_declaration.getName().getLexeme() &&
+            static_cast<std::size_t>(argc) ==
+                m_declaration.getParams().size()) {
+            Assembler::Label other;
+            m_asm.bytes({0x4C, 0x89, 0xEF}); // mov rdi, r13
+            m_asm.bytes({0xBE});             // mov esi, site
+            m_asm.imm32(site);
+            m_asm.bytes({0x48, 0xBA}); // mov rdx, &m_declaration
+            m_asm.imm64(reinterpret_cast<std::uint64_t>(&m_declaration));
+            m_asm.bytes({0x48, 0xB8}); // mov rax, Jit::isSelfCall
+            m_asm.imm64(reinterpret_cast<std::uint64_t>(&Jit::isSelfCall));
+            m_asm.bytes({0xFF, 0xD0, 0x85, 0xC0}); // call rax; test eax, eax
+            m_asm.jcc(Assembler::E, other);
+            // 参数都已求值，可以放心覆盖参数槽
+            for (std::int32_t i = 0; i < argc; i++) {
+                m_asm.loadRsp(8 * i);
+                m_asm.storeRbp(slotOffset(i));
+            }
+            m_asm.addRsp(area);
+            m_asm.jmp(m_body);
+            m_asm.bind(other);
+        }
+        m_asm.bytes({0x4C, 0x89, 0xEF}); // mov rdi, r13
+        m_asm.bytes({0xBE});             // mov esi, site
+        m_asm.imm32(site);
+        m_asm.bytes({0x48, 0x89, 0xE2});       // mov rdx, rsp
+        m_asm.bytes({0x48, 0x8D, 0x8C, 0x24}); // lea rcx, [rsp + 8 * argc]
+        m_asm.imm32(8 * argc);
+        m_asm.bytes({0x48, 0xB8}); // mov rax, Jit::callFromNative
+        m_asm.imm64(reinterpret_cast<std::uint64_t>(&Jit::callFromNative));
+        m_asm.bytes({0xFF, 0xD0, 0x85, 0xC0}); // call rax; test eax, eax
+        m_asm.jcc(Assembler::NE, m_bailout);
+        m_asm.loadRsp(8 * argc);
+        m_asm.addRsp(area);
+        return true;
+    }
+
+    // 当 expr 的真值等于 jumpWhen 时跳到 target。数字总是真值
+    auto emitBranch(const AbstractExpressionRef<Object> &expr, bool jumpWhen,
+                    Assembler::Label &target) -> bool {
+        if (stackExhausted())
+            return false;
+        if (auto literal =
+                std::dynamic_pointer_cast<LiteralExpression<Object>>(expr)) {
+            auto value = literal->getValue();
+            bool truthy = value.getType() == Object::Object_bool
+                              ? value.getBool()
+                              : value.getType() != Object::Object_nil;
+            if (truthy == jumpWhen)
+                m_asm.jmp(target);
+            return true;
+        }
+        if (auto group =
+                std::dynamic_pointer_cast<GroupingExpression<Object>>(expr)) {
+            return emitBranch(group->getExpr(), jumpWhen, target);
+        }
+        if (auto unary =
+                std::dynamic_pointer_cast<UnaryExpression<Object>>(expr)) {
+            if (unary->getOperation().getType() == BANG)
+                return emitBranch(unary->getRightExpr(), !jumpWhen, target);
+        }
+        if (auto logical =
+                std::dynamic_pointer_cast<LogicalExpression<Object>>(expr)) {
+            // and 在左边为假时短路，or 在左边为真时短路
+            bool shortCircuit = logical->getOperation().getType() == OR;
+            if (shortCircuit == jumpWhen) {
+                return emitBranch(logical->getLeftExpr(), jumpWhen, target) &&
+                       emitBranch(logical->getRightExpr(), jumpWhen, target);
+            }
+            Assembler::Label skip;
+            if (!emitBranch(logical->getLeftExpr(), shortCircuit, skip) ||
+                !emitBranch(logical->getRightExpr(), jumpWhen, target))
+                return false;
+            m_asm.bind(skip);
+            return true;
+        }
+        if (auto binary =
+                std::dynamic_pointer_cast<BinaryExpression<Object>>(expr)) {
+            auto type = binary->getOperation().getType();
+            if (type == LESS || type == LESS_EQUAL || type == GREATER ||
+                type == GREATER_EQUAL || type == EQUAL_EQUAL ||
+                type == BANG_EQUAL) {
+                if (!emitOperands(binary))
+                    return false;
+                emitCompare(type, jumpWhen, target);
+                return true;
+            }
+        }
+        // 其余的表达式只能是数字，总是真值
+        if (!emitNumber(expr))
+            return false;
+        if (jumpWhen)
+            m_asm.jmp(target);
+        return true;
+    }
+
+    // xmm0 与 xmm1 比较。ucomisd 遇到 NaN 时 ZF=PF=CF=1，
+    // 选择的条件码保证 NaN 参与的比较除了 != 之外都为假
+    auto emitCompare(TokenType type, bool jumpWhen, Assembler::Label &target)
+        -> void {
+        const std::uint8_t ucomisd01[] = {0x66, 0x0F, 0x2E, 0xC1};
+        const std::uint8_t ucomisd10[] = {0x66, 0x0F, 0x2E, 0xC8};
+        auto compare = [this](const std::uint8_t(&op)[4]) {
+            m_asm.bytes({op[0], op[1], op[2], op[3]});
+        };
+        switch (type) {
+        case LESS: // xmm1 > xmm0
+            compare(ucomisd10);
+            m_asm.jcc(jumpWhen ? Assembler::A : Assembler::BE, target);
+            break;
+        case LESS_EQUAL:
+            compare(ucomisd10);
+            m_asm.jcc(jumpWhen ? Assembler::AE : Assembler::B, target);
+            break;
+        case GREATER:
+            compare(ucomisd01);
+            m_asm.jcc(jumpWhen ? Assembler::A : Assembler::BE, target);
+            break;
+        case GREATER_EQUAL:
+            compare(ucomisd01);
+            m_asm.jcc(jumpWhen ? Assembler::AE : Assembler::B, target);
+            break;
+        case EQUAL_EQUAL:
+        case BANG_EQUAL: {
+            compare(ucomisd01);
+            // 相等当且仅当 ZF=1 且 PF=0
+            bool jumpIfEqual = (type == EQUAL_EQUAL) == jumpWhen;
+            if (jumpIfEqual) {
+                Assembler::Label skip;
+                m_asm.jcc(Assembler::P, skip);
+                m_asm.jcc(Assembler::E, target);
+                m_asm.bind(skip);
+            } else {
+                m_asm.jcc(Assembler::P, target);
+                m_asm.jcc(Assembler::NE, target);
+            }
+            break;
+        }
+        default:
+            break;
+        }
+    }
+
+    Jit &m_jit;
+    FunStmt &m_declaration;
+    Assembler m_asm;
+    Assembler::Label m_body, m_return, m_epilogue, m_bailout;
+    std::vector<std::unordered_map<std::string, int>> m_scopes;
+    int m_slots = 0;
+};
+
+#endif // LOX_JIT_X64
+
+static auto enabledByEnvironment() -> bool {
+    const char *value = std::getenv("LOX_JIT");
+    if (value == nullptr)
+        return true;
+    return std::strcmp(value, "off") != 0 && std::strcmp(value, "0") != 0;
+}
+
+Jit::Jit(Interpreter &interpreter)
+    : m_interpreter(&interpreter),
+      m_enabled(isSupported() && enabledByEnvironment()) {}
+
+Jit::~Jit() {
+#ifdef LOX_JIT_X64
+    for (auto &[declaration, compiled] : m_functions) {
+        if (compiled.pages != nullptr)
+            munmap(compiled.pages, compiled.size);
+    }
+#endif
+}
+
+auto Jit::isSupported() -> bool {
+#ifdef LOX_JIT_X64
+    return true;
+#else
+    return false;
+#endif
+}
+
+auto Jit::compile(const FunStmtRef &declaration) -> CompiledFunction & {
+    auto &compiled = m_functions[declaration.get()];
+    if (compiled.code != nullptr || compiled.failed)
+        return compiled;
+    compiled.declaration = declaration;
+    compiled.failed = true;
+#ifdef LOX_JIT_X64
+    JitCompiler compiler(*this, *declaration);
+    if (!compiler.compile())
+        return compiled;
+    auto &code = compiler.code();
+    auto pageSize = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+    auto size = (code.size() + pageSize - 1) / pageSize * pageSize;
+    // 先写入再改成只读可执行，任何时候页面都不同时可写可执行
+    void *pages = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (pages == MAP_FAILED)
+        return compiled;
+    std::memcpy(pages, code.data(), code.size());
+    if (mprotect(pages, size, PROT_READ | PROT_EXEC) != 0) {
+        munmap(pages, size);
+        return compiled;
+    }
+    compiled.pages = pages;
+    compiled.size = size;
+    compiled.code = reinterpret_cast<NativeCode>(pages);
+    compiled.failed = false;
+    m_compiled++;
+#endif
+    return compiled;
+}
+
+auto Jit::addCallSite(std::string name, std::size_t argc) -> int {
+    CallSite site;
+    site.name = std::move(name);
+    site.argc = argc;
+    m_sites.push_back(std::move(site));
+    return static_cast<int>(m_sites.size() - 1);
+}
+
+auto Jit::resolveCallSite(CallSite &site) -> CompiledFunction * {
+    auto *globals = m_interpreter->getGlobals().get();
+    if (site.target != nullptr && site.globals == globals &&
+        site.version == globals->getVersion())
+        return site.target;
+
+    auto value = globals->find(site.name);
+    if (value == nullptr || value->getType() != Object::Object_fun)
+        return nullptr;
+    auto function = std::dynamic_pointer_cast<LoxFunction>(value->getFun());
+    if (function == nullptr || function->isInitializer() ||
+        static_cast<std::size_t>(function->arity()) != site.argc)
+        return nullptr;
+    auto &compiled = compile(function->getDeclaration());
+    if (compiled.code == nullptr)
+        return nullptr;
+    site.globals = globals;
+    site.version = globals->getVersion();
+    site.target = &compiled;
+    return site.target;
+}
+
+auto Jit::callFromNative(Jit *jit, int site, const double *args, double *out)
+    -> int {
+    // 机器码帧没有展开信息，异常不能穿过这里
+    try {
+        auto *target = jit->resolveCallSite(jit->m_sites[site]);
+        if (target == nullptr || jit->m_depth >= kMaxDepth)
+            return 1;
+        jit->m_depth++;
+        auto status = target->code(args, out, jit);
+        jit->m_depth--;
+        return status;
+    } catch (...) {
+        return 1;
+    }
+}
+
+auto Jit::isSelfCall(Jit *jit, int site, const FunStmt *self) -> int {
+    try {
+        auto *target = jit->resolveCallSite(jit->m_sites[site]);
+        return target != nullptr && target->declaration.get() == self;
+    } catch (...) {
+        return 0;
+    }
+}
+
+auto Jit::prepare(LoxFunction &function) -> CompiledFunction * {
+    if (!m_enabled)
+        return nullptr;
+    auto declaration = function.getDeclaration();
+    auto iter = m_functions.find(declaration.get());
+    if (iter == m_functions.end() || iter->second.code == nullptr) {
+        auto &counter = m_functions[declaration.get()];
+        if (counter.failed)
+            return nullptr;
+        counter.declaration = declaration;
+        if (++counter.calls < m_threshold)
+            return nullptr;
+        if (compile(declaration).code == nullptr)
+            return nullptr;
+        iter = m_functions.find(declaration.get());
+    }
+    auto &compiled = iter->second;
+    return compiled.failed ? nullptr : &compiled;
+}
+
+auto Jit::tryCall(LoxFunction &function, const std::vector<ObjectRef> &arguments,
+                  double &result) -> bool {
+    auto *compiled = prepare(function);
+    if (compiled == nullptr)
+        return false;
+    // 入口守卫：参数必须都是数字
+    std::vector<double> args(arguments.size());
+    for (std::size_t i = 0; i < arguments.size(); i++) {
+        if (arguments[i]->getType() != Object::Object_num)
+            return false;
+        args[i] = arguments[i]->getNum();
+    }
+    return invoke(*compiled, args.data(), result);
+}
+
+auto Jit::tryCall(LoxFunction &function, const Object *arguments,
+                  std::size_t argc, double &result) -> bool {
+    auto *compiled = prepare(function);
+    if (compiled == nullptr)
+        return false;
+    std::vector<double> args(argc);
+    for (std::size_t i = 0; i < argc; i++) {
+        if (arguments[i].getType() != Object::Object_num)
+            return false;
+        args[i] = arguments[i].getNum();
+    }
+    return invoke(*compiled, args.data(), result);
+}
+
+auto Jit::invoke(CompiledFunction &compiled, const double *args,
+                 double &result) -> bool {
+    if (m_depth >= kMaxDepth)
+        return false;
+    m_depth++;
+    auto status = compiled.code(args, &result, this);
+    m_depth--;
+    if (status != 0) {
+        m_bailouts++;
+        if (++compiled.bailouts >= kMaxBailouts)
+            compiled.failed = true;
+        return false;
+    }
+    return true;
+}
+
+} // namespace lox
@@ -1,42 +1,21 @@
 #include "Interpreter/Lox.h"
-#include "Interpreter/Interpreter.h"
-#include "Interpreter/Parser.h"
-#include "Interpreter/Resolver.h"
-#include "Interpreter/Scanner.h"
-#include "Interpreter/Tokentype.h"
+#include "Interpreter/BatchRunner.h"
 
 #include <cstdlib>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
-#include <memory>
 #include <sstream>
 #include <stdexcept>
 namespace lox {
 
-auto Lox::hasError = false;
-auto Lox::hasRuntimeError = false;
-
-void Lox::run(const std::string &source) {
-    auto scanner = std::make_shared<Scanner>(source);
-    auto tokens = scanner->scanTokens();
-    auto parser = std::make_shared<Parser>(tokens);
-
-    auto expr = parser->parse();
-
-    if (hasError)
-        return;
-
-    auto interpreter = std::make_shared<Interpreter>();
-    auto resolver = std::make_shared<Resolver>(interpreter);
-    if (hasError)
-        return;
-    interpreter->interpret(expr);
+auto Lox::run(const std::string &source) -> Isolate::Status {
+    return m_isolate.run(source);
 }
 
-void Lox::runFile(const std::string &path) {
+static auto readFile(const std::string &path) -> std::string {
     // 检查文件是否存在
-    if (!std::__fs::filesystem::exists(path)) {
+    if (!std::filesystem::exists(path)) {
         throw std::runtime_error("File not found: " + path);
     }
     // 打开文件并读取内容
@@ -47,10 +26,46 @@ void Lox::runFile(const std::string &path) {
 
     std::stringstream buffer;
     buffer << file.rdbuf(); // 将文件内容读入缓冲区
-    run(buffer.str());      // 将内容传递给run函数
-    if (hasError)
+    return buffer.str();
+}
+
+void Lox::runFile(const std::string &path) {
+    // 脚本里 import 的相对路径相对于脚本所在的目录
+    getInterpreter()->setModuleRoot(
+        std::filesystem::absolute(path).parent_path().string());
+    auto status = run(readFile(path)); // 将内容传递给run函数
+    if (status == Isolate::Status::COMPILE_ERROR)
         std::exit(65);
-    if (hasRuntimeError)
+    if (status == Isolate::Status::RUNTIME_ERROR)
+        std::exit(70);
+}
+
+void Lox::runFiles(const std::vector<std::string> &paths) {
+    std::vector<SourceFile> files;
+    for (auto &path : paths) {
+        files.push_back({path, readFile(path)});
+    }
+    auto status = m_isolate.runFiles(files);
+    if (status == Isolate::Status::COMPILE_ERROR)
+        std::exit(65);
+    if (status == Isolate::Status::RUNTIME_ERROR)
+        std::exit(70);
+}
+
+void Lox::streamFile(const std::string &path) {
+    Isolate::Status status;
+    if (path == "-") {
+        status = m_isolate.runStream(std::cin);
+    } else {
+        std::ifstream file(path, std::ios::binary);
+        if (!file) {
+            throw std::runtime_error("Failed to open file: " + path);
+        }
+        status = m_isolate.runStream(file);
+    }
+    if (status == Isolate::Status::COMPILE_ERROR)
+        std::exit(65);
+    if (status == Isolate::Status::RUNTIME_ERROR)
         std::exit(70);
 }
 
@@ -61,30 +76,51 @@ void Lox::runPrompt() {
         if (!std::getline(std::cin, line)) { // 从标准输入读取一行
             break;                           // 如果输入流结束，退出循环
         }
-        run(line); // 将输入传递给run函数处理
-        hasError = false;
+        run(line); // 将输入传递给run函数处理，错误状态在每次 run 时重置
     }
 };
 
-void Lox::report(int line, std::string where, std::string message) {
-    std::cerr << "[line " << line << "] Error" << where << ": " << message;
-    hasError = true;
+auto Lox::runBatch(const std::vector<std::string> &paths, std::size_t workers)
+    -> int {
+    std::vector<BatchJob> jobs;
+    jobs.reserve(paths.size());
+    for (const auto &path : paths) {
+        jobs.push_back(BatchJob::fromFile(path));
+    }
+    int exitCode = 0;
+    for (const auto &result : BatchRunner(workers).run(jobs)) {
+        std::cout << result.output;
+        // 错误信息逐行加上脚本名，便于区分是哪个脚本出错
+        std::istringstream errors(result.errors);
+        for (std::string line; std::getline(errors, line);) {
+            std::cerr << result.name << ": " << line << '\n';
+        }
+        if (exitCode == 0)
+            exitCode = result.exitCode;
+    }
+    std::cout.flush();
+    return exitCode;
 }
 
-void Lox::error(int line, std::string message) { report(line, "", message); }
-
-auto Lox::error(TokenRef token, std::string message) -> void {
-    if (token->getType() == TokenType::EOF_TOKEN) {
-        report(token->getLine(), "at end", message);
-    } else {
-        report(token->getLine(), " at ", message);
+auto Lox::compileFile(const std::string &path, const std::string &output,
+                      Transpiler::Output kind) -> int {
+    ErrorReporter reporter(std::cerr);
+    auto program = Program::compile(readFile(path), reporter);
+    if (program == nullptr)
+        return 65;
+    std::string source;
+    try {
+        source = Transpiler::translate(*program);
+    } catch (std::runtime_error &error) {
+        std::cerr << error.what() << '\n';
+        return 65;
     }
-}
-void Lox::runtimeError(RuntimeError error) {
-    std::cout << std::string(error.what()) + "\n[line " +
-                     std::to_string(error.getToken()->getLine()) + "]"
-              << std::endl;
-    hasRuntimeError = true;
+    std::string errors;
+    if (!Transpiler::build(source, output, kind, errors)) {
+        std::cerr << errors;
+        return 1;
+    }
+    return 0;
 }
 
 } // namespace lox
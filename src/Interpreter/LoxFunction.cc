@@ -1,7 +1,7 @@
 #include "Interpreter/LoxFunction.h"
 #include "Interpreter/Environment.h"
+#include "Interpreter/Interpreter.h"
 #include "Interpreter/Object.h"
-#include "Interpreter/Return.h"
 
 #include <cstddef>
 #include <memory>
@@ -13,40 +13,49 @@ auto LoxFunction::bind(LoxInstanceRef instance) -> LoxFunctionRef {
     auto instance_obj = Object::make_instance_obj(instance);
     auto instance_ref = std::make_shared<Object>(instance_obj);
     env->define("this", instance_ref);
-    auto res =
-        std::make_shared<LoxFunction>(m_declaration, env, m_isInitializer);
+    auto res = std::make_shared<LoxFunction>(m_declaration, env,
+                                             m_isInitializer, m_code);
     return res;
 }
 
 auto LoxFunction::call(InterpreterRef interpreter,
                        std::vector<ObjectRef> arguments) -> ObjectRef {
+    // 函数体以尾调用结束时，在这里循环执行被调用的函数，原生栈不再加深
+    auto *function = this;
+    LoxFunctionRef tailFunction; // 保证尾调用的函数在执行期间存活
+    for (;;) {
+        double number;
+        if (!function->m_isInitializer &&
+            interpreter->getJit().tryCall(*function, arguments, number)) {
+            return std::make_shared<Object>(Object::make_num_obj(number));
+        }
 
-    auto environment = std::make_shared<Environment>(m_closure);
-
-    for (auto i = 0; (size_t)i < m_declaration->getParams().size(); i++) {
-        environment->define(m_declaration->getParams().at(i)->getLexeme(),
-                            arguments.at(i));
-    }
+        auto environment = std::make_shared<Environment>(function->m_closure);
+        const auto &params = function->m_declaration->getParams();
+        for (std::size_t i = 0; i < params.size(); i++) {
+            environment->define(params[i].getLexeme(), arguments[i]);
+        }
 
-    try {
-        interpreter->executeBlock(m_declaration->getBody(), environment);
-    } catch (ReturnError return_value) {
-        if (m_isInitializer) {
-            return m_closure->getAt(0, "this");
+        Object result = Object::make_nil_obj();
+        if (function->m_code != nullptr) {
+            function->m_code->run(*interpreter, std::move(environment), result);
+        } else {
+            interpreter->execute(function->m_declaration->getBody(),
+                                 std::move(environment), result);
         }
-        return std::make_shared<Object>(return_value.value);
-    }
-    if (m_isInitializer) {
-        return m_closure->getAt(0, "this");
+        if (function->m_isInitializer) {
+            return function->m_closure->getAt(0, "this");
+        }
+        if (!interpreter->takeTailCall(tailFunction, arguments))
+            return std::make_shared<Object>(result);
+        function = tailFunction.get();
     }
-
-    return nullptr;
 }
 
 auto LoxFunction::arity() -> int { return m_declaration->getParams().size(); }
 
 auto LoxFunction::toString() -> std::string {
-    return "<fn " + m_declaration->getName()->getLexeme() + ">";
+    return "<fn " + m_declaration->getName().getLexeme() + ">";
 }
 
 } // namespace lox
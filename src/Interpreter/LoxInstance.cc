@@ -7,22 +7,55 @@
 
 namespace lox {
 
-auto LoxInstance::get(TokenRef name) -> ObjectRef {
-    if (m_fields.find(name->getLexeme()) != m_fields.end()) {
-        return m_fields.at(name->getLexeme());
-    }
-    auto method = m_class->findMethod(name->getLexeme());
+auto LoxInstance::get(const SourceToken &name) -> ObjectRef {
+    if (auto field = findField(name.getLexeme()))
+        return field;
+    auto method = m_class->findMethod(name.getLexeme());
 
     if (method != nullptr) {
-        auto res = Object::make_fun_obj(
-            std::dynamic_pointer_cast<LoxCallable>(method));
+        auto res = Object::make_fun_obj(std::dynamic_pointer_cast<LoxCallable>(
+            method->bind(shared_from_this())));
         return std::make_shared<Object>(res);
     }
-    throw RuntimeError(name, "Undefined property '" + name->getLexeme() + "'.");
+    throw RuntimeError(name, "Undefined property '" + name.getLexeme() + "'.");
+}
+
+auto LoxInstance::set(const SourceToken &name, ObjectRef value) -> void {
+    setField(name.getLexeme(), std::move(value));
+}
+
+auto LoxInstance::findField(const std::string &name) -> ObjectRef {
+    if (m_scope != nullptr) {
+        auto field = m_scope->findLocal(name);
+        return field != nullptr ? *field : nullptr;
+    }
+    auto iter = m_fields.find(name);
+    return iter != m_fields.end() ? iter->second : nullptr;
+}
+
+auto LoxInstance::setField(const std::string &name, ObjectRef value)
+    -> void {
+    if (m_scope != nullptr) {
+        m_scope->define(name, std::move(value));
+        return;
+    }
+    m_fields[name] = std::move(value);
+}
+
+auto LoxInstance::getFields() -> std::unordered_map<std::string, ObjectRef> {
+    return m_scope != nullptr ? m_scope->getValues() : m_fields;
+}
+
+auto LoxInstance::clearFields() -> void {
+    m_fields.clear();
+    if (m_scope != nullptr)
+        m_scope->clear();
 }
 
-auto LoxInstance::set(TokenRef name, ObjectRef value) -> void {
-    m_fields.insert({name->getLexeme(), value});
+auto LoxInstance::copy() -> LoxInstanceRef {
+    auto instance = std::make_shared<LoxInstance>(m_class, m_scope);
+    instance->m_fields = m_fields;
+    return instance;
 }
 
 } // namespace lox
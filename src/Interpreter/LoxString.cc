@@ -0,0 +1,149 @@
+#include "Interpreter/LoxString.h"
+
+#include <utility>
+#include <vector>
+
+namespace lox {
+
+LoxString::~LoxString() {
+    release(std::move(m_left));
+    release(std::move(m_right));
+    release(std::move(m_parent));
+}
+
+auto LoxString::release(LoxStringRef node) -> void {
+    if (node == nullptr || node.use_count() > 1) {
+        return;
+    }
+    std::vector<LoxStringRef> pending;
+    pending.push_back(std::move(node));
+    while (!pending.empty()) {
+        auto current = std::move(pending.back());
+        pending.pop_back();
+        if (current.use_count() > 1) {
+            continue;
+        }
+        // 先把孩子摘下来，current 析构时就不会再递归
+        for (auto *child :
+             {&current->m_left, &current->m_right, &current->m_parent}) {
+            if (*child != nullptr) {
+                pending.push_back(std::move(*child));
+            }
+        }
+    }
+}
+
+auto LoxString::make(std::string str) -> LoxStringRef {
+    return std::make_shared<LoxString>(std::move(str));
+}
+
+auto LoxString::concat(const LoxStringRef &left, const LoxStringRef &right)
+    -> LoxStringRef {
+    if (left->length() == 0) {
+        return right;
+    }
+    if (right->length() == 0) {
+        return left;
+    }
+    auto length = left->length() + right->length();
+    if (length < kMinRopeLength) {
+        std::string flat;
+        flat.reserve(length);
+        flat.append(left->view());
+        flat.append(right->view());
+        return make(std::move(flat));
+    }
+    auto rope = LoxStringRef(new LoxString(Rope, length));
+    rope->m_left = left;
+    rope->m_right = right;
+    return rope;
+}
+
+auto LoxString::slice(const LoxStringRef &parent, std::size_t start,
+                      std::size_t length) -> LoxStringRef {
+    if (start >= parent->length()) {
+        return make("");
+    }
+    if (length > parent->length() - start) {
+        length = parent->length() - start;
+    }
+    if (start == 0 && length == parent->length()) {
+        return parent;
+    }
+    auto slice = LoxStringRef(new LoxString(Slice, length));
+    // 切片的切片直接指向最初的父串，保证视图链只有一层
+    if (parent->m_kind == Slice) {
+        slice->m_parent = parent->m_parent;
+        slice->m_offset = parent->m_offset + start;
+    } else {
+        slice->m_parent = parent;
+        slice->m_offset = start;
+    }
+    return slice;
+}
+
+auto LoxString::flatten() -> void {
+    std::string flat;
+    flat.reserve(m_length);
+    // 显式栈做中序遍历，深度不受 C++ 栈限制
+    std::vector<LoxString *> stack{this};
+    while (!stack.empty()) {
+        auto node = stack.back();
+        stack.pop_back();
+        if (node->m_kind == Rope) {
+            stack.push_back(node->m_right.get());
+            stack.push_back(node->m_left.get());
+        } else {
+            flat.append(node->view());
+        }
+    }
+    m_flat = std::move(flat);
+    m_kind = Flat;
+    release(std::move(m_left));
+    release(std::move(m_right));
+}
+
+auto LoxString::view() -> std::string_view {
+    switch (m_kind) {
+    case Rope:
+        flatten();
+        return m_flat;
+    case Slice:
+        return m_parent->view().substr(m_offset, m_length);
+    default:
+        return m_flat;
+    }
+}
+
+auto LoxString::str() -> const std::string & {
+    if (m_kind == Slice) {
+        m_flat = std::string(view());
+        m_kind = Flat;
+        release(std::move(m_parent));
+    } else if (m_kind == Rope) {
+        flatten();
+    }
+    return m_flat;
+}
+
+auto LoxString::equals(LoxString &other) -> bool {
+    if (this == &other) {
+        return true;
+    }
+    if (m_length != other.m_length) {
+        return false;
+    }
+    return view() == other.view();
+}
+
+auto StringTable::intern(std::string_view str) -> LoxStringRef {
+    auto iter = m_strings.find(str);
+    if (iter != m_strings.end()) {
+        return iter->second;
+    }
+    auto interned = LoxString::make(std::string(str));
+    m_strings.emplace(interned->view(), interned);
+    return interned;
+}
+
+} // namespace lox
@@ -0,0 +1,63 @@
+#include "Interpreter/ModuleCache.h"
+#include "Interpreter/ErrorReporter.h"
+
+#include <fstream>
+#include <sstream>
+#include <system_error>
+
+namespace lox {
+
+auto ModuleCache::shared() -> const ModuleCacheRef & {
+    static const ModuleCacheRef cache = std::make_shared<ModuleCache>();
+    return cache;
+}
+
+auto ModuleCache::load(const std::string &path, std::string &errors)
+    -> ProgramRef {
+    // 命中时只查修改时间，不打开文件
+    std::error_code error;
+    auto modified = std::filesystem::last_write_time(path, error);
+    if (!error) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto iter = m_modules.find(path);
+        if (iter != m_modules.end() && iter->second.modified == modified)
+            return iter->second.program;
+    }
+    std::ifstream file;
+    if (!error)
+        file.open(path, std::ios::binary);
+    if (error || !file) {
+        errors = "Can't open module '" + path + "'.";
+        return nullptr;
+    }
+
+    // 编译时不持有锁，不同的模块可以同时编译。
+    // 两个线程同时编译同一个模块时结果相同，留下哪一个都可以
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    std::ostringstream diagnostics;
+    ErrorReporter reporter(diagnostics);
+    reporter.setFileName(path);
+    auto program = Program::compileModule(buffer.str(), path, reporter);
+    if (program == nullptr) {
+        errors = diagnostics.str();
+        if (!errors.empty() && errors.back() == '\n')
+            errors.pop_back();
+        return nullptr;
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_modules[path] = {modified, program};
+    return program;
+}
+
+auto ModuleCache::size() const -> std::size_t {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_modules.size();
+}
+
+auto ModuleCache::clear() -> void {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_modules.clear();
+}
+
+} // namespace lox
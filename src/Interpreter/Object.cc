@@ -1,19 +1,54 @@
 #include "Interpreter/Object.h"
+#include "Interpreter/LoxCallable.h"
+#include "Interpreter/LoxClass.h"
+#include "Interpreter/LoxInstance.h"
+
+#include <charconv>
+#include <cmath>
+#include <cstring>
 
 namespace lox {
 
+auto Object::formatNumber(double num, char *buf) -> std::size_t {
+    if (std::isnan(num)) {
+        std::memcpy(buf, "nan", 3);
+        return 3;
+    }
+    if (std::isinf(num)) {
+        if (num < 0) {
+            std::memcpy(buf, "-inf", 4);
+            return 4;
+        }
+        std::memcpy(buf, "inf", 3);
+        return 3;
+    }
+    auto end = buf + kNumberBufferSize;
+    // 不太大的整数按定点输出，避免 1e+16 这样的指数形式
+    auto format = (std::trunc(num) == num && std::fabs(num) < 1e21)
+                      ? std::chars_format::fixed
+                      : std::chars_format::general;
+    auto res = std::to_chars(buf, end, num, format);
+    return static_cast<std::size_t>(res.ptr - buf);
+}
+
 std::string Object::toString() {
     switch (m_type) {
     case Object_nil:
         return "nil";
     case Object_bool:
-        return m_boolean ? "1" : "0";
+        return m_boolean ? "true" : "false";
     case Object_str:
-        return m_str;
+        return std::string(m_str->view());
     case Object_fun:
-        return "function";
-    default:
-        return std::to_string(m_num);
+        return m_function->toString();
+    case Object_class:
+        return m_class->toString();
+    case Object_instance:
+        return m_instance->toString();
+    default: {
+        char buf[kNumberBufferSize];
+        return std::string(buf, formatNumber(m_num, buf));
+    }
     }
 }
 
@@ -25,9 +60,13 @@ Object Object::make_num_obj(double num) {
 }
 
 Object Object::make_str_obj(std::string str) {
+    return make_str_obj(LoxString::make(std::move(str)));
+}
+
+Object Object::make_str_obj(LoxStringRef str) {
     Object str_obj;
     str_obj.m_type = Object_str;
-    str_obj.m_str = str;
+    str_obj.m_str = std::move(str);
     return str_obj;
 }
 
@@ -1,24 +1,93 @@
 #include "Interpreter/Parser.h"
 #include "Interpreter/Expression.h"
 #include "Interpreter/Object.h"
+#include "Interpreter/Resolver.h"
+#include "Interpreter/RuntimeError.h"
 #include "Interpreter/Statements.h"
 #include "Interpreter/Token.h"
 #include "Interpreter/Tokentype.h"
 
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
 #include <memory>
-#include <stdexcept>
+#include <sstream>
+#include <utility>
 #include <vector>
 namespace lox {
 
+// 解析器递归的最大深度。只有向右嵌套的源码（括号、一元运算符、赋值、
+// 嵌套的语句）才会递归；左结合的运算链和 else if 链在循环里解析，不受限制。
+// 后面各遍遍历很高的语法树时自己检查原生栈的余量（见 stackExhausted）
+static constexpr int kMaxNesting = 1000;
+
+// 记录解析器在当前位置的递归深度：递归地解析子节点之前调用 enter。
+// 超过 kMaxNesting 时报告错误并返回 false，调用者随即返回。
+// 析构时减去这一层加上的深度
+class Parser::Nesting {
+  public:
+    explicit Nesting(Parser &parser) : m_parser(parser) {}
+    ~Nesting() { m_parser.m_nesting -= m_count; }
+    Nesting(const Nesting &) = delete;
+    auto operator=(const Nesting &) -> Nesting & = delete;
+
+    auto enter() -> bool {
+        m_count++;
+        if (++m_parser.m_nesting <= kMaxNesting)
+            return true;
+        m_parser.fail(m_parser.peek(), "Too much nesting.");
+        return false;
+    }
+
+  private:
+    Parser &m_parser;
+    int m_count = 0;
+};
+
+// 延迟解析的函数体：tokens 是 '{' 之后直到配对的 '}' 的 token 加上 EOF。
+// 诊断信息与预先解析时相同，作为函数名处的运行时错误抛出
+static auto parseBody(const std::vector<TokenRef> &tokens, const FunStmt &fun,
+                      FunctionType type, ClassType klass)
+    -> std::vector<StmtRef> {
+    std::ostringstream errors;
+    ErrorReporter reporter(errors);
+    Parser parser(tokens, &reporter);
+    auto body = parser.block();
+    if (!reporter.hadError())
+        Resolver(reporter).resolveBody(fun, body, type, klass);
+    if (reporter.hadError()) {
+        auto message = errors.str();
+        message.pop_back(); // 最后的换行
+        throw RuntimeError(fun.getName(), message);
+    }
+    return body;
+}
+
 auto Parser::parse() -> std::vector<StmtRef> {
     std::vector<StmtRef> statements;
+    // 错误数达到上限后 isAtEnd 一直为真
     while (!isAtEnd()) {
         statements.push_back(declaration());
     }
     return statements;
 }
 
+auto Parser::next(StmtRef &stmt) -> bool {
+    // 只保留 previous()，前面的 token 不会再用到
+    if (m_current > 1) {
+        m_tokens.erase(m_tokens.begin(), m_tokens.begin() + m_current - 1);
+        m_current = 1;
+    }
+    if (isAtEnd())
+        return false;
+    stmt = declaration();
+    return true;
+}
+
 auto Parser::statement() -> StmtRef {
+    Nesting nesting(*this);
+    if (!nesting.enter())
+        return nullptr;
     if (match(FOR))
         return std::dynamic_pointer_cast<Stmt>(forStatement());
 
@@ -43,21 +112,27 @@ auto Parser::statement() -> StmtRef {
 }
 
 auto Parser::declaration() -> StmtRef {
-    try {
-        if (match(CLASS)) {
-            return classDeclaration();
-        }
-        if (match(FUN)) {
-            return function("function");
-        }
-        if (match(VAR)) {
-            return varDeclaration();
-        }
-        return statement();
-    } catch (std::runtime_error error) {
-        synchronize();
+    StmtRef stmt;
+    if (match(CLASS)) {
+        stmt = classDeclaration();
+    } else if (match(FUN)) {
+        stmt = function("function");
+    } else if (match(VAR)) {
+        stmt = varDeclaration();
+    } else if (match(IMPORT)) {
+        stmt = importDeclaration();
+    } else {
+        stmt = statement();
+    }
+    // 出错后各层解析函数都已经返回，从出错的 token 开始同步；
+    // 构造了一半的语法树直接丢掉
+    if (m_panic) {
+        m_panic = false;
+        if (!m_stopped)
+            synchronize();
         return nullptr;
     }
+    return stmt;
 }
 
 auto Parser::varDeclaration() -> StmtRef {
@@ -72,9 +147,12 @@ auto Parser::varDeclaration() -> StmtRef {
 }
 
 auto Parser::function(std::string kind) -> StmtRef {
+    Nesting nesting(*this);
+    if (!nesting.enter())
+        return nullptr;
     auto name = consume(IDENTIFIER, "Expect " + kind + " name.");
     consume(LEFT_PAREN, "Expect '(' after " + kind + " name.");
-    std::vector<TokenRef> parameters;
+    std::vector<SourceToken> parameters;
     if (!check(RIGHT_PAREN)) {
         do {
             if (parameters.size() >= 255) {
@@ -85,11 +163,42 @@ auto Parser::function(std::string kind) -> StmtRef {
     }
     consume(RIGHT_PAREN, "Expect ')' after parameters.");
     consume(LEFT_BRACE, "Expect '{' before " + kind + " body.");
+    if (m_lazyBodies && m_blockDepth == 0) {
+        auto type = FunctionType::FUNCTION;
+        if (kind == "method") {
+            type = name->getLexeme() == "init" ? FunctionType::INITIALIZER
+                                               : FunctionType::METHOD;
+        }
+        return std::make_shared<FunStmt>(
+            name, parameters,
+            [tokens = skipBody(), type, klass = m_class](const FunStmt &fun) {
+                return parseBody(tokens, fun, type, klass);
+            });
+    }
     std::vector<StmtRef> body = block();
     auto fun_stmt = std::make_shared<FunStmt>(name, parameters, body);
     return fun_stmt;
 }
 
+auto Parser::skipBody() -> std::vector<TokenRef> {
+    auto start = m_current;
+    int depth = 1;
+    while (!isAtEnd()) {
+        auto type = advance()->getType();
+        if (type == LEFT_BRACE) {
+            depth++;
+        } else if (type == RIGHT_BRACE && --depth == 0) {
+            std::vector<TokenRef> tokens(m_tokens.begin() + start,
+                                         m_tokens.begin() + m_current);
+            tokens.push_back(std::make_shared<Token>(EOF_TOKEN, "", nullptr,
+                                                     previous()->getLine()));
+            return tokens;
+        }
+    }
+    fail(peek(), "Expect '}' after block.");
+    return {};
+}
+
 auto Parser::classDeclaration() -> StmtRef {
     auto name = consume(IDENTIFIER, "Expect class name.");
     VariableExpressionRef<Object> superclass = nullptr;
@@ -100,10 +209,12 @@ auto Parser::classDeclaration() -> StmtRef {
 
     consume(LEFT_BRACE, "Expect '{' before class body.");
     std::vector<FunStmtRef> methods;
+    m_class = superclass != nullptr ? ClassType::SUBCLASS : ClassType::CLASS;
     while (!check(RIGHT_BRACE) && !isAtEnd()) {
         methods.push_back(
             std::dynamic_pointer_cast<FunStmt>(function("method")));
     }
+    m_class = ClassType::NONE;
 
     consume(RIGHT_BRACE, "Expect '}' after class body.");
 
@@ -111,6 +222,43 @@ auto Parser::classDeclaration() -> StmtRef {
     return class_stmt;
 }
 
+auto Parser::importDeclaration() -> StmtRef {
+    auto keyword = previous();
+    auto pathToken = consume(STRING, "Expect module path after 'import'.");
+    if (m_panic)
+        return nullptr;
+    auto lexeme = pathToken->getLexeme();
+    std::filesystem::path path = lexeme.substr(1, lexeme.size() - 2);
+    if (path.empty()) {
+        fail(pathToken, "Module path can't be empty.");
+        return nullptr;
+    }
+    // as 不是保留字，只在这里当关键字用
+    TokenRef name;
+    if (check(IDENTIFIER) && peek()->getLexeme() == "as") {
+        advance();
+        name = consume(IDENTIFIER, "Expect module name after 'as'.");
+    } else {
+        auto stem = path.stem().string();
+        if (stem.empty() || keywordType(stem) != IDENTIFIER ||
+            std::isdigit(static_cast<unsigned char>(stem[0])) ||
+            !std::all_of(stem.begin(), stem.end(), [](char c) {
+                return std::isalnum(static_cast<unsigned char>(c)) || c == '_';
+            })) {
+            fail(pathToken, "Module file name is not an identifier; use 'as'.");
+            return nullptr;
+        }
+        name = std::make_shared<Token>(IDENTIFIER, stem, nullptr,
+                                       pathToken->getLine(),
+                                       pathToken->getColumn());
+    }
+    consume(SEMICOLON, "Expect ';' after import.");
+    if (path.is_relative() && !m_importBase.empty())
+        path = std::filesystem::path(m_importBase) / path;
+    return std::make_shared<ImportStmt>(
+        keyword, path.lexically_normal().string(), name);
+}
+
 auto Parser::printStatement() -> StmtRef {
     auto value = expression();
     consume(SEMICOLON, "Exprect ';' after value.");
@@ -126,17 +274,29 @@ auto Parser::expressionStatment() -> StmtRef {
 }
 
 auto Parser::ifStatement() -> StmtRef {
-    consume(LEFT_PAREN, "Expect '(' after 'if'.");
-    auto condition = expression();
-    consume(RIGHT_PAREN, "Expect ')' after if condition");
-
-    auto thenBranch = statement();
+    // else if 链在循环里解析，再从后往前接成嵌套的 IfStmt，
+    // 很长的分派链不会加深解析器的递归
+    std::vector<std::pair<AbstractExpressionRef<Object>, StmtRef>> branches;
     StmtRef elseBranch = nullptr;
-    if (match(ELSE)) {
-        elseBranch = statement();
+    do {
+        consume(LEFT_PAREN, "Expect '(' after 'if'.");
+        auto condition = expression();
+        consume(RIGHT_PAREN, "Expect ')' after if condition");
+        auto thenBranch = statement();
+        branches.emplace_back(condition, thenBranch);
+        if (!match(ELSE))
+            break;
+        if (!match(IF)) {
+            elseBranch = statement();
+            break;
+        }
+    } while (true);
+
+    for (auto iter = branches.rbegin(); iter != branches.rend(); ++iter) {
+        elseBranch =
+            std::make_shared<IfStmt>(iter->first, iter->second, elseBranch);
     }
-    auto if_stmt = std::make_shared<IfStmt>(condition, thenBranch, elseBranch);
-    return if_stmt;
+    return elseBranch;
 }
 
 auto Parser::whileStatement() -> StmtRef {
@@ -163,7 +323,7 @@ auto Parser::forStatement() -> StmtRef {
     if (!check(SEMICOLON)) {
         condition = expression();
     }
-    consume(LEFT_PAREN, "Expect ';' after loop condition.");
+    consume(SEMICOLON, "Expect ';' after loop condition.");
 
     AbstractExpressionRef<Object> increment = nullptr;
     if (!check(RIGHT_PAREN)) {
@@ -203,15 +363,20 @@ auto Parser::returnStatement() -> StmtRef {
 
 auto Parser::block() -> std::vector<StmtRef> {
     std::vector<StmtRef> statements;
+    m_blockDepth++;
     while (!check(RIGHT_BRACE) && !isAtEnd()) {
         statements.push_back(declaration());
     }
+    m_blockDepth--;
     consume(RIGHT_BRACE, "Expect '}' after block.");
     return statements;
 }
 
 auto Parser::assignment() -> AbstractExpressionRef<Object> {
-    auto expr = equality();
+    Nesting nesting(*this);
+    if (!nesting.enter())
+        return nullptr;
+    auto expr = Or();
     if (match(EQUAL)) {
         auto equals = previous();
         auto value = assignment();
@@ -222,6 +387,12 @@ auto Parser::assignment() -> AbstractExpressionRef<Object> {
                 std::make_shared<AssignmentExpression<Object>>(name, value);
             return res;
         }
+        auto get = dynamic_cast<GetExpression<Object> *>(expr.get());
+        if (get != nullptr) {
+            auto res = std::make_shared<SetExpression<Object>>(
+                get->getObject(), get->getName(), value);
+            return res;
+        }
 
         error(equals, "Invalid assignment target.");
     }
@@ -302,6 +473,9 @@ auto Parser::factor() -> AbstractExpressionRef<Object> {
 
 auto Parser::unary() -> AbstractExpressionRef<Object> {
     if (match(BANG, MINUS)) {
+        Nesting nesting(*this);
+        if (!nesting.enter())
+            return nullptr;
         auto opt = previous();
         auto right = unary();
         return std::static_pointer_cast<AbstractExpression<Object>>(
@@ -313,15 +487,14 @@ auto Parser::unary() -> AbstractExpressionRef<Object> {
 
 auto Parser::call() -> AbstractExpressionRef<Object> {
     auto expr = primary();
-    while (true) {
+    while (check(LEFT_PAREN) || check(DOT)) {
         if (match(LEFT_PAREN)) {
             expr = finishCall(expr);
-        } else if (match(DOT)) {
+        } else {
+            advance();
             auto name = consume(IDENTIFIER, "Expect property name after '.'.");
             auto getExpr = std::make_shared<GetExpression<Object>>(expr, name);
             expr = getExpr;
-        } else {
-            break;
         }
     }
     return expr;
@@ -406,8 +579,10 @@ auto Parser::primary() -> AbstractExpressionRef<Object> {
         auto expr = expression();
         consume(RIGHT_PAREN, "Expect ')' after expression.");
         auto res = std::make_shared<GroupingExpression<Object>>(expr);
+        return res;
     }
-    throw error(peek(), "Expect expression.");
+    fail(peek(), "Expect expression.");
+    return nullptr;
 }
 
 template <typename... Args> auto Parser::match(Args... types) -> bool {
@@ -423,7 +598,8 @@ template <typename... Args> auto Parser::match(Args... types) -> bool {
 auto Parser::consume(TokenType type, std::string message) -> TokenRef {
     if (check(type))
         return advance();
-    throw error(peek(), message);
+    fail(peek(), message);
+    return peek();
 }
 
 // 判断当前current指向的token的type和给定的token的type是否相同
@@ -439,18 +615,28 @@ auto Parser::advance() -> TokenRef {
     return previous();
 }
 
-auto Parser::isAtEnd() -> bool { return peek()->getType() == EOF_TOKEN; }
-auto Parser::peek() -> TokenRef { return m_tokens[m_current]; }
+auto Parser::isAtEnd() -> bool { return m_panic || m_stopped || atEof(); }
+auto Parser::atEof() -> bool { return peek()->getType() == EOF_TOKEN; }
+auto Parser::peek() -> TokenRef {
+    if (m_source) {
+        while (m_current >= static_cast<int>(m_tokens.size()))
+            m_tokens.push_back(m_source());
+    }
+    return m_tokens[m_current];
+}
 auto Parser::previous() -> TokenRef { return m_tokens[m_current - 1]; }
 
-std::runtime_error Parser::error(TokenRef token, std::string message) {
-    if (token->getType() == EOF_TOKEN) {
-        return std::runtime_error(std::to_string(token->getLine()) + " at end" +
-                                  message);
-    } else {
-        return std::runtime_error(std::to_string(token->getLine()) + " at '" +
-                                  token->getLexeme() + "'" + message);
-    }
+auto Parser::error(TokenRef token, std::string message) -> void {
+    if (m_panic)
+        return;
+    m_reporter->error(token, message);
+    if (m_reporter->reachedMaxErrors())
+        m_stopped = true;
+}
+
+auto Parser::fail(TokenRef token, std::string message) -> void {
+    error(std::move(token), std::move(message));
+    m_panic = true;
 }
 
 auto Parser::synchronize() -> void {
@@ -460,10 +646,11 @@ auto Parser::synchronize() -> void {
             return;
         switch (peek()->getType()) {
         default:
-            return;
+            break;
         case CLASS:
         case FUN:
         case VAR:
+        case IMPORT:
         case FOR:
         case IF:
         case WHILE:
@@ -0,0 +1,189 @@
+#include "Interpreter/Program.h"
+#include "Interpreter/Parser.h"
+#include "Interpreter/Resolver.h"
+#include "Interpreter/Scanner.h"
+#include "Interpreter/ThreadPool.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <memory>
+#include <sstream>
+#include <thread>
+
+namespace lox {
+
+// 函数只能出现在语句里（Lox 没有函数表达式），遍历语句树即可找全
+static auto collectFunctions(const StmtRef &stmt,
+                             std::vector<FunStmtRef> &functions) -> void {
+    if (stmt == nullptr)
+        return;
+    if (auto fun = std::dynamic_pointer_cast<FunStmt>(stmt)) {
+        functions.push_back(fun);
+        for (auto &body : fun->getBody()) {
+            collectFunctions(body, functions);
+        }
+    } else if (auto klass = std::dynamic_pointer_cast<ClassStmt>(stmt)) {
+        for (auto &method : klass->getMethods()) {
+            collectFunctions(method, functions);
+        }
+    } else if (auto block = std::dynamic_pointer_cast<BlockStmt>(stmt)) {
+        for (auto &inner : block->getStmt()) {
+            collectFunctions(inner, functions);
+        }
+    } else if (auto branch = std::dynamic_pointer_cast<IfStmt>(stmt)) {
+        // else if 链在循环里走
+        StmtRef next = branch;
+        for (; branch != nullptr;
+             branch = std::dynamic_pointer_cast<IfStmt>(next)) {
+            collectFunctions(branch->getThen(), functions);
+            next = branch->getElse();
+        }
+        collectFunctions(next, functions);
+    } else if (auto loop = std::dynamic_pointer_cast<WhileStmt>(stmt)) {
+        collectFunctions(loop->getBody(), functions);
+    }
+}
+
+// 与 collectFunctions 走同样的语句，但不进入函数体：
+// 延迟解析的函数体不会因此被解析
+static auto declaresFunctions(const StmtRef &stmt) -> bool {
+    if (stmt == nullptr)
+        return false;
+    if (stmt->kind() == StmtKind::Fun)
+        return true;
+    if (auto klass = std::dynamic_pointer_cast<ClassStmt>(stmt))
+        return !klass->getMethods().empty();
+    if (auto block = std::dynamic_pointer_cast<BlockStmt>(stmt)) {
+        auto &inner = block->getStmt();
+        return std::any_of(inner.begin(), inner.end(), [](auto &stmt) {
+            return declaresFunctions(stmt);
+        });
+    }
+    if (auto branch = std::dynamic_pointer_cast<IfStmt>(stmt)) {
+        StmtRef next = branch;
+        for (; branch != nullptr;
+             branch = std::dynamic_pointer_cast<IfStmt>(next)) {
+            if (declaresFunctions(branch->getThen()))
+                return true;
+            next = branch->getElse();
+        }
+        return declaresFunctions(next);
+    }
+    if (auto loop = std::dynamic_pointer_cast<WhileStmt>(stmt))
+        return declaresFunctions(loop->getBody());
+    return false;
+}
+
+auto Program::compile(const std::string &source, ErrorReporter &reporter,
+                      StringTable *strings, bool lazy) -> ProgramRef {
+    std::shared_ptr<Program> program(new Program());
+    if (strings == nullptr) {
+        strings = &program->m_strings;
+    }
+    reporter.reset();
+    auto scanner = std::make_shared<Scanner>(source, strings, &reporter);
+    // 很大的源码（生成的数据表等）分块并行扫描，小的源码仍然顺序扫描
+    auto tokens = scanner->scanTokensParallel();
+    auto parser = std::make_shared<Parser>(tokens, &reporter);
+    parser->setLazyBodies(lazy);
+    program->m_statements = parser->parse();
+    if (reporter.hadError())
+        return nullptr;
+
+    // 顶层作用域不在 Resolver 中记录，每次编译用新的 Resolver 即可
+    auto resolver = std::make_shared<Resolver>(reporter);
+    resolver->resolve(program->m_statements);
+    if (reporter.hadError())
+        return nullptr;
+    return program;
+}
+
+auto Program::compileModule(const std::string &source,
+                            const std::string &path, ErrorReporter &reporter)
+    -> ProgramRef {
+    std::shared_ptr<Program> program(new Program());
+    reporter.reset();
+    Scanner scanner(source, &program->m_strings, &reporter);
+    Parser parser(scanner.scanTokensParallel(), &reporter);
+    parser.setImportBase(std::filesystem::path(path).parent_path().string());
+    program->m_statements = parser.parse();
+    if (reporter.hadError())
+        return nullptr;
+    Resolver(reporter).resolveModule(program->m_statements);
+    if (reporter.hadError())
+        return nullptr;
+    return program;
+}
+
+auto Program::compileFiles(const std::vector<SourceFile> &files,
+                           ErrorReporter &reporter, StringTable *strings,
+                           bool lazy, std::size_t threads) -> ProgramRef {
+    std::shared_ptr<Program> program(new Program());
+    if (strings == nullptr) {
+        strings = &program->m_strings;
+    }
+    reporter.reset();
+
+    // 每个文件的诊断信息先写到自己的 ErrorReporter，最后按文件顺序合并
+    struct Unit {
+        std::ostringstream errors;
+        ErrorReporter reporter{errors};
+        std::vector<TokenRef> tokens;
+        std::vector<StmtRef> statements;
+    };
+    std::vector<Unit> units(files.size());
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    ThreadPool pool(std::max<std::size_t>(1, std::min(threads, files.size())));
+    for (std::size_t i = 0; i < files.size(); i++) {
+        pool.submit([&, i] {
+            units[i].reporter.setFileName(files[i].name);
+            units[i].reporter.setMaxErrors(reporter.getMaxErrors());
+            Scanner scanner(files[i].source, nullptr, &units[i].reporter);
+            units[i].tokens = scanner.scanTokens();
+        });
+    }
+    pool.wait();
+    // 驻留表不是线程安全的，字面量在两个阶段之间按文件顺序驻留
+    for (auto &unit : units) {
+        Scanner::internStrings(unit.tokens, *strings);
+    }
+    // 顶层作用域不在 Resolver 中记录，每个文件可以单独解析变量
+    for (std::size_t i = 0; i < files.size(); i++) {
+        pool.submit([&, i] {
+            auto &unit = units[i];
+            Parser parser(std::move(unit.tokens), &unit.reporter);
+            parser.setLazyBodies(lazy);
+            unit.statements = parser.parse();
+            if (!unit.reporter.hadError())
+                Resolver(unit.reporter).resolve(unit.statements);
+        });
+    }
+    pool.wait();
+
+    for (auto &unit : units) {
+        reporter.forward(unit.errors.str(), unit.reporter);
+        program->m_statements.insert(program->m_statements.end(),
+                                     unit.statements.begin(),
+                                     unit.statements.end());
+    }
+    if (reporter.hadError())
+        return nullptr;
+    return program;
+}
+
+auto Program::declaresFunctions() const -> bool {
+    return std::any_of(m_statements.begin(), m_statements.end(),
+                       [](auto &stmt) { return lox::declaresFunctions(stmt); });
+}
+
+auto Program::getFunctions() const -> const std::vector<FunStmtRef> & {
+    std::call_once(m_collected, [this] {
+        for (auto &stmt : m_statements) {
+            collectFunctions(stmt, m_functions);
+        }
+    });
+    return m_functions;
+}
+
+} // namespace lox
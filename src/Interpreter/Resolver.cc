@@ -1,27 +1,59 @@
 #include "Interpreter/Resolver.h"
 #include "Interpreter/Expression.h"
-#include "Interpreter/Lox.h"
 #include "Interpreter/Object.h"
 #include "Interpreter/Parser.h"
 #include "Interpreter/Statements.h"
+#include "Runtime/StackProbe.h"
 
 #include <string>
 #include <unordered_map>
 namespace lox {
 
-static Lox lox;
-auto Resolver::resolve(std::vector<StmtRef> statements) -> void {
-    for (auto statement : statements) {
+auto Resolver::resolve(const std::vector<StmtRef> &statements) -> void {
+    for (const auto &statement : statements) {
         resolve(statement);
     }
 };
 
-auto Resolver::resolve(StmtRef stmt) -> void {
-    stmt->accept(shared_from_this());
+auto Resolver::resolve(const StmtRef &stmt) -> void { visitStmt(*stmt); }
+
+auto Resolver::resolve(const AbstractExpressionRef<Object> &expr) -> void {
+    // 语法树的高度不受 Parser 限制（很长的 a + b + …），原生栈快用完时
+    // 报告错误，不再往下走
+    if (stackExhausted()) {
+        if (auto *where = exprToken(*expr)) {
+            m_reporter->error(*where, "Too much nesting.");
+            return;
+        }
+    }
+    visitExpr(*expr);
 }
 
-auto Resolver::resolve(AbstractExpressionRef<Object> expr) -> void {
-    expr->accept(shared_from_this());
+auto Resolver::declaredName(const StmtRef &stmt) -> const SourceToken * {
+    switch (stmt->kind()) {
+    case StmtKind::Var:
+        return &static_cast<VarStmt &>(*stmt).getName();
+    case StmtKind::Fun:
+        return &static_cast<FunStmt &>(*stmt).getName();
+    case StmtKind::Class:
+        return &static_cast<ClassStmt &>(*stmt).getName();
+    case StmtKind::Import:
+        return &static_cast<ImportStmt &>(*stmt).getName();
+    default:
+        return nullptr;
+    }
+}
+
+auto Resolver::resolveModule(const std::vector<StmtRef> &statements) -> void {
+    m_module = true;
+    beginScope();
+    for (const auto &statement : statements) {
+        if (auto name = declaredName(statement))
+            m_scopes.back()[name->getLexeme()] = true;
+    }
+    resolve(statements);
+    endScope();
+    m_module = false;
 }
 
 auto Resolver::beginScope() -> void {
@@ -29,127 +61,165 @@ auto Resolver::beginScope() -> void {
     m_scopes.push_back(scope);
 }
 
-auto Resolver::endScope() -> void { m_scopes.pop_front(); }
+auto Resolver::endScope() -> void { m_scopes.pop_back(); }
 
-auto Resolver::declare(TokenRef name) -> void {
+auto Resolver::declare(const SourceToken &name) -> void {
     if (m_scopes.empty()) {
         return;
     }
-    auto scope = m_scopes.back();
-    if (scope.find(name->getLexeme()) != scope.end()) {
-        lox.error(name, "Already variable with this name in this scope.");
+    auto &scope = m_scopes.back();
+    if (scope.find(name.getLexeme()) != scope.end() &&
+        !(m_module && m_scopes.size() == 1)) {
+        m_reporter->error(name, "Already variable with this name in this scope.");
     }
-    scope.insert({name->getLexeme(), false});
+    scope.insert({name.getLexeme(), false});
 }
-auto Resolver::define(TokenRef name) -> void {
+auto Resolver::define(const SourceToken &name) -> void {
     if (m_scopes.empty()) {
         return;
     }
-    m_scopes.back().insert({name->getLexeme(), true});
+    m_scopes.back()[name.getLexeme()] = true;
 }
 
-auto Resolver::resolveLocal(AbstractExpressionRef<Object> expr, TokenRef name)
-    -> void {
+auto Resolver::resolveLocal(AbstractExpression<Object> &expr,
+                            const SourceToken &name) -> void {
     for (int i = m_scopes.size() - 1; i >= 0; i--) {
-        if (m_scopes[i].find(name->getLexeme()) != m_scopes[i].end()) {
-            m_interpret->resolve(expr, m_scopes.size() - 1 - i);
+        if (m_scopes[i].find(name.getLexeme()) != m_scopes[i].end()) {
+            expr.setDepth(m_scopes.size() - 1 - i);
             return;
         }
     }
 }
 
-auto Resolver::resolveFun(FunStmtRef fun, FunctionType type) -> void {
+auto Resolver::resolveFun(const FunStmt &fun, FunctionType type) -> void {
+    if (fun.isLazy())
+        return;
     FunctionType enclosingFun = current_function;
     current_function = type;
     beginScope();
-    for (auto param : fun->getParams()) {
+    for (const auto &param : fun.getParams()) {
         declare(param);
         define(param);
     }
-    resolve(fun->getBody());
+    resolve(fun.getBody());
     endScope();
     current_function = enclosingFun;
 }
 
-auto Resolver::visitBlockStmt(BlockStmtRef stmt) -> void {
+auto Resolver::resolveBody(const FunStmt &fun, const std::vector<StmtRef> &body,
+                           FunctionType type, ClassType klass) -> void {
+    // 与 visitClassStmt 建立的作用域相同
+    current_class = klass;
+    if (klass == ClassType::SUBCLASS) {
+        beginScope();
+        m_scopes.back().insert({"super", true});
+    }
+    if (klass != ClassType::NONE) {
+        beginScope();
+        m_scopes.back().insert({"this", true});
+    }
+    current_function = type;
+    beginScope();
+    for (const auto &param : fun.getParams()) {
+        declare(param);
+        define(param);
+    }
+    resolve(body);
+    m_scopes.clear();
+    current_function = FunctionType::NONE;
+    current_class = ClassType::NONE;
+}
+
+auto Resolver::visitBlockStmt(BlockStmt &stmt) -> void {
     beginScope();
-    resolve(stmt->getStmt());
+    resolve(stmt.getStmt());
     endScope();
-    return;
 }
 
-auto Resolver::visitVarStmt(VarStmtRef stmt) -> void {
-    declare(stmt->getName());
-    if (stmt->getInitExpr() != nullptr) {
-        resolve(stmt->getInitExpr());
+auto Resolver::visitVarStmt(VarStmt &stmt) -> void {
+    declare(stmt.getName());
+    if (stmt.getInitExpr() != nullptr) {
+        resolve(stmt.getInitExpr());
     }
-    define(stmt->getName());
-    return;
+    define(stmt.getName());
 }
 
-auto Resolver::visitFunStmt(FunStmtRef stmt, FunctionType type) -> void {
-    declare(stmt->getName());
-    define(stmt->getName());
+auto Resolver::visitFunStmt(FunStmt &stmt) -> void {
+    declare(stmt.getName());
+    define(stmt.getName());
     resolveFun(stmt, FunctionType::FUNCTION);
-    return;
 }
 
-auto Resolver::visitExpressionStmt(ExpressionStmtRef stmt) -> void {
-    resolve(stmt);
-    return;
+auto Resolver::visitExpressionStmt(ExpressionStmt &stmt) -> void {
+    resolve(stmt.getExpr());
 }
 
-auto Resolver::visitIfStmt(IfStmtRef stmt) -> void {
-    resolve(stmt->getCondition());
-    resolve(stmt->getThen());
-    if (stmt->getElse() != nullptr)
-        resolve(stmt->getElse());
-    return;
+auto Resolver::visitIfStmt(IfStmt &stmt) -> void {
+    // else if 链在循环里处理
+    for (auto *branch = &stmt;;) {
+        resolve(branch->getCondition());
+        resolve(branch->getThen());
+        auto &next = branch->getElse();
+        if (next == nullptr)
+            break;
+        if (next->kind() != StmtKind::If) {
+            resolve(next);
+            break;
+        }
+        branch = static_cast<IfStmt *>(next.get());
+    }
 }
 
-auto Resolver::visitPrintStmt(PrintStmtRef stmt) -> void {
-    resolve(stmt->getExpr());
-    return;
+auto Resolver::visitPrintStmt(PrintStmt &stmt) -> void {
+    resolve(stmt.getExpr());
 }
 
-auto Resolver::visitReturnStmt(ReturnStmtRef stmt) -> void {
+auto Resolver::visitReturnStmt(ReturnStmt &stmt) -> void {
     if (current_function == FunctionType::NONE) {
-        lox.error(stmt->getKeyword(), "Can't return from top-level code.");
+        m_reporter->error(stmt.getKeyword(), "Can't return from top-level code.");
     }
-    if (stmt->getValue() != nullptr) {
+    if (stmt.getValue() != nullptr) {
         if (current_function == FunctionType::INITIALIZER) {
-            lox.error(stmt->getKeyword(),
+            m_reporter->error(stmt.getKeyword(),
                       "Can't return a value from an initializer.");
         }
+        // 尾位置上的调用由外层的 LoxFunction::call 接着执行，不再嵌套
+        if (stmt.getValue()->kind() == ExprKind::Call) {
+            static_cast<CallExpression<Object> &>(*stmt.getValue())
+                .setTailCall(current_function != FunctionType::INITIALIZER);
+        }
 
-        resolve(stmt->getValue());
+        resolve(stmt.getValue());
     }
-    return;
 }
 
-auto Resolver::visitWhileStmt(WhileStmtRef stmt) -> void {
-    resolve(stmt->getCondition());
-    resolve(stmt->getBody());
-    return;
+auto Resolver::visitWhileStmt(WhileStmt &stmt) -> void {
+    resolve(stmt.getCondition());
+    resolve(stmt.getBody());
+}
+
+auto Resolver::visitImportStmt(ImportStmt &stmt) -> void {
+    declare(stmt.getName());
+    define(stmt.getName());
 }
 
-auto Resolver::visitClassStmt(ClassStmtRef stmt) -> void {
+auto Resolver::visitClassStmt(ClassStmt &stmt) -> void {
     ClassType enclosingClass = current_class;
     current_class = ClassType::CLASS;
-    declare(stmt->getName());
-    define(stmt->getName());
-    if (stmt->getSuper() != nullptr &&
-        stmt->getName()->getLexeme() ==
-            stmt->getSuper()->getName()->getLexeme()) {
-        lox.error(stmt->getSuper()->getName(),
+    declare(stmt.getName());
+    define(stmt.getName());
+    if (stmt.getSuper() != nullptr &&
+        stmt.getName().getLexeme() ==
+            stmt.getSuper()->getName().getLexeme()) {
+        m_reporter->error(stmt.getSuper()->getName(),
                   "A class can't inherit from itself.");
     }
-    if (stmt->getSuper() != nullptr) {
+    if (stmt.getSuper() != nullptr) {
         current_class = ClassType::SUBCLASS;
-        resolve(stmt->getSuper());
+        resolve(stmt.getSuper());
     }
 
-    if (stmt->getSuper() != nullptr) {
+    if (stmt.getSuper() != nullptr) {
         beginScope();
         m_scopes.back().insert({"super", true});
     }
@@ -157,108 +227,96 @@ auto Resolver::visitClassStmt(ClassStmtRef stmt) -> void {
     beginScope();
     m_scopes.back().insert({"this", true});
 
-    for (auto &method : stmt->getMethods()) {
+    for (auto &method : stmt.getMethods()) {
         FunctionType declaration = FunctionType::METHOD;
-        if (method->getName()->getLexeme() == "init") {
+        if (method->getName().getLexeme() == "init") {
             declaration = FunctionType::INITIALIZER;
         }
 
-        resolveFun(method, declaration);
+        resolveFun(*method, declaration);
     }
     endScope();
-    if (stmt->getSuper() != nullptr)
+    if (stmt.getSuper() != nullptr)
         endScope();
     current_class = enclosingClass;
-    return;
 }
 
 /*************************************************************/
 /*   Expression      */
 /*************************************************************/
 
-auto Resolver::visitVariableExpr(VariableExpressionRef<Object> expr) -> Object {
-    if (!m_scopes.empty() &&
-        m_scopes.back().at(expr->getName()->getLexeme()) == false) {
-        lox.error(expr->getName(),
-                  "Can't read local variable in its own initializer.");
+auto Resolver::visitVariableExpr(VariableExpression<Object> &expr) -> void {
+    if (!m_scopes.empty()) {
+        auto &scope = m_scopes.back();
+        auto iter = scope.find(expr.getName().getLexeme());
+        if (iter != scope.end() && iter->second == false) {
+            m_reporter->error(expr.getName(),
+                      "Can't read local variable in its own initializer.");
+        }
     }
-    resolveLocal(expr, expr->getName());
-    return Object::make_nil_obj();
+    resolveLocal(expr, expr.getName());
 }
 
-auto Resolver::visitAssignmentExpr(AssignmentExpressionRef<Object> expr)
-    -> Object {
-    resolve(expr->getValue());
-    resolveLocal(expr, expr->getName());
-    return Object::make_nil_obj();
+auto Resolver::visitAssignmentExpr(AssignmentExpression<Object> &expr) -> void {
+    resolve(expr.getValue());
+    resolveLocal(expr, expr.getName());
 }
 
-auto Resolver::visitBinaryExpr(BinaryExpressionRef<Object> expr) -> Object {
-    resolve(expr->getLeftExpr());
-    resolve(expr->getRightExpr());
-    return Object::make_nil_obj();
+auto Resolver::visitBinaryExpr(BinaryExpression<Object> &expr) -> void {
+    resolve(expr.getLeftExpr());
+    resolve(expr.getRightExpr());
 }
 
-auto Resolver::visitCallExpr(CallExpressionRef<Object> expr) -> Object {
-    resolve(expr->getCallee());
-    for (auto arg : expr->getArgs()) {
+auto Resolver::visitCallExpr(CallExpression<Object> &expr) -> void {
+    resolve(expr.getCallee());
+    for (const auto &arg : expr.getArgs()) {
         resolve(arg);
     }
-    return Object::make_nil_obj();
 }
 
-auto Resolver::visitGroupingExpr(GroupingExpressionRef<Object> expr) -> Object {
-    resolve(expr->getExpr());
-    return Object::make_nil_obj();
+auto Resolver::visitGroupingExpr(GroupingExpression<Object> &expr) -> void {
+    resolve(expr.getExpr());
 }
 
-auto Resolver::visitLiteralExpr(LiteralExpressionRef<Object> expr) -> Object {
-    return Object::make_nil_obj();
-}
+auto Resolver::visitLiteralExpr(LiteralExpression<Object> &) -> void {}
 
-auto Resolver::visitLogicalExpr(LogicalExpressionRef<Object> expr) -> Object {
-    resolve(expr->getLeftExpr());
-    resolve(expr->getRightExpr());
-    return Object::make_nil_obj();
+auto Resolver::visitLogicalExpr(LogicalExpression<Object> &expr) -> void {
+    resolve(expr.getLeftExpr());
+    resolve(expr.getRightExpr());
 }
 
-auto Resolver::visitUnaryExpr(UnaryExpressionRef<Object> expr) -> Object {
-    resolve(expr->getRightExpr());
-    return Object::make_nil_obj();
+auto Resolver::visitUnaryExpr(UnaryExpression<Object> &expr) -> void {
+    resolve(expr.getRightExpr());
 }
 
-auto Resolver::visitGetExpr(GetExpressionRef<Object> expr) -> Object {
-    resolve(expr->getObject());
-    return Object::make_nil_obj();
+auto Resolver::visitGetExpr(GetExpression<Object> &expr) -> void {
+    resolve(expr.getObject());
 }
 
-auto Resolver::visitSetExpr(SetExpressionRef<Object> expr) -> Object {
-    resolve(expr->getValue());
-    resolve(expr->getObject());
-    return Object::make_nil_obj();
+auto Resolver::visitSetExpr(SetExpression<Object> &expr) -> void {
+    resolve(expr.getValue());
+    resolve(expr.getObject());
 }
 
-auto Resolver::visitThisExpr(ThisExpressionRef<Object> expr) -> Object {
+auto Resolver::visitThisExpr(ThisExpression<Object> &expr) -> void {
     if (current_class == ClassType::NONE) {
-        lox.error(expr->getKeyword(), "Can't use 'this' outside of a class.");
-        return Object::make_nil_obj();
+        m_reporter->error(expr.getKeyword(), "Can't use 'this' outside of a class.");
+        return;
     }
-    resolveLocal(expr, expr->getKeyword());
-    return Object::make_nil_obj();
+    resolveLocal(expr, expr.getKeyword());
 }
 
-auto Resolver::visitSuperExpr(SuperExpressionRef<Object> expr) -> Object {
+auto Resolver::visitSuperExpr(SuperExpression<Object> &expr) -> void {
 
     if (current_class == ClassType::NONE) {
-        lox.error(expr->getKey(), "Can't use 'super' outside of a class.");
-    } else if (current_class == ClassType::SUBCLASS) {
+        m_reporter->error(expr.getKey(), "Can't use 'super' outside of a class.");
+    } else if (current_class != ClassType::SUBCLASS) {
 
-        lox.error(expr->getKey(),
+        m_reporter->error(expr.getKey(),
                   "Can't use 'super' in a class with no superclass.");
     }
 
-    resolveLocal(expr, expr->getKey());
-    return Object::make_nil_obj();
+    resolveLocal(expr, expr.getKey());
 }
 
 } // namespace lox
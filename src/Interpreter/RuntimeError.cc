@@ -3,7 +3,7 @@
 
 namespace lox {
 
-auto RuntimeError::getToken() -> TokenRef { return m_token; }
+auto RuntimeError::getToken() const -> const SourceToken & { return m_token; }
 auto RuntimeError::getMessage() -> std::string { return m_message; }
 
 } // namespace lox
@@ -0,0 +1,312 @@
+#include "Interpreter/ScanKernels.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <initializer_list>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define LOX_SCAN_X64 1
+#include <immintrin.h>
+// 只有这些函数使用 AVX2 指令，调用前先检查 CPU
+#define LOX_SCAN_AVX2 __attribute__((target("avx2")))
+#endif
+
+namespace lox {
+
+static inline auto isIdentifierChar(char c) -> bool {
+    auto lower = static_cast<unsigned char>(c | 0x20);
+    return (lower >= 'a' && lower <= 'z') || (c >= '0' && c <= '9') ||
+           c == '_';
+}
+
+/*******************************************************************/
+/*         标量实现                                                */
+/*******************************************************************/
+
+static auto skipWhitespaceScalar(const char *p, const char *end, int *lines)
+    -> const char * {
+    for (; p < end; p++) {
+        if (*p == '\n')
+            ++*lines;
+        else if (*p != ' ' && *p != '\t' && *p != '\r')
+            break;
+    }
+    return p;
+}
+
+static auto findNewlineScalar(const char *p, const char *end)
+    -> const char * {
+    auto *found = static_cast<const char *>(std::memchr(p, '\n', end - p));
+    return found != nullptr ? found : end;
+}
+
+static auto findQuoteScalar(const char *p, const char *end, int *lines)
+    -> const char * {
+    for (; p < end && *p != '"'; p++) {
+        if (*p == '\n')
+            ++*lines;
+    }
+    return p;
+}
+
+static auto skipIdentifierScalar(const char *p, const char *end)
+    -> const char * {
+    while (p < end && isIdentifierChar(*p))
+        p++;
+    return p;
+}
+
+#ifdef LOX_SCAN_X64
+
+// 大多数空白（单个空格）和标识符都很短，SIMD 实现先逐字节检查这么多个，
+// 还没结束时才按块扫描
+static constexpr int kScalarPrefix = 8;
+
+// 逐字节检查至多 kScalarPrefix 个字节，遇到不满足条件的字节时返回 true
+static inline auto whitespacePrefix(const char *&p, const char *end,
+                                    int *lines) -> bool {
+    for (int i = 0; i < kScalarPrefix && p < end; i++, p++) {
+        if (*p == '\n')
+            ++*lines;
+        else if (*p != ' ' && *p != '\t' && *p != '\r')
+            return true;
+    }
+    return p == end;
+}
+
+static inline auto identifierPrefix(const char *&p, const char *end) -> bool {
+    for (int i = 0; i < kScalarPrefix && p < end; i++, p++) {
+        if (!isIdentifierChar(*p))
+            return true;
+    }
+    return p == end;
+}
+
+// 块内第一个不满足条件的字节之前（mask 的低位）有多少个换行
+static inline auto newlinesBefore(std::uint32_t newlines, int index) -> int {
+    return __builtin_popcount(newlines & ((1u << index) - 1));
+}
+
+/*******************************************************************/
+/*         SSE2：x86-64 上总是可用                                 */
+/*******************************************************************/
+
+static inline auto eq16(__m128i v, char c) -> __m128i {
+    return _mm_cmpeq_epi8(v, _mm_set1_epi8(c));
+}
+
+static inline auto mask16(__m128i v) -> std::uint32_t {
+    return static_cast<std::uint32_t>(_mm_movemask_epi8(v));
+}
+
+static auto skipWhitespaceSse2(const char *p, const char *end, int *lines)
+    -> const char * {
+    if (whitespacePrefix(p, end, lines))
+        return p;
+    for (; end - p >= 16; p += 16) {
+        auto v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+        auto newline = eq16(v, '\n');
+        auto space = _mm_or_si128(_mm_or_si128(eq16(v, ' '), eq16(v, '\t')),
+                                  _mm_or_si128(eq16(v, '\r'), newline));
+        auto other = ~mask16(space) & 0xFFFF;
+        auto newlines = mask16(newline);
+        if (other != 0) {
+            auto index = __builtin_ctz(other);
+            *lines += newlinesBefore(newlines, index);
+            return p + index;
+        }
+        *lines += __builtin_popcount(newlines);
+    }
+    return skipWhitespaceScalar(p, end, lines);
+}
+
+static auto findNewlineSse2(const char *p, const char *end) -> const char * {
+    for (; end - p >= 16; p += 16) {
+        auto v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+        if (auto found = mask16(eq16(v, '\n')))
+            return p + __builtin_ctz(found);
+    }
+    return findNewlineScalar(p, end);
+}
+
+static auto findQuoteSse2(const char *p, const char *end, int *lines)
+    -> const char * {
+    for (; end - p >= 16; p += 16) {
+        auto v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+        auto quotes = mask16(eq16(v, '"'));
+        auto newlines = mask16(eq16(v, '\n'));
+        if (quotes != 0) {
+            auto index = __builtin_ctz(quotes);
+            *lines += newlinesBefore(newlines, index);
+            return p + index;
+        }
+        *lines += __builtin_popcount(newlines);
+    }
+    return findQuoteScalar(p, end, lines);
+}
+
+// 有符号比较：0x80 以上的字节是负数，不会落在任何一个范围里
+static auto skipIdentifierSse2(const char *p, const char *end)
+    -> const char * {
+    if (identifierPrefix(p, end))
+        return p;
+    for (; end - p >= 16; p += 16) {
+        auto v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+        auto lower = _mm_or_si128(v, _mm_set1_epi8(0x20));
+        auto alpha =
+            _mm_and_si128(_mm_cmpgt_epi8(lower, _mm_set1_epi8('a' - 1)),
+                          _mm_cmplt_epi8(lower, _mm_set1_epi8('z' + 1)));
+        auto digit = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8('0' - 1)),
+                                   _mm_cmplt_epi8(v, _mm_set1_epi8('9' + 1)));
+        auto ident = _mm_or_si128(_mm_or_si128(alpha, digit), eq16(v, '_'));
+        auto other = ~mask16(ident) & 0xFFFF;
+        if (other != 0)
+            return p + __builtin_ctz(other);
+    }
+    return skipIdentifierScalar(p, end);
+}
+
+/*******************************************************************/
+/*         AVX2                                                    */
+/*******************************************************************/
+
+LOX_SCAN_AVX2 static inline auto eq32(__m256i v, char c) -> __m256i {
+    return _mm256_cmpeq_epi8(v, _mm256_set1_epi8(c));
+}
+
+LOX_SCAN_AVX2 static inline auto mask32(__m256i v) -> std::uint32_t {
+    return static_cast<std::uint32_t>(_mm256_movemask_epi8(v));
+}
+
+LOX_SCAN_AVX2 static auto skipWhitespaceAvx2(const char *p, const char *end,
+                                             int *lines) -> const char * {
+    if (whitespacePrefix(p, end, lines))
+        return p;
+    for (; end - p >= 32; p += 32) {
+        auto v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+        auto newline = eq32(v, '\n');
+        auto space =
+            _mm256_or_si256(_mm256_or_si256(eq32(v, ' '), eq32(v, '\t')),
+                            _mm256_or_si256(eq32(v, '\r'), newline));
+        auto other = ~mask32(space);
+        auto newlines = mask32(newline);
+        if (other != 0) {
+            auto index = __builtin_ctz(other);
+            *lines += newlinesBefore(newlines, index);
+            return p + index;
+        }
+        *lines += __builtin_popcount(newlines);
+    }
+    return skipWhitespaceSse2(p, end, lines);
+}
+
+LOX_SCAN_AVX2 static auto findNewlineAvx2(const char *p, const char *end)
+    -> const char * {
+    for (; end - p >= 32; p += 32) {
+        auto v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+        if (auto found = mask32(eq32(v, '\n')))
+            return p + __builtin_ctz(found);
+    }
+    return findNewlineSse2(p, end);
+}
+
+LOX_SCAN_AVX2 static auto findQuoteAvx2(const char *p, const char *end,
+                                        int *lines) -> const char * {
+    for (; end - p >= 32; p += 32) {
+        auto v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+        auto quotes = mask32(eq32(v, '"'));
+        auto newlines = mask32(eq32(v, '\n'));
+        if (quotes != 0) {
+            auto index = __builtin_ctz(quotes);
+            *lines += newlinesBefore(newlines, index);
+            return p + index;
+        }
+        *lines += __builtin_popcount(newlines);
+    }
+    return findQuoteSse2(p, end, lines);
+}
+
+LOX_SCAN_AVX2 static auto skipIdentifierAvx2(const char *p, const char *end)
+    -> const char * {
+    if (identifierPrefix(p, end))
+        return p;
+    for (; end - p >= 32; p += 32) {
+        auto v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+        auto lower = _mm256_or_si256(v, _mm256_set1_epi8(0x20));
+        auto alpha = _mm256_andnot_si256(
+            _mm256_cmpgt_epi8(lower, _mm256_set1_epi8('z')),
+            _mm256_cmpgt_epi8(lower, _mm256_set1_epi8('a' - 1)));
+        auto digit = _mm256_andnot_si256(
+            _mm256_cmpgt_epi8(v, _mm256_set1_epi8('9')),
+            _mm256_cmpgt_epi8(v, _mm256_set1_epi8('0' - 1)));
+        auto ident =
+            _mm256_or_si256(_mm256_or_si256(alpha, digit), eq32(v, '_'));
+        auto other = ~mask32(ident);
+        if (other != 0)
+            return p + __builtin_ctz(other);
+    }
+    return skipIdentifierSse2(p, end);
+}
+
+#endif // LOX_SCAN_X64
+
+static const ScanKernels kScalar = {ScanKernels::Path::Scalar,
+                                    skipWhitespaceScalar, findNewlineScalar,
+                                    findQuoteScalar, skipIdentifierScalar};
+#ifdef LOX_SCAN_X64
+static const ScanKernels kSse2 = {ScanKernels::Path::Sse2, skipWhitespaceSse2,
+                                  findNewlineSse2, findQuoteSse2,
+                                  skipIdentifierSse2};
+static const ScanKernels kAvx2 = {ScanKernels::Path::Avx2, skipWhitespaceAvx2,
+                                  findNewlineAvx2, findQuoteAvx2,
+                                  skipIdentifierAvx2};
+#endif
+
+auto ScanKernels::get(Path path) -> const ScanKernels * {
+    switch (path) {
+    case Path::Scalar:
+        return &kScalar;
+#ifdef LOX_SCAN_X64
+    case Path::Sse2:
+        return &kSse2;
+    case Path::Avx2:
+        return __builtin_cpu_supports("avx2") ? &kAvx2 : nullptr;
+#else
+    default:
+        return nullptr;
+#endif
+    }
+    return nullptr;
+}
+
+static auto selectBest() -> const ScanKernels & {
+    const char *value = std::getenv("LOX_SIMD");
+    if (value != nullptr &&
+        (std::strcmp(value, "off") == 0 || std::strcmp(value, "0") == 0))
+        return kScalar;
+    for (auto path : {ScanKernels::Path::Avx2, ScanKernels::Path::Sse2}) {
+        if (auto *kernels = ScanKernels::get(path))
+            return *kernels;
+    }
+    return kScalar;
+}
+
+auto ScanKernels::best() -> const ScanKernels & {
+    static const ScanKernels &kernels = selectBest();
+    return kernels;
+}
+
+auto ScanKernels::pathName(Path path) -> const char * {
+    switch (path) {
+    case Path::Scalar:
+        return "scalar";
+    case Path::Sse2:
+        return "sse2";
+    case Path::Avx2:
+        return "avx2";
+    }
+    return "unknown";
+}
+
+} // namespace lox
@@ -1,40 +1,81 @@
 #include "Interpreter/Scanner.h"
-#include "Interpreter/Lox.h"
 #include "Interpreter/Object.h"
 #include "Interpreter/Token.h"
+#include "Interpreter/ThreadPool.h"
 #include "Interpreter/Tokentype.h"
-#include <cctype>
+#include <algorithm>
+#include <cstring>
+#include <iterator>
 #include <memory>
 #include <string>
+#include <string_view>
+#include <thread>
 
 namespace lox {
 
-static Lox lox;
-auto Scanner::isAtEnd() -> bool {
-    return m_current >= static_cast<int>(m_source.size());
+// 只认 ASCII，不受 locale 影响
+static auto isAlpha(char c) -> bool {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
 }
 
+static auto isDigit(char c) -> bool { return c >= '0' && c <= '9'; }
+
+Scanner::Scanner(std::string_view text, int begin, int end, int line,
+                 const ScanKernels &kernels)
+    : m_text(text), m_end(end), m_chunk(true), m_strings(nullptr),
+      m_reporter(&m_ownReporter), m_kernels(&kernels), m_start(begin),
+      m_current(begin), m_line(line) {
+    // 块从换行之后开始，只有重新扫描越过块尾的字符串时才要往回找
+    auto *newline =
+        static_cast<const char *>(memrchr(text.data(), '\n', begin));
+    m_lineStart = newline != nullptr ? newline - text.data() + 1 : 0;
+}
+
+auto Scanner::error(const std::string &message) -> void {
+    // 出错的字符（没有结束的字符串是源码末尾）
+    auto column = m_current - m_lineStart;
+    if (m_chunk)
+        m_errors.push_back({m_line, column, m_start, message});
+    else
+        m_reporter->error(m_line, message, column);
+}
+
+auto Scanner::newLines(int from, int to) -> void {
+    auto *data = m_text.data();
+    auto *newline =
+        static_cast<const char *>(memrchr(data + from, '\n', to - from));
+    if (newline != nullptr)
+        m_lineStart = static_cast<int>(newline - data) + 1;
+}
+
+auto Scanner::hasMoreInput() const -> bool {
+    return m_end < static_cast<int>(m_text.size()) ||
+           (m_input != nullptr && !m_inputDone);
+}
+
+auto Scanner::isAtEnd() -> bool { return m_current >= m_end; }
+
 auto Scanner::advance() -> char {
     m_current++;
-    return m_source[m_current - 1];
+    return m_text[m_current - 1];
 }
 
-// TODO: 根据type生成对应的token对象加入m_tokens中
-auto Scanner::addToken(TokenType type) -> void {
-    auto literal_obj = lox::Object::make_nil_obj();
-    auto literal = std::make_shared<Object>(literal_obj);
-    addToken(type, literal);
-}
+auto Scanner::addToken(TokenType type) -> void { addToken(type, nullptr); }
 
 auto Scanner::addToken(TokenType type, ObjectRef literal) -> void {
-    std::string lexeme = m_source.substr(m_start, m_current - m_start);
-    m_tokens.push_back(std::make_shared<Token>(type, lexeme, literal, m_line));
+    // 只有标识符和数字保存词素，见 Token
+    LoxStringRef text;
+    if (type == IDENTIFIER || type == NUMBER)
+        text = m_names.intern(m_text.substr(m_start, m_current - m_start));
+    m_tokens.push_back(std::make_shared<Token>(type, std::move(text),
+                                               std::move(literal), m_line,
+                                               m_start - m_lineStart + 1));
 }
 
 auto Scanner::match(char expected) -> bool {
     if (isAtEnd())
         return false;
-    if (m_source[m_current] != expected)
+    if (m_text[m_current] != expected)
         return false;
     m_current++;
     return true;
@@ -43,63 +84,72 @@ auto Scanner::match(char expected) -> bool {
 auto Scanner::peek() -> char {
     if (isAtEnd())
         return '\0';
-    return m_source[m_current];
+    return m_text[m_current];
 }
 
 auto Scanner::peekNext() -> char {
-    if (m_current + 1 >= static_cast<int>(m_source.size()))
+    if (m_current + 1 >= m_end)
         return '\0';
-    return m_source[m_current + 1];
+    return m_text[m_current + 1];
 }
 
 auto Scanner::get_string() -> void {
-    // 当下一个不是第二个"并且不是末尾的时候移动current
-    while (peek() != '"' && !isAtEnd()) {
-        if (peek() == '\n')
-            m_line++;
-        advance();
-    }
+    // 移动current到第二个"或者末尾
+    auto line = m_line;
+    auto lineStart = m_lineStart;
+    auto *data = m_text.data();
+    m_current = static_cast<int>(
+        m_kernels->findQuote(data + m_current, data + m_end, &m_line) - data);
+    if (m_line != line)
+        newLines(m_start, m_current);
     if (isAtEnd()) {
-        lox.error(m_line, "Unterminated string.");
+        if (hasMoreInput()) {
+            // 字符串越过了块尾，由 scanTokensParallel 或 nextToken
+            // 从它的起点重新扫描
+            m_openString = m_start;
+            m_openLine = line;
+            m_openLineStart = lineStart;
+            return;
+        }
+        error("Unterminated string.");
         return;
     }
     advance();
     // 获取字面量的具体值并且构建string_obj
-    auto value = m_source.substr(m_start + 1, m_current - m_start - 2);
-    auto literal = std::make_shared<Object>(Object::make_str_obj(value));
+    auto value = m_text.substr(m_start + 1, m_current - m_start - 2);
+    auto str = m_strings != nullptr ? m_strings->intern(value)
+                                    : LoxString::make(std::string(value));
+    auto literal = std::make_shared<Object>(Object::make_str_obj(str));
 
+    // 跨行的字符串的列号是它开始的那一行里的位置
+    std::swap(lineStart, m_lineStart);
     addToken(STRING, literal);
+    m_lineStart = lineStart;
 }
 
 auto Scanner::get_number() -> void {
-    while (isdigit(peek()))
+    while (isDigit(peek()))
         advance();
     // Look for a fractional part.
-    if (peek() == '.' && isdigit(peekNext())) {
+    if (peek() == '.' && isDigit(peekNext())) {
         // Consume the "."
         advance();
-        while (isdigit(peek()))
+        while (isDigit(peek()))
             advance();
     }
 
     auto literal_obj = Object::make_num_obj(
-        std::stod(m_source.substr(m_start, m_current - m_start)));
+        std::stod(std::string(m_text.substr(m_start, m_current - m_start))));
     auto literal = std::make_shared<Object>(literal_obj);
     addToken(NUMBER, literal);
 }
 
 auto Scanner::identifier() -> void {
-    while (std::isalpha(peek()) || std::isdigit(peek())) {
-        advance();
-    }
-    auto text = m_source.substr(m_start, m_current - m_start);
-    TokenType type;
-    if (lox::stringToTokenType.find(text) == lox::stringToTokenType.end()) {
-        type = IDENTIFIER;
-    } else {
-        type = stringToTokenType.at(text);
-    }
-    addToken(type);
+    auto *data = m_text.data();
+    m_current = static_cast<int>(
+        m_kernels->skipIdentifier(data + m_current, data + m_end) - data);
+    auto text = m_text.substr(m_start, m_current - m_start);
+    addToken(keywordType(text));
 }
 
 auto Scanner::scanToken() -> void {
@@ -154,8 +204,9 @@ auto Scanner::scanToken() -> void {
         // 说明是注释
         if (match('/')) {
             // A comment goes until the end of the line.
-            while (peek() != '\n' && !isAtEnd())
-                advance();
+            auto *data = m_text.data();
+            m_current = static_cast<int>(
+                m_kernels->findNewline(data + m_current, data + m_end) - data);
         } else { // 说明是除法
             addToken(SLASH);
         }
@@ -163,21 +214,27 @@ auto Scanner::scanToken() -> void {
     case ' ':
     case '\r':
     case '\t':
-        // Ignore whitespace.
-        break;
-    case '\n':
-        m_line++;
+    case '\n': {
+        // Ignore whitespace. 连续的空白（缩进）一次跳过
+        auto *data = m_text.data();
+        auto line = m_line;
+        m_current = static_cast<int>(
+            m_kernels->skipWhitespace(data + m_start, data + m_end, &m_line) -
+            data);
+        if (m_line != line)
+            newLines(m_start, m_current);
         break;
+    }
     case '"':
         get_string();
         break;
     default:
-        if (std::isdigit(c)) {
+        if (isDigit(c)) {
             get_number();
-        } else if (std::isalpha(c)) {
+        } else if (isAlpha(c)) {
             identifier();
         } else {
-            lox.error(m_line, "Unexpected character.");
+            error("Unexpected character.");
         }
         break;
     }
@@ -188,11 +245,185 @@ auto Scanner::scanTokens() -> std::vector<TokenRef> {
         m_start = m_current;
         scanToken();
     }
-    auto literal_obj = lox::Object::make_nil_obj();
-    auto literal = std::make_shared<Object>(literal_obj);
     m_tokens.push_back(std::make_shared<Token>(lox::TokenType::EOF_TOKEN, "",
-                                               literal, m_line));
+                                               nullptr, m_line,
+                                               m_current - m_lineStart + 1));
+    return m_tokens;
+}
+
+auto Scanner::scanChunk(int begin, int end, int line) const -> Chunk {
+    Scanner scanner(m_text, begin, end, line, *m_kernels);
+    while (!scanner.isAtEnd()) {
+        scanner.m_start = scanner.m_current;
+        scanner.scanToken();
+    }
+    return {std::move(scanner.m_tokens), std::move(scanner.m_errors),
+            scanner.m_openString, scanner.m_openLine};
+}
+
+auto Scanner::rescan(std::string_view text, int begin, int line,
+                     const std::function<bool(int)> &stop) -> Rescan {
+    Scanner scanner(text, begin, static_cast<int>(text.size()), line,
+                    ScanKernels::best());
+    Rescan result;
+    while (!scanner.isAtEnd()) {
+        if (scanner.m_current != begin && stop(scanner.m_current))
+            break;
+        scanner.m_start = scanner.m_current;
+        auto count = scanner.m_tokens.size();
+        scanner.scanToken();
+        if (scanner.m_tokens.size() != count)
+            result.offsets.push_back(scanner.m_start);
+    }
+    result.tokens = std::move(scanner.m_tokens);
+    result.errors = std::move(scanner.m_errors);
+    result.end = scanner.m_current;
+    return result;
+}
+
+// 注释只到行尾，所以在换行之后切开时，只有跨行的字符串会让一块的开头
+// 落在 token 中间。各块先假设自己从 token 边界开始同时扫描，拼接时
+// 再从越过块尾的字符串的起点顺序重新扫描，直到它结束所在的那一块的末尾
+auto Scanner::internStrings(const std::vector<TokenRef> &tokens,
+                            StringTable &strings) -> void {
+    for (auto &token : tokens) {
+        if (token->getType() == STRING) {
+            auto lexeme = token->getLexeme();
+            auto value = std::string_view(lexeme).substr(1, lexeme.size() - 2);
+            *token->getLiteral() = Object::make_str_obj(strings.intern(value));
+        }
+    }
+}
+
+auto Scanner::scanTokensParallel(std::size_t threads, std::size_t minChunk)
+    -> std::vector<TokenRef> {
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    auto size = m_text.size();
+    // 每个线程分几块，块之间快慢不一时也能均衡
+    auto count =
+        std::min(threads * 4, size / std::max<std::size_t>(minChunk, 1));
+    if (threads < 2 || count < 2 || m_current != 0)
+        return scanTokens();
+
+    auto *data = m_text.data();
+    std::vector<int> bounds{0};
+    for (std::size_t i = 1; i < count; i++) {
+        auto pos = std::max(size * i / count, std::size_t(bounds.back()));
+        auto *newline = static_cast<const char *>(
+            std::memchr(data + pos, '\n', size - pos));
+        if (newline == nullptr || newline + 1 == data + size)
+            break;
+        bounds.push_back(static_cast<int>(newline + 1 - data));
+    }
+    bounds.push_back(static_cast<int>(size));
+    auto chunkCount = bounds.size() - 1;
+    if (chunkCount < 2)
+        return scanTokens();
+
+    ThreadPool pool(std::min(threads, chunkCount));
+    // 先数出每块的换行，得到每块开始的行号
+    std::vector<int> newlines(chunkCount);
+    for (std::size_t i = 0; i < chunkCount; i++) {
+        pool.submit([&, i] {
+            newlines[i] = static_cast<int>(
+                std::count(data + bounds[i], data + bounds[i + 1], '\n'));
+        });
+    }
+    pool.wait();
+    std::vector<int> lines(chunkCount + 1, 1);
+    for (std::size_t i = 0; i < chunkCount; i++)
+        lines[i + 1] = lines[i] + newlines[i];
+    std::vector<Chunk> chunks(chunkCount);
+    for (std::size_t i = 0; i < chunkCount; i++) {
+        pool.submit([&, i] {
+            chunks[i] = scanChunk(bounds[i], bounds[i + 1], lines[i]);
+        });
+    }
+    pool.wait();
+
+    for (std::size_t i = 0; i < chunkCount;) {
+        auto chunk = std::move(chunks[i]);
+        auto next = i + 1;
+        while (true) {
+            if (m_strings != nullptr)
+                internStrings(chunk.tokens, *m_strings);
+            m_tokens.insert(m_tokens.end(),
+                            std::make_move_iterator(chunk.tokens.begin()),
+                            std::make_move_iterator(chunk.tokens.end()));
+            for (auto &error : chunk.errors)
+                m_reporter->error(error.line, error.message, error.column);
+            if (chunk.openString < 0)
+                break;
+            int ignored = 0;
+            auto *quote = m_kernels->findQuote(data + chunk.openString + 1,
+                                               data + size, &ignored);
+            next = std::upper_bound(bounds.begin(), bounds.end(),
+                                    static_cast<int>(quote - data)) -
+                   bounds.begin();
+            next = std::min(next, chunkCount);
+            chunk = scanChunk(chunk.openString, bounds[next], chunk.openLine);
+        }
+        i = next;
+    }
+
+    m_start = m_current = static_cast<int>(size);
+    m_line = lines[chunkCount];
+    newLines(0, m_current);
+    m_tokens.push_back(std::make_shared<Token>(
+        EOF_TOKEN, "", nullptr, m_line, m_current - m_lineStart + 1));
     return m_tokens;
 }
 
+auto Scanner::refill() -> bool {
+    if (m_input == nullptr || m_inputDone)
+        return false;
+    m_source.erase(0, m_start);
+    m_current -= m_start;
+    m_lineStart -= m_start; // 行首可能已经丢掉了，只用来算列号
+    m_start = 0;
+    // 很长的字符串每次都要从头重新扫描，读入的块随缓冲区一起变大
+    auto block = std::max(m_block, m_source.size());
+    do {
+        auto size = m_source.size();
+        m_source.resize(size + block);
+        m_input->read(m_source.data() + size, block);
+        m_source.resize(size + m_input->gcount());
+        if (!*m_input)
+            m_inputDone = true;
+    } while (!m_inputDone &&
+             m_source.find('\n', m_current) == std::string::npos);
+    m_text = m_source;
+    auto newline = m_source.rfind('\n');
+    m_end = m_inputDone || newline == std::string::npos
+                ? static_cast<int>(m_source.size())
+                : static_cast<int>(newline + 1);
+    return true;
+}
+
+auto Scanner::nextToken() -> TokenRef {
+    while (m_tokens.empty()) {
+        if (isAtEnd()) {
+            if (refill())
+                continue;
+            m_start = m_current;
+            return std::make_shared<Token>(EOF_TOKEN, "", nullptr, m_line,
+                                           m_current - m_lineStart + 1);
+        }
+        m_start = m_current;
+        scanToken();
+        if (m_openString >= 0) {
+            // 字符串越过了已经读入的部分，读入更多后从它的起点重新扫描
+            m_start = m_current = m_openString;
+            m_line = m_openLine;
+            m_lineStart = m_openLineStart;
+            m_openString = -1;
+            refill();
+        }
+    }
+    auto token = std::move(m_tokens.back());
+    m_tokens.clear();
+    return token;
+}
+
 } // namespace lox
@@ -0,0 +1,949 @@
+#include "Interpreter/Snapshot.h"
+#include "Interpreter/LoxClass.h"
+#include "Interpreter/LoxFunction.h"
+#include "Interpreter/LoxInstance.h"
+#include "Runtime/StackProbe.h"
+
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <functional>
+#include <stdexcept>
+#include <string_view>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <unordered_map>
+#include <utility>
+
+namespace lox {
+
+// 文件格式（本机字节序，对象之间的引用都是 i32 下标，-1 表示空）：
+//   magic "LOXSNAP\0", u32 版本
+//   名字:   u32 数量, 每个 string（token 的词素，语法树里用下标引用）
+//   程序:   u32 数量, 每个 u32 语句数, 语句
+//   字符串: u32 数量, 每个 string
+//   环境:   u32 数量, 每个外层环境
+//   函数:   u32 数量, 每个程序, 声明, 闭包环境, u8 是否初始化器
+//   类:     u32 数量, 每个 string 名字, 父类, u32 方法数, {string, 函数}
+//   实例:   u32 数量, 每个类
+//   环境的变量: 每个环境 u32 数量, {string 名字, 值}
+//   实例的字段: 每个实例 u32 数量, {string 名字, 值}
+//   全局环境
+// 值为 u8 Object::Object_type 加上对应的数据；string 为 u32 长度加字节。
+//
+// 语法树带着 Resolver 的结果，加载时不经过扫描、解析和变量解析：
+//   token:  u8 种类, i32 行, i32 列, 名字（-1 表示拼写固定）
+//   表达式: u8 ExprKind（kNone 表示空）, i32 作用域距离, 按种类的子节点；
+//           字面量为 u8 类型加数据，字符串直接写 string；调用多一个
+//           u8 是否尾调用
+//   语句:   u8 StmtKind（kNone 表示空）, 按种类的子节点；
+//           列表都是 u32 数量加元素
+static constexpr char kMagic[8] = {'L', 'O', 'X', 'S', 'N', 'A', 'P', '\0'};
+static constexpr std::uint32_t kVersion = 2;
+static constexpr std::uint8_t kNone = 0xff;
+
+namespace {
+
+class SnapshotWriter {
+  public:
+    template <class T> auto put(T value) -> void {
+        m_buf.append(reinterpret_cast<const char *>(&value), sizeof(value));
+    }
+    auto putString(std::string_view str) -> void {
+        put<std::uint32_t>(str.size());
+        m_buf.append(str);
+    }
+    auto putBytes(const char *bytes, std::size_t size) -> void {
+        m_buf.append(bytes, size);
+    }
+    auto data() const -> const std::string & { return m_buf; }
+
+  private:
+    std::string m_buf;
+};
+
+// 只读映射进来的快照文件，加载完就解除映射
+class MappedFile {
+  public:
+    explicit MappedFile(const std::string &path) {
+        auto fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            throw std::runtime_error("Failed to open snapshot: " + path);
+        }
+        struct stat info;
+        if (::fstat(fd, &info) == 0 && info.st_size > 0) {
+            m_size = static_cast<std::size_t>(info.st_size);
+            m_data = ::mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        }
+        ::close(fd);
+        if (m_data == MAP_FAILED) {
+            throw std::runtime_error("Failed to map snapshot: " + path);
+        }
+    }
+    ~MappedFile() {
+        if (m_data != nullptr)
+            ::munmap(m_data, m_size);
+    }
+
+    MappedFile(const MappedFile &) = delete;
+    auto operator=(const MappedFile &) -> MappedFile & = delete;
+
+    auto data() const -> const char * {
+        return static_cast<const char *>(m_data);
+    }
+    auto size() const -> std::size_t { return m_size; }
+
+  private:
+    void *m_data = nullptr;
+    std::size_t m_size = 0;
+};
+
+class SnapshotReader {
+  public:
+    SnapshotReader(const char *data, std::size_t size)
+        : m_data(data), m_size(size) {}
+
+    template <class T> auto get() -> T {
+        need(sizeof(T));
+        T value;
+        std::memcpy(&value, m_data + m_pos, sizeof(T));
+        m_pos += sizeof(T);
+        return value;
+    }
+    auto getString() -> std::string { return getBytes(get<std::uint32_t>()); }
+    auto getBytes(std::size_t size) -> std::string {
+        return std::string(getView(size));
+    }
+    // 指向映射的文件，只在加载期间有效
+    auto getView(std::size_t size) -> std::string_view {
+        need(size);
+        std::string_view view(m_data + m_pos, size);
+        m_pos += size;
+        return view;
+    }
+    // 读一个下标并检查范围，-1 只在 allowNone 时合法
+    auto getIndex(std::size_t count, bool allowNone = false) -> std::int32_t {
+        auto index = get<std::int32_t>();
+        if ((index < 0 && !(allowNone && index == -1)) ||
+            (index >= 0 && static_cast<std::size_t>(index) >= count)) {
+            throw std::runtime_error("Invalid snapshot file: bad index.");
+        }
+        return index;
+    }
+
+  private:
+    auto need(std::size_t bytes) -> void {
+        if (m_size - m_pos < bytes) {
+            throw std::runtime_error("Invalid snapshot file: truncated.");
+        }
+    }
+
+    const char *m_data;
+    std::size_t m_size;
+    std::size_t m_pos = 0;
+};
+
+// 把解析过变量的语法树写进快照；token 的词素收进名字表
+class AstWriter {
+  public:
+    explicit AstWriter(SnapshotWriter &out) : m_out(out) {}
+
+    auto getNames() const -> const std::vector<std::string> & {
+        return m_names;
+    }
+
+    auto stmt(const Stmt *stmt) -> void {
+        if (stmt == nullptr) {
+            m_out.put<std::uint8_t>(kNone);
+            return;
+        }
+        m_out.put<std::uint8_t>(static_cast<std::uint8_t>(stmt->kind()));
+        switch (stmt->kind()) {
+        case StmtKind::Expression:
+            expr(static_cast<const ExpressionStmt *>(stmt)->getExpr().get());
+            break;
+        case StmtKind::Print:
+            expr(static_cast<const PrintStmt *>(stmt)->getExpr().get());
+            break;
+        case StmtKind::Var: {
+            auto &var = static_cast<const VarStmt &>(*stmt);
+            token(var.getName());
+            expr(var.getInitExpr().get());
+            break;
+        }
+        case StmtKind::Block:
+            stmts(static_cast<const BlockStmt *>(stmt)->getStmt());
+            break;
+        case StmtKind::If: {
+            // else if 链在循环里写出，格式与递归写出的相同
+            auto *branch = static_cast<const IfStmt *>(stmt);
+            while (true) {
+                expr(branch->getCondition().get());
+                this->stmt(branch->getThen().get());
+                auto *next = branch->getElse().get();
+                if (next == nullptr || next->kind() != StmtKind::If) {
+                    this->stmt(next);
+                    break;
+                }
+                m_out.put<std::uint8_t>(
+                    static_cast<std::uint8_t>(StmtKind::If));
+                branch = static_cast<const IfStmt *>(next);
+            }
+            break;
+        }
+        case StmtKind::While: {
+            auto &loop = static_cast<const WhileStmt &>(*stmt);
+            expr(loop.getCondition().get());
+            this->stmt(loop.getBody().get());
+            break;
+        }
+        case StmtKind::Fun: {
+            auto &fun = static_cast<const FunStmt &>(*stmt);
+            token(fun.getName());
+            m_out.put<std::uint32_t>(fun.getParams().size());
+            for (auto &param : fun.getParams())
+                token(param);
+            stmts(fun.getBody());
+            break;
+        }
+        case StmtKind::Return: {
+            auto &ret = static_cast<const ReturnStmt &>(*stmt);
+            token(ret.getKeyword());
+            expr(ret.getValue().get());
+            break;
+        }
+        case StmtKind::Class: {
+            auto &klass = static_cast<const ClassStmt &>(*stmt);
+            token(klass.getName());
+            expr(klass.getSuper().get());
+            m_out.put<std::uint32_t>(klass.getMethods().size());
+            for (auto &method : klass.getMethods())
+                this->stmt(method.get());
+            break;
+        }
+        case StmtKind::Import: {
+            auto &import = static_cast<const ImportStmt &>(*stmt);
+            token(import.getKeyword());
+            m_out.putString(import.getPath());
+            token(import.getName());
+            break;
+        }
+        }
+    }
+
+    auto stmts(const std::vector<StmtRef> &statements) -> void {
+        m_out.put<std::uint32_t>(statements.size());
+        for (auto &statement : statements)
+            stmt(statement.get());
+    }
+
+  private:
+    auto expr(const AbstractExpression<Object> *expr) -> void {
+        if (expr == nullptr) {
+            m_out.put<std::uint8_t>(kNone);
+            return;
+        }
+        // 语法树的高度不受 Parser 限制，原生栈快用完时放弃保存
+        if (stackExhausted())
+            throw std::runtime_error("Snapshot: syntax tree too deep.");
+        m_out.put<std::uint8_t>(static_cast<std::uint8_t>(expr->kind()));
+        m_out.put<std::int32_t>(expr->getDepth());
+        switch (expr->kind()) {
+        case ExprKind::Binary: {
+            auto &binary = static_cast<const BinaryExpression<Object> &>(*expr);
+            this->expr(binary.getLeftExpr().get());
+            this->expr(binary.getRightExpr().get());
+            token(binary.getOperation());
+            break;
+        }
+        case ExprKind::Unary: {
+            auto &unary = static_cast<const UnaryExpression<Object> &>(*expr);
+            this->expr(unary.getRightExpr().get());
+            token(unary.getOperation());
+            break;
+        }
+        case ExprKind::Literal: {
+            auto &value = static_cast<const LiteralExpression<Object> &>(*expr);
+            literal(value.getValue());
+            break;
+        }
+        case ExprKind::Grouping: {
+            auto &group =
+                static_cast<const GroupingExpression<Object> &>(*expr);
+            this->expr(group.getExpr().get());
+            break;
+        }
+        case ExprKind::Variable: {
+            auto &var = static_cast<const VariableExpression<Object> &>(*expr);
+            token(var.getName());
+            break;
+        }
+        case ExprKind::Assignment: {
+            auto &assign =
+                static_cast<const AssignmentExpression<Object> &>(*expr);
+            token(assign.getName());
+            this->expr(assign.getValue().get());
+            break;
+        }
+        case ExprKind::Logical: {
+            auto &logical =
+                static_cast<const LogicalExpression<Object> &>(*expr);
+            this->expr(logical.getLeftExpr().get());
+            this->expr(logical.getRightExpr().get());
+            token(logical.getOperation());
+            break;
+        }
+        case ExprKind::Call: {
+            auto &call = static_cast<const CallExpression<Object> &>(*expr);
+            this->expr(call.getCallee().get());
+            token(call.getParen());
+            m_out.put<std::uint32_t>(call.getArgs().size());
+            for (auto &argument : call.getArgs())
+                this->expr(argument.get());
+            m_out.put<std::uint8_t>(call.isTailCall());
+            break;
+        }
+        case ExprKind::Get: {
+            auto &get = static_cast<const GetExpression<Object> &>(*expr);
+            this->expr(get.getObject().get());
+            token(get.getName());
+            break;
+        }
+        case ExprKind::Set: {
+            auto &set = static_cast<const SetExpression<Object> &>(*expr);
+            this->expr(set.getObject().get());
+            token(set.getName());
+            this->expr(set.getValue().get());
+            break;
+        }
+        case ExprKind::This: {
+            auto &self = static_cast<const ThisExpression<Object> &>(*expr);
+            token(self.getKeyword());
+            break;
+        }
+        case ExprKind::Super: {
+            auto &super = static_cast<const SuperExpression<Object> &>(*expr);
+            token(super.getKey());
+            token(super.getMethod());
+            break;
+        }
+        }
+    }
+
+    auto literal(const Object &value) -> void {
+        m_out.put<std::uint8_t>(value.getType());
+        switch (value.getType()) {
+        case Object::Object_nil:
+            break;
+        case Object::Object_bool:
+            m_out.put<std::uint8_t>(value.getBool());
+            break;
+        case Object::Object_num:
+            m_out.put<double>(value.getNum());
+            break;
+        case Object::Object_str:
+            m_out.putString(value.getString()->view());
+            break;
+        default:
+            throw std::logic_error("Snapshot: unexpected literal.");
+        }
+    }
+
+    auto token(const SourceToken &token) -> void {
+        m_out.put<std::uint8_t>(token.getType());
+        m_out.put<std::int32_t>(token.getLine());
+        m_out.put<std::int32_t>(token.getColumn());
+        auto &text = token.getText();
+        if (text == nullptr) {
+            m_out.put<std::int32_t>(-1);
+            return;
+        }
+        auto [iter, inserted] =
+            m_index.try_emplace(std::string(text->view()), m_names.size());
+        if (inserted)
+            m_names.push_back(iter->first);
+        m_out.put<std::int32_t>(iter->second);
+    }
+
+    SnapshotWriter &m_out;
+    std::vector<std::string> m_names;
+    std::unordered_map<std::string, std::int32_t> m_index;
+};
+
+// 按 AstWriter 的格式重建语法树。文件可能损坏，下标、种类和嵌套深度都要检查
+class AstReader {
+  public:
+    AstReader(SnapshotReader &in, const std::vector<LoxStringRef> &names,
+              StringTable &strings)
+        : m_in(in), m_names(names), m_strings(strings) {}
+
+    auto stmt() -> StmtRef {
+        auto kind = m_in.get<std::uint8_t>();
+        if (kind == kNone)
+            return nullptr;
+        return stmt(kind);
+    }
+
+    auto stmt(std::uint8_t kind) -> StmtRef {
+        checkStack();
+        switch (static_cast<StmtKind>(kind)) {
+        case StmtKind::Expression:
+            return std::make_shared<ExpressionStmt>(expr());
+        case StmtKind::Print:
+            return std::make_shared<PrintStmt>(expr());
+        case StmtKind::Var: {
+            auto name = token();
+            return std::make_shared<VarStmt>(name, expr());
+        }
+        case StmtKind::Block:
+            return std::make_shared<BlockStmt>(stmts());
+        case StmtKind::If:
+            return ifStmt();
+        case StmtKind::While: {
+            auto condition = expr();
+            return std::make_shared<WhileStmt>(condition, stmt());
+        }
+        case StmtKind::Fun: {
+            auto name = token();
+            std::vector<SourceToken> params(m_in.get<std::uint32_t>());
+            for (auto &param : params)
+                param = token();
+            return std::make_shared<FunStmt>(name, std::move(params),
+                                             stmts());
+        }
+        case StmtKind::Return: {
+            auto keyword = token();
+            return std::make_shared<ReturnStmt>(keyword, expr());
+        }
+        case StmtKind::Class: {
+            auto name = token();
+            auto superclass = expr();
+            if (superclass != nullptr &&
+                superclass->kind() != ExprKind::Variable)
+                invalid("bad superclass");
+            std::vector<FunStmtRef> methods(m_in.get<std::uint32_t>());
+            for (auto &method : methods) {
+                auto statement = stmt();
+                if (statement == nullptr || statement->kind() != StmtKind::Fun)
+                    invalid("bad method");
+                method = std::static_pointer_cast<FunStmt>(statement);
+            }
+            return std::make_shared<ClassStmt>(
+                name,
+                std::static_pointer_cast<VariableExpression<Object>>(
+                    superclass),
+                std::move(methods));
+        }
+        case StmtKind::Import: {
+            auto keyword = token();
+            auto path = m_in.getString();
+            return std::make_shared<ImportStmt>(keyword, std::move(path),
+                                                token());
+        }
+        }
+        invalid("bad statement");
+    }
+
+    // else if 链在循环里读出，再从后往前接成嵌套的 IfStmt
+    auto ifStmt() -> StmtRef {
+        std::vector<std::pair<AbstractExpressionRef<Object>, StmtRef>>
+            branches;
+        StmtRef elseBranch;
+        do {
+            auto condition = expr();
+            branches.emplace_back(condition, stmt());
+            auto kind = m_in.get<std::uint8_t>();
+            if (kind == static_cast<std::uint8_t>(StmtKind::If))
+                continue;
+            if (kind != kNone)
+                elseBranch = stmt(kind);
+            break;
+        } while (true);
+        for (auto iter = branches.rbegin(); iter != branches.rend(); ++iter) {
+            elseBranch =
+                std::make_shared<IfStmt>(iter->first, iter->second, elseBranch);
+        }
+        return elseBranch;
+    }
+
+    auto stmts() -> std::vector<StmtRef> {
+        std::vector<StmtRef> statements(m_in.get<std::uint32_t>());
+        for (auto &statement : statements)
+            statement = stmt();
+        return statements;
+    }
+
+  private:
+    // 语法树的高度不受 Parser 限制（很长的 a + b + …），
+    // 损坏的文件更可能嵌套得任意深，原生栈快用完时放弃
+    static auto checkStack() -> void {
+        if (stackExhausted())
+            invalid("too deep");
+    }
+
+    [[noreturn]] static auto invalid(const std::string &what) -> void {
+        throw std::runtime_error("Invalid snapshot file: " + what + ".");
+    }
+
+    auto expr() -> AbstractExpressionRef<Object> {
+        auto kind = m_in.get<std::uint8_t>();
+        if (kind == kNone)
+            return nullptr;
+        checkStack();
+        auto depth = m_in.get<std::int32_t>();
+        auto expr = node(static_cast<ExprKind>(kind));
+        expr->setDepth(depth);
+        return expr;
+    }
+
+    auto node(ExprKind kind) -> AbstractExpressionRef<Object> {
+        switch (kind) {
+        case ExprKind::Binary: {
+            auto left = expr();
+            auto right = expr();
+            return std::make_shared<BinaryExpression<Object>>(left, right,
+                                                              token());
+        }
+        case ExprKind::Unary: {
+            auto right = expr();
+            return std::make_shared<UnaryExpression<Object>>(right, token());
+        }
+        case ExprKind::Literal:
+            return std::make_shared<LiteralExpression<Object>>(literal());
+        case ExprKind::Grouping:
+            return std::make_shared<GroupingExpression<Object>>(expr());
+        case ExprKind::Variable:
+            return std::make_shared<VariableExpression<Object>>(token());
+        case ExprKind::Assignment: {
+            auto name = token();
+            return std::make_shared<AssignmentExpression<Object>>(name,
+                                                                  expr());
+        }
+        case ExprKind::Logical: {
+            auto left = expr();
+            auto right = expr();
+            return std::make_shared<LogicalExpression<Object>>(left, right,
+                                                               token());
+        }
+        case ExprKind::Call: {
+            auto callee = expr();
+            auto paren = token();
+            std::vector<AbstractExpressionRef<Object>> arguments(
+                m_in.get<std::uint32_t>());
+            for (auto &argument : arguments)
+                argument = expr();
+            auto call = std::make_shared<CallExpression<Object>>(
+                callee, paren, std::move(arguments));
+            call->setTailCall(m_in.get<std::uint8_t>() != 0);
+            return call;
+        }
+        case ExprKind::Get: {
+            auto object = expr();
+            return std::make_shared<GetExpression<Object>>(object, token());
+        }
+        case ExprKind::Set: {
+            auto object = expr();
+            auto name = token();
+            return std::make_shared<SetExpression<Object>>(object, name,
+                                                           expr());
+        }
+        case ExprKind::This:
+            return std::make_shared<ThisExpression<Object>>(token());
+        case ExprKind::Super: {
+            auto keyword = token();
+            return std::make_shared<SuperExpression<Object>>(keyword, token());
+        }
+        }
+        invalid("bad expression");
+    }
+
+    // 字符串字面量驻留到程序自己的表里，与 Program::compile 相同
+    auto literal() -> Object {
+        switch (m_in.get<std::uint8_t>()) {
+        case Object::Object_nil:
+            return Object::make_nil_obj();
+        case Object::Object_bool:
+            return Object::make_bool_obj(m_in.get<std::uint8_t>() != 0);
+        case Object::Object_num:
+            return Object::make_num_obj(m_in.get<double>());
+        case Object::Object_str:
+            return Object::make_str_obj(m_strings.intern(
+                m_in.getView(m_in.get<std::uint32_t>())));
+        default:
+            invalid("bad literal");
+        }
+    }
+
+    auto token() -> SourceToken {
+        auto type = m_in.get<std::uint8_t>();
+        if (type > EOF_TOKEN)
+            invalid("bad token");
+        auto line = m_in.get<std::int32_t>();
+        auto column = m_in.get<std::int32_t>();
+        auto name = m_in.getIndex(m_names.size(), true);
+        return SourceToken(static_cast<TokenType>(type),
+                           name < 0 ? nullptr : m_names[name], line, column);
+    }
+
+    SnapshotReader &m_in;
+    const std::vector<LoxStringRef> &m_names;
+    StringTable &m_strings;
+};
+
+// 与 Interpreter::clearHeap 一样，打破闭包和环境之间的引用环
+auto breakCycles(const Interpreter::Heap &heap) -> void {
+    for (auto &env : heap.envs) {
+        if (env != nullptr)
+            env->clear();
+    }
+    for (auto &klass : heap.classes) {
+        if (klass != nullptr)
+            klass->clear();
+    }
+    for (auto &instance : heap.instances) {
+        if (instance != nullptr)
+            instance->clearFields();
+    }
+}
+
+// 加载到一半出错时，已经建立起来的对象之间也可能有引用环
+class HeapGuard {
+  public:
+    explicit HeapGuard(const Interpreter::Heap &heap) : m_heap(&heap) {}
+    ~HeapGuard() {
+        if (m_heap != nullptr)
+            breakCycles(*m_heap);
+    }
+    auto release() -> void { m_heap = nullptr; }
+
+  private:
+    const Interpreter::Heap *m_heap;
+};
+
+} // namespace
+
+Snapshot::~Snapshot() { breakCycles(m_heap); }
+
+auto Snapshot::save(const std::string &path) const -> void {
+    std::unordered_map<const void *, std::int32_t> index;
+    auto indexOf = [&index](const void *object) -> std::int32_t {
+        if (object == nullptr)
+            return -1;
+        auto iter = index.find(object);
+        if (iter == index.end()) {
+            throw std::logic_error("Snapshot references an unknown object.");
+        }
+        return iter->second;
+    };
+    for (std::size_t i = 0; i < m_heap.strings.size(); i++) {
+        index[m_heap.strings[i].get()] = i;
+    }
+    for (std::size_t i = 0; i < m_heap.envs.size(); i++) {
+        index[m_heap.envs[i].get()] = i;
+    }
+    for (std::size_t i = 0; i < m_heap.instances.size(); i++) {
+        index[m_heap.instances[i].get()] = i;
+    }
+    // 父类排在子类之前，加载时可以直接构造
+    std::vector<LoxClassRef> classes;
+    std::function<void(const LoxClassRef &)> addClass =
+        [&](const LoxClassRef &klass) {
+            if (klass == nullptr || index.count(klass.get()))
+                return;
+            addClass(klass->getSuper());
+            index[klass.get()] = classes.size();
+            classes.push_back(klass);
+        };
+    for (auto &klass : m_heap.classes) {
+        addClass(klass);
+    }
+
+    // 函数对象没有单独收集，从所有值和方法表里找出来
+    std::unordered_map<const FunStmt *, std::pair<std::int32_t, std::int32_t>>
+        declarations;
+    for (std::size_t p = 0; p < m_programs.size(); p++) {
+        auto &functions = m_programs[p]->getFunctions();
+        for (std::size_t f = 0; f < functions.size(); f++) {
+            declarations[functions[f].get()] = {p, f};
+        }
+    }
+    std::vector<LoxFunctionRef> functions;
+    auto addFunction = [&](const LoxFunctionRef &fun) {
+        if (index.count(fun.get()))
+            return;
+        index[fun.get()] = functions.size();
+        functions.push_back(fun);
+    };
+    auto scanValue = [&](const ObjectRef &value) {
+        if (value != nullptr && value->getType() == Object::Object_fun) {
+            auto fun = std::dynamic_pointer_cast<LoxFunction>(value->getFun());
+            if (fun == nullptr) {
+                throw std::logic_error("Cannot snapshot a native function.");
+            }
+            addFunction(fun);
+        }
+    };
+    for (auto &env : m_heap.envs) {
+        for (auto &[name, value] : env->getValues()) {
+            scanValue(value);
+        }
+    }
+    for (auto &instance : m_heap.instances) {
+        for (auto &[name, value] : instance->getFields()) {
+            scanValue(value);
+        }
+    }
+    for (auto &klass : classes) {
+        for (auto &[name, method] : klass->getMethods()) {
+            addFunction(method);
+        }
+    }
+
+    SnapshotWriter out;
+    auto putValue = [&](const ObjectRef &value) {
+        auto type = value != nullptr ? value->getType() : Object::Object_nil;
+        out.put<std::uint8_t>(type);
+        switch (type) {
+        case Object::Object_bool:
+            out.put<std::uint8_t>(value->getBool());
+            break;
+        case Object::Object_num:
+            out.put<double>(value->getNum());
+            break;
+        case Object::Object_str:
+            out.put<std::int32_t>(indexOf(value->getString().get()));
+            break;
+        case Object::Object_fun:
+            out.put<std::int32_t>(indexOf(
+                std::dynamic_pointer_cast<LoxFunction>(value->getFun()).get()));
+            break;
+        case Object::Object_class:
+            out.put<std::int32_t>(indexOf(value->getClass().get()));
+            break;
+        case Object::Object_instance:
+            out.put<std::int32_t>(indexOf(value->getInstance().get()));
+            break;
+        default:
+            break;
+        }
+    };
+
+    // 语法树先写到一边，收集完名字表再接在它后面
+    SnapshotWriter trees;
+    AstWriter ast(trees);
+    for (auto &program : m_programs) {
+        ast.stmts(program->getStatements());
+    }
+
+    out.putBytes(kMagic, sizeof(kMagic));
+    out.put(kVersion);
+    out.put<std::uint32_t>(ast.getNames().size());
+    for (auto &name : ast.getNames()) {
+        out.putString(name);
+    }
+    out.put<std::uint32_t>(m_programs.size());
+    out.putBytes(trees.data().data(), trees.data().size());
+    out.put<std::uint32_t>(m_heap.strings.size());
+    for (auto &str : m_heap.strings) {
+        out.putString(str->view());
+    }
+    out.put<std::uint32_t>(m_heap.envs.size());
+    for (auto &env : m_heap.envs) {
+        out.put<std::int32_t>(indexOf(env->getEnclosing().get()));
+    }
+    out.put<std::uint32_t>(functions.size());
+    for (auto &fun : functions) {
+        auto iter = declarations.find(fun->getDeclaration().get());
+        if (iter == declarations.end()) {
+            throw std::logic_error("Function declared outside the snapshot.");
+        }
+        out.put<std::int32_t>(iter->second.first);
+        out.put<std::int32_t>(iter->second.second);
+        out.put<std::int32_t>(indexOf(fun->getClosure().get()));
+        out.put<std::uint8_t>(fun->isInitializer());
+    }
+    out.put<std::uint32_t>(classes.size());
+    for (auto &klass : classes) {
+        out.putString(klass->getName());
+        out.put<std::int32_t>(indexOf(klass->getSuper().get()));
+        auto methods = klass->getMethods();
+        out.put<std::uint32_t>(methods.size());
+        for (auto &[name, method] : methods) {
+            out.putString(name);
+            out.put<std::int32_t>(indexOf(method.get()));
+        }
+    }
+    out.put<std::uint32_t>(m_heap.instances.size());
+    for (auto &instance : m_heap.instances) {
+        out.put<std::int32_t>(indexOf(instance->getClass().get()));
+    }
+    for (auto &env : m_heap.envs) {
+        out.put<std::uint32_t>(env->getValues().size());
+        for (auto &[name, value] : env->getValues()) {
+            out.putString(name);
+            putValue(value);
+        }
+    }
+    for (auto &instance : m_heap.instances) {
+        auto fields = instance->getFields();
+        out.put<std::uint32_t>(fields.size());
+        for (auto &[name, value] : fields) {
+            out.putString(name);
+            putValue(value);
+        }
+    }
+    out.put<std::int32_t>(indexOf(m_globals.get()));
+
+    std::ofstream file(path, std::ios::binary);
+    file.write(out.data().data(), out.data().size());
+    if (!file) {
+        throw std::runtime_error("Failed to write snapshot: " + path);
+    }
+}
+
+auto Snapshot::load(const std::string &path) -> SnapshotRef {
+    MappedFile file(path);
+    SnapshotReader in(file.data(), file.size());
+
+    auto magic = in.getBytes(sizeof(kMagic));
+    if (std::memcmp(magic.data(), kMagic, sizeof(kMagic)) != 0 ||
+        in.get<std::uint32_t>() != kVersion) {
+        throw std::runtime_error("Invalid snapshot file: " + path);
+    }
+
+    std::vector<LoxStringRef> names(in.get<std::uint32_t>());
+    for (auto &name : names) {
+        name = LoxString::make(in.getString());
+    }
+    // 直接重建语法树，不执行；堆的状态由下面的对象表恢复
+    std::vector<ProgramRef> programs(in.get<std::uint32_t>());
+    for (auto &program : programs) {
+        std::shared_ptr<Program> rebuilt(new Program());
+        rebuilt->m_statements =
+            AstReader(in, names, rebuilt->m_strings).stmts();
+        program = std::move(rebuilt);
+    }
+
+    Interpreter::Heap heap;
+    HeapGuard guard(heap);
+    heap.strings.resize(in.get<std::uint32_t>());
+    for (auto &str : heap.strings) {
+        str = LoxString::make(in.getString());
+    }
+
+    // 外层环境的下标可能更大，先读完再递归地按依赖顺序创建
+    std::vector<std::int32_t> enclosing(in.get<std::uint32_t>());
+    for (auto &parent : enclosing) {
+        parent = in.getIndex(enclosing.size(), true);
+    }
+    heap.envs.resize(enclosing.size());
+    std::vector<bool> creating(enclosing.size());
+    std::function<EnvironmentRef(std::int32_t)> makeEnv =
+        [&](std::int32_t i) -> EnvironmentRef {
+        if (i < 0)
+            return nullptr;
+        if (heap.envs[i] == nullptr) {
+            // 损坏的文件可能让外层链成环
+            if (creating[i]) {
+                throw std::runtime_error("Invalid snapshot file: bad scope.");
+            }
+            creating[i] = true;
+            heap.envs[i] = std::make_shared<Environment>(makeEnv(enclosing[i]));
+        }
+        return heap.envs[i];
+    };
+    for (std::size_t i = 0; i < enclosing.size(); i++) {
+        makeEnv(i);
+    }
+
+    std::vector<LoxFunctionRef> functions(in.get<std::uint32_t>());
+    for (auto &fun : functions) {
+        auto program = in.getIndex(programs.size());
+        auto &declarations = programs[program]->getFunctions();
+        auto declaration = in.getIndex(declarations.size());
+        auto closure = in.getIndex(heap.envs.size(), true);
+        bool isInitializer = in.get<std::uint8_t>() != 0;
+        fun = std::make_shared<LoxFunction>(declarations[declaration],
+                                            makeEnv(closure), isInitializer);
+    }
+
+    heap.classes.resize(in.get<std::uint32_t>());
+    for (std::size_t i = 0; i < heap.classes.size(); i++) {
+        auto name = in.getString();
+        auto super = in.getIndex(i, true);
+        std::unordered_map<std::string, LoxFunctionRef> methods;
+        auto count = in.get<std::uint32_t>();
+        for (std::uint32_t m = 0; m < count; m++) {
+            auto method = in.getString();
+            methods[method] = functions[in.getIndex(functions.size())];
+        }
+        heap.classes[i] = std::make_shared<LoxClass>(
+            name, super < 0 ? nullptr : heap.classes[super], methods);
+    }
+
+    heap.instances.resize(in.get<std::uint32_t>());
+    for (auto &instance : heap.instances) {
+        instance = std::make_shared<LoxInstance>(
+            heap.classes[in.getIndex(heap.classes.size())]);
+    }
+
+    auto getValue = [&]() -> ObjectRef {
+        auto type = in.get<std::uint8_t>();
+        switch (type) {
+        case Object::Object_nil:
+            return std::make_shared<Object>(Object::make_nil_obj());
+        case Object::Object_bool:
+            return std::make_shared<Object>(
+                Object::make_bool_obj(in.get<std::uint8_t>() != 0));
+        case Object::Object_num:
+            return std::make_shared<Object>(
+                Object::make_num_obj(in.get<double>()));
+        case Object::Object_str:
+            return std::make_shared<Object>(Object::make_str_obj(
+                heap.strings[in.getIndex(heap.strings.size())]));
+        case Object::Object_fun:
+            return std::make_shared<Object>(Object::make_fun_obj(
+                functions[in.getIndex(functions.size())]));
+        case Object::Object_class:
+            return std::make_shared<Object>(Object::make_class_obj(
+                heap.classes[in.getIndex(heap.classes.size())]));
+        case Object::Object_instance:
+            return std::make_shared<Object>(Object::make_instance_obj(
+                heap.instances[in.getIndex(heap.instances.size())]));
+        default:
+            throw std::runtime_error("Invalid snapshot file: bad value.");
+        }
+    };
+    for (auto &env : heap.envs) {
+        auto count = in.get<std::uint32_t>();
+        for (std::uint32_t v = 0; v < count; v++) {
+            auto name = in.getString();
+            env->define(name, getValue());
+        }
+    }
+    for (auto &instance : heap.instances) {
+        auto count = in.get<std::uint32_t>();
+        for (std::uint32_t f = 0; f < count; f++) {
+            auto name = in.getString();
+            instance->setField(name, getValue());
+        }
+    }
+    auto globals = heap.envs.at(in.getIndex(heap.envs.size()));
+
+    for (auto &env : heap.envs) {
+        env->freeze();
+    }
+    for (auto &klass : heap.classes) {
+        klass->freeze();
+    }
+    for (auto &instance : heap.instances) {
+        instance->freeze();
+    }
+    guard.release();
+    return std::make_shared<const Snapshot>(globals, std::move(heap),
+                                            std::move(programs));
+}
+
+} // namespace lox
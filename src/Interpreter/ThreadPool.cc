@@ -0,0 +1,132 @@
+#include "Interpreter/ThreadPool.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace lox {
+
+// 当前线程所属的线程池和它在池中的编号，非工作线程 current_pool 为空
+static thread_local const ThreadPool *current_pool = nullptr;
+static thread_local std::size_t current_index = 0;
+
+ThreadPool::ThreadPool(std::size_t threads) {
+    if (threads == 0) {
+        threads = std::max<std::size_t>(1, std::thread::hardware_concurrency());
+    }
+    for (std::size_t i = 0; i < threads; i++) {
+        m_queues.push_back(std::make_unique<WorkQueue>());
+    }
+    for (std::size_t i = 0; i < threads; i++) {
+        m_workers.emplace_back([this, i] { workerLoop(i); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        m_stop = true;
+    }
+    m_workAvailable.notify_all();
+    for (auto &worker : m_workers) {
+        worker.join();
+    }
+}
+
+auto ThreadPool::submit(std::function<void()> task) -> void {
+    // 工作线程提交的任务放进自己的队列，外部线程轮流分发
+    std::size_t index = current_pool == this
+                            ? current_index
+                            : m_nextQueue.fetch_add(1) % m_queues.size();
+    {
+        std::lock_guard<std::mutex> guard(m_queues[index]->mutex);
+        m_queues[index]->tasks.push_back(std::move(task));
+    }
+    m_unfinished.fetch_add(1);
+    m_queued.fetch_add(1);
+    // 没有线程在睡眠时不碰 m_mutex。否则先加锁再通知：
+    // 正在准备睡眠的线程要么还没检查 m_queued，要么已经在等通知
+    if (m_sleeping.load() > 0) {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        m_workAvailable.notify_one();
+    }
+}
+
+auto ThreadPool::wait() -> void {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_idle.wait(lock, [this] { return m_unfinished.load() == 0; });
+    if (m_error != nullptr) {
+        auto error = std::exchange(m_error, nullptr);
+        std::rethrow_exception(error);
+    }
+}
+
+auto ThreadPool::claim() -> bool {
+    auto queued = m_queued.load();
+    while (queued > 0) {
+        if (m_queued.compare_exchange_weak(queued, queued - 1))
+            return true;
+    }
+    return false;
+}
+
+auto ThreadPool::popLocal(std::size_t index, std::function<void()> &task)
+    -> bool {
+    auto &queue = *m_queues[index];
+    std::lock_guard<std::mutex> guard(queue.mutex);
+    if (queue.tasks.empty()) {
+        return false;
+    }
+    task = std::move(queue.tasks.back());
+    queue.tasks.pop_back();
+    return true;
+}
+
+auto ThreadPool::steal(std::size_t thief, std::function<void()> &task)
+    -> bool {
+    for (std::size_t i = 1; i < m_queues.size(); i++) {
+        auto &queue = *m_queues[(thief + i) % m_queues.size()];
+        std::lock_guard<std::mutex> guard(queue.mutex);
+        if (!queue.tasks.empty()) {
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+auto ThreadPool::workerLoop(std::size_t index) -> void {
+    current_pool = this;
+    current_index = index;
+    while (true) {
+        if (!claim()) {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_sleeping.fetch_add(1);
+            m_workAvailable.wait(
+                lock, [this] { return m_stop || m_queued.load() > 0; });
+            m_sleeping.fetch_sub(1);
+            if (m_stop && m_queued.load() == 0) {
+                return;
+            }
+            continue;
+        }
+        std::function<void()> task;
+        while (!popLocal(index, task) && !steal(index, task)) {
+            std::this_thread::yield();
+        }
+        try {
+            task();
+        } catch (...) {
+            std::lock_guard<std::mutex> guard(m_mutex);
+            if (m_error == nullptr)
+                m_error = std::current_exception();
+        }
+        task = nullptr; // 捕获的状态在 wait 返回之前释放
+        if (m_unfinished.fetch_sub(1) == 1) {
+            std::lock_guard<std::mutex> guard(m_mutex);
+            m_idle.notify_all();
+        }
+    }
+}
+
+} // namespace lox
@@ -2,15 +2,56 @@
 #include "Interpreter/Tokentype.h"
 
 namespace lox {
-auto Token::toString() -> std::string {
-    auto type = lox::tokenTypeToString[m_type];
-    auto literal = m_literal->toString();
-    std::string res = "type: " + type + "     " + "lexeme: " + m_lexeme + " " +
-                      "literal: " + literal;
+
+// 只有字面量保存字面量对象
+static auto hasLiteral(TokenType type) -> bool {
+    return type == NUMBER || type == STRING;
+}
+
+Token::Token(TokenType type, LoxStringRef text, ObjectRef literal, int line,
+             int column)
+    : m_text(std::move(text)),
+      m_literal(hasLiteral(type) ? std::move(literal) : nullptr),
+      m_type(type), m_line(line), m_column(column) {}
+
+Token::Token(TokenType type, const std::string &lexeme, ObjectRef literal,
+             int line, int column)
+    : Token(type, LoxStringRef(), std::move(literal), line, column) {
+    auto derived = !tokenSpelling(type).empty() ||
+                   (type == STRING && m_literal != nullptr &&
+                    m_literal->getString() != nullptr);
+    if (!derived && !lexeme.empty())
+        m_text = LoxString::make(lexeme);
+}
+
+auto Token::toString() const -> std::string {
+    auto type = std::string(tokenTypeName(m_type));
+    auto literal = m_literal != nullptr ? m_literal->toString() : "nil";
+    std::string res = "type: " + type + "     " + "lexeme: " + getLexeme() +
+                      " " + "literal: " + literal;
     return res;
 }
-auto Token::getType() -> TokenType { return m_type; }
-auto Token::getLine() -> int { return m_line; }
-auto Token::getLiteral() -> ObjectRef { return m_literal; }
-auto Token::getLexeme() -> std::string { return m_lexeme; }
+auto Token::getType() const -> TokenType { return m_type; }
+auto Token::getLine() const -> int { return m_line; }
+auto Token::getLiteral() const -> ObjectRef { return m_literal; }
+auto Token::getLexeme() const -> std::string {
+    if (m_text != nullptr)
+        return m_text->str();
+    if (m_type == STRING && m_literal != nullptr)
+        return "\"" + m_literal->getString()->str() + "\"";
+    return std::string(tokenSpelling(m_type));
+}
+
+SourceToken::SourceToken(const Token &token)
+    : m_text(token.m_text), m_type(token.m_type), m_line(token.m_line),
+      m_column(token.m_column) {
+    if (m_type == STRING && m_text == nullptr)
+        m_text = LoxString::make(token.getLexeme());
+}
+
+auto SourceToken::getLexeme() const -> std::string {
+    if (m_text != nullptr)
+        return m_text->str();
+    return std::string(tokenSpelling(m_type));
+}
 } // namespace lox
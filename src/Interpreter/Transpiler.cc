@@ -0,0 +1,613 @@
+#include "Interpreter/Transpiler.h"
+#include "Interpreter/Expression.h"
+#include "Interpreter/LoxString.h"
+#include "Interpreter/Object.h"
+#include "Interpreter/Statements.h"
+#include "Runtime/StackProbe.h"
+
+#include <charconv>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <dlfcn.h>
+#include <fstream>
+#include <map>
+#include <stdexcept>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#ifndef LOX_RUNTIME_INCLUDE_DIR
+#define LOX_RUNTIME_INCLUDE_DIR "src/include"
+#endif
+#ifndef LOX_RUNTIME_LIBRARY
+#define LOX_RUNTIME_LIBRARY "liblox_runtime.a"
+#endif
+
+namespace lox {
+
+namespace {
+
+// 作用域中的一个变量
+struct Variable {
+    int id;
+    std::string cpp; // 生成的 C++ 代码中的名字
+    bool boxed;      // 被内层函数捕获，放在 Cell 里
+    int function;    // 声明它的函数的嵌套层次，0 为顶层
+};
+
+// 按 Resolver 的作用域结构遍历 AST 并生成 C++ 代码。
+//
+// 哪些变量被内层函数捕获要看完整个函数才知道，所以生成分两遍：
+// 第一遍只收集被捕获的变量，第二遍据此决定变量是否放进 Cell。
+// 两遍按相同的顺序给变量编号。
+class CodeGenerator {
+  public:
+    explicit CodeGenerator(const std::unordered_set<int> &boxed)
+        : m_boxed(boxed) {}
+
+    auto generate(const std::vector<StmtRef> &statements) -> void {
+        m_indent = 1;
+        for (auto &stmt : statements) {
+            emitStmt(stmt);
+        }
+    }
+
+    auto getCaptured() const -> const std::unordered_set<int> & {
+        return m_captured;
+    }
+
+    auto source() const -> std::string {
+        std::string out = "// Generated by the lox transpiler. Do not edit.\n"
+                          "#include \"Runtime/Runtime.h\"\n\n"
+                          "namespace {\n\n"
+                          "using namespace lox::runtime;\n\n";
+        for (auto &[name, cpp] : m_globals) {
+            out += "Global " + cpp + "(\"" + name + "\");\n";
+        }
+        for (auto &decl : m_constants) {
+            out += decl + "\n";
+        }
+        out += "\nvoid program() {\n";
+        for (auto &[name, cpp] : m_globals) {
+            out += "    " + cpp + ".reset();\n";
+        }
+        out += m_body;
+        out += "}\n\n"
+               "} // namespace\n\n"
+               "extern \"C\" int lox_main() {\n"
+               "    return lox::runtime::runProgram(program);\n"
+               "}\n\n"
+               "#ifndef LOX_SHARED\n"
+               "int main() { return lox_main(); }\n"
+               "#endif\n";
+        return out;
+    }
+
+  private:
+    auto line(const std::string &text) -> void {
+        m_body.append(m_indent * 4, ' ');
+        m_body += text;
+        m_body += '\n';
+    }
+
+    auto nextName(const std::string &prefix) -> std::string {
+        return prefix + std::to_string(m_nextId++);
+    }
+
+    auto declareLocal(const std::string &name) -> Variable & {
+        auto id = m_nextId++;
+        Variable var{id, "l" + std::to_string(id) + "_" + name,
+                     m_boxed.count(id) > 0, m_function};
+        return m_scopes.back()[name] = var;
+    }
+
+    // 按 Resolver 记录的作用域距离查找局部变量，全局变量返回 nullptr
+    auto lookup(const std::string &name, int depth) -> Variable * {
+        if (depth < 0 || static_cast<std::size_t>(depth) >= m_scopes.size())
+            return nullptr;
+        auto &scope = m_scopes[m_scopes.size() - 1 - depth];
+        auto iter = scope.find(name);
+        if (iter == scope.end())
+            return nullptr;
+        if (iter->second.function != m_function)
+            m_captured.insert(iter->second.id);
+        return &iter->second;
+    }
+
+    static auto ref(const Variable &var) -> std::string {
+        return var.boxed ? "(*" + var.cpp + ")" : var.cpp;
+    }
+
+    auto global(const std::string &name) -> const std::string & {
+        auto iter = m_globals.find(name);
+        if (iter == m_globals.end())
+            iter = m_globals.emplace(name, "g_" + name).first;
+        return iter->second;
+    }
+
+    static auto quote(std::string_view text) -> std::string {
+        std::string out = "\"";
+        for (unsigned char c : text) {
+            if (c == '"' || c == '\\') {
+                out += '\\';
+                out += static_cast<char>(c);
+            } else if (c >= 0x20 && c < 0x7f) {
+                out += static_cast<char>(c);
+            } else {
+                // 固定三位八进制，避免与后面的数字连在一起
+                char buf[5];
+                std::snprintf(buf, sizeof(buf), "\\%03o", c);
+                out += buf;
+            }
+        }
+        return out + "\"";
+    }
+
+    // 字符串字面量和属性名只构造一次，放在文件作用域
+    auto constant(std::map<std::string, std::string> &table,
+                  const std::string &text, const char *prefix,
+                  const char *type, const std::string &init) -> std::string {
+        auto iter = table.find(text);
+        if (iter != table.end())
+            return iter->second;
+        auto name = nextName(prefix);
+        m_constants.push_back("const " + std::string(type) + " " + name +
+                              " = " + init + ";");
+        table.emplace(text, name);
+        return name;
+    }
+
+    auto stringConstant(const std::string &text) -> std::string {
+        return constant(m_strings, text, "s", "Value",
+                        "Value::string(" + quote(text) + ")");
+    }
+
+    auto nameConstant(const std::string &text) -> std::string {
+        return constant(m_names, text, "n", "std::string", quote(text));
+    }
+
+    static auto numberLiteral(double value) -> std::string {
+        if (std::isinf(value))
+            return value < 0 ? "-std::numeric_limits<double>::infinity()"
+                             : "std::numeric_limits<double>::infinity()";
+        char buf[32];
+        auto res = std::to_chars(buf, buf + sizeof(buf), value);
+        std::string text(buf, res.ptr);
+        if (text.find_first_of(".e") == std::string::npos)
+            text += ".0";
+        return "Value(" + text + ")";
+    }
+
+    static auto lineOf(const SourceToken &token) -> std::string {
+        return std::to_string(token.getLine());
+    }
+
+    auto emitExpr(const AbstractExpressionRef<Object> &expr) -> std::string {
+        // 语法树的高度不受 Parser 限制，原生栈快用完时报告错误
+        if (stackExhausted()) {
+            if (auto *where = exprToken(*expr))
+                throw std::runtime_error("[line " + lineOf(*where) +
+                                         "] Too much nesting.");
+        }
+        if (auto literal =
+                std::dynamic_pointer_cast<LiteralExpression<Object>>(expr)) {
+            auto value = literal->getValue();
+            switch (value.getType()) {
+            case Object::Object_bool:
+                return value.getBool() ? "Value(true)" : "Value(false)";
+            case Object::Object_num:
+                return numberLiteral(value.getNum());
+            case Object::Object_str:
+                return stringConstant(std::string(value.getString()->view()));
+            default:
+                return "Value()";
+            }
+        }
+        if (auto group =
+                std::dynamic_pointer_cast<GroupingExpression<Object>>(expr)) {
+            return emitExpr(group->getExpr());
+        }
+        if (auto unary =
+                std::dynamic_pointer_cast<UnaryExpression<Object>>(expr)) {
+            auto operand = emitExpr(unary->getRightExpr());
+            if (unary->getOperation().getType() == BANG)
+                return "Value(!truthy(" + operand + "))";
+            return "negate(" + operand + ", " +
+                   lineOf(unary->getOperation()) + ")";
+        }
+        if (expr->kind() == ExprKind::Binary ||
+            expr->kind() == ExprKind::Logical) {
+            return emitChain(expr);
+        }
+        if (auto var =
+                std::dynamic_pointer_cast<VariableExpression<Object>>(expr)) {
+            auto name = var->getName().getLexeme();
+            if (auto *local = lookup(name, var->getDepth()))
+                return ref(*local);
+            return global(name) + ".get(" + lineOf(var->getName()) + ")";
+        }
+        if (auto assign =
+                std::dynamic_pointer_cast<AssignmentExpression<Object>>(expr)) {
+            auto value = emitExpr(assign->getValue());
+            auto name = assign->getName().getLexeme();
+            if (auto *local = lookup(name, assign->getDepth()))
+                return "(" + ref(*local) + " = " + value + ")";
+            return global(name) + ".assign(" + value + ", " +
+                   lineOf(assign->getName()) + ")";
+        }
+        if (auto call =
+                std::dynamic_pointer_cast<CallExpression<Object>>(expr)) {
+            std::string values = emitExpr(call->getCallee());
+            for (auto &arg : call->getArgs()) {
+                values += ", " + emitExpr(arg);
+            }
+            // 尾调用由外层的 callValue 接着执行，递归的尾调用不加深原生栈
+            return (call->isTailCall() ? "tailCall({" : "call({") + values +
+                   "}, " + lineOf(call->getParen()) + ")";
+        }
+        if (auto get = std::dynamic_pointer_cast<GetExpression<Object>>(expr)) {
+            return "getProperty(" + emitExpr(get->getObject()) + ", " +
+                   nameConstant(get->getName().getLexeme()) + ", " +
+                   lineOf(get->getName()) + ")";
+        }
+        if (auto set = std::dynamic_pointer_cast<SetExpression<Object>>(expr)) {
+            // 先确认对象是实例再对右边求值，与解释器的顺序一致
+            return "[&] { Value o_ = " + emitExpr(set->getObject()) +
+                   "; Instance &i_ = requireInstance(o_, " +
+                   lineOf(set->getName()) +
+                   "); Value v_ = " + emitExpr(set->getValue()) + "; i_.set(" +
+                   nameConstant(set->getName().getLexeme()) +
+                   ", v_); return v_; }()";
+        }
+        if (auto self = std::dynamic_pointer_cast<ThisExpression<Object>>(expr)) {
+            return ref(*lookup("this", self->getDepth()));
+        }
+        if (auto super =
+                std::dynamic_pointer_cast<SuperExpression<Object>>(expr)) {
+            auto *superclass = lookup("super", super->getDepth());
+            auto *self = lookup("this", super->getDepth() - 1);
+            return "superMethod(" + ref(*superclass) + ", " + ref(*self) +
+                   ", " + nameConstant(super->getMethod().getLexeme()) + ", " +
+                   lineOf(super->getMethod()) + ")";
+        }
+        throw std::logic_error("Transpiler: unsupported expression");
+    }
+
+    // 左结合的二元、逻辑运算链 a + b - c … 在循环里生成：从最里面的左操作数
+    // 开始，一层层包上外面的运算
+    auto emitChain(const AbstractExpressionRef<Object> &expr) -> std::string {
+        std::vector<AbstractExpression<Object> *> spine;
+        auto *node = expr.get();
+        while (node->kind() == ExprKind::Binary ||
+               node->kind() == ExprKind::Logical) {
+            spine.push_back(node);
+            node = leftOperand(*node)->get();
+        }
+        auto code = emitExpr(*leftOperand(*spine.back()));
+        for (auto iter = spine.rbegin(); iter != spine.rend(); ++iter) {
+            if ((*iter)->kind() == ExprKind::Binary) {
+                code = emitBinary(
+                    static_cast<BinaryExpression<Object> &>(**iter), code);
+            } else {
+                code = emitLogical(
+                    static_cast<LogicalExpression<Object> &>(**iter), code);
+            }
+        }
+        return code;
+    }
+
+    // 短路求值，结果是某一侧操作数本身
+    auto emitLogical(const LogicalExpression<Object> &logical,
+                     const std::string &left) -> std::string {
+        bool isOr = logical.getOperation().getType() == OR;
+        return "[&] { Value t_ = " + left + "; if (" + (isOr ? "" : "!") +
+               "truthy(t_)) return t_; return Value(" +
+               emitExpr(logical.getRightExpr()) + "); }()";
+    }
+
+    auto emitBinary(const BinaryExpression<Object> &binary,
+                    const std::string &left) -> std::string {
+        auto operands =
+            "{" + left + ", " + emitExpr(binary.getRightExpr()) + "}";
+        auto line = lineOf(binary.getOperation());
+        switch (binary.getOperation().getType()) {
+        case PLUS:
+            return "add(" + operands + ", " + line + ")";
+        case MINUS:
+            return "subtract(" + operands + ", " + line + ")";
+        case STAR:
+            return "multiply(" + operands + ", " + line + ")";
+        case SLASH:
+            return "divide(" + operands + ", " + line + ")";
+        case LESS:
+            return "less(" + operands + ", " + line + ")";
+        case LESS_EQUAL:
+            return "lessEqual(" + operands + ", " + line + ")";
+        case GREATER:
+            return "greater(" + operands + ", " + line + ")";
+        case GREATER_EQUAL:
+            return "greaterEqual(" + operands + ", " + line + ")";
+        case EQUAL_EQUAL:
+            return "equalOp(" + operands + ")";
+        case BANG_EQUAL:
+            return "notEqualOp(" + operands + ")";
+        default:
+            throw std::logic_error("Transpiler: unsupported operator");
+        }
+    }
+
+    auto emitStmt(const StmtRef &stmt) -> void {
+        if (auto expr = std::dynamic_pointer_cast<ExpressionStmt>(stmt)) {
+            line(emitExpr(expr->getExpr()) + ";");
+        } else if (auto print = std::dynamic_pointer_cast<PrintStmt>(stmt)) {
+            line("print(" + emitExpr(print->getExpr()) + ");");
+        } else if (auto var = std::dynamic_pointer_cast<VarStmt>(stmt)) {
+            auto init = var->getInitExpr() != nullptr
+                            ? emitExpr(var->getInitExpr())
+                            : std::string("Value()");
+            auto name = var->getName().getLexeme();
+            if (m_scopes.empty()) {
+                line(global(name) + ".define(" + init + ");");
+            } else {
+                auto &local = declareLocal(name);
+                line(local.boxed ? "Cell " + local.cpp + " = makeCell(" + init +
+                                       ");"
+                                 : "Value " + local.cpp + " = " + init + ";");
+            }
+        } else if (auto block = std::dynamic_pointer_cast<BlockStmt>(stmt)) {
+            line("{");
+            m_indent++;
+            m_scopes.emplace_back();
+            for (auto &inner : block->getStmt()) {
+                emitStmt(inner);
+            }
+            m_scopes.pop_back();
+            m_indent--;
+            line("}");
+        } else if (auto branch = std::dynamic_pointer_cast<IfStmt>(stmt)) {
+            // else if 链在循环里生成
+            line("if (truthy(" + emitExpr(branch->getCondition()) + ")) {");
+            emitNested(branch->getThen());
+            auto next = branch->getElse();
+            while (auto elseIf = std::dynamic_pointer_cast<IfStmt>(next)) {
+                line("} else if (truthy(" + emitExpr(elseIf->getCondition()) +
+                     ")) {");
+                emitNested(elseIf->getThen());
+                next = elseIf->getElse();
+            }
+            if (next != nullptr) {
+                line("} else {");
+                emitNested(next);
+            }
+            line("}");
+        } else if (auto loop = std::dynamic_pointer_cast<WhileStmt>(stmt)) {
+            line("while (truthy(" + emitExpr(loop->getCondition()) + ")) {");
+            emitNested(loop->getBody());
+            line("}");
+        } else if (auto fun = std::dynamic_pointer_cast<FunStmt>(stmt)) {
+            emitFunStmt(fun);
+        } else if (auto ret = std::dynamic_pointer_cast<ReturnStmt>(stmt)) {
+            if (ret->getValue() != nullptr) {
+                line("return " + emitExpr(ret->getValue()) + ";");
+            } else {
+                line(m_initializer ? "return " + m_self + ";"
+                                   : std::string("return Value();"));
+            }
+        } else if (auto klass = std::dynamic_pointer_cast<ClassStmt>(stmt)) {
+            emitClass(klass);
+        } else if (auto import = std::dynamic_pointer_cast<ImportStmt>(stmt)) {
+            throw std::runtime_error(
+                "[line " + std::to_string(import->getKeyword().getLine()) +
+                "] Can't compile 'import' ahead of time.");
+        } else {
+            throw std::logic_error("Transpiler: unsupported statement");
+        }
+    }
+
+    auto emitNested(const StmtRef &stmt) -> void {
+        m_indent++;
+        emitStmt(stmt);
+        m_indent--;
+    }
+
+    auto emitFunStmt(const FunStmtRef &fun) -> void {
+        auto name = fun->getName().getLexeme();
+        auto self = nextName("self");
+        if (m_scopes.empty()) {
+            emitFunction(global(name) + ".define(", fun, false, self, ");");
+            return;
+        }
+        // 先声明再创建函数，函数体里可以递归引用自己
+        auto &local = declareLocal(name);
+        if (local.boxed) {
+            line("Cell " + local.cpp + " = makeCell();");
+            emitFunction("*" + local.cpp + " = ", fun, false, self, ";");
+        } else {
+            emitFunction("Value " + local.cpp + " = ", fun, false, self, ";");
+        }
+    }
+
+    // 生成 makeFunction(...)，前后分别接上 prefix 和 suffix。
+    // self 是 lambda 中绑定的实例参数的名字
+    auto emitFunction(const std::string &prefix, const FunStmtRef &fun,
+                      bool initializer, const std::string &self,
+                      const std::string &suffix) -> void {
+        auto params = fun->getParams();
+        auto args = nextName("args");
+        line(prefix + "makeFunction(" + quote(fun->getName().getLexeme()) +
+             ", " + std::to_string(params.size()) + ", " +
+             (initializer ? "true" : "false") + ", [=](const Value &" + self +
+             ", Value *" + args + ") -> Value {");
+        auto enclosingSelf = m_self;
+        auto enclosingInitializer = m_initializer;
+        m_self = self;
+        m_initializer = initializer;
+        m_function++;
+        m_indent++;
+        m_scopes.emplace_back();
+        for (std::size_t i = 0; i < params.size(); i++) {
+            auto &param = declareLocal(params[i].getLexeme());
+            auto arg = args + "[" + std::to_string(i) + "]";
+            line(param.boxed ? "Cell " + param.cpp + " = makeCell(" + arg + ");"
+                             : "Value " + param.cpp + " = " + arg + ";");
+        }
+        for (auto &stmt : fun->getBody()) {
+            emitStmt(stmt);
+        }
+        line(initializer ? "return " + self + ";"
+                         : std::string("return Value();"));
+        m_scopes.pop_back();
+        m_indent--;
+        m_function--;
+        m_self = enclosingSelf;
+        m_initializer = enclosingInitializer;
+        line("})" + suffix);
+    }
+
+    auto emitClass(const ClassStmtRef &klass) -> void {
+        auto name = klass->getName().getLexeme();
+        bool isGlobal = m_scopes.empty();
+        std::string target;
+        if (isGlobal) {
+            target = global(name);
+        } else {
+            auto &local = declareLocal(name);
+            line(local.boxed ? "Cell " + local.cpp + " = makeCell();"
+                             : "Value " + local.cpp + ";");
+            target = ref(local);
+        }
+        line("{");
+        m_indent++;
+        auto cls = nextName("class");
+        auto super = klass->getSuper();
+        std::string superName = "Value()";
+        if (super != nullptr) {
+            superName = nextName("super");
+            line("Value " + superName + " = " + emitExpr(super) + ";");
+        }
+        auto superLine =
+            lineOf(super != nullptr ? super->getName() : klass->getName());
+        line("ClassRef " + cls + " = makeClass(" + quote(name) + ", " +
+             superName + ", " + superLine + ");");
+        // 解释器先把类名定义为 nil，方法创建完之后再赋值
+        if (isGlobal)
+            line(target + ".define(Value());");
+
+        if (super != nullptr) {
+            m_scopes.emplace_back();
+            m_scopes.back()["super"] = {m_nextId++, superName, false,
+                                        m_function};
+        }
+        m_scopes.emplace_back();
+        m_scopes.back()["this"] = {m_nextId++, "", false, m_function};
+        for (auto &method : klass->getMethods()) {
+            // 每个方法的 this 是它自己的 self 参数
+            auto self = nextName("self");
+            m_scopes.back()["this"].cpp = self;
+            auto methodName = method->getName().getLexeme();
+            emitFunction(cls + "->addMethod(" + quote(methodName) + ", ",
+                         method, methodName == "init", self, ");");
+        }
+        m_scopes.pop_back();
+        if (super != nullptr)
+            m_scopes.pop_back();
+
+        line(isGlobal ? target + ".define(Value(" + cls + "));"
+                      : target + " = Value(" + cls + ");");
+        m_indent--;
+        line("}");
+    }
+
+    const std::unordered_set<int> &m_boxed;
+    std::unordered_set<int> m_captured;
+    std::vector<std::unordered_map<std::string, Variable>> m_scopes;
+    int m_function = 0;
+    int m_nextId = 0;
+    std::string m_self;
+    bool m_initializer = false;
+
+    int m_indent = 1;
+    std::string m_body;
+    std::map<std::string, std::string> m_globals;
+    std::map<std::string, std::string> m_strings;
+    std::map<std::string, std::string> m_names;
+    std::vector<std::string> m_constants;
+};
+
+auto shellQuote(const std::string &text) -> std::string {
+    std::string out = "'";
+    for (char c : text) {
+        if (c == '\'')
+            out += "'\\''";
+        else
+            out += c;
+    }
+    return out + "'";
+}
+
+} // namespace
+
+auto Transpiler::translate(const Program &program) -> std::string {
+    std::unordered_set<int> none;
+    CodeGenerator analysis(none);
+    analysis.generate(program.getStatements());
+    CodeGenerator generator(analysis.getCaptured());
+    generator.generate(program.getStatements());
+    return generator.source();
+}
+
+auto Transpiler::build(const std::string &source, const std::string &output,
+                       Output kind, std::string &errors) -> bool {
+    auto sourcePath = output + ".cc";
+    {
+        std::ofstream file(sourcePath);
+        file << source;
+        if (!file) {
+            errors = "Failed to write " + sourcePath;
+            return false;
+        }
+    }
+    const char *cxx = std::getenv("LOX_CXX");
+    std::string command = cxx != nullptr ? cxx : "c++";
+    command += " -std=c++17 -O2 -w";
+    if (kind == Output::SharedObject)
+        command += " -shared -fPIC -DLOX_SHARED";
+    command += " -I" + shellQuote(LOX_RUNTIME_INCLUDE_DIR) + " " +
+               shellQuote(sourcePath) + " " + shellQuote(LOX_RUNTIME_LIBRARY) +
+               " -o " + shellQuote(output) + " 2>&1";
+
+    errors.clear();
+    FILE *pipe = popen(command.c_str(), "r");
+    if (pipe == nullptr) {
+        errors = "Failed to run " + command;
+        return false;
+    }
+    char buf[4096];
+    for (std::size_t n; (n = std::fread(buf, 1, sizeof(buf), pipe)) > 0;) {
+        errors.append(buf, n);
+    }
+    auto status = pclose(pipe);
+    std::remove(sourcePath.c_str());
+    return status == 0;
+}
+
+auto Transpiler::runShared(const std::string &path) -> int {
+    // 不带目录的名字会被 dlopen 当作库名在系统路径中查找
+    auto file = path.find('/') == std::string::npos ? "./" + path : path;
+    void *handle = dlopen(file.c_str(), RTLD_NOW | RTLD_LOCAL);
+    if (handle == nullptr)
+        throw std::runtime_error(dlerror());
+    auto entry = reinterpret_cast<int (*)()>(dlsym(handle, "lox_main"));
+    if (entry == nullptr) {
+        std::string message = dlerror();
+        dlclose(handle);
+        throw std::runtime_error(message);
+    }
+    auto status = entry();
+    dlclose(handle);
+    return status;
+}
+
+} // namespace lox
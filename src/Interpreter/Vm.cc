@@ -0,0 +1,702 @@
+#include "Interpreter/Vm.h"
+#include "Interpreter/Interpreter.h"
+#include "Interpreter/LoxClass.h"
+#include "Interpreter/LoxFunction.h"
+#include "Interpreter/LoxInstance.h"
+#include "Interpreter/RuntimeError.h"
+
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#if (defined(__GNUC__) || defined(__clang__)) &&                               \
+    !defined(LOX_VM_SWITCH_DISPATCH)
+#define LOX_VM_COMPUTED_GOTO 1
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define LOX_VM_NOINLINE __attribute__((noinline))
+#else
+#define LOX_VM_NOINLINE
+#endif
+
+namespace lox {
+
+auto Vm::hasThreadedDispatch() -> bool {
+#ifdef LOX_VM_COMPUTED_GOTO
+    return true;
+#else
+    return false;
+#endif
+}
+
+auto Vm::dispatchTable() -> const void *const * {
+#ifdef LOX_VM_COMPUTED_GOTO
+    static const void *const *table = [] {
+        const void *const *labels = nullptr;
+        execute<true>(nullptr, nullptr, nullptr, &labels);
+        return labels;
+    }();
+    return table;
+#else
+    return nullptr;
+#endif
+}
+
+auto Vm::acquire(std::size_t count) -> Object * {
+    for (;;) {
+        if (m_current == m_segments.size()) {
+            Segment segment;
+            segment.size = std::max(kSegmentSize, count);
+            segment.slots = std::make_unique<Object[]>(segment.size);
+            m_segments.push_back(std::move(segment));
+        }
+        auto &segment = m_segments[m_current];
+        if (segment.used + count <= segment.size) {
+            auto *slots = segment.slots.get() + segment.used;
+            segment.used += count;
+            return slots;
+        }
+        if (segment.used == 0) {
+            // 空的段放不下，换一个足够大的
+            segment.size = count;
+            segment.slots = std::make_unique<Object[]>(count);
+            continue;
+        }
+        m_current++;
+    }
+}
+
+auto Vm::release(std::size_t count) -> void {
+    auto &segment = m_segments[m_current];
+    segment.used -= count;
+    if (segment.used == 0 && m_current > 0)
+        m_current--;
+}
+
+auto Vm::run(const Chunk &chunk, EnvironmentRef env, Object &result) -> bool {
+    auto *stack = acquire(static_cast<std::size_t>(chunk.maxStack));
+    m_frames.push_back(
+        Frame{&chunk, chunk.code.data(), stack, stack, std::move(env), nullptr});
+    auto *entry = &m_frames.back();
+    bool returned;
+    try {
+        returned = m_threaded ? execute<true>(this, entry, &result, nullptr)
+                              : execute<false>(this, entry, &result, nullptr);
+    } catch (...) {
+        unwind(entry);
+        throw;
+    }
+    // 尾调用可能换掉了入口帧的 chunk，按最后的大小归还
+    release(static_cast<std::size_t>(entry->chunk->maxStack));
+    m_frames.pop_back();
+    return returned;
+}
+
+auto Vm::unwind(const Frame *entry) -> void {
+    for (;;) {
+        auto &frame = m_frames.back();
+        auto count = static_cast<std::size_t>(frame.chunk->maxStack);
+        // 出错时栈上可能还有值，清掉它们持有的引用
+        std::fill(frame.stack, frame.stack + count, Object());
+        release(count);
+        bool done = &frame == entry;
+        if (!done)
+            m_interpreter->leaveCall();
+        m_frames.pop_back();
+        if (done)
+            return;
+    }
+}
+
+// 指令的具体操作都在栈槽上原地读写，不在 execute 里产生临时对象：
+// 字节码和其他可调用对象互相调用时每层都要占用一个 execute 栈帧，
+// 未优化的构建里每个临时对象都会让这个栈帧变大
+
+static inline auto isTruthy(const Object &value) -> bool {
+    if (value.getType() == Object::Object_nil)
+        return false;
+    if (value.getType() == Object::Object_bool)
+        return value.getBool();
+    return true;
+}
+
+static inline auto bothNumbers(const Object &left, const Object &right)
+    -> bool {
+    return left.getType() == Object::Object_num &&
+           right.getType() == Object::Object_num;
+}
+
+static inline auto clear(Object &slot) -> void { slot = Object(); }
+static inline auto setNil(Object &slot) -> void {
+    slot = Object::make_nil_obj();
+}
+static inline auto setValue(Object &slot, bool value) -> void {
+    slot = Object::make_bool_obj(value);
+}
+static inline auto setValue(Object &slot, double value) -> void {
+    slot = Object::make_num_obj(value);
+}
+
+[[noreturn]] static auto numberError(const SourceToken &operation) -> void {
+    throw RuntimeError(operation, "Operand must be a number.");
+}
+
+[[noreturn]] static auto fieldsError(const SourceToken &name) -> void {
+    throw RuntimeError(name, "Only instances have fields.");
+}
+
+// left = left + right
+static inline auto add(Object &left, const Object &right,
+                       const SourceToken &operation) -> void {
+    if (bothNumbers(left, right)) {
+        setValue(left, left.getNum() + right.getNum());
+        return;
+    }
+    if (left.getType() == Object::Object_str &&
+        right.getType() == Object::Object_str) {
+        left = Object::make_str_obj(
+            LoxString::concat(left.getString(), right.getString()));
+        return;
+    }
+    throw RuntimeError(operation, "Operands must be two numbers or two strings.");
+}
+
+// left = left op right，两边都必须是数字；op 是算术运算或比较
+template <typename Op>
+static inline auto binary(Object &left, const Object &right,
+                          const SourceToken &operation) -> void {
+    if (!bothNumbers(left, right))
+        numberError(operation);
+    setValue(left, Op{}(left.getNum(), right.getNum()));
+}
+
+template <typename Op>
+static inline auto compare(const Object &left, const Object &right,
+                           const SourceToken &operation) -> bool {
+    if (!bothNumbers(left, right))
+        numberError(operation);
+    return Op{}(left.getNum(), right.getNum());
+}
+
+static inline auto equal(Interpreter &interpreter, const Object &left,
+                         const Object &right) -> bool {
+    return interpreter.isEqual(left, right);
+}
+
+static inline auto negate(Object &slot, const SourceToken &operation) -> void {
+    if (slot.getType() != Object::Object_num)
+        numberError(operation);
+    setValue(slot, -slot.getNum());
+}
+
+// 从 env 向外走 depth 层；只有遇到冻结的环境才交给解释器找副本
+static inline auto scope(Interpreter &interpreter, Environment *env, int depth,
+                         bool create) -> Environment * {
+    for (int i = 0; i < depth; i++) {
+        env = env->getEnclosing().get();
+    }
+    if (env->isFrozen())
+        return interpreter.localScope(env, 0, create);
+    return env;
+}
+
+static inline auto setLocal(Environment *env, const std::string &name,
+                            const Object &value) -> void {
+    env->define(name, std::make_shared<Object>(value));
+}
+
+static inline auto getGlobal(Interpreter &interpreter, Object &slot,
+                             const SourceToken &name) -> void {
+    slot = *interpreter.globals->get(name);
+}
+
+static inline auto setGlobal(Interpreter &interpreter, const SourceToken &name,
+                             const Object &value) -> void {
+    interpreter.globals->assign(name, std::make_shared<Object>(value));
+}
+
+// 把 slot 中的值定义到 env 中并清空 slot
+static inline auto define(Environment &env, const std::string &name,
+                          Object &slot) -> void {
+    env.define(name, std::make_shared<Object>(std::move(slot)));
+    clear(slot);
+}
+
+static inline auto print(Interpreter &interpreter, Object &slot) -> void {
+    interpreter.print(std::move(slot));
+    clear(slot);
+}
+
+static inline auto pushScope(EnvironmentRef &env) -> void {
+    env = std::make_shared<Environment>(std::move(env));
+}
+
+static inline auto popScope(EnvironmentRef &env) -> void {
+    env = env->getEnclosing();
+}
+
+// 调用、定义之类的慢路径不内联，免得它们的局部变量撑大 execute 的栈帧
+
+// 函数体的字节码。延迟解析的函数体在第一次调用时解析和编译
+static auto chunkOf(const FunctionCode *code) -> const Chunk * {
+    if (auto *chunk = dynamic_cast<const Chunk *>(code))
+        return chunk;
+    if (auto *lazy = dynamic_cast<const LazyFunctionCode *>(code))
+        return dynamic_cast<const Chunk *>(lazy->get().get());
+    return nullptr;
+}
+
+// callee 是函数体编译成了字节码的 Lox 函数时返回它，字节码写入 chunk
+static auto bytecodeFunction(const Object &callee, const Chunk *&chunk)
+    -> LoxFunctionRef {
+    if (callee.getType() != Object::Object_fun)
+        return nullptr;
+    auto function = std::dynamic_pointer_cast<LoxFunction>(callee.getFun());
+    if (function == nullptr ||
+        (chunk = chunkOf(function->getCode().get())) == nullptr)
+        return nullptr;
+    return function;
+}
+
+template <bool Tail>
+LOX_VM_NOINLINE auto Vm::call(Frame *frame, const Frame *entry,
+                              const Instruction *ip, Object *sp,
+                              const SourceToken *name) -> bool {
+    auto &interpreter = *m_interpreter;
+    const auto &paren = frame->chunk->tokens[ip->c];
+    auto argc = ip->b;
+    auto *callee = sp - 1;
+    frame->ip = ip + 1;
+    frame->sp = sp;
+    if (name != nullptr)
+        *callee = interpreter.getProperty(std::move(*callee), *name);
+
+    const Chunk *chunk = nullptr;
+    auto function = bytecodeFunction(*callee, chunk);
+    if (function == nullptr) {
+        std::vector<ObjectRef> arguments;
+        arguments.reserve(argc);
+        for (auto *arg = callee + 1; arg != callee + 1 + argc; arg++) {
+            arguments.push_back(std::make_shared<Object>(std::move(*arg)));
+            clear(*arg);
+        }
+        auto target = std::move(*callee);
+        // 只有入口帧外面有 LoxFunction::call 接着执行记下的尾调用
+        if (Tail && frame == entry) {
+            *callee = interpreter.tailCall(std::move(target),
+                                           std::move(arguments), paren);
+        } else {
+            *callee = interpreter.callValue(std::move(target),
+                                            std::move(arguments), paren);
+        }
+        return false;
+    }
+
+    if (argc != function->arity()) {
+        throw RuntimeError(paren, "Expected " +
+                                      std::to_string(function->arity()) +
+                                      " arguments but got " +
+                                      std::to_string(argc) + ".");
+    }
+    if (!Tail)
+        interpreter.enterCall(paren);
+    double number;
+    if (!function->isInitializer() &&
+        interpreter.getJit().tryCall(*function, callee + 1,
+                                     static_cast<std::size_t>(argc), number)) {
+        std::fill(callee + 1, callee + 1 + argc, Object());
+        setValue(*callee, number);
+        if (!Tail)
+            interpreter.leaveCall();
+        return false;
+    }
+
+    auto env = std::make_shared<Environment>(function->getClosure());
+    const auto &params = function->getDeclaration()->getParams();
+    for (int i = 0; i < argc; i++) {
+        define(*env, params[i].getLexeme(), callee[1 + i]);
+    }
+    clear(*callee);
+    if constexpr (Tail) {
+        // 参数已经移进新的环境，当前帧的操作数栈可以先归还再换成新函数的
+        release(static_cast<std::size_t>(frame->chunk->maxStack));
+        auto *stack = acquire(static_cast<std::size_t>(chunk->maxStack));
+        *frame = Frame{chunk,           chunk->code.data(), stack, stack,
+                       std::move(env), std::move(function)};
+    } else {
+        auto *stack = acquire(static_cast<std::size_t>(chunk->maxStack));
+        m_frames.push_back(Frame{chunk, chunk->code.data(), stack, stack,
+                                 std::move(env), std::move(function)});
+    }
+    return true;
+}
+
+LOX_VM_NOINLINE auto Vm::leave(const Frame *entry, Object *value,
+                               Object *result) -> bool {
+    auto &frame = m_frames.back();
+    auto returned = Object::make_nil_obj();
+    if (value != nullptr) {
+        returned = std::move(*value);
+        clear(*value);
+    }
+    if (frame.function != nullptr && frame.function->isInitializer())
+        returned = *frame.function->getClosure()->getAt(0, "this");
+    if (&frame == entry) {
+        *result = std::move(returned);
+        return true;
+    }
+    release(static_cast<std::size_t>(frame.chunk->maxStack));
+    m_frames.pop_back();
+    m_interpreter->leaveCall();
+    m_frames.back().sp[-1] = std::move(returned);
+    return false;
+}
+
+LOX_VM_NOINLINE static auto getProperty(Interpreter &interpreter,
+                                        Object &object, const SourceToken &name)
+    -> void {
+    object = interpreter.getProperty(std::move(object), name);
+}
+
+// [对象 值] -> [值]
+LOX_VM_NOINLINE static auto setProperty(Interpreter &interpreter,
+                                        Object *object, const SourceToken &name)
+    -> void {
+    interpreter.localCopy(object[0].getInstance(), true)
+        ->set(name, std::make_shared<Object>(object[1]));
+    object[0] = std::move(object[1]);
+    clear(object[1]);
+}
+
+LOX_VM_NOINLINE static auto getSuper(Object &slot, Environment *superScope,
+                                     Environment *thisScope,
+                                     const SourceToken &name) -> void {
+    auto superclass = (*superScope->findLocal("super"))->getClass();
+    auto instance = (*thisScope->findLocal("this"))->getInstance();
+    auto method = superclass->findMethod(name.getLexeme());
+    if (method == nullptr) {
+        throw RuntimeError(name,
+                           "Undefined property '" + name.getLexeme() + "'.");
+    }
+    slot = Object::make_fun_obj(method->bind(instance));
+}
+
+LOX_VM_NOINLINE static auto defineFunction(const EnvironmentRef &env,
+                                           const Chunk::Function &function)
+    -> void {
+    auto closure = std::make_shared<LoxFunction>(function.declaration, env,
+                                                 false, function.code);
+    env->define(function.declaration->getName().getLexeme(),
+                std::make_shared<Object>(Object::make_fun_obj(closure)));
+}
+
+// 第一次导入时在这里嵌套执行模块。帧栈是 deque，操作数栈按段分配，
+// 嵌套执行不会移动当前帧和它的栈槽
+LOX_VM_NOINLINE static auto importModule(Interpreter &interpreter,
+                                         Object &slot, const ImportStmt &stmt)
+    -> void {
+    slot = interpreter.importModule(stmt);
+}
+
+// superclass 不为空时是栈上的父类，取出之后清空
+LOX_VM_NOINLINE static auto defineClass(Interpreter &interpreter,
+                                        const EnvironmentRef &env,
+                                        const Chunk::Class &klass,
+                                        Object *superclass) -> void {
+    ObjectRef super = nullptr;
+    if (superclass != nullptr) {
+        super = std::make_shared<Object>(std::move(*superclass));
+        clear(*superclass);
+    }
+    interpreter.defineClass(env, klass.name, super, klass.superName,
+                            klass.methods);
+}
+
+template <bool Threaded>
+auto Vm::execute(Vm *vm, Frame *entry, Object *result,
+                 const void *const **table) -> bool {
+#ifdef LOX_VM_COMPUTED_GOTO
+    static const void *const labels[] = {
+#define LOX_OPCODE_LABEL(name) &&op_##name,
+        LOX_OPCODES(LOX_OPCODE_LABEL)
+#undef LOX_OPCODE_LABEL
+    };
+    if (table != nullptr) {
+        *table = labels;
+        return false;
+    }
+// 直接线索化：跳到下一条指令自己的处理代码。
+// 通过 goto * 离开作用域时编译器不会析构其中的局部变量，
+// 所以指令处理代码里只有平凡类型的局部变量
+#define DISPATCH()                                                             \
+    do {                                                                       \
+        if constexpr (Threaded)                                                \
+            goto *ip->target;                                                  \
+        else                                                                   \
+            goto dispatch;                                                     \
+    } while (0)
+#define CASE(name)                                                             \
+    case OpCode::name:                                                         \
+    op_##name:
+#else
+#define DISPATCH() goto dispatch
+#define CASE(name) case OpCode::name:
+#endif
+#define NEXT()                                                                 \
+    do {                                                                       \
+        ++ip;                                                                  \
+        DISPATCH();                                                            \
+    } while (0)
+// 切换到帧栈顶的帧：刚压入的被调用者，或者返回后的调用者
+#define LOAD_FRAME()                                                           \
+    do {                                                                       \
+        frame = &vm->m_frames.back();                                          \
+        chunk = frame->chunk;                                                  \
+        code = chunk->code.data();                                             \
+        ip = frame->ip;                                                        \
+        sp = frame->sp;                                                        \
+        env = frame->env.get();                                                \
+    } while (0)
+#define TOKEN(index) chunk->tokens[index]
+#define CONSTANT(index) chunk->constants[index]
+#define SCOPE(index, create)                                                   \
+    scope(*interpreter, env, chunk->locals[index].depth, create)
+#define LOCAL(index)                                                           \
+    (**SCOPE(index, false)->findLocal(chunk->locals[index].name))
+#define JUMP_IF(condition)                                                     \
+    do {                                                                       \
+        ip = (condition) ? code + ip->a : ip + 1;                              \
+        DISPATCH();                                                            \
+    } while (0)
+
+    auto *interpreter = vm->m_interpreter;
+    Frame *frame;
+    const Chunk *chunk;
+    const Instruction *code;
+    const Instruction *ip;
+    Object *sp;
+    Environment *env;
+    bool taken;
+
+    LOAD_FRAME();
+
+    DISPATCH();
+#ifdef LOX_VM_COMPUTED_GOTO
+dispatch: // 线索化分派不会跳到这里
+    __attribute__((unused));
+#else
+dispatch:
+#endif
+    switch (ip->op) {
+    CASE(CONSTANT)
+        *sp++ = CONSTANT(ip->a);
+        NEXT();
+    CASE(NIL)
+        setNil(*sp++);
+        NEXT();
+    CASE(TRUE)
+        setValue(*sp++, true);
+        NEXT();
+    CASE(FALSE)
+        setValue(*sp++, false);
+        NEXT();
+    CASE(POP)
+        clear(*--sp);
+        NEXT();
+    CASE(GET_LOCAL)
+        *sp++ = LOCAL(ip->a);
+        NEXT();
+    CASE(SET_LOCAL)
+        setLocal(SCOPE(ip->a, true), chunk->locals[ip->a].name, sp[-1]);
+        NEXT();
+    CASE(GET_GLOBAL)
+        getGlobal(*interpreter, *sp++, TOKEN(ip->a));
+        NEXT();
+    CASE(SET_GLOBAL)
+        setGlobal(*interpreter, TOKEN(ip->a), sp[-1]);
+        NEXT();
+    CASE(DEFINE)
+        define(*env, chunk->names[ip->a], *--sp);
+        NEXT();
+    CASE(GET_PROPERTY)
+        getProperty(*interpreter, sp[-1], TOKEN(ip->a));
+        NEXT();
+    CASE(CHECK_FIELDS)
+        if (sp[-1].getType() != Object::Object_instance)
+            fieldsError(TOKEN(ip->a));
+        NEXT();
+    CASE(SET_PROPERTY)
+        setProperty(*interpreter, sp - 2, TOKEN(ip->a));
+        --sp;
+        NEXT();
+    CASE(GET_SUPER)
+        getSuper(*sp++, SCOPE(ip->a, false), SCOPE(ip->b, false), TOKEN(ip->c));
+        NEXT();
+    CASE(ADD)
+        add(sp[-2], sp[-1], TOKEN(ip->c));
+        clear(*--sp);
+        NEXT();
+#define LOX_VM_BINARY(name, op)                                                \
+    CASE(name)                                                                 \
+        binary<op>(sp[-2], sp[-1], TOKEN(ip->c));                              \
+        --sp;                                                                  \
+        NEXT();
+    LOX_VM_BINARY(SUBTRACT, std::minus<double>)
+    LOX_VM_BINARY(MULTIPLY, std::multiplies<double>)
+    LOX_VM_BINARY(DIVIDE, std::divides<double>)
+    LOX_VM_BINARY(LESS, std::less<double>)
+    LOX_VM_BINARY(LESS_EQUAL, std::less_equal<double>)
+    LOX_VM_BINARY(GREATER, std::greater<double>)
+    LOX_VM_BINARY(GREATER_EQUAL, std::greater_equal<double>)
+#undef LOX_VM_BINARY
+    CASE(EQUAL)
+        setValue(sp[-2], equal(*interpreter, sp[-2], sp[-1]));
+        clear(*--sp);
+        NEXT();
+    CASE(NOT_EQUAL)
+        setValue(sp[-2], !equal(*interpreter, sp[-2], sp[-1]));
+        clear(*--sp);
+        NEXT();
+    CASE(NEGATE)
+        negate(sp[-1], TOKEN(ip->c));
+        NEXT();
+    CASE(NOT)
+        setValue(sp[-1], !isTruthy(sp[-1]));
+        NEXT();
+    CASE(PRINT)
+        print(*interpreter, *--sp);
+        NEXT();
+    CASE(JUMP)
+        ip = code + ip->a;
+        DISPATCH();
+    CASE(JUMP_IF_FALSE)
+        taken = !isTruthy(*--sp);
+        clear(*sp);
+        JUMP_IF(taken);
+    CASE(JUMP_IF_FALSE_KEEP)
+        JUMP_IF(!isTruthy(sp[-1]));
+    CASE(JUMP_IF_TRUE_KEEP)
+        JUMP_IF(isTruthy(sp[-1]));
+    CASE(CALL)
+        sp -= ip->b;
+        if (vm->call<false>(frame, entry, ip, sp, nullptr)) {
+            LOAD_FRAME();
+            DISPATCH();
+        }
+        NEXT();
+    CASE(TAIL_CALL)
+        sp -= ip->b;
+        if (vm->call<true>(frame, entry, ip, sp, nullptr)) {
+            LOAD_FRAME();
+            DISPATCH();
+        }
+        NEXT();
+    CASE(INVOKE)
+        sp -= ip->b;
+        if (vm->call<false>(frame, entry, ip, sp, &TOKEN(ip->a))) {
+            LOAD_FRAME();
+            DISPATCH();
+        }
+        NEXT();
+    CASE(FUNCTION)
+        defineFunction(frame->env, chunk->functions[ip->a]);
+        NEXT();
+    CASE(CLASS)
+        if (ip->b != 0)
+            --sp;
+        defineClass(*interpreter, frame->env, chunk->classes[ip->a],
+                    ip->b != 0 ? sp : nullptr);
+        NEXT();
+    CASE(IMPORT)
+        importModule(*interpreter, *sp++, *chunk->imports[ip->a]);
+        NEXT();
+    CASE(PUSH_SCOPE)
+        pushScope(frame->env);
+        env = frame->env.get();
+        NEXT();
+    CASE(POP_SCOPE)
+        popScope(frame->env);
+        env = frame->env.get();
+        NEXT();
+    CASE(RETURN)
+        if (vm->leave(entry, sp - 1, result))
+            return true;
+        LOAD_FRAME();
+        DISPATCH();
+    CASE(END)
+        // 入口帧执行到末尾时没有返回值，由调用者决定结果
+        if (frame == entry && frame->function == nullptr)
+            return false;
+        if (vm->leave(entry, nullptr, result))
+            return true;
+        LOAD_FRAME();
+        DISPATCH();
+    CASE(ADD_LOCALS)
+        *sp = LOCAL(ip->a);
+        add(*sp++, LOCAL(ip->b), TOKEN(ip->c));
+        NEXT();
+    CASE(ADD_K)
+        add(sp[-1], CONSTANT(ip->a), TOKEN(ip->c));
+        NEXT();
+#define LOX_VM_BINARY_K(name, op)                                              \
+    CASE(name)                                                                 \
+        binary<op>(sp[-1], CONSTANT(ip->a), TOKEN(ip->c));                     \
+        NEXT();
+    LOX_VM_BINARY_K(SUBTRACT_K, std::minus<double>)
+    LOX_VM_BINARY_K(MULTIPLY_K, std::multiplies<double>)
+    LOX_VM_BINARY_K(DIVIDE_K, std::divides<double>)
+    LOX_VM_BINARY_K(LESS_K, std::less<double>)
+    LOX_VM_BINARY_K(LESS_EQUAL_K, std::less_equal<double>)
+    LOX_VM_BINARY_K(GREATER_K, std::greater<double>)
+    LOX_VM_BINARY_K(GREATER_EQUAL_K, std::greater_equal<double>)
+#undef LOX_VM_BINARY_K
+#define LOX_VM_COMPARE_JUMP(name, op)                                          \
+    CASE(name)                                                                 \
+        sp -= 2;                                                               \
+        JUMP_IF(!compare<op>(sp[0], sp[1], TOKEN(ip->c)));
+    LOX_VM_COMPARE_JUMP(JUMP_UNLESS_LESS, std::less<double>)
+    LOX_VM_COMPARE_JUMP(JUMP_UNLESS_LESS_EQUAL, std::less_equal<double>)
+    LOX_VM_COMPARE_JUMP(JUMP_UNLESS_GREATER, std::greater<double>)
+    LOX_VM_COMPARE_JUMP(JUMP_UNLESS_GREATER_EQUAL, std::greater_equal<double>)
+#undef LOX_VM_COMPARE_JUMP
+    CASE(JUMP_UNLESS_EQUAL)
+        taken = !equal(*interpreter, sp[-2], sp[-1]);
+        sp -= 2;
+        clear(sp[0]);
+        clear(sp[1]);
+        JUMP_IF(taken);
+    CASE(JUMP_UNLESS_NOT_EQUAL)
+        taken = equal(*interpreter, sp[-2], sp[-1]);
+        sp -= 2;
+        clear(sp[0]);
+        clear(sp[1]);
+        JUMP_IF(taken);
+#define LOX_VM_COMPARE_JUMP_K(name, op)                                        \
+    CASE(name)                                                                 \
+        --sp;                                                                  \
+        JUMP_IF(!compare<op>(sp[0], CONSTANT(ip->b), TOKEN(ip->c)));
+    LOX_VM_COMPARE_JUMP_K(JUMP_UNLESS_LESS_K, std::less<double>)
+    LOX_VM_COMPARE_JUMP_K(JUMP_UNLESS_LESS_EQUAL_K, std::less_equal<double>)
+    LOX_VM_COMPARE_JUMP_K(JUMP_UNLESS_GREATER_K, std::greater<double>)
+    LOX_VM_COMPARE_JUMP_K(JUMP_UNLESS_GREATER_EQUAL_K,
+                          std::greater_equal<double>)
+#undef LOX_VM_COMPARE_JUMP_K
+    }
+    return false;
+
+#undef JUMP_IF
+#undef LOAD_FRAME
+#undef LOCAL
+#undef SCOPE
+#undef CONSTANT
+#undef TOKEN
+#undef NEXT
+#undef CASE
+#undef DISPATCH
+}
+
+} // namespace lox
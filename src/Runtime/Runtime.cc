@@ -0,0 +1,275 @@
+#include "Runtime/Runtime.h"
+#include "Runtime/StackProbe.h"
+
+#include <charconv>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <iterator>
+#include <vector>
+
+namespace lox::runtime {
+
+auto error(const std::string &message, int line) -> void {
+    throw RuntimeError(message, line);
+}
+
+auto numberOperandError(int line) -> void {
+    error("Operand must be a number.", line);
+}
+
+Value::Value(FunctionRef function)
+    : m_type(Type::Function), m_object(std::move(function)) {}
+
+Value::Value(ClassRef klass) : m_type(Type::Class), m_object(std::move(klass)) {}
+
+Value::Value(InstanceRef instance)
+    : m_type(Type::Instance), m_object(std::move(instance)) {}
+
+auto Value::string(std::string text) -> Value {
+    Value value;
+    value.m_type = Type::String;
+    value.m_object = std::make_shared<String>(std::move(text));
+    return value;
+}
+
+auto Value::asString() const -> const std::string & {
+    return static_cast<String *>(m_object.get())->getText();
+}
+
+auto Value::asFunction() const -> Function * {
+    return static_cast<Function *>(m_object.get());
+}
+
+auto Value::asClass() const -> ClassRef {
+    return std::static_pointer_cast<Class>(m_object);
+}
+
+auto Value::asInstance() const -> Instance * {
+    return static_cast<Instance *>(m_object.get());
+}
+
+// 与解释器的 Object::formatNumber 相同：不太大的整数按定点输出
+static auto formatNumber(double num) -> std::string {
+    if (std::isnan(num))
+        return "nan";
+    if (std::isinf(num))
+        return num < 0 ? "-inf" : "inf";
+    char buf[32];
+    auto format = (std::trunc(num) == num && std::fabs(num) < 1e21)
+                      ? std::chars_format::fixed
+                      : std::chars_format::general;
+    auto res = std::to_chars(buf, buf + sizeof(buf), num, format);
+    return std::string(buf, res.ptr);
+}
+
+auto Value::toString() const -> std::string {
+    switch (m_type) {
+    case Type::Nil:
+        return "nil";
+    case Type::Bool:
+        return m_bool ? "true" : "false";
+    case Type::Number:
+        return formatNumber(m_number);
+    case Type::String:
+        return asString();
+    case Type::Function:
+        return "<fn " + asFunction()->getName() + ">";
+    case Type::Class:
+        return asClass()->getName();
+    case Type::Instance:
+        return asInstance()->getClass()->getName() + " instance";
+    }
+    return "nil";
+}
+
+auto Function::bind(const Value &instance) const -> FunctionRef {
+    return std::make_shared<Function>(m_name, m_arity, m_initializer, m_code,
+                                      instance);
+}
+
+auto Class::findMethod(const std::string &name) const -> Function * {
+    for (auto *klass = this; klass != nullptr;
+         klass = klass->m_superclass.get()) {
+        auto iter = klass->m_methods.find(name);
+        if (iter != klass->m_methods.end())
+            return iter->second.get();
+    }
+    return nullptr;
+}
+
+auto Class::arity() const -> int {
+    auto *init = findMethod("init");
+    return init != nullptr ? init->arity() : 0;
+}
+
+auto Instance::get(const Value &self, const std::string &name, int line) const
+    -> Value {
+    auto iter = m_fields.find(name);
+    if (iter != m_fields.end())
+        return iter->second;
+    if (auto *method = m_class->findMethod(name))
+        return Value(method->bind(self));
+    error("Undefined property '" + name + "'.", line);
+}
+
+auto Global::undefined(int line) const -> void {
+    error("Undefined variable '" + std::string(m_name) + "'.", line);
+}
+
+auto makeClass(std::string name, const Value &superclass, int line)
+    -> ClassRef {
+    ClassRef super;
+    if (superclass.getType() != Value::Type::Nil) {
+        if (superclass.getType() != Value::Type::Class)
+            error("Superclass must be a class.", line);
+        super = superclass.asClass();
+    }
+    return std::make_shared<Class>(std::move(name), std::move(super));
+}
+
+auto equal(const Value &left, const Value &right) -> bool {
+    if (left.getType() != right.getType())
+        return false;
+    switch (left.getType()) {
+    case Value::Type::Nil:
+        return true;
+    case Value::Type::Bool:
+        return left.asBool() == right.asBool();
+    case Value::Type::Number:
+        return left.asNumber() == right.asNumber();
+    case Value::Type::String:
+        return left.asString() == right.asString();
+    default:
+        return left.getObject() == right.getObject();
+    }
+}
+
+auto addSlow(const Operands &operands, int line) -> Value {
+    if (operands[0].getType() == Value::Type::String &&
+        operands[1].getType() == Value::Type::String)
+        return Value::string(operands[0].asString() + operands[1].asString());
+    error("Operands must be two numbers or two strings.", line);
+}
+
+static std::size_t maxCallDepth = kDefaultMaxCallDepth;
+static thread_local std::size_t callDepth = 0;
+
+auto getMaxCallDepth() -> std::size_t { return maxCallDepth; }
+
+auto setMaxCallDepth(std::size_t depth) -> void { maxCallDepth = depth; }
+
+// 一层 Lox 调用。嵌套超过最大深度，或者原生栈快要用完时报告
+// "Stack overflow."，而不是让进程崩溃（见 Interpreter::enterCall）
+class CallScope {
+  public:
+    explicit CallScope(int line) {
+        if (callDepth >= maxCallDepth || stackExhausted())
+            error("Stack overflow.", line);
+        callDepth++;
+    }
+    ~CallScope() { callDepth--; }
+    CallScope(const CallScope &) = delete;
+    auto operator=(const CallScope &) -> CallScope & = delete;
+};
+
+// 检查 callee 可以用 argc 个参数调用
+static auto checkCallable(const Value &callee, std::size_t argc, int line)
+    -> void {
+    int arity;
+    if (callee.getType() == Value::Type::Function) {
+        arity = callee.asFunction()->arity();
+    } else if (callee.getType() == Value::Type::Class) {
+        arity = callee.asClass()->arity();
+    } else {
+        error("Can only call functions and classes.", line);
+    }
+    if (argc != static_cast<std::size_t>(arity)) {
+        error("Expected " + std::to_string(arity) + " arguments but got " +
+                  std::to_string(argc) + ".",
+              line);
+    }
+}
+
+// 记下的尾调用，没有时为空
+static thread_local FunctionRef tailFunction;
+static thread_local std::vector<Value> tailArguments;
+
+// 函数体以尾调用结束时，在这里循环执行被调用的函数，原生栈不再加深
+static auto run(const Function &function, Value *args) -> Value {
+    auto result = function.call(args);
+    while (tailFunction != nullptr) {
+        auto next = std::move(tailFunction);
+        auto arguments = std::move(tailArguments);
+        tailFunction = nullptr;
+        tailArguments.clear();
+        result = next->call(arguments.data());
+    }
+    return result;
+}
+
+auto callValue(const Value &callee, Value *args, std::size_t argc, int line)
+    -> Value {
+    checkCallable(callee, argc, line);
+    CallScope scope(line);
+    if (callee.getType() == Value::Type::Function)
+        return run(*callee.asFunction(), args);
+
+    auto klass = callee.asClass();
+    Value instance(std::make_shared<Instance>(klass));
+    if (auto *init = klass->findMethod("init"))
+        run(*init->bind(instance), args);
+    return instance;
+}
+
+auto tailCallValue(const Value &callee, Value *args, std::size_t argc,
+                   int line) -> Value {
+    checkCallable(callee, argc, line);
+    if (callee.getType() != Value::Type::Function)
+        return callValue(callee, args, argc, line);
+    tailFunction = std::static_pointer_cast<Function>(callee.getObject());
+    tailArguments.assign(std::make_move_iterator(args),
+                         std::make_move_iterator(args + argc));
+    return Value();
+}
+
+auto getProperty(const Value &object, const std::string &name, int line)
+    -> Value {
+    if (object.getType() != Value::Type::Instance)
+        error("Only instances have properties.", line);
+    return object.asInstance()->get(object, name, line);
+}
+
+auto requireInstance(const Value &object, int line) -> Instance & {
+    if (object.getType() != Value::Type::Instance)
+        error("Only instances have fields.", line);
+    return *object.asInstance();
+}
+
+auto superMethod(const Value &superclass, const Value &self,
+                 const std::string &name, int line) -> Value {
+    auto *method = superclass.asClass()->findMethod(name);
+    if (method == nullptr)
+        error("Undefined property '" + name + "'.", line);
+    return Value(method->bind(self));
+}
+
+auto print(const Value &value) -> void {
+    auto text = value.toString();
+    text.push_back('\n');
+    std::fwrite(text.data(), 1, text.size(), stdout);
+}
+
+auto runProgram(void (*program)()) -> int {
+    try {
+        program();
+    } catch (const RuntimeError &e) {
+        std::fflush(stdout);
+        std::fprintf(stderr, "%s\n[line %d]\n", e.what(), e.getLine());
+        return 70;
+    }
+    std::fflush(stdout);
+    return 0;
+}
+
+} // namespace lox::runtime
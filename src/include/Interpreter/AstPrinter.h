@@ -5,26 +5,22 @@
 #include <string>
 namespace lox {
 
-class AstPrinter : public Visitor<std::string>,
-                   public std::enable_shared_from_this<AstPrinter> {
+class AstPrinter
+    : public ExprVisitor<AstPrinter, std::string, std::string> {
   public:
     std::string print(const AbstractExpressionRef<std::string> &expr);
-    std::string visitLiteralExpr(LiteralExpressionRef<std::string> expr);
-    std::string visitBinaryExpr(BinaryExpressionRef<std::string> expr);
-    std::string visitUnaryExpr(UnaryExpressionRef<std::string> expr);
-    std::string visitGroupingExpr(GroupingExpressionRef<std::string> expr);
-    std::string visitVariableExpr(VariableExpressionRef<std::string> expr);
-    std::string visitAssignmentExpr(AssignmentExpressionRef<std::string> expr);
-    std::string visitLogicalExpr(LogicalExpressionRef<std::string> expr);
-    std::string visitCallExpr(CallExpressionRef<std::string> expr);
-    std::string visitGetExpr(GetExpressionRef<std::string> expr) { return ""; }
-    std::string visitSetExpr(SetExpressionRef<std::string> expr) { return ""; }
-    std::string visitThisExpr(ThisExpressionRef<std::string> expr) {
-        return "";
-    }
-    std::string visitSuperExpr(SuperExpressionRef<std::string> expr) {
-        return "";
-    }
+    std::string visitLiteralExpr(LiteralExpression<std::string> &expr);
+    std::string visitBinaryExpr(BinaryExpression<std::string> &expr);
+    std::string visitUnaryExpr(UnaryExpression<std::string> &expr);
+    std::string visitGroupingExpr(GroupingExpression<std::string> &expr);
+    std::string visitVariableExpr(VariableExpression<std::string> &expr);
+    std::string visitAssignmentExpr(AssignmentExpression<std::string> &expr);
+    std::string visitLogicalExpr(LogicalExpression<std::string> &expr);
+    std::string visitCallExpr(CallExpression<std::string> &expr);
+    std::string visitGetExpr(GetExpression<std::string> &) { return ""; }
+    std::string visitSetExpr(SetExpression<std::string> &) { return ""; }
+    std::string visitThisExpr(ThisExpression<std::string> &) { return ""; }
+    std::string visitSuperExpr(SuperExpression<std::string> &) { return ""; }
 };
 
 } // namespace lox
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "Isolate.h"
+#include "Program.h"
+#include "Snapshot.h"
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace lox {
+
+// 一个待执行的脚本，来自文件、内存中的源码或已经编译好的程序
+struct BatchJob {
+    std::string name;
+    std::string source;
+    bool isFile = false;
+    ProgramRef program; // 不为空时直接执行，多个任务可以共享同一个程序
+
+    static auto fromFile(std::string path) -> BatchJob;
+    static auto fromSource(std::string name, std::string source) -> BatchJob;
+    static auto fromProgram(std::string name, ProgramRef program) -> BatchJob;
+};
+
+struct BatchResult {
+    std::string name;
+    Isolate::Status status = Isolate::Status::OK;
+    int exitCode = 0; // 与 lox_shell 运行单个脚本的退出码一致
+    std::string output;
+    std::string errors;
+};
+
+// 在固定大小的工作窃取线程池上并行执行一批脚本，
+// 每个脚本都在自己独立的 Isolate 中运行，结果按输入顺序返回。
+class BatchRunner {
+  public:
+    // workers 为 0 时使用硬件线程数；
+    // prelude 不为空时每个脚本都在它的一个 fork 上运行
+    explicit BatchRunner(std::size_t workers = 0, SnapshotRef prelude = nullptr)
+        : m_workers(workers), m_prelude(std::move(prelude)) {}
+
+    auto run(const std::vector<BatchJob> &jobs) -> std::vector<BatchResult>;
+
+    static auto runOne(const BatchJob &job, const SnapshotRef &prelude = nullptr)
+        -> BatchResult;
+
+  private:
+    std::size_t m_workers;
+    SnapshotRef m_prelude;
+};
+
+} // namespace lox
@@ -0,0 +1,149 @@
+#pragma once
+
+#include "FunctionCode.h"
+#include "Object.h"
+#include "Statements.h"
+#include "Token.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace lox {
+
+// 字节码指令。操作数 a、b、c 的含义见各条指令的注释，
+// “跳转目标”是指令下标，tok 是 Chunk::tokens 的下标，用于报错和全局变量
+#define LOX_OPCODES(X)                                                         \
+    X(CONSTANT)           /* a=常量 */                                         \
+    X(NIL)                                                                     \
+    X(TRUE)                                                                    \
+    X(FALSE)                                                                   \
+    X(POP)                                                                     \
+    X(GET_LOCAL)          /* a=局部变量 */                                     \
+    X(SET_LOCAL)          /* a=局部变量，值留在栈上 */                         \
+    X(GET_GLOBAL)         /* a=tok */                                          \
+    X(SET_GLOBAL)         /* a=tok，值留在栈上 */                              \
+    X(DEFINE)             /* a=名字，在当前环境中定义并弹出 */                 \
+    X(GET_PROPERTY)       /* a=tok */                                          \
+    X(CHECK_FIELDS)       /* a=tok，栈顶必须是实例 */                          \
+    X(SET_PROPERTY)       /* a=tok，[对象 值] -> [值] */                       \
+    X(GET_SUPER)          /* a=super 变量 b=this 变量 c=tok */                 \
+    X(ADD)                /* c=tok */                                          \
+    X(SUBTRACT)                                                                \
+    X(MULTIPLY)                                                                \
+    X(DIVIDE)                                                                  \
+    X(LESS)                                                                    \
+    X(LESS_EQUAL)                                                              \
+    X(GREATER)                                                                 \
+    X(GREATER_EQUAL)                                                           \
+    X(EQUAL)                                                                   \
+    X(NOT_EQUAL)                                                               \
+    X(NEGATE)             /* c=tok */                                          \
+    X(NOT)                                                                     \
+    X(PRINT)                                                                   \
+    X(JUMP)               /* a=跳转目标 */                                     \
+    X(JUMP_IF_FALSE)      /* a=跳转目标，弹出条件 */                           \
+    X(JUMP_IF_FALSE_KEEP) /* a=跳转目标，保留条件（and/or） */                 \
+    X(JUMP_IF_TRUE_KEEP)                                                       \
+    X(CALL)               /* b=参数个数 c=tok */                               \
+    X(TAIL_CALL)          /* 同 CALL，尾位置上的调用（见 Interpreter::tailCall） */ \
+    X(INVOKE)             /* a=方法名 tok b=参数个数 c=tok：取属性并调用 */    \
+    X(FUNCTION)           /* a=函数，在当前环境中定义 */                       \
+    X(CLASS)              /* a=类 b=栈上是否有父类 */                          \
+    X(IMPORT)             /* a=导入语句，压入模块对象 */                       \
+    X(PUSH_SCOPE)                                                              \
+    X(POP_SCOPE)                                                               \
+    X(RETURN)                                                                  \
+    X(END)                                                                     \
+    /* 以下是窥孔优化合成的超级指令 */                                         \
+    X(ADD_LOCALS)         /* a、b=局部变量 c=tok */                            \
+    X(ADD_K)              /* a=常量 c=tok：栈顶与常量运算 */                   \
+    X(SUBTRACT_K)                                                              \
+    X(MULTIPLY_K)                                                              \
+    X(DIVIDE_K)                                                                \
+    X(LESS_K)                                                                  \
+    X(LESS_EQUAL_K)                                                            \
+    X(GREATER_K)                                                               \
+    X(GREATER_EQUAL_K)                                                         \
+    X(JUMP_UNLESS_LESS)   /* a=跳转目标 c=tok：比较结果为假时跳转 */           \
+    X(JUMP_UNLESS_LESS_EQUAL)                                                  \
+    X(JUMP_UNLESS_GREATER)                                                     \
+    X(JUMP_UNLESS_GREATER_EQUAL)                                               \
+    X(JUMP_UNLESS_EQUAL)                                                       \
+    X(JUMP_UNLESS_NOT_EQUAL)                                                   \
+    X(JUMP_UNLESS_LESS_K) /* a=跳转目标 b=常量 c=tok */                        \
+    X(JUMP_UNLESS_LESS_EQUAL_K)                                                \
+    X(JUMP_UNLESS_GREATER_K)                                                   \
+    X(JUMP_UNLESS_GREATER_EQUAL_K)
+
+enum class OpCode : std::uint8_t {
+#define LOX_OPCODE_ENUM(name) name,
+    LOX_OPCODES(LOX_OPCODE_ENUM)
+#undef LOX_OPCODE_ENUM
+};
+
+auto opcodeName(OpCode op) -> const char *;
+
+struct Instruction {
+    // 直接线索化分派时这条指令处理代码的地址，由编译器填好
+    const void *target = nullptr;
+    OpCode op;
+    std::int32_t a = 0;
+    std::int32_t b = 0;
+    std::int32_t c = 0;
+};
+
+// 局部变量：Resolver 算出的作用域距离和名字
+struct LocalSlot {
+    int depth;
+    std::string name;
+};
+
+class Chunk;
+using ChunkRef = std::shared_ptr<const Chunk>;
+
+// 一段编译好的字节码（整个程序或一个函数体）以及它引用的常量和符号
+class Chunk : public FunctionCode {
+  public:
+    struct Function {
+        FunStmtRef declaration;
+        FunctionCodeRef code; // Chunk，或者延迟解析时的 LazyFunctionCode
+    };
+    struct Class {
+        SourceToken name;
+        SourceToken superName;
+        std::vector<std::pair<FunStmtRef, FunctionCodeRef>> methods;
+    };
+
+    auto run(Interpreter &interpreter, EnvironmentRef env, Object &result) const
+        -> bool override;
+
+    // 反汇编，包括其中定义的函数和方法，用于调试和测试
+    auto disassemble() const -> std::string;
+
+    std::vector<Instruction> code;
+    std::vector<Object> constants;
+    std::vector<SourceToken> tokens;
+    std::vector<LocalSlot> locals;
+    std::vector<std::string> names;
+    std::vector<Function> functions;
+    std::vector<Class> classes;
+    std::vector<ImportStmtRef> imports;
+    int maxStack = 0; // 执行时操作数栈的最大深度
+};
+
+// 把作用域解析之后的 AST 降低成字节码。
+// superinstructions 为 true 时，降低时为参数没有副作用的方法调用选择 INVOKE，
+// 之后再用窥孔优化把常见的指令序列合并成超级指令
+class BytecodeCompiler {
+  public:
+    static auto compile(const std::vector<StmtRef> &statements,
+                        bool superinstructions = true) -> ChunkRef;
+
+    // 窥孔优化：在不跨越跳转目标的前提下合并相邻指令，并重新计算跳转目标
+    static auto optimize(std::vector<Instruction> &code) -> void;
+};
+
+} // namespace lox
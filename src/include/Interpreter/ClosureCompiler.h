@@ -0,0 +1,24 @@
+#pragma once
+
+#include "FunctionCode.h"
+#include "Statements.h"
+#include <vector>
+
+namespace lox {
+
+// 闭包编译：把作用域解析之后的 AST 遍历一遍，生成一棵由普通函数指针驱动的
+// 节点树。每个节点在编译时就确定了要调用的求值函数，运算符的类型分支
+// 提前到编译期选好，子节点、变量的作用域距离和名字都直接存在节点里。
+// 执行时每个节点只有一次间接调用，不用把每一步压进任务栈再取出来
+// （见 Interpreter::execute）。
+//
+// 运行时的对象模型（Environment、LoxFunction、LoxClass、LoxInstance）
+// 与解释器共用，两种执行方式产生的函数和实例可以互相调用，
+// 快照、fork 和 JIT 也照常工作。
+class ClosureCompiler {
+  public:
+    static auto compile(const std::vector<StmtRef> &statements)
+        -> FunctionCodeRef;
+};
+
+} // namespace lox
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "ErrorReporter.h"
+#include "Scanner.h"
+#include "Statements.h"
+#include "Token.h"
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace lox {
+
+// 编辑器里打开的一个源文件，给语言服务器用。
+// 源码按顶层声明分段，每段保存自己的 token、语法树和诊断信息。
+// 每次编辑只从编辑位置的前一段开始重新扫描，直到扫描器重新落在一个
+// 没有变化的段的开头；再从同一处重新解析，直到某个顶层声明恰好在一个
+// 保留下来的段的开头结束；只有新解析出来的顶层声明重新解析变量。
+// 其余段的语法树原样复用，位置整体平移。
+// 结果与从头扫描、解析编辑之后的源码相同，只是诊断信息按段排列：
+// 每段依次是扫描、语法和变量解析的错误。
+// 每条没有语法错误的顶层声明单独解析变量，所以别处有语法错误时
+// 它的变量解析错误也会报告（Program::compile 这时不解析变量）
+class Document {
+  public:
+    explicit Document(std::string source, std::string fileName = "");
+
+    // 把源码中 [offset, offset + length) 替换成 text。
+    // offset 和 length 是字节位置，超出源码的部分截掉
+    auto edit(std::size_t offset, std::size_t length, const std::string &text)
+        -> void;
+
+    auto getSource() const -> const std::string & { return m_source; }
+    auto getDiagnostics() const -> std::vector<Diagnostic>;
+    // 每条顶层声明的语法树，有语法错误的是 nullptr
+    auto getStatements() -> std::vector<StmtRef>;
+    // 全部 token，最后是 EOF_TOKEN
+    auto getTokens() -> std::vector<TokenRef>;
+    // 上一次编辑（或者构造）重新扫描的字节数和重新解析的顶层声明数
+    auto getRescannedBytes() const -> std::size_t { return m_rescanned; }
+    auto getReparsed() const -> std::size_t { return m_reparsed; }
+
+  private:
+    // 一条顶层声明。最后一段只有 EOF_TOKEN，没有语法树
+    struct Segment {
+        int begin;                      // 第一个 token 在源码中的位置
+        int line;                       // 第一个 token 开始的行
+        int shift = 0;                  // 行号还要加上多少
+        std::vector<TokenRef> tokens;   // 包括跨段出错时同步跳过的 token
+        std::vector<int> offsets;       // 每个 token 相对 begin 的位置
+        std::vector<Scanner::ChunkError> scanErrors; // offset 相对 begin
+        std::vector<Diagnostic> diagnostics;         // 语法和变量解析
+        StmtRef stmt;
+    };
+
+    // 重新扫描和解析从第 first 段开始的部分，替换掉旧的段。
+    // 第 kept 段之前的段已经失效；之后的段开头在 minStop 之前的，
+    // 即使开头没有变化也要重新扫描
+    auto update(std::size_t first, std::size_t kept, int minStop) -> void;
+    // 把挂起的行号平移作用到段的 token、语法树和诊断信息上
+    static auto settle(Segment &segment) -> void;
+
+    std::string m_source;
+    std::string m_fileName;
+    std::vector<Segment> m_segments;
+    std::size_t m_rescanned = 0;
+    std::size_t m_reparsed = 0;
+};
+
+} // namespace lox
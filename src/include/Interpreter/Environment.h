@@ -2,6 +2,7 @@
 
 #include "Object.h"
 #include "Token.h"
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <unordered_map>
@@ -15,21 +16,46 @@ class Environment : public std::enable_shared_from_this<Environment> {
     Environment();
     Environment(EnvironmentRef enclosing);
 
-    auto getEnclosing() -> EnvironmentRef { return m_enclosing; }
+    auto getEnclosing() -> const EnvironmentRef & { return m_enclosing; }
 
-    auto define(std::string name, ObjectRef value) -> void;
+    auto define(const std::string &name, ObjectRef value) -> void;
 
-    auto get(TokenRef name) -> ObjectRef;
-    auto getAt(int distance, std::string name) -> ObjectRef;
+    auto get(const SourceToken &name) -> ObjectRef;
+    // 沿外层环境查找，不存在时返回 nullptr 而不是抛出异常
+    auto find(const std::string &name) -> ObjectRef;
+    auto getAt(int distance, const std::string &name) -> ObjectRef;
+    // 只在这一层查找，不存在时返回 nullptr；不增加引用计数
+    auto findLocal(const std::string &name) const -> const ObjectRef * {
+        auto iter = m_values.find(name);
+        return iter != m_values.end() ? &iter->second : nullptr;
+    }
 
-    auto assign(TokenRef name, ObjectRef value) -> void;
-    auto assignAt(int distance, TokenRef name, ObjectRef value) -> void;
+    auto assign(const SourceToken &name, ObjectRef value) -> void;
+    auto assignAt(int distance, const SourceToken &name, ObjectRef value)
+        -> void;
 
     auto ancestor(int distance) -> EnvironmentRef;
 
+    auto getValues() -> const std::unordered_map<std::string, ObjectRef> & {
+        return m_values;
+    }
+    // 断开这个环境持有的所有引用，用于销毁时打破闭包形成的环
+    auto clear() -> void;
+
+    // 冻结的环境属于快照，被多个解释器共享只读，
+    // 解释器对它的修改写在自己的副本上（见 Interpreter::localCopy）
+    auto freeze() -> void { m_frozen = true; }
+    auto isFrozen() const -> bool { return m_frozen; }
+    // 每次写入变量都会增加，JIT 用它判断缓存的全局查找结果是否还有效
+    auto getVersion() const -> std::uint64_t { return m_version; }
+    // 复制出一个未冻结的、外层环境相同的副本
+    auto copy() -> EnvironmentRef;
+
   private:
     std::unordered_map<std::string, ObjectRef> m_values;
     EnvironmentRef m_enclosing;
+    bool m_frozen = false;
+    std::uint64_t m_version = 0;
 };
 
 } // namespace lox
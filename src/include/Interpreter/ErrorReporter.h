@@ -0,0 +1,67 @@
+#pragma once
+
+#include "RuntimeError.h"
+#include "Token.h"
+#include <cstddef>
+#include <iostream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace lox {
+
+// 一条编译期诊断信息。file 是 ErrorReporter::setFileName 设置的文件名，
+// column 从 1 开始，0 表示不知道；message 不含位置
+struct Diagnostic {
+    std::string file;
+    int line;
+    int column;
+    std::string message;
+};
+
+// 收集一次运行中的编译期和运行期错误。
+// 每个 Isolate 持有自己的 ErrorReporter，不同线程之间互不影响。
+class ErrorReporter {
+  public:
+    explicit ErrorReporter(std::ostream &err = std::cerr) : m_err(&err) {}
+
+    auto report(int line, int column, const std::string &where,
+                const std::string &message) -> void;
+    auto error(int line, const std::string &message, int column = 0) -> void;
+    auto error(const SourceToken &token, const std::string &message) -> void;
+    auto runtimeError(RuntimeError &error) -> void;
+    // 编译期的诊断信息前面加上文件名，为空时不加
+    auto setFileName(std::string name) -> void { m_fileName = std::move(name); }
+    // 转发另一个 ErrorReporter 写到 text 里的诊断信息，并合并它的错误状态
+    auto forward(const std::string &text, const ErrorReporter &from) -> void;
+    // 每次编译（reset 之后）最多记录多少条诊断信息，0 表示不限制。
+    // 超过之后的诊断信息既不输出也不记录，Parser 随即停止解析。
+    // Program::compileFiles 对每个文件分别计数
+    auto setMaxErrors(std::size_t max) -> void { m_maxErrors = max; }
+    auto getMaxErrors() const -> std::size_t { return m_maxErrors; }
+    auto reachedMaxErrors() const -> bool {
+        return m_maxErrors != 0 && m_diagnostics.size() >= m_maxErrors;
+    }
+    // reset 之后记录的编译期诊断信息，按报告的顺序排列
+    auto getDiagnostics() const -> const std::vector<Diagnostic> & {
+        return m_diagnostics;
+    }
+
+    auto hadError() const -> bool { return m_hadError; }
+    auto hadRuntimeError() const -> bool { return m_hadRuntimeError; }
+    auto reset() -> void {
+        m_hadError = false;
+        m_hadRuntimeError = false;
+        m_diagnostics.clear();
+    }
+
+  private:
+    std::ostream *m_err;
+    std::string m_fileName;
+    std::vector<Diagnostic> m_diagnostics;
+    std::size_t m_maxErrors = 0;
+    bool m_hadError = false;
+    bool m_hadRuntimeError = false;
+};
+
+} // namespace lox
@@ -1,7 +1,10 @@
 #pragma once
 
 #include "Token.h"
+#include <cstdint>
 #include <memory>
+#include <stdexcept>
+#include <utility>
 #include <vector>
 namespace lox {
 
@@ -42,252 +45,365 @@ template <class R> using GetExpressionRef = std::shared_ptr<GetExpression<R>>;
 template <class R> using SetExpressionRef = std::shared_ptr<SetExpression<R>>;
 template <class R> using ThisExpressionRef = std::shared_ptr<ThisExpression<R>>;
 
-// 抽象访问者
-template <class R> class Visitor {
-  public:
-    virtual ~Visitor() = default;
-    // 对一些具体的表达式进行一些操作
-    virtual R visitBinaryExpr(BinaryExpressionRef<R> expr) = 0;
-    virtual R visitUnaryExpr(UnaryExpressionRef<R> expr) = 0;
-    virtual R visitLiteralExpr(LiteralExpressionRef<R> expr) = 0;
-    virtual R visitGroupingExpr(GroupingExpressionRef<R> expr) = 0;
-    virtual R visitVariableExpr(VariableExpressionRef<R> expr) = 0;
-    virtual R visitAssignmentExpr(AssignmentExpressionRef<R> expr) = 0;
-    virtual R visitLogicalExpr(LogicalExpressionRef<R> expr) = 0;
-    virtual R visitCallExpr(CallExpressionRef<R> expr) = 0;
-    virtual R visitGetExpr(GetExpressionRef<R> expr) = 0;
-    virtual R visitSetExpr(SetExpressionRef<R> expr) = 0;
-    virtual R visitThisExpr(ThisExpressionRef<R> expr) = 0;
-    virtual R visitSuperExpr(SuperExpressionRef<R> expr) = 0;
+// 表达式节点的种类。各个 pass 按种类静态分派（见 ExprVisitor），不经过虚函数
+enum class ExprKind : std::uint8_t {
+    Binary,
+    Unary,
+    Literal,
+    Grouping,
+    Variable,
+    Assignment,
+    Logical,
+    Call,
+    Get,
+    Set,
+    This,
+    Super,
 };
 
-template <class R> using VisitorRef = std::shared_ptr<Visitor<R>>;
-
 // 表达式基类
 template <class R> class AbstractExpression {
   public:
-    virtual R accept(VisitorRef<R> visitor) = 0;
     virtual ~AbstractExpression() = default;
+
+    auto kind() const -> ExprKind { return m_kind; }
+
+    // Resolver 算出的局部变量作用域距离，-1 表示全局变量。
+    // 只在编译期写入一次，之后 AST 可以被多个解释器同时只读使用
+    auto getDepth() const -> int { return m_depth; }
+    auto setDepth(int depth) -> void { m_depth = depth; }
+
+  protected:
+    explicit AbstractExpression(ExprKind kind) : m_kind(kind) {}
+
+    // 交出左结合的链上的下一个节点（见 leftOperand），没有时返回空
+    virtual auto releaseLeft() -> AbstractExpressionRef<R> { return nullptr; }
+
+    // 沿左链逐个释放只被这里引用的节点。很长的 a + b + … 递归地析构
+    // 会耗尽原生栈
+    static auto releaseChain(AbstractExpressionRef<R> left) -> void {
+        while (left != nullptr && left.use_count() == 1)
+            left = left->releaseLeft();
+    }
+
+  private:
+    ExprKind m_kind;
+    int m_depth = -1;
 };
 
 template <class R>
-class BinaryExpression
-    : public AbstractExpression<R>,
-      public std::enable_shared_from_this<BinaryExpression<R>> {
+class BinaryExpression : public AbstractExpression<R> {
   public:
     explicit BinaryExpression(AbstractExpressionRef<R> left,
-                              AbstractExpressionRef<R> right, TokenRef opt)
-        : m_left(left), m_right(right), m_opt(opt) {};
-    auto accept(VisitorRef<R> visitor) -> R override;
+                              AbstractExpressionRef<R> right, SourceToken opt)
+        : AbstractExpression<R>(ExprKind::Binary), m_left(left),
+          m_right(right), m_opt(opt) {};
+
+    auto getOperation() const -> const auto & { return m_opt; }
+    auto getLeftExpr() const -> const auto & { return m_left; }
+    auto getRightExpr() const -> const auto & { return m_right; }
+
+    ~BinaryExpression() override { this->releaseChain(std::move(m_left)); }
 
-    auto getOperation() { return m_opt; }
-    auto getLeftExpr() { return m_left; }
-    auto getRightExpr() { return m_right; }
+  protected:
+    auto releaseLeft() -> AbstractExpressionRef<R> override {
+        return std::move(m_left);
+    }
 
   private:
     AbstractExpressionRef<R> m_left;
     AbstractExpressionRef<R> m_right;
-    TokenRef m_opt;
+    SourceToken m_opt;
 };
 
 template <class R>
-class UnaryExpression
-    : public AbstractExpression<R>,
-      public std::enable_shared_from_this<UnaryExpression<R>> {
+class UnaryExpression : public AbstractExpression<R> {
   public:
-    explicit UnaryExpression(AbstractExpressionRef<R> right, TokenRef opt)
-        : m_right(right), m_opt(opt) {};
+    explicit UnaryExpression(AbstractExpressionRef<R> right, SourceToken opt)
+        : AbstractExpression<R>(ExprKind::Unary), m_right(right),
+          m_opt(opt) {};
 
-    auto accept(VisitorRef<R>) -> R override;
-
-    auto getOperation() { return m_opt; }
-    auto getRightExpr() { return m_right; }
+    auto getOperation() const -> const auto & { return m_opt; }
+    auto getRightExpr() const -> const auto & { return m_right; }
 
   private:
     AbstractExpressionRef<R> m_right;
-    TokenRef m_opt;
+    SourceToken m_opt;
 };
 
 template <class R>
-class LiteralExpression
-    : public AbstractExpression<R>,
-      public std::enable_shared_from_this<LiteralExpression<R>> {
+class LiteralExpression : public AbstractExpression<R> {
   public:
-    explicit LiteralExpression(R literal) : m_literal(literal) {};
-
-    auto accept(VisitorRef<R>) -> R override;
+    explicit LiteralExpression(R literal)
+        : AbstractExpression<R>(ExprKind::Literal), m_literal(literal) {};
 
-    R getValue() { return m_literal; }
+    auto getValue() const -> const R & { return m_literal; }
 
   private:
     R m_literal;
 };
 
 template <class R>
-class GroupingExpression
-    : public AbstractExpression<R>,
-      public std::enable_shared_from_this<GroupingExpression<R>> {
+class GroupingExpression : public AbstractExpression<R> {
   public:
     explicit GroupingExpression(AbstractExpressionRef<R> expr)
-        : m_expr(expr) {};
-
-    auto accept(VisitorRef<R>) -> R override;
+        : AbstractExpression<R>(ExprKind::Grouping), m_expr(expr) {};
 
-    auto getExpr() { return m_expr; }
+    auto getExpr() const -> const auto & { return m_expr; }
 
   private:
     AbstractExpressionRef<R> m_expr;
 };
 
 template <class R>
-class VariableExpression
-    : public AbstractExpression<R>,
-      public std::enable_shared_from_this<VariableExpression<R>> {
+class VariableExpression : public AbstractExpression<R> {
   public:
-    explicit VariableExpression(TokenRef name) : m_name(name) {}
+    explicit VariableExpression(SourceToken name)
+        : AbstractExpression<R>(ExprKind::Variable), m_name(name) {}
 
-    auto accept(VisitorRef<R>) -> R override;
-
-    auto getName() -> TokenRef { return m_name; }
+    auto getName() const -> const auto & { return m_name; }
 
   private:
-    TokenRef m_name;
+    SourceToken m_name;
 };
 
 template <class R>
-class AssignmentExpression
-    : public AbstractExpression<R>,
-      public std::enable_shared_from_this<AssignmentExpression<R>> {
+class AssignmentExpression : public AbstractExpression<R> {
   public:
-    explicit AssignmentExpression(TokenRef name, AbstractExpressionRef<R> value)
-        : m_name(name), m_values(value) {};
-
-    auto accept(VisitorRef<R>) -> R override;
+    explicit AssignmentExpression(SourceToken name,
+                                  AbstractExpressionRef<R> value)
+        : AbstractExpression<R>(ExprKind::Assignment), m_name(name),
+          m_values(value) {};
 
-    auto getValue() -> AbstractExpressionRef<R> { return m_values; }
-    auto getName() -> TokenRef { return m_name; }
+    auto getValue() const -> const auto & { return m_values; }
+    auto getName() const -> const auto & { return m_name; }
 
   private:
-    TokenRef m_name;
+    SourceToken m_name;
     AbstractExpressionRef<R> m_values;
 };
 
 template <class R>
-class LogicalExpression
-    : public AbstractExpression<R>,
-      public std::enable_shared_from_this<LogicalExpression<R>> {
+class LogicalExpression : public AbstractExpression<R> {
   public:
     explicit LogicalExpression(AbstractExpressionRef<R> left,
-                               AbstractExpressionRef<R> right, TokenRef opt)
-        : m_left(left), m_right(right), m_opt(opt) {};
-    auto accept(VisitorRef<R>) -> R override;
+                               AbstractExpressionRef<R> right, SourceToken opt)
+        : AbstractExpression<R>(ExprKind::Logical), m_left(left),
+          m_right(right), m_opt(opt) {};
+
+    auto getOperation() const -> const auto & { return m_opt; }
+    auto getLeftExpr() const -> const auto & { return m_left; }
+    auto getRightExpr() const -> const auto & { return m_right; }
+
+    ~LogicalExpression() override { this->releaseChain(std::move(m_left)); }
 
-    auto getOperation() { return m_opt; }
-    auto getLeftExpr() { return m_left; }
-    auto getRightExpr() { return m_right; }
+  protected:
+    auto releaseLeft() -> AbstractExpressionRef<R> override {
+        return std::move(m_left);
+    }
 
   private:
     AbstractExpressionRef<R> m_left;
     AbstractExpressionRef<R> m_right;
-    TokenRef m_opt;
+    SourceToken m_opt;
 };
 
 template <class R>
-class CallExpression : public AbstractExpression<R>,
-                       public std::enable_shared_from_this<CallExpression<R>> {
+class CallExpression : public AbstractExpression<R> {
   public:
-    explicit CallExpression(AbstractExpressionRef<R> callee, TokenRef paren,
+    explicit CallExpression(AbstractExpressionRef<R> callee, SourceToken paren,
                             std::vector<AbstractExpressionRef<R>> args)
-        : m_callee(callee), m_paren(paren), m_arguments(args) {};
+        : AbstractExpression<R>(ExprKind::Call), m_callee(callee),
+          m_paren(paren), m_arguments(args) {};
 
-    auto accept(VisitorRef<R>) -> R override;
+    auto getCallee() const -> const auto & { return m_callee; }
+    auto getParen() const -> const auto & { return m_paren; }
+    auto getArgs() const -> const auto & { return m_arguments; }
+    // 由 Resolver 标记：return 语句直接返回这次调用的结果
+    auto isTailCall() const -> bool { return m_tailCall; }
+    auto setTailCall(bool tailCall) -> void { m_tailCall = tailCall; }
 
-    auto getCallee() { return m_callee; }
-    auto getParen() { return m_paren; }
-    auto getArgs() { return m_arguments; }
+    ~CallExpression() override { this->releaseChain(std::move(m_callee)); }
+
+  protected:
+    auto releaseLeft() -> AbstractExpressionRef<R> override {
+        return std::move(m_callee);
+    }
 
   private:
     AbstractExpressionRef<R> m_callee;
-    TokenRef m_paren;
+    SourceToken m_paren;
     std::vector<AbstractExpressionRef<R>> m_arguments;
+    bool m_tailCall = false;
 };
 
 template <class R>
-class GetExpression : public AbstractExpression<R>,
-                      public std::enable_shared_from_this<GetExpression<R>> {
+class GetExpression : public AbstractExpression<R> {
   public:
-    explicit GetExpression(AbstractExpressionRef<R> object, TokenRef name)
-        : m_object(object), m_name(name) {};
+    explicit GetExpression(AbstractExpressionRef<R> object, SourceToken name)
+        : AbstractExpression<R>(ExprKind::Get), m_object(object),
+          m_name(name) {};
+
+    auto getObject() const -> const auto & { return m_object; }
+    auto getName() const -> const auto & { return m_name; }
 
-    auto accept(VisitorRef<R>) -> R override;
+    ~GetExpression() override { this->releaseChain(std::move(m_object)); }
 
-    auto getObject() { return m_object; }
-    auto getName() { return m_name; }
+  protected:
+    auto releaseLeft() -> AbstractExpressionRef<R> override {
+        return std::move(m_object);
+    }
 
   private:
     AbstractExpressionRef<R> m_object;
-    TokenRef m_name;
+    SourceToken m_name;
 };
 
 template <class R>
-class SetExpression : public AbstractExpression<R>,
-                      public std::enable_shared_from_this<SetExpression<R>> {
+class SetExpression : public AbstractExpression<R> {
   public:
-    explicit SetExpression(AbstractExpressionRef<R> object, TokenRef name,
+    explicit SetExpression(AbstractExpressionRef<R> object, SourceToken name,
                            AbstractExpressionRef<R> value)
-        : m_object(object), m_name(name), m_value(value) {};
+        : AbstractExpression<R>(ExprKind::Set), m_object(object), m_name(name),
+          m_value(value) {};
+
+    auto getObject() const -> const auto & { return m_object; }
+    auto getName() const -> const auto & { return m_name; }
+    auto getValue() const -> const auto & { return m_value; }
 
-    auto accept(VisitorRef<R>) -> R override;
+    ~SetExpression() override { this->releaseChain(std::move(m_object)); }
 
-    auto getObject() { return m_object; }
-    auto getName() { return m_name; }
-    auto getValue() { return m_value; }
+  protected:
+    auto releaseLeft() -> AbstractExpressionRef<R> override {
+        return std::move(m_object);
+    }
 
   private:
     AbstractExpressionRef<R> m_object;
-    TokenRef m_name;
+    SourceToken m_name;
     AbstractExpressionRef<R> m_value;
 };
 
 template <class R>
-class ThisExpression : public AbstractExpression<R>,
-                       public std::enable_shared_from_this<ThisExpression<R>> {
+class ThisExpression : public AbstractExpression<R> {
   public:
-    explicit ThisExpression(TokenRef keyword) : m_keyword(keyword) {};
+    explicit ThisExpression(SourceToken keyword)
+        : AbstractExpression<R>(ExprKind::This), m_keyword(keyword) {};
 
-    auto accept(VisitorRef<R>) -> R override;
-
-    auto getKeyword() { return m_keyword; }
+    auto getKeyword() const -> const auto & { return m_keyword; }
 
   private:
-    TokenRef m_keyword;
+    SourceToken m_keyword;
 };
 
 template <class R>
-class SuperExpression
-    : public AbstractExpression<R>,
-      public std::enable_shared_from_this<SuperExpression<R>> {
+class SuperExpression : public AbstractExpression<R> {
   public:
-    explicit SuperExpression(TokenRef keyword, TokenRef method)
-        : m_keyword(keyword), m_method(method) {};
-
-    auto accept(VisitorRef<R>) -> R override;
+    explicit SuperExpression(SourceToken keyword, SourceToken method)
+        : AbstractExpression<R>(ExprKind::Super), m_keyword(keyword),
+          m_method(method) {};
 
-    auto getKey() { return m_keyword; }
-    auto getMethod() { return m_method; }
+    auto getKey() const -> const auto & { return m_keyword; }
+    auto getMethod() const -> const auto & { return m_method; }
 
   private:
-    TokenRef m_keyword;
-    TokenRef m_method;
+    SourceToken m_keyword;
+    SourceToken m_method;
 };
 
-// template <class R>
-// class Expression : public AbstractExpression<R>,
-//                    public std::enable_shared_from_this<Expression<R>> {
-//   public:
-//     explicit Expression();
-
-//   private:
-// };
+// 左结合的链上的下一个节点：二元和逻辑运算的左操作数、调用的被调用者、
+// 属性读写的对象，其余节点为空。这样的链可以任意长，各遍沿着它循环，
+// 或者在递归之前检查原生栈的余量（见 stackExhausted）
+template <class R>
+auto leftOperand(const AbstractExpression<R> &expr)
+    -> const AbstractExpressionRef<R> * {
+    switch (expr.kind()) {
+    case ExprKind::Binary:
+        return &static_cast<const BinaryExpression<R> &>(expr).getLeftExpr();
+    case ExprKind::Logical:
+        return &static_cast<const LogicalExpression<R> &>(expr).getLeftExpr();
+    case ExprKind::Call:
+        return &static_cast<const CallExpression<R> &>(expr).getCallee();
+    case ExprKind::Get:
+        return &static_cast<const GetExpression<R> &>(expr).getObject();
+    case ExprKind::Set:
+        return &static_cast<const SetExpression<R> &>(expr).getObject();
+    default:
+        return nullptr;
+    }
+}
+
+// 报告错误时表达式的位置：运算符、名字、括号或关键字。
+// 字面量和括号表达式没有自己的 token，返回空
+template <class R>
+auto exprToken(const AbstractExpression<R> &expr) -> const SourceToken * {
+    switch (expr.kind()) {
+    case ExprKind::Binary:
+        return &static_cast<const BinaryExpression<R> &>(expr).getOperation();
+    case ExprKind::Unary:
+        return &static_cast<const UnaryExpression<R> &>(expr).getOperation();
+    case ExprKind::Variable:
+        return &static_cast<const VariableExpression<R> &>(expr).getName();
+    case ExprKind::Assignment:
+        return &static_cast<const AssignmentExpression<R> &>(expr).getName();
+    case ExprKind::Logical:
+        return &static_cast<const LogicalExpression<R> &>(expr).getOperation();
+    case ExprKind::Call:
+        return &static_cast<const CallExpression<R> &>(expr).getParen();
+    case ExprKind::Get:
+        return &static_cast<const GetExpression<R> &>(expr).getName();
+    case ExprKind::Set:
+        return &static_cast<const SetExpression<R> &>(expr).getName();
+    case ExprKind::This:
+        return &static_cast<const ThisExpression<R> &>(expr).getKeyword();
+    case ExprKind::Super:
+        return &static_cast<const SuperExpression<R> &>(expr).getKey();
+    default:
+        return nullptr;
+    }
+}
+
+// 静态分派的表达式访问者（CRTP）。visitExpr 按节点的 kind() 直接调用
+// Derived::visitXxxExpr(XxxExpression<R> &)，没有虚调用，也不复制 shared_ptr。
+// Ret 是各个 visit 函数的返回类型，只为副作用遍历 AST 的 pass 用 void
+template <class Derived, class R, class Ret = void> class ExprVisitor {
+  public:
+    auto visitExpr(AbstractExpression<R> &expr) -> Ret {
+        auto &self = static_cast<Derived &>(*this);
+        switch (expr.kind()) {
+        case ExprKind::Binary:
+            return self.visitBinaryExpr(
+                static_cast<BinaryExpression<R> &>(expr));
+        case ExprKind::Unary:
+            return self.visitUnaryExpr(static_cast<UnaryExpression<R> &>(expr));
+        case ExprKind::Literal:
+            return self.visitLiteralExpr(
+                static_cast<LiteralExpression<R> &>(expr));
+        case ExprKind::Grouping:
+            return self.visitGroupingExpr(
+                static_cast<GroupingExpression<R> &>(expr));
+        case ExprKind::Variable:
+            return self.visitVariableExpr(
+                static_cast<VariableExpression<R> &>(expr));
+        case ExprKind::Assignment:
+            return self.visitAssignmentExpr(
+                static_cast<AssignmentExpression<R> &>(expr));
+        case ExprKind::Logical:
+            return self.visitLogicalExpr(
+                static_cast<LogicalExpression<R> &>(expr));
+        case ExprKind::Call:
+            return self.visitCallExpr(static_cast<CallExpression<R> &>(expr));
+        case ExprKind::Get:
+            return self.visitGetExpr(static_cast<GetExpression<R> &>(expr));
+        case ExprKind::Set:
+            return self.visitSetExpr(static_cast<SetExpression<R> &>(expr));
+        case ExprKind::This:
+            return self.visitThisExpr(static_cast<ThisExpression<R> &>(expr));
+        case ExprKind::Super:
+            return self.visitSuperExpr(static_cast<SuperExpression<R> &>(expr));
+        }
+        throw std::logic_error("ExprVisitor: unknown expression kind");
+    }
+};
 
 } // namespace lox
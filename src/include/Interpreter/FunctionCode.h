@@ -0,0 +1,55 @@
+#pragma once
+
+#include "Environment.h"
+#include "Object.h"
+#include <functional>
+#include <memory>
+#include <mutex>
+
+namespace lox {
+
+class Interpreter;
+
+// 预先编译好的一段语句（整个程序或一个函数体），不按 AST 执行。
+// 编译结果不可变，可以被多个函数对象以及 fork 出来的 Isolate 共享
+class FunctionCode {
+  public:
+    virtual ~FunctionCode() = default;
+
+    // 在 env 中执行。执行了 return 语句时返回 true，返回值写入 result
+    virtual auto run(Interpreter &interpreter, EnvironmentRef env,
+                     Object &result) const -> bool = 0;
+};
+
+using FunctionCodeRef = std::shared_ptr<const FunctionCode>;
+
+// 第一次执行时才编译的函数体，用于延迟解析的函数（见 FunStmt）。
+// 编译失败（函数体有语法错误）时异常传给调用者，下次调用再试
+class LazyFunctionCode : public FunctionCode {
+  public:
+    using Compile = std::function<FunctionCodeRef()>;
+
+    explicit LazyFunctionCode(Compile compile)
+        : m_compile(std::move(compile)) {}
+
+    auto run(Interpreter &interpreter, EnvironmentRef env, Object &result) const
+        -> bool override {
+        return get()->run(interpreter, std::move(env), result);
+    }
+
+    // 编译好的函数体
+    auto get() const -> const FunctionCodeRef & {
+        std::call_once(m_once, [this] {
+            m_code = m_compile();
+            m_compile = nullptr;
+        });
+        return m_code;
+    }
+
+  private:
+    mutable std::once_flag m_once;
+    mutable Compile m_compile;
+    mutable FunctionCodeRef m_code;
+};
+
+} // namespace lox
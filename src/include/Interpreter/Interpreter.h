@@ -1,77 +1,260 @@
 #pragma once
 #include "Environment.h"
+#include "ErrorReporter.h"
 #include "Expression.h"
+#include "FunctionCode.h"
+#include "Jit.h"
+#include "LoxString.h"
+#include "ModuleCache.h"
 #include "Object.h"
 #include "Statements.h"
 #include "Token.h"
+#include "Vm.h"
+#include "Runtime/StackProbe.h"
 
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
 #include <memory>
+#include <ostream>
 #include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 namespace lox {
 
 class Interpreter;
 using InterpreterRef = std::shared_ptr<Interpreter>;
+class LoxFunction;
+using LoxFunctionRef = std::shared_ptr<LoxFunction>;
 
 // 解释器
-class Interpreter : public Visitor<Object>,
-                    public StmtVisitor,
-                    public std::enable_shared_from_this<Interpreter> {
+class Interpreter : public std::enable_shared_from_this<Interpreter> {
   public:
-    Interpreter();
-
-    auto visitLiteralExpr(LiteralExpressionRef<Object> expr) -> Object;
-    auto visitGroupingExpr(GroupingExpressionRef<Object> expr) -> Object;
-    auto visitUnaryExpr(UnaryExpressionRef<Object> expr) -> Object;
-    auto visitBinaryExpr(BinaryExpressionRef<Object> expr) -> Object;
-    auto visitVariableExpr(VariableExpressionRef<Object> expr) -> Object;
-    auto visitAssignmentExpr(AssignmentExpressionRef<Object> expr) -> Object;
-    auto visitLogicalExpr(LogicalExpressionRef<Object> expr) -> Object;
-    auto visitCallExpr(CallExpressionRef<Object> expr) -> Object;
-    auto visitGetExpr(GetExpressionRef<Object> expr) -> Object;
-    auto visitSetExpr(SetExpressionRef<Object> expr) -> Object;
-    auto visitThisExpr(ThisExpressionRef<Object> expr) -> Object;
-    auto visitSuperExpr(SuperExpressionRef<Object> expr) -> Object;
-
-    auto evaluate(AbstractExpressionRef<Object> expr) -> Object;
-
-    auto visitExpressionStmt(ExpressionStmtRef stmt) -> void;
-    auto visitPrintStmt(PrintStmtRef stmt) -> void;
-    auto visitVarStmt(VarStmtRef stmt) -> void;
-    auto visitBlockStmt(BlockStmtRef stmt) -> void;
-    auto visitIfStmt(IfStmtRef stmt) -> void;
-    auto visitWhileStmt(WhileStmtRef stmt) -> void;
-    auto visitFunStmt(FunStmtRef stmt) -> void;
-    auto visitReturnStmt(ReturnStmtRef stmt) -> void;
-    auto visitClassStmt(ClassStmtRef stmt) -> void;
-
-    auto evaluate(StmtRef stmt) -> void;
-
-    auto execute(StmtRef stmt) -> void;
-    auto executeBlock(std::vector<StmtRef> statements, EnvironmentRef env)
-        -> void;
+    // 从某些根环境出发可达的、未冻结的堆对象
+    struct Heap {
+        std::vector<EnvironmentRef> envs;
+        std::vector<LoxClassRef> classes;
+        std::vector<LoxInstanceRef> instances;
+        std::vector<LoxStringRef> strings;
+    };
+
+    // 执行方式：逐个节点访问 AST，先把 AST 编译成闭包树再执行
+    // （见 ClosureCompiler），或者编译成字节码交给 Vm 执行。
+    // 三者的输出和错误信息相同。默认按 AST 执行，
+    // 环境变量 LOX_EXEC=closure 时使用闭包树，LOX_EXEC=bytecode 时使用字节码
+    enum class ExecutionMode { TreeWalk, Closure, Bytecode };
+
+    // Lox 调用默认的最大嵌套深度
+    static constexpr std::size_t kDefaultMaxCallDepth =
+        lox::kDefaultMaxCallDepth;
+
+    // print 输出到 out；reporter 为空时使用解释器自己的 ErrorReporter。
+    // base 是快照冻结的全局环境，不为空时新的全局环境建立在它之上
+    explicit Interpreter(std::ostream &out = std::cout,
+                         ErrorReporter *reporter = nullptr,
+                         EnvironmentRef base = nullptr);
+    ~Interpreter();
 
-    auto resolve(AbstractExpressionRef<Object> expr, int depth) -> void;
+    // 在 env 中按 AST 执行 statements。执行了 return 时返回 true，
+    // 返回值写入 result。
+    //
+    // 求值和执行不递归：待办的步骤压进任务栈，中间结果压进值栈，
+    // 按 AST 执行的 Lox 函数之间的调用也只是压入一个调用帧，
+    // 在同一个循环里接着执行被调用者（见 Vm）。
+    // 嵌套很深的表达式和递归很深的 Lox 函数都不占用原生栈，
+    // 递归深度只受最大调用深度限制
+    auto execute(const std::vector<StmtRef> &statements, EnvironmentRef env,
+                 Object &result) -> bool;
 
-    auto lookUpVariable(TokenRef name, AbstractExpressionRef<Object> expr)
-        -> Object;
+    // 调用函数或类，callee 不可调用或参数个数不对时抛出 RuntimeError
+    auto callValue(Object callee, std::vector<ObjectRef> arguments,
+                   const SourceToken &paren) -> Object;
+    // 尾位置上的调用。被调用者是 Lox 函数时只做同样的检查，记下这次调用并
+    // 返回 nil，由正在返回的 LoxFunction::call 取走后在同一个原生栈帧里
+    // 接着执行；其余的可调用对象照常调用
+    auto tailCall(Object callee, std::vector<ObjectRef> arguments,
+                  const SourceToken &paren) -> Object;
+    // 取走记下的尾调用，没有时返回 false
+    auto takeTailCall(LoxFunctionRef &function,
+                      std::vector<ObjectRef> &arguments) -> bool;
+    // 进入一层 Lox 调用。嵌套超过最大深度，或者原生栈快要用完时
+    // 抛出 "Stack overflow." 运行时错误，而不是让进程崩溃
+    auto enterCall(const SourceToken &paren) -> void;
+    auto leaveCall() -> void { m_callDepth--; }
+    auto getCallDepth() const -> std::size_t { return m_callDepth; }
+    auto getMaxCallDepth() const -> std::size_t { return m_maxCallDepth; }
+    auto setMaxCallDepth(std::size_t depth) -> void { m_maxCallDepth = depth; }
+    // 读取实例的字段或方法
+    auto getProperty(Object obj, const SourceToken &name) -> Object;
+    // print 语句的输出
+    auto print(Object value) -> void;
+
+    auto lookUpVariable(const SourceToken &name,
+                        const AbstractExpression<Object> &expr) -> Object;
 
     auto isTruthy(Object obj) -> bool;
     auto isEqual(Object a, Object b) -> bool;
 
-    auto checkNumberOperand(TokenRef operation, Object operand) -> void;
-    auto checkNumberOperands(TokenRef operation, Object left, Object right)
+    auto checkNumberOperand(const SourceToken &operation, Object operand)
         -> void;
+    auto checkNumberOperands(const SourceToken &operation, Object left,
+                             Object right) -> void;
 
     auto interpret(std::vector<StmtRef> statements) -> void;
+    // 返回 stmt 导入的模块对象。一个模块在每个解释器里只执行一次：
+    // 第一次导入时从模块缓存取得编译好的程序，在模块自己的环境（外层是
+    // 全局环境）里执行它的顶层语句；之后的导入（包括菱形依赖）只查一次表。
+    // 模块对象是一个实例，字段是模块执行完时各个顶层名字的值。
+    // 循环导入、文件打不开或者模块有编译错误时抛出 RuntimeError
+    auto importModule(const ImportStmt &stmt) -> Object;
+    // 主程序里 import 的相对路径按 root 补全，为空时按当前目录
+    auto setModuleRoot(std::string root) -> void {
+        m_moduleRoot = std::move(root);
+    }
+    // 默认使用进程里共享的 ModuleCache::shared()
+    auto setModuleCache(ModuleCacheRef cache) -> void {
+        m_moduleCache = std::move(cache);
+    }
+    auto getModuleCache() const -> const ModuleCacheRef & {
+        return m_moduleCache;
+    }
+    auto hasImportedModules() const -> bool { return !m_modules.empty(); }
+    // 从全局环境出发清空所有可达的环境、实例和类，
+    // 打破闭包与环境之间的引用环，让引用计数能回收整个堆
+    auto clearHeap() -> void;
+    // 冻结从全局环境可达的整个堆并展平其中的字符串，返回被冻结的对象
+    auto freezeHeap() -> Heap;
+    static auto collectHeap(std::vector<EnvironmentRef> roots,
+                            std::vector<ObjectRef> values = {}) -> Heap;
+
+    // 在 env 中定义一个类，父类不是类时抛出 RuntimeError。
+    // methods 中的 code 是编译好的方法体，为空时按 AST 执行
+    auto defineClass(
+        const EnvironmentRef &env, const SourceToken &name,
+        ObjectRef superclass, const SourceToken &superName,
+        const std::vector<std::pair<FunStmtRef, FunctionCodeRef>> &methods)
+        -> void;
+
+    // 从 env 向外走 depth 层，冻结的环境换成本解释器的副本（见 localCopy）。
+    // 副本由解释器持有，返回的指针在解释器存活期间有效
+    auto localScope(Environment *env, int depth, bool create) -> Environment *;
+    // 冻结的环境和实例在这里换成本解释器自己的副本；
+    // create 为 false 时只读，没有副本就直接返回原对象
+    auto localCopy(const EnvironmentRef &env, bool create) -> EnvironmentRef;
+    auto localCopy(const LoxInstanceRef &instance, bool create)
+        -> LoxInstanceRef;
     auto stringify(Object obj) -> std::string;
 
     auto getEnvironment() { return m_env; }
     auto getGlobals() { return globals; }
+    auto getReporter() -> ErrorReporter & { return *m_reporter; }
+    auto getOutput() -> std::ostream & { return *m_out; }
+    auto getJit() -> Jit & { return m_jit; }
+    auto getVm() -> Vm & { return m_vm; }
+    auto getExecutionMode() const -> ExecutionMode { return m_mode; }
+    auto setExecutionMode(ExecutionMode mode) -> void { m_mode = mode; }
 
     EnvironmentRef globals;
     EnvironmentRef m_env;
-    std::unordered_map<AbstractExpressionRef<Object>, int> m_locals;
+
+  private:
+    struct Module {
+        ProgramRef program;
+        ObjectRef object; // 模块还在执行时为空
+    };
+
+    // 按 AST 执行时待办的一个步骤
+    struct Task {
+        enum class Op : std::uint8_t {
+            Evaluate,   // 求值表达式
+            Sequence,   // 执行语句序列中下标为 index 的语句
+            RestoreEnv, // 块执行完毕，恢复外层的环境
+            Leave,      // 函数体执行到末尾，返回 nil
+            Pop,
+            Print,
+            Define,
+            If,
+            While,
+            Return,
+            Class,
+            Unary,
+            Binary,
+            Logical,
+            Assign,
+            Call,
+            Get,
+            SetObject, // 检查 Set 的对象，再求值右边的值
+            Set,
+        };
+        Op op;
+        std::uint32_t index;
+        // 表达式、语句或者语句序列（Sequence）
+        const void *node;
+    };
+    // 一次按 AST 执行的 Lox 函数调用
+    struct Frame {
+        LoxFunctionRef function;
+        EnvironmentRef env; // 调用者的环境
+        // 调用时各个栈的高度，返回时回到这里
+        std::size_t tasks;
+        std::size_t values;
+        std::size_t envs;
+    };
+
+    auto push(Task::Op op, const void *node, std::uint32_t index = 0)
+        -> void {
+        m_tasks.push_back(Task{op, index, node});
+    }
+    auto pop() -> Object {
+        auto value = std::move(m_values.back());
+        m_values.pop_back();
+        return value;
+    }
+    // 求值 expr，结果压进值栈
+    auto evaluate(const AbstractExpression<Object> *expr) -> void;
+    // 执行 stmt，需要子表达式的值时把剩下的步骤压进任务栈
+    auto execute(const StmtRef &stmt) -> void;
+    // [被调用者 参数...] -> [返回值]。frames 是这次 execute 开始时的帧数
+    auto invoke(const CallExpression<Object> &expr, std::size_t frames)
+        -> void;
+    // 最内层的调用帧返回 value
+    auto leave(Object value) -> void;
+    auto binary(const BinaryExpression<Object> &expr, const Object &left,
+                const Object &right) -> Object;
+    auto superMethod(const SuperExpression<Object> &expr) -> Object;
+
+    // 按执行方式在 env 中执行模块的顶层语句
+    auto executeModule(const std::vector<StmtRef> &statements,
+                       const EnvironmentRef &env) -> void;
+    // 在 enterCall/leaveCall 之间调用一个已经检查过的可调用对象
+    auto call(const LoxCallableRef &function, std::vector<ObjectRef> arguments,
+              const SourceToken &paren) -> Object;
+
+    std::ostream *m_out;
+    ErrorReporter m_ownReporter;
+    ErrorReporter *m_reporter;
+    std::unordered_map<const Environment *, EnvironmentRef> m_envCopies;
+    std::unordered_map<const LoxInstance *, LoxInstanceRef> m_instanceCopies;
+    Jit m_jit{*this};
+    Vm m_vm{*this};
+    std::vector<Task> m_tasks;
+    std::vector<Object> m_values;
+    std::vector<EnvironmentRef> m_envs; // 块执行完要恢复的环境
+    std::vector<Frame> m_frames;
+    LoxFunctionRef m_tailFunction;
+    std::vector<ObjectRef> m_tailArguments;
+    std::size_t m_callDepth = 0;
+    std::size_t m_maxCallDepth = kDefaultMaxCallDepth;
+    ExecutionMode m_mode = ExecutionMode::TreeWalk;
+    std::string m_moduleRoot;
+    ModuleCacheRef m_moduleCache = ModuleCache::shared();
+    std::unordered_map<std::string, Module> m_modules; // 按规范化的路径
+    // 每条执行过的 import 语句导入的模块；持有语句，地址不会被重用
+    std::unordered_map<const ImportStmt *,
+                       std::pair<std::shared_ptr<const ImportStmt>, ObjectRef>>
+        m_importSites;
 };
 
 } // namespace lox
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "ErrorReporter.h"
+#include "Interpreter.h"
+#include "LoxString.h"
+#include "Program.h"
+#include "Snapshot.h"
+#include <iostream>
+#include <istream>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace lox {
+
+// 一个独立的 Lox 运行时：错误状态、全局环境和堆、驻留字符串、输出流
+// 全部归它所有，没有任何进程级的可变全局状态。
+// 不同的 Isolate 可以在不同线程上同时运行；同一个 Isolate 不能并发使用。
+class Isolate {
+  public:
+    enum class Status { OK, COMPILE_ERROR, RUNTIME_ERROR };
+
+    explicit Isolate(std::ostream &out = std::cout,
+                     std::ostream &err = std::cerr);
+    // 从快照 fork：一开始就能看到快照里的全部状态
+    explicit Isolate(SnapshotRef snapshot, std::ostream &out = std::cout,
+                     std::ostream &err = std::cerr);
+
+    Isolate(const Isolate &) = delete;
+    auto operator=(const Isolate &) -> Isolate & = delete;
+
+    // 在当前状态上增量执行一段源码，之前定义的全局变量依然可见
+    auto run(const std::string &source) -> Status;
+    // 执行一个已经编译好的程序，program 可以同时被其他 Isolate 使用
+    auto run(const ProgramRef &program) -> Status;
+    // 把多个文件编译成一个程序再执行（见 Program::compileFiles）
+    auto runFiles(const std::vector<SourceFile> &files) -> Status;
+    // 边读边执行：每解析完一个顶层声明就解析变量并执行它，
+    // 用过的 token 和执行完的语法树随即释放，内存只与最大的声明有关。
+    // 与 run 不同，后面的编译错误出现之前，前面的声明已经执行过了；
+    // 出现编译错误后只继续解析以报告其余的错误。
+    // 执行完的语法树不保留，之后不能再做快照
+    auto runStream(std::istream &input) -> Status;
+
+    // 之后编译的源码是否延迟解析函数体（见 Program::compile）。
+    // 默认关闭；环境变量 LOX_LAZY_PARSE=on 时打开
+    auto setLazyParsing(bool lazy) -> void { m_lazyParsing = lazy; }
+
+    // 冻结当前的堆并返回快照，这个 Isolate 之后也从快照继续运行。
+    // fork 出来的 Isolate 和导入过模块的 Isolate 不能做快照
+    auto snapshot() -> SnapshotRef;
+
+    auto getInterpreter() -> InterpreterRef { return m_interpreter; }
+    auto getReporter() -> ErrorReporter & { return m_reporter; }
+    auto getStrings() -> StringTable & { return m_strings; }
+    auto getOutput() -> std::ostream & { return *m_out; }
+
+  private:
+    std::ostream *m_out;
+    ErrorReporter m_reporter;
+    StringTable m_strings;
+    std::vector<ProgramRef> m_programs; // 执行过的声明了函数的程序
+    bool m_streamed = false;            // 执行过的流，语法树已经释放
+    bool m_lazyParsing = false;
+    SnapshotRef m_snapshot;             // 必须比解释器活得久
+    InterpreterRef m_interpreter;
+};
+
+} // namespace lox
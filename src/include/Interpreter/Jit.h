@@ -0,0 +1,113 @@
+#pragma once
+
+#include "Environment.h"
+#include "Object.h"
+#include "Statements.h"
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace lox {
+
+class Interpreter;
+class LoxFunction;
+
+// 基线模板 JIT：把调用次数超过阈值的纯数值函数逐节点翻译成 x86-64 机器码，
+// 放在 mmap 出来的可执行页里。
+//
+// 支持的子集：数字参数和局部变量、数字字面量、+ - * / 和一元负号、
+// 条件中的比较和逻辑运算、if/while/for/块、return，以及对全局函数的调用。
+// 尾位置上对自身的调用编译成跳回函数开头，不占用机器栈。
+// 这个子集里的代码没有副作用，所以任何守卫失败（参数不是数字、全局函数
+// 被换掉、函数没有返回值、递归太深……）都可以直接放弃这次调用，
+// 由解释器从头重新执行，结果与解释执行完全一致。
+// 不支持的函数在第一次编译时被标记，之后总是解释执行。
+//
+// 每个 Interpreter 持有自己的 Jit，不同 Isolate 之间不共享代码，也无需加锁。
+// 设置环境变量 LOX_JIT=off 或调用 setEnabled(false) 可以关闭 JIT。
+class Jit {
+  public:
+    static constexpr int kDefaultThreshold = 50;
+    // 机器码之间互相调用的最大深度，超过时放弃给解释器
+    static constexpr int kMaxDepth = 4000;
+
+    explicit Jit(Interpreter &interpreter);
+    ~Jit();
+
+    Jit(const Jit &) = delete;
+    auto operator=(const Jit &) -> Jit & = delete;
+
+    // 当前平台能否生成机器码
+    static auto isSupported() -> bool;
+
+    auto setEnabled(bool enabled) -> void { m_enabled = enabled; }
+    auto isEnabled() const -> bool { return m_enabled; }
+    auto setThreshold(int threshold) -> void { m_threshold = threshold; }
+
+    // 用机器码执行一次调用。成功时把返回值写入 result 并返回 true；
+    // 返回 false 时调用者应当照常解释执行
+    auto tryCall(LoxFunction &function, const std::vector<ObjectRef> &arguments,
+                 double &result) -> bool;
+    // 同上，参数是连续存放的 argc 个值（字节码虚拟机的操作数栈）
+    auto tryCall(LoxFunction &function, const Object *arguments,
+                 std::size_t argc, double &result) -> bool;
+
+    auto compiledCount() const -> std::size_t { return m_compiled; }
+    auto bailoutCount() const -> std::size_t { return m_bailouts; }
+
+  private:
+    // 机器码入口：args 是参数数组，结果写入 out，返回 0 表示成功，1 表示放弃
+    using NativeCode = int (*)(const double *args, double *out, Jit *jit);
+
+    struct CompiledFunction {
+        // 持有声明，保证作为键的地址不会被新的声明复用
+        FunStmtRef declaration;
+        int calls = 0;
+        int bailouts = 0;
+        bool failed = false; // 不支持或放弃次数太多，不再尝试
+        NativeCode code = nullptr;
+        void *pages = nullptr;
+        std::size_t size = 0;
+    };
+
+    // 机器码中对全局函数的一个调用点，带一个以全局环境版本为键的内联缓存
+    struct CallSite {
+        std::string name;
+        std::size_t argc = 0;
+        std::uint64_t version = 0;
+        const Environment *globals = nullptr;
+        CompiledFunction *target = nullptr;
+    };
+
+    friend class JitCompiler;
+
+    auto compile(const FunStmtRef &declaration) -> CompiledFunction &;
+    // 调用计数，达到阈值时编译；没有可用的机器码时返回 nullptr
+    auto prepare(LoxFunction &function) -> CompiledFunction *;
+    // 执行机器码，失败时记下一次放弃
+    auto invoke(CompiledFunction &compiled, const double *args, double &result)
+        -> bool;
+    auto addCallSite(std::string name, std::size_t argc) -> int;
+    auto resolveCallSite(CallSite &site) -> CompiledFunction *;
+    // 机器码调用全局函数时经过这里
+    static auto callFromNative(Jit *jit, int site, const double *args,
+                               double *out) -> int;
+    // 调用点当前是否指向 self，用来把自身的尾调用编译成跳转
+    static auto isSelfCall(Jit *jit, int site, const FunStmt *self) -> int;
+
+    Interpreter *m_interpreter;
+    bool m_enabled;
+    int m_threshold = kDefaultThreshold;
+    int m_depth = 0;
+    std::size_t m_compiled = 0;
+    std::size_t m_bailouts = 0;
+    std::unordered_map<const FunStmt *, CompiledFunction> m_functions;
+    // 编译时会追加新的调用点，deque 保证已有元素的地址不变
+    std::deque<CallSite> m_sites;
+};
+
+} // namespace lox
@@ -1,23 +1,46 @@
 #pragma once
 #include "Interpreter.h"
-#include "RuntimeError.h"
-#include "Token.h"
+#include "Isolate.h"
+#include "LoxString.h"
+#include "Transpiler.h"
+#include <cstddef>
 #include <string>
+#include <vector>
 
 namespace lox {
+
+// Lox 命令行前端。一个 Lox 对象持有一个 Isolate 作为会话：解释器、
+// 全局环境、驻留字符串在多次 run() 之间保留，REPL 的每一行都增量地
+// 解析并执行在同一个状态上。
 class Lox {
   public:
-    void run(const std::string &content);
+    Lox() = default;
+    // 从堆快照启动，快照中的全局状态一开始就可见
+    explicit Lox(SnapshotRef snapshot) : m_isolate(std::move(snapshot)) {}
+
+    auto run(const std::string &content) -> Isolate::Status;
     void runFile(const std::string &path);
+    // 把多个脚本按顺序组成一个程序执行，各个文件的前端并行处理
+    void runFiles(const std::vector<std::string> &paths);
+    // 边读边执行脚本（见 Isolate::runStream），path 为 "-" 时读标准输入
+    void streamFile(const std::string &path);
     void runPrompt();
-    void report(int line, std::string where, std::string message);
+    // 并行执行一批脚本文件，每个脚本一个独立的 Isolate。
+    // 输出按输入顺序写到标准输出，返回第一个失败脚本的退出码
+    static auto runBatch(const std::vector<std::string> &paths,
+                         std::size_t workers = 0) -> int;
+    // 把脚本预先编译成可执行文件或共享库，返回退出码：
+    // 脚本有编译错误时为 65，C++ 编译失败时为 1
+    static auto compileFile(const std::string &path, const std::string &output,
+                            Transpiler::Output kind) -> int;
 
-    void error(int line, std::string message);
-    auto error(TokenRef token, std::string message) -> void;
-    void runtimeError(RuntimeError error);
+    auto getIsolate() -> Isolate & { return m_isolate; }
+    auto getInterpreter() -> InterpreterRef {
+        return m_isolate.getInterpreter();
+    }
+    auto getStrings() -> StringTable & { return m_isolate.getStrings(); }
 
   private:
-    static bool hasError;
-    static bool hasRuntimeError;
+    Isolate m_isolate;
 };
 } // namespace lox
@@ -3,6 +3,7 @@
 #include "Interpreter.h"
 #include "Object.h"
 #include <memory>
+#include <string>
 #include <vector>
 namespace lox {
 
@@ -15,6 +16,7 @@ class LoxCallable {
     virtual auto call(InterpreterRef interpreter,
                       std::vector<ObjectRef> arguments) -> ObjectRef = 0;
     virtual auto arity() -> int = 0;
+    virtual auto toString() -> std::string = 0;
 };
 
 } // namespace lox
@@ -24,14 +24,23 @@ class LoxClass : public LoxCallable,
         -> ObjectRef override;
     auto arity() -> int override;
 
-    auto toString() -> std::string { return m_name; }
+    auto toString() -> std::string override { return m_name; }
     auto getName() -> std::string { return m_name; }
     auto getMethods() { return m_methods; }
+    auto getSuper() { return m_super; }
+    auto clear() -> void {
+        m_methods.clear();
+        m_super = nullptr;
+    }
+    // 类创建后本身就不可变，冻结只表示它属于快照，销毁时由快照清理
+    auto freeze() -> void { m_frozen = true; }
+    auto isFrozen() const -> bool { return m_frozen; }
 
   private:
     std::string m_name;
     LoxClassRef m_super;
     std::unordered_map<std::string, LoxFunctionRef> m_methods;
+    bool m_frozen = false;
 };
 
 } // namespace lox
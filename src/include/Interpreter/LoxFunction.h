@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Environment.h"
+#include "FunctionCode.h"
 #include "LoxCallable.h"
 #include "Statements.h"
 #include <memory>
@@ -13,10 +14,11 @@ using LoxFunctionRef = std::shared_ptr<LoxFunction>;
 class LoxFunction : public LoxCallable,
                     public std::enable_shared_from_this<LoxFunction> {
   public:
+    // code 是编译好的函数体（闭包树或字节码），为空时按 AST 执行
     explicit LoxFunction(FunStmtRef declaration, EnvironmentRef closure,
-                         bool isInitializer)
+                         bool isInitializer, FunctionCodeRef code = nullptr)
         : m_declaration(declaration), m_closure(closure),
-          m_isInitializer(isInitializer) {};
+          m_isInitializer(isInitializer), m_code(std::move(code)) {};
 
     auto bind(LoxInstanceRef instance) -> LoxFunctionRef;
 
@@ -25,14 +27,18 @@ class LoxFunction : public LoxCallable,
 
     auto arity() -> int override;
 
-    auto toString() -> std::string;
+    auto toString() -> std::string override;
 
     auto getDeclaration() { return m_declaration; }
+    auto getClosure() { return m_closure; }
+    auto isInitializer() const -> bool { return m_isInitializer; }
+    auto getCode() const -> const FunctionCodeRef & { return m_code; }
 
   private:
     FunStmtRef m_declaration;
     EnvironmentRef m_closure;
     bool m_isInitializer;
+    FunctionCodeRef m_code;
 };
 
 } // namespace lox
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "Environment.h"
 #include "LoxCallable.h"
 #include "LoxClass.h"
 #include "Object.h"
@@ -12,18 +13,33 @@ namespace lox {
 class LoxInstance : public std::enable_shared_from_this<LoxInstance> {
   public:
     explicit LoxInstance(LoxClassRef klass) : m_class(klass) {};
+    // 模块对象：字段就是模块顶层环境里的变量，读写都直接落在环境上，
+    // 模块里的函数修改了顶层变量，从模块对象上也能读到
+    LoxInstance(LoxClassRef klass, EnvironmentRef scope)
+        : m_class(klass), m_scope(std::move(scope)) {};
 
-    auto get(TokenRef name) -> ObjectRef;
-    auto set(TokenRef name, ObjectRef value) -> void;
+    auto get(const SourceToken &name) -> ObjectRef;
+    auto set(const SourceToken &name, ObjectRef value) -> void;
+    // 只查字段，不存在时返回 nullptr
+    auto findField(const std::string &name) -> ObjectRef;
+    auto setField(const std::string &name, ObjectRef value) -> void;
 
     auto toString() -> std::string { return m_class->getName() + " instance"; }
 
-    auto getFields() { return m_fields; }
+    auto getFields() -> std::unordered_map<std::string, ObjectRef>;
+    auto clearFields() -> void;
     auto getClass() { return m_class; }
 
+    // 与 Environment 一样，冻结的实例属于快照，只读共享
+    auto freeze() -> void { m_frozen = true; }
+    auto isFrozen() const -> bool { return m_frozen; }
+    auto copy() -> LoxInstanceRef;
+
   private:
     LoxClassRef m_class;
     std::unordered_map<std::string, ObjectRef> m_fields;
+    EnvironmentRef m_scope; // 模块对象的顶层环境，普通实例为空
+    bool m_frozen = false;
 };
 
 } // namespace lox
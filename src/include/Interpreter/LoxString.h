@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace lox {
+
+class LoxString;
+using LoxStringRef = std::shared_ptr<LoxString>;
+
+// 不可变的堆上字符串，有三种形态：
+//   Flat  - 自己持有字符
+//   Rope  - 两个子串的拼接节点
+//   Slice - 父串中的一段视图
+// 拼接和切片都是 O(1)，只有在需要连续字符（比较、输出）时才展平。
+class LoxString {
+  public:
+    enum Kind { Flat, Rope, Slice };
+
+    // 短于这个长度的拼接直接复制成 Flat，省掉节点开销
+    static constexpr std::size_t kMinRopeLength = 64;
+
+    explicit LoxString(std::string str)
+        : m_kind(Flat), m_length(str.size()), m_flat(std::move(str)) {}
+    ~LoxString();
+
+    LoxString(const LoxString &) = delete;
+    auto operator=(const LoxString &) -> LoxString & = delete;
+
+    static auto make(std::string str) -> LoxStringRef;
+    static auto concat(const LoxStringRef &left, const LoxStringRef &right)
+        -> LoxStringRef;
+    static auto slice(const LoxStringRef &parent, std::size_t start,
+                      std::size_t length) -> LoxStringRef;
+
+    auto getKind() const -> Kind { return m_kind; }
+    auto length() const -> std::size_t { return m_length; }
+
+    // 连续字符的视图，Rope 会在这里被展平并缓存结果
+    auto view() -> std::string_view;
+    // 返回展平后的 std::string，Slice 会在这里物化
+    auto str() -> const std::string &;
+    auto equals(LoxString &other) -> bool;
+
+  private:
+    LoxString(Kind kind, std::size_t length) : m_kind(kind), m_length(length) {}
+
+    auto flatten() -> void;
+    // 迭代地释放子节点，避免深层 Rope 在析构时递归爆栈
+    static auto release(LoxStringRef node) -> void;
+
+    Kind m_kind;
+    std::size_t m_length;
+    std::string m_flat;
+
+    LoxStringRef m_left; // Rope
+    LoxStringRef m_right;
+    LoxStringRef m_parent; // Slice
+    std::size_t m_offset = 0;
+};
+
+// 字符串驻留表：内容相同的字面量共享同一个 LoxString
+class StringTable {
+  public:
+    auto intern(std::string_view str) -> LoxStringRef;
+    auto size() const -> std::size_t { return m_strings.size(); }
+
+  private:
+    // key 指向 value 自己持有的字符，Flat 串的字符不会移动
+    std::unordered_map<std::string_view, LoxStringRef> m_strings;
+};
+
+} // namespace lox
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "Program.h"
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace lox {
+
+class ModuleCache;
+using ModuleCacheRef = std::shared_ptr<ModuleCache>;
+
+// 编译好的模块，按规范化之后的路径缓存。
+// Program 编译之后只读，可以被任意多个解释器同时执行（见 Program），
+// 所以同一进程里的所有 Isolate 默认共享 shared() 这一个缓存：
+// 一个模块只在第一次被导入时读文件、扫描、解析和解析变量。
+// 已经缓存的模块再次导入时只查一次修改时间，不打开文件；
+// 修改时间变了之后再导入时重新读文件、重新编译。线程安全
+class ModuleCache {
+  public:
+    static auto shared() -> const ModuleCacheRef &;
+
+    // 返回 path 处模块编译好的程序。文件打不开或者有编译错误时返回 nullptr，
+    // 诊断信息（带上文件名）写到 errors。失败的结果不缓存
+    auto load(const std::string &path, std::string &errors) -> ProgramRef;
+
+    auto size() const -> std::size_t;
+    auto clear() -> void;
+
+  private:
+    struct Entry {
+        std::filesystem::file_time_type modified;
+        ProgramRef program;
+    };
+
+    mutable std::mutex m_mutex;
+    std::unordered_map<std::string, Entry> m_modules;
+};
+
+} // namespace lox
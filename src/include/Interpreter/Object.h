@@ -1,4 +1,6 @@
 #pragma once
+#include "LoxString.h"
+#include <cstddef>
 #include <memory>
 #include <string>
 
@@ -28,28 +30,37 @@ class Object {
         Object_class,
     };
 
+    // 足够容纳任意 double 的最短往返表示
+    static constexpr std::size_t kNumberBufferSize = 32;
+
     std::string toString();
+    // 将 num 以最短往返形式写入 buf，返回写入的字节数，不做堆分配。
+    // 整数值不带小数部分。
+    static auto formatNumber(double num, char *buf) -> std::size_t;
     static Object make_num_obj(double num);
     static Object make_str_obj(std::string str);
+    static Object make_str_obj(LoxStringRef str);
     static Object make_bool_obj(bool boolean);
     static Object make_nil_obj();
     static Object make_fun_obj(LoxCallableRef function_);
     static Object make_instance_obj(LoxInstanceRef instance);
     static Object make_class_obj(LoxClassRef klass);
-    auto getType() -> Object_type { return m_type; }
-    auto getBool() -> bool { return m_boolean; }
-    auto getNum() -> double { return m_num; }
-    auto getStr() -> std::string { return m_str; };
-    auto getFun() -> LoxCallableRef { return m_function; };
-    auto getInstance() -> LoxInstanceRef { return m_instance; }
-    auto getClass() -> LoxClassRef { return m_class; }
+    auto getType() const -> Object_type { return m_type; }
+    auto getBool() const -> bool { return m_boolean; }
+    auto getNum() const -> double { return m_num; }
+    // 字符串按需展平，返回的引用在 Object 存活期间有效
+    auto getStr() const -> const std::string & { return m_str->str(); };
+    auto getString() const -> LoxStringRef { return m_str; }
+    auto getFun() const -> LoxCallableRef { return m_function; };
+    auto getInstance() const -> LoxInstanceRef { return m_instance; }
+    auto getClass() const -> LoxClassRef { return m_class; }
 
   private:
-    std::string m_str;
-    double m_num;
-    bool m_boolean;
-    int *m_nil;
-    Object_type m_type;
+    LoxStringRef m_str;
+    double m_num = 0;
+    bool m_boolean = false;
+    int *m_nil = nullptr;
+    Object_type m_type = Object_nil;
 
     LoxCallableRef m_function;
     LoxClassRef m_class;
@@ -1,11 +1,14 @@
 #pragma once
 
+#include "ErrorReporter.h"
 #include "Expression.h"
 #include "Object.h"
+#include "Resolver.h"
+#include "Scanner.h"
 #include "Statements.h"
 #include "Token.h"
 #include "Tokentype.h"
-#include <stdexcept>
+#include <functional>
 #include <string>
 #include <vector>
 namespace lox {
@@ -13,14 +16,37 @@ namespace lox {
 // 递归下降法
 class Parser {
   public:
-    Parser(std::vector<TokenRef> tokens) { m_tokens = std::move(tokens); }
+    // reporter 为空时错误记录在 Parser 自己的 ErrorReporter 上
+    Parser(std::vector<TokenRef> tokens, ErrorReporter *reporter = nullptr)
+        : m_tokens(std::move(tokens)),
+          m_reporter(reporter != nullptr ? reporter : &m_ownReporter) {}
+    // 流式解析：需要时才向 scanner 要下一个 token，用 next 逐个取出顶层声明
+    Parser(Scanner &scanner, ErrorReporter *reporter = nullptr)
+        : Parser([&scanner] { return scanner.nextToken(); }, reporter) {}
+    // 同上，token 来自 source，最后一直返回 EOF_TOKEN（见 Document）
+    Parser(std::function<TokenRef()> source, ErrorReporter *reporter = nullptr)
+        : m_source(std::move(source)),
+          m_reporter(reporter != nullptr ? reporter : &m_ownReporter) {}
     // parse方法启动解析过程，返回AST的根节点；尝试解析一个表达式并返回其AST表示。
   public:
     auto parse() -> std::vector<StmtRef>;
+    // 解析下一个顶层声明（出错时为 nullptr），没有更多声明时返回 false。
+    // 之前声明的 token 随即丢掉
+    auto next(StmtRef &stmt) -> bool;
+    // 延迟解析顶层函数和顶层类的方法：预解析时只检查花括号是否配对，
+    // 第一次调用时才完整解析函数体并解析变量（见 FunStmt）。
+    // 之后才报告函数体里的语法错误，没有调用过的函数不会报告
+    auto setLazyBodies(bool lazy) -> void { m_lazyBodies = lazy; }
+    // import 的相对路径按 base 补全（解析模块时是模块所在的目录）。
+    // 为空时保留相对路径，运行时再按解释器的模块根目录补全
+    auto setImportBase(std::string base) -> void {
+        m_importBase = std::move(base);
+    }
     auto statement() -> StmtRef;
     auto declaration() -> StmtRef;
     auto varDeclaration() -> StmtRef;
     auto classDeclaration() -> StmtRef;
+    auto importDeclaration() -> StmtRef;
     auto function(std::string kind) -> StmtRef;
 
     auto printStatement() -> StmtRef;
@@ -54,14 +80,20 @@ class Parser {
     // 返回当前的token，并且前进一位
     auto advance() -> TokenRef;
 
-    // 判断当前Token是否是结尾（==EOF）
+    // 判断当前Token是否是结尾（==EOF）。恐慌模式下（见 fail）和错误数
+    // 达到 ErrorReporter 的上限之后也为真
     auto isAtEnd() -> bool;
     // 返回当前指向的TokenRef
     auto peek() -> TokenRef;
     // 返回前一个TokenRef
     auto previous() -> TokenRef;
-    // 报错
-    std::runtime_error error(TokenRef token, std::string message);
+    // 报告一个错误，不影响接下来的解析（如参数太多）
+    auto error(TokenRef token, std::string message) -> void;
+    // 报告一个语法错误并进入恐慌模式：isAtEnd 随即为真，各层解析函数
+    // 不再消耗 token，返回不完整的结果，直到最近的 declaration 丢掉它们
+    // 并同步到下一条语句。恐慌期间不再报告错误。整个过程不抛出异常，
+    // 有大量语法错误的源码也不会因为栈展开而变慢
+    auto fail(TokenRef token, std::string message) -> void;
     auto synchronize() -> void;
 
     // 检查当前的type是否存在于传入的type中，如果存在，那么前进并且返回true；否则返回false
@@ -69,8 +101,25 @@ class Parser {
     auto consume(TokenType type, std::string message) -> TokenRef;
 
   private:
+    class Nesting;
+
+    // 真正到达 token 序列的末尾
+    auto atEof() -> bool;
+    // 跳过函数体直到配对的 '}'，返回函数体的 token（包括 '}'）
+    auto skipBody() -> std::vector<TokenRef>;
+
     int m_current = 0;
     std::vector<TokenRef> m_tokens;
+    std::function<TokenRef()> m_source; // 流式解析时 token 的来源
+    bool m_lazyBodies = false;
+    bool m_panic = false;   // 出错之后、同步之前
+    bool m_stopped = false; // 错误数达到上限，不再解析
+    std::string m_importBase;
+    int m_blockDepth = 0;                  // 正在解析的块的嵌套深度
+    int m_nesting = 0;                     // 解析器当前的递归深度
+    ClassType m_class = ClassType::NONE; // 正在解析的类
+    ErrorReporter m_ownReporter;
+    ErrorReporter *m_reporter;
 };
 
 } // namespace lox
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "ErrorReporter.h"
+#include "LoxString.h"
+#include "Statements.h"
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace lox {
+
+class Program;
+using ProgramRef = std::shared_ptr<const Program>;
+
+// 组成一个程序的一个源文件，name 用在诊断信息里
+struct SourceFile {
+    std::string name;
+    std::string source;
+};
+
+// 编译好的程序：经过 Parser 和 Resolver 之后不再改变的 AST，
+// 作用域解析结果直接记录在 AST 节点上。
+// 同一个 Program 可以被任意多个解释器同时执行而不需要复制：
+// 运行时状态都在各自的环境里，AST 只会被读取；
+// 字符串字面量都是 Flat 串，读取它们不会触发展平。
+class Program {
+  public:
+    // 编译失败时返回 nullptr，诊断信息写到 reporter（编译前会先 reset）。
+    // strings 不为空时字面量驻留到调用者的表里，否则使用 Program 自己的表
+    // lazy 为 true 时顶层函数和方法的函数体延迟到第一次调用时才解析
+    // （见 Parser::setLazyBodies），它们的语法错误那时才报告。
+    // 不保留源码，编译之后只剩语法树
+    static auto compile(const std::string &source, ErrorReporter &reporter,
+                        StringTable *strings = nullptr, bool lazy = false)
+        -> ProgramRef;
+    // 把多个文件按顺序编译成一个程序，相当于依次执行它们。
+    // 每个文件在 threads 个线程（0 表示硬件线程数）上各自扫描、解析和
+    // 解析变量；诊断信息带上文件名，按文件顺序输出，与线程数无关
+    static auto compileFiles(const std::vector<SourceFile> &files,
+                             ErrorReporter &reporter,
+                             StringTable *strings = nullptr, bool lazy = false,
+                             std::size_t threads = 0) -> ProgramRef;
+
+    // 编译 path 处的模块（见 ImportStmt）：顶层声明属于模块自己的作用域
+    // 而不是全局环境（见 Resolver::resolveModule），模块里 import 的相对路径
+    // 按 path 所在的目录补全。模块总是预先解析
+    static auto compileModule(const std::string &source,
+                              const std::string &path, ErrorReporter &reporter)
+        -> ProgramRef;
+
+    Program(const Program &) = delete;
+    auto operator=(const Program &) -> Program & = delete;
+
+    auto getStatements() const -> const std::vector<StmtRef> & {
+        return m_statements;
+    }
+    // 程序中所有的函数和方法声明，按源码中出现的顺序排列；
+    // 堆快照用下标引用函数，快照文件里重建的语法树得到的顺序不变。
+    // 第一次调用时才收集，延迟解析的函数体会在这时全部解析
+    auto getFunctions() const -> const std::vector<FunStmtRef> &;
+    // 是否声明了函数或方法，不会解析延迟解析的函数体
+    auto declaresFunctions() const -> bool;
+
+  private:
+    // 快照文件直接重建语法树，不经过编译
+    friend class Snapshot;
+
+    Program() = default;
+
+    std::vector<StmtRef> m_statements;
+    mutable std::once_flag m_collected;
+    mutable std::vector<FunStmtRef> m_functions;
+    StringTable m_strings;
+};
+
+} // namespace lox
@@ -1,7 +1,7 @@
 #pragma once
 
+#include "ErrorReporter.h"
 #include "Expression.h"
-#include "Interpreter.h"
 #include "Object.h"
 #include "Statements.h"
 #include "Token.h"
@@ -14,55 +14,66 @@ namespace lox {
 enum class FunctionType { NONE, FUNCTION, INITIALIZER, METHOD };
 enum class ClassType { NONE, CLASS, SUBCLASS };
 
-class Resolver : public StmtVisitor,
-                 public Visitor<Object>,
-                 public std::enable_shared_from_this<Resolver> {
+// 只做检查和标注，所有 visit 都不产生值
+class Resolver : public StmtVisitor<Resolver>,
+                 public ExprVisitor<Resolver, Object> {
   public:
-    Resolver(InterpreterRef interpret) : m_interpret(interpret) {};
-    auto resolve(std::vector<StmtRef> statement) -> void;
-    auto resolve(StmtRef stmt) -> void;
-    auto resolve(AbstractExpressionRef<Object> expr) -> void;
+    explicit Resolver(ErrorReporter &reporter) : m_reporter(&reporter) {};
+    auto resolve(const std::vector<StmtRef> &statement) -> void;
+    auto resolve(const StmtRef &stmt) -> void;
+    auto resolve(const AbstractExpressionRef<Object> &expr) -> void;
+    // 解析模块的顶层语句。模块的顶层是一个局部作用域（执行时是模块自己的
+    // 环境），其中所有的顶层名字预先声明，函数可以引用后面才声明的名字，
+    // 与全局作用域一样可以重复声明
+    auto resolveModule(const std::vector<StmtRef> &statements) -> void;
+    // 声明语句（var、fun、class、import）声明的名字，其他语句返回 nullptr
+    static auto declaredName(const StmtRef &stmt) -> const SourceToken *;
 
     auto beginScope() -> void;
     auto endScope() -> void;
 
-    auto declare(TokenRef name) -> void;
-    auto define(TokenRef name) -> void;
+    auto declare(const SourceToken &name) -> void;
+    auto define(const SourceToken &name) -> void;
 
-    auto resolveLocal(AbstractExpressionRef<Object> expr, TokenRef name)
+    auto resolveLocal(AbstractExpression<Object> &expr, const SourceToken &name)
         -> void;
-    auto resolveFun(FunStmtRef fun, FunctionType type) -> void;
+    // 延迟解析的函数体在解析时才由 resolveBody 处理，这里跳过
+    auto resolveFun(const FunStmt &fun, FunctionType type) -> void;
+    // 解析延迟解析的函数体 body 中的变量。只有顶层的函数和顶层类的方法
+    // 会延迟解析，外层作用域只可能是方法的 this 和 super
+    auto resolveBody(const FunStmt &fun, const std::vector<StmtRef> &body,
+                     FunctionType type, ClassType klass) -> void;
 
-    auto visitBlockStmt(BlockStmtRef stmt) -> void;
-    auto visitVarStmt(VarStmtRef stmt) -> void;
-    auto visitExpressionStmt(ExpressionStmtRef stmt) -> void;
-    auto visitFunStmt(FunStmtRef stmt) -> void {}
-    auto visitIfStmt(IfStmtRef stmt) -> void;
-    auto visitPrintStmt(PrintStmtRef stmt) -> void;
-    auto visitReturnStmt(ReturnStmtRef stmt) -> void;
-    auto visitWhileStmt(WhileStmtRef stmt) -> void;
-    auto visitClassStmt(ClassStmtRef stmt) -> void;
+    auto visitBlockStmt(BlockStmt &stmt) -> void;
+    auto visitVarStmt(VarStmt &stmt) -> void;
+    auto visitExpressionStmt(ExpressionStmt &stmt) -> void;
+    auto visitFunStmt(FunStmt &stmt) -> void;
+    auto visitIfStmt(IfStmt &stmt) -> void;
+    auto visitPrintStmt(PrintStmt &stmt) -> void;
+    auto visitReturnStmt(ReturnStmt &stmt) -> void;
+    auto visitWhileStmt(WhileStmt &stmt) -> void;
+    auto visitClassStmt(ClassStmt &stmt) -> void;
+    auto visitImportStmt(ImportStmt &stmt) -> void;
 
-    auto visitFunStmt(FunStmtRef stmt, FunctionType type) -> void;
-
-    auto visitLiteralExpr(LiteralExpressionRef<Object> expr) -> Object;
-    auto visitGroupingExpr(GroupingExpressionRef<Object> expr) -> Object;
-    auto visitUnaryExpr(UnaryExpressionRef<Object> expr) -> Object;
-    auto visitBinaryExpr(BinaryExpressionRef<Object> expr) -> Object;
-    auto visitLogicalExpr(LogicalExpressionRef<Object> expr) -> Object;
-    auto visitCallExpr(CallExpressionRef<Object> expr) -> Object;
-    auto visitVariableExpr(VariableExpressionRef<Object> expr) -> Object;
-    auto visitAssignmentExpr(AssignmentExpressionRef<Object> expr) -> Object;
-    auto visitGetExpr(GetExpressionRef<Object> expr) -> Object;
-    auto visitSetExpr(SetExpressionRef<Object> expr) -> Object;
-    auto visitThisExpr(ThisExpressionRef<Object> expr) -> Object;
-    auto visitSuperExpr(SuperExpressionRef<Object> expr) -> Object;
+    auto visitLiteralExpr(LiteralExpression<Object> &expr) -> void;
+    auto visitGroupingExpr(GroupingExpression<Object> &expr) -> void;
+    auto visitUnaryExpr(UnaryExpression<Object> &expr) -> void;
+    auto visitBinaryExpr(BinaryExpression<Object> &expr) -> void;
+    auto visitLogicalExpr(LogicalExpression<Object> &expr) -> void;
+    auto visitCallExpr(CallExpression<Object> &expr) -> void;
+    auto visitVariableExpr(VariableExpression<Object> &expr) -> void;
+    auto visitAssignmentExpr(AssignmentExpression<Object> &expr) -> void;
+    auto visitGetExpr(GetExpression<Object> &expr) -> void;
+    auto visitSetExpr(SetExpression<Object> &expr) -> void;
+    auto visitThisExpr(ThisExpression<Object> &expr) -> void;
+    auto visitSuperExpr(SuperExpression<Object> &expr) -> void;
 
   private:
-    InterpreterRef m_interpret;
+    ErrorReporter *m_reporter;
     std::deque<std::unordered_map<std::string, bool>> m_scopes;
     FunctionType current_function = FunctionType::NONE;
     ClassType current_class = ClassType::NONE;
+    bool m_module = false; // 最外层作用域是模块的顶层
 };
 
 } // namespace lox
@@ -7,15 +7,15 @@
 namespace lox {
 class RuntimeError : public std::exception {
   public:
-    RuntimeError(TokenRef token, std::string messgae)
+    RuntimeError(const SourceToken &token, std::string messgae)
         : m_token(token), m_message(messgae) {};
-    auto getToken() -> TokenRef;
+    auto getToken() const -> const SourceToken &;
     auto getMessage() -> std::string;
 
     virtual const char *what() const throw() { return m_message.c_str(); }
 
   private:
-    TokenRef m_token;
+    SourceToken m_token;
     std::string m_message;
 };
 } // namespace lox
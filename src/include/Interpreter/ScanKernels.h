@@ -0,0 +1,29 @@
+#pragma once
+#include <cstddef>
+
+namespace lox {
+
+// 词法分析里按字节循环的几个热点。每个函数从 p 开始向后扫描，不越过 end，
+// 返回第一个不满足条件的位置。SIMD 实现一次检查 16/32 个字节，
+// 结果与标量实现完全相同
+struct ScanKernels {
+    enum class Path { Scalar, Sse2, Avx2 };
+
+    Path path;
+    // 跳过空格、制表符、回车和换行，跳过的换行数累加到 *lines
+    const char *(*skipWhitespace)(const char *p, const char *end, int *lines);
+    // 下一个换行（// 注释的结尾），没有时返回 end
+    const char *(*findNewline)(const char *p, const char *end);
+    // 下一个双引号（字符串字面量的结尾），途中的换行数累加到 *lines
+    const char *(*findQuote)(const char *p, const char *end, int *lines);
+    // 跳过标识符的字符 [A-Za-z0-9_]
+    const char *(*skipIdentifier)(const char *p, const char *end);
+
+    // 当前 CPU 支持的最快实现。环境变量 LOX_SIMD=off 时使用标量实现
+    static auto best() -> const ScanKernels &;
+    // 指定的实现，CPU 不支持时返回 nullptr
+    static auto get(Path path) -> const ScanKernels *;
+    static auto pathName(Path path) -> const char *;
+};
+
+} // namespace lox
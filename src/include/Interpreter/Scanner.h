@@ -1,6 +1,14 @@
 #pragma once
+#include "ErrorReporter.h"
+#include "LoxString.h"
+#include "ScanKernels.h"
 #include "Token.h"
+#include <cstddef>
+#include <functional>
+#include <istream>
 #include <string>
+#include <string_view>
+#include <utility>
 #include <vector>
 namespace lox {
 
@@ -8,7 +16,22 @@ namespace lox {
 
 class Scanner {
   public:
-    Scanner(std::string source) { m_source = source; }
+    // reporter 为空时错误记录在 Scanner 自己的 ErrorReporter 上
+    Scanner(std::string source, StringTable *strings = nullptr,
+            ErrorReporter *reporter = nullptr)
+        : m_source(std::move(source)), m_text(m_source),
+          m_end(static_cast<int>(m_text.size())), m_strings(strings),
+          m_reporter(reporter != nullptr ? reporter : &m_ownReporter) {}
+    // 流式扫描：用 nextToken 逐个取 token，源码按块从 input 读入，
+    // 已经扫描过的部分随即丢掉
+    explicit Scanner(std::istream &input, StringTable *strings = nullptr,
+                     ErrorReporter *reporter = nullptr,
+                     std::size_t block = kStreamBlock)
+        : m_text(m_source), m_end(0), m_input(&input), m_block(block),
+          m_strings(strings),
+          m_reporter(reporter != nullptr ? reporter : &m_ownReporter) {}
+    Scanner(const Scanner &) = delete;
+    auto operator=(const Scanner &) -> Scanner & = delete;
     // help funcitons
     // 判断是否扫描到了source的末尾
     auto isAtEnd() -> bool;
@@ -32,15 +55,94 @@ class Scanner {
 
     auto scanToken() -> void;
     auto scanTokens() -> std::vector<TokenRef>;
+    // 把源码在换行处切成至少 minChunk 字节的块，用 threads 个线程
+    // （0 表示硬件线程数）同时扫描再拼起来，结果与 scanTokens 完全相同。
+    // 源码不够切成两块时直接顺序扫描
+    auto scanTokensParallel(std::size_t threads = 0,
+                            std::size_t minChunk = kMinParallelChunk)
+        -> std::vector<TokenRef>;
+
+    static constexpr std::size_t kMinParallelChunk = 1 << 20;
+    // 把没有驻留的扫描结果中的字符串字面量驻留到 strings
+    static auto internStrings(const std::vector<TokenRef> &tokens,
+                              StringTable &strings) -> void;
+
+    // 扫描并返回下一个 token，到达末尾后一直返回 EOF_TOKEN
+    auto nextToken() -> TokenRef;
+    static constexpr std::size_t kStreamBlock = 1 << 16;
 
     auto getTokens() -> std::vector<TokenRef> { return m_tokens; }
 
+    // 跳过空白、注释、字符串内容和标识符时使用的实现，默认为
+    // ScanKernels::best()
+    auto setKernels(const ScanKernels &kernels) -> void {
+        m_kernels = &kernels;
+    }
+
+    // 没有直接报告的扫描错误，offset 是出错的词素开始的位置
+    struct ChunkError {
+        int line;
+        int column;
+        int offset;
+        std::string message;
+    };
+    // 增量扫描的结果
+    struct Rescan {
+        std::vector<TokenRef> tokens;
+        std::vector<int> offsets; // 每个 token 在源码中的位置
+        std::vector<ChunkError> errors;
+        int end = 0; // 停下的位置
+    };
+    // 增量扫描（见 Document）：从 text 的 begin 处（某个 token 的开头或者
+    // 源码开头，在第 line 行）开始，扫描到 begin 之后第一个 stop(offset)
+    // 为真的 token 边界或者源码末尾为止。扫描器在 token 边界上没有状态，
+    // 从那里往后的结果和原来的一样。不加 EOF_TOKEN，字符串字面量不驻留
+    static auto rescan(std::string_view text, int begin, int line,
+                       const std::function<bool(int)> &stop) -> Rescan;
+
   private:
+    // 并行扫描中一块的结果
+    struct Chunk {
+        std::vector<TokenRef> tokens;
+        std::vector<ChunkError> errors;
+        int openString = -1; // 块尾有没结束的字符串时，它的起点
+        int openLine = 0;    // 这个字符串开始的行
+    };
+
+    // 扫描 text 中 [begin, end) 的一块，begin 在第 line 行
+    Scanner(std::string_view text, int begin, int end, int line,
+            const ScanKernels &kernels);
+    auto scanChunk(int begin, int end, int line) const -> Chunk;
+    auto error(const std::string &message) -> void;
+    // [from, to) 中有换行时把行首移到最后一个换行之后
+    auto newLines(int from, int to) -> void;
+    // m_end 之后是否还有要扫描的字符（在下一块或者还没有读入）
+    auto hasMoreInput() const -> bool;
+    // 流式扫描时丢掉 m_start 之前的字符，再读入至少一块，
+    // 扫描范围截到最后一个换行之后。没有更多输入时返回 false
+    auto refill() -> bool;
+
     std::string m_source;           // 输入流
+    std::string_view m_text;        // 被扫描的字符，通常就是 m_source
+    int m_end;                      // 扫描到这里为止
+    bool m_chunk = false;           // 是否只扫描并行扫描中的一块
+    int m_openString = -1;          // 见 Chunk
+    int m_openLine = 0;
+    int m_openLineStart = 0;
+    std::vector<ChunkError> m_errors; // 块的错误
+    std::istream *m_input = nullptr; // 流式扫描的输入
+    std::size_t m_block = kStreamBlock;
+    bool m_inputDone = false;
+    StringTable *m_strings;         // 字符串字面量的驻留表，可以为空
+    StringTable m_names; // 标识符和数字的词素，并行扫描时每块各有一张
+    ErrorReporter m_ownReporter;
+    ErrorReporter *m_reporter;
+    const ScanKernels *m_kernels = &ScanKernels::best();
     std::vector<TokenRef> m_tokens; // 序列
     int m_start = 0;                // 指向被扫描的string中的第一个字符
     int m_current = 0;              // 指向当前正在处理的字符
     int m_line = 1;                 // current所在源文件的行数
+    int m_lineStart = 0;            // 这一行第一个字符的位置，用来算列号
 };
 
 } // namespace lox
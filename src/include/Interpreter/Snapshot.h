@@ -0,0 +1,49 @@
+#pragma once
+
+#include "Environment.h"
+#include "Interpreter.h"
+#include "Program.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace lox {
+
+class Snapshot;
+using SnapshotRef = std::shared_ptr<const Snapshot>;
+
+// 某个 Isolate 在某一时刻冻结下来的堆：全局变量、类、实例和闭包环境。
+// 快照只读，可以被任意多个线程上的 Isolate 同时 fork；
+// fork 只新建一个建立在快照全局环境之上的空环境，耗时与堆的大小无关。
+// 被 fork 的 Isolate 对快照对象的修改都写在自己的副本上，不会泄漏回快照。
+//
+// 快照可以保存成与地址无关的文件：对象之间用下标互相引用，加载时先创建
+// 全部对象再按下标回填引用。函数引用 (程序, 函数声明下标)，文件中带着
+// 解析过变量的语法树，加载时把文件映射进来直接重建，不经过扫描、解析和
+// 变量解析，也不执行。
+class Snapshot {
+  public:
+    Snapshot(EnvironmentRef globals, Interpreter::Heap heap,
+             std::vector<ProgramRef> programs)
+        : m_globals(std::move(globals)), m_heap(std::move(heap)),
+          m_programs(std::move(programs)) {}
+    ~Snapshot();
+
+    // 文件无法写入时抛出 std::runtime_error
+    auto save(const std::string &path) const -> void;
+    // 文件无法读取或格式不对时抛出 std::runtime_error
+    static auto load(const std::string &path) -> SnapshotRef;
+
+    Snapshot(const Snapshot &) = delete;
+    auto operator=(const Snapshot &) -> Snapshot & = delete;
+
+    auto getGlobals() const -> const EnvironmentRef & { return m_globals; }
+    auto getHeap() const -> const Interpreter::Heap & { return m_heap; }
+
+  private:
+    EnvironmentRef m_globals;
+    Interpreter::Heap m_heap;
+    std::vector<ProgramRef> m_programs;
+};
+
+} // namespace lox
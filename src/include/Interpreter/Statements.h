@@ -2,7 +2,12 @@
 #include "Expression.h"
 #include "Object.h"
 #include "Token.h"
+#include <cstdint>
+#include <functional>
 #include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <utility>
 #include <vector>
 
 namespace lox {
@@ -18,6 +23,7 @@ class ForStmt;
 class FunStmt;
 class ReturnStmt;
 class ClassStmt;
+class ImportStmt;
 
 using StmtRef = std::shared_ptr<Stmt>;
 using ExpressionStmtRef = std::shared_ptr<ExpressionStmt>;
@@ -30,91 +36,98 @@ using ForStmtRef = std::shared_ptr<ForStmt>;
 using FunStmtRef = std::shared_ptr<FunStmt>;
 using ReturnStmtRef = std::shared_ptr<ReturnStmt>;
 using ClassStmtRef = std::shared_ptr<ClassStmt>;
-
-class StmtVisitor {
-  public:
-    virtual ~StmtVisitor() = default;
-    virtual void visitExpressionStmt(ExpressionStmtRef stmt) = 0;
-    virtual void visitPrintStmt(PrintStmtRef stmt) = 0;
-    virtual void visitVarStmt(VarStmtRef stmt) = 0;
-    virtual void visitBlockStmt(BlockStmtRef stmt) = 0;
-    virtual void visitIfStmt(IfStmtRef stmt) = 0;
-    virtual void visitWhileStmt(WhileStmtRef stmt) = 0;
-    virtual void visitFunStmt(FunStmtRef stmt) = 0;
-    virtual void visitReturnStmt(ReturnStmtRef stmt) = 0;
-    virtual void visitClassStmt(ClassStmtRef stmt) = 0;
+using ImportStmtRef = std::shared_ptr<ImportStmt>;
+
+// 语句节点的种类，用于静态分派（见 StmtVisitor）
+enum class StmtKind : std::uint8_t {
+    Expression,
+    Print,
+    Var,
+    Block,
+    If,
+    While,
+    Fun,
+    Return,
+    Class,
+    Import,
 };
-using StmtVistiorRef = std::shared_ptr<StmtVisitor>;
 
 class Stmt {
   public:
-    virtual void accept(StmtVistiorRef visitor) = 0;
     virtual ~Stmt() = default;
+
+    auto kind() const -> StmtKind { return m_kind; }
+
+  protected:
+    explicit Stmt(StmtKind kind) : m_kind(kind) {}
+
+  private:
+    StmtKind m_kind;
 };
 
-class ExpressionStmt : public Stmt,
-                       public std::enable_shared_from_this<ExpressionStmt> {
+class ExpressionStmt : public Stmt {
   public:
-    ExpressionStmt(AbstractExpressionRef<Object> expr) : m_expr(expr) {}
+    ExpressionStmt(AbstractExpressionRef<Object> expr)
+        : Stmt(StmtKind::Expression), m_expr(expr) {}
 
-    virtual void accept(StmtVistiorRef visitor) override;
-    auto getExpr() { return m_expr; }
+    auto getExpr() const -> const auto & { return m_expr; }
 
   private:
     AbstractExpressionRef<Object> m_expr;
 };
 
-class PrintStmt : public Stmt, public std::enable_shared_from_this<PrintStmt> {
+class PrintStmt : public Stmt {
   public:
-    PrintStmt(AbstractExpressionRef<Object> expr) : m_expr(expr) {}
+    PrintStmt(AbstractExpressionRef<Object> expr)
+        : Stmt(StmtKind::Print), m_expr(expr) {}
 
-    virtual void accept(StmtVistiorRef visitor) override;
-
-    auto getExpr() { return m_expr; }
+    auto getExpr() const -> const auto & { return m_expr; }
 
   private:
     AbstractExpressionRef<Object> m_expr;
 };
 
-class VarStmt : public Stmt, public std::enable_shared_from_this<VarStmt> {
+class VarStmt : public Stmt {
   public:
-    VarStmt(TokenRef name, AbstractExpressionRef<Object> initializer)
-        : m_name(name), m_initializer(initializer) {}
-
-    virtual void accept(StmtVistiorRef visitor) override;
+    VarStmt(SourceToken name, AbstractExpressionRef<Object> initializer)
+        : Stmt(StmtKind::Var), m_name(name), m_initializer(initializer) {}
 
-    auto getName() { return m_name; }
-    auto getInitExpr() { return m_initializer; }
+    auto getName() const -> const auto & { return m_name; }
+    auto getInitExpr() const -> const auto & { return m_initializer; }
 
   private:
-    TokenRef m_name;
+    SourceToken m_name;
     AbstractExpressionRef<Object> m_initializer;
 };
 
-class BlockStmt : public Stmt, public std::enable_shared_from_this<BlockStmt> {
+class BlockStmt : public Stmt {
   public:
-    BlockStmt(std::vector<StmtRef> statements) : m_statements(statements) {};
-
-    virtual void accept(StmtVistiorRef visitor) override;
+    BlockStmt(std::vector<StmtRef> statements)
+        : Stmt(StmtKind::Block), m_statements(statements) {};
 
-    auto getStmt() -> std::vector<StmtRef> { return m_statements; }
+    auto getStmt() const -> const auto & { return m_statements; }
 
   private:
     std::vector<StmtRef> m_statements;
 };
 
-class IfStmt : public Stmt, public std::enable_shared_from_this<IfStmt> {
+class IfStmt : public Stmt {
   public:
     IfStmt(AbstractExpressionRef<Object> condition, StmtRef thenBranch,
            StmtRef elseBranch)
-        : m_condition(condition), m_thenBranch(thenBranch),
+        : Stmt(StmtKind::If), m_condition(condition), m_thenBranch(thenBranch),
           m_elseBranch(elseBranch) {};
-
-    virtual void accept(StmtVistiorRef visitor) override;
-
-    auto getCondition() -> AbstractExpressionRef<Object> { return m_condition; }
-    auto getThen() { return m_thenBranch; }
-    auto getElse() { return m_elseBranch; }
+    // 很长的 else if 链逐个释放，不递归地析构
+    ~IfStmt() override {
+        auto next = std::move(m_elseBranch);
+        while (next != nullptr && next.use_count() == 1 &&
+               next->kind() == StmtKind::If)
+            next = std::move(static_cast<IfStmt &>(*next).m_elseBranch);
+    }
+
+    auto getCondition() const -> const auto & { return m_condition; }
+    auto getThen() const -> const auto & { return m_thenBranch; }
+    auto getElse() const -> const auto & { return m_elseBranch; }
 
   private:
     AbstractExpressionRef<Object> m_condition;
@@ -122,15 +135,13 @@ class IfStmt : public Stmt, public std::enable_shared_from_this<IfStmt> {
     StmtRef m_elseBranch;
 };
 
-class WhileStmt : public Stmt, public std::enable_shared_from_this<WhileStmt> {
+class WhileStmt : public Stmt {
   public:
     WhileStmt(AbstractExpressionRef<Object> condition, StmtRef body)
-        : m_condition(condition), m_body(body) {}
-
-    virtual void accept(StmtVistiorRef visitor) override;
+        : Stmt(StmtKind::While), m_condition(condition), m_body(body) {}
 
-    auto getCondition() -> AbstractExpressionRef<Object> { return m_condition; }
-    auto getBody() -> StmtRef { return m_body; }
+    auto getCondition() const -> const auto & { return m_condition; }
+    auto getBody() const -> const auto & { return m_body; }
 
   private:
     AbstractExpressionRef<Object> m_condition;
@@ -139,61 +150,130 @@ class WhileStmt : public Stmt, public std::enable_shared_from_this<WhileStmt> {
 
 class FunStmt : public Stmt, public std::enable_shared_from_this<FunStmt> {
   public:
-    FunStmt(TokenRef name, std::vector<TokenRef> params,
-            std::vector<StmtRef> body)
-        : m_name(name), m_params(params), m_body(body) {};
-    virtual void accept(StmtVistiorRef visitor) override;
+    // 解析并解析变量之后的函数体，出错时抛出 RuntimeError
+    using BodyParser = std::function<std::vector<StmtRef>(const FunStmt &)>;
 
-    auto getName() { return m_name; }
-    auto getParams() { return m_params; }
-    auto getBody() { return m_body; }
+    FunStmt(SourceToken name, std::vector<SourceToken> params,
+            std::vector<StmtRef> body)
+        : Stmt(StmtKind::Fun), m_name(name), m_params(params), m_body(body) {};
+    // 延迟解析的函数体：第一次 getBody 时才调用 parseBody。
+    // 同一个 Program 可能在多个线程上执行，只解析一次
+    FunStmt(SourceToken name, std::vector<SourceToken> params,
+            BodyParser parseBody)
+        : Stmt(StmtKind::Fun), m_name(name), m_params(params),
+          m_lazy(std::make_unique<LazyBody>()) {
+        m_lazy->parse = std::move(parseBody);
+    };
+
+    auto getName() const -> const auto & { return m_name; }
+    auto getParams() const -> const auto & { return m_params; }
+    auto getBody() const -> const std::vector<StmtRef> & {
+        if (m_lazy != nullptr) {
+            std::call_once(m_lazy->once, [this] {
+                m_body = m_lazy->parse(*this);
+                m_lazy->parse = nullptr; // 释放函数体的 token
+            });
+        }
+        return m_body;
+    }
+    // 函数体是否延迟解析（不论现在是否已经解析过）
+    auto isLazy() const -> bool { return m_lazy != nullptr; }
 
   private:
-    TokenRef m_name;
-    std::vector<TokenRef> m_params;
-    std::vector<StmtRef> m_body;
+    struct LazyBody {
+        std::once_flag once;
+        BodyParser parse;
+    };
+
+    SourceToken m_name;
+    std::vector<SourceToken> m_params;
+    mutable std::vector<StmtRef> m_body;
+    std::unique_ptr<LazyBody> m_lazy;
 };
 
-class ReturnStmt : public Stmt,
-                   public std::enable_shared_from_this<ReturnStmt> {
+class ReturnStmt : public Stmt {
   public:
-    ReturnStmt(TokenRef Keyword, AbstractExpressionRef<Object> value)
-        : m_keyword(Keyword), m_value(value) {};
-
-    virtual void accept(StmtVistiorRef visitor) override;
+    ReturnStmt(SourceToken Keyword, AbstractExpressionRef<Object> value)
+        : Stmt(StmtKind::Return), m_keyword(Keyword), m_value(value) {};
 
-    auto getValue() { return m_value; }
-    auto getKeyword() { return m_keyword; }
+    auto getValue() const -> const auto & { return m_value; }
+    auto getKeyword() const -> const auto & { return m_keyword; }
 
   private:
-    TokenRef m_keyword;
+    SourceToken m_keyword;
     AbstractExpressionRef<Object> m_value;
 };
 
-class ClassStmt : public Stmt, public std::enable_shared_from_this<ClassStmt> {
+class ClassStmt : public Stmt {
   public:
-    ClassStmt(TokenRef name, std::vector<FunStmtRef> methods)
-        : m_name(name), m_methods(methods) {};
+    ClassStmt(SourceToken name, std::vector<FunStmtRef> methods)
+        : Stmt(StmtKind::Class), m_name(name), m_methods(methods) {};
 
-    ClassStmt(TokenRef name, VariableExpressionRef<Object> superclass,
+    ClassStmt(SourceToken name, VariableExpressionRef<Object> superclass,
               std::vector<FunStmtRef> methods)
-        : m_name(name), m_methods(methods) {};
+        : Stmt(StmtKind::Class), m_name(name), m_superclass(superclass),
+          m_methods(methods) {};
 
-    virtual void accept(StmtVistiorRef visitor) override;
-
-    auto getName() { return m_name; }
-    auto getMethods() { return m_methods; }
-    auto getSuper() { return m_superclass; }
+    auto getName() const -> const auto & { return m_name; }
+    auto getMethods() const -> const auto & { return m_methods; }
+    auto getSuper() const -> const auto & { return m_superclass; }
 
   private:
-    TokenRef m_name;
+    SourceToken m_name;
     VariableExpressionRef<Object> m_superclass;
     std::vector<FunStmtRef> m_methods;
 };
 
-// class Stmt : public Stmt, public std::enable_shared_from_this<Stmt> {
-//   public:
-//   private:
-// };
+// import "path" [as name];
+// path 是解析时就确定下来的模块路径：相对路径按导入者所在的目录补全，
+// 主程序里的相对路径在运行时按解释器的模块根目录补全（见 Interpreter）。
+// name 是绑定模块对象的变量，没有 as 时取文件名去掉扩展名
+class ImportStmt : public Stmt, public std::enable_shared_from_this<ImportStmt> {
+  public:
+    ImportStmt(SourceToken keyword, std::string path, SourceToken name)
+        : Stmt(StmtKind::Import), m_keyword(keyword), m_path(std::move(path)),
+          m_name(name) {};
+
+    auto getKeyword() const -> const auto & { return m_keyword; }
+    auto getPath() const -> const auto & { return m_path; }
+    auto getName() const -> const auto & { return m_name; }
+
+  private:
+    SourceToken m_keyword;
+    std::string m_path;
+    SourceToken m_name;
+};
+
+// 静态分派的语句访问者（CRTP），与 ExprVisitor 相同
+template <class Derived, class Ret = void> class StmtVisitor {
+  public:
+    auto visitStmt(Stmt &stmt) -> Ret {
+        auto &self = static_cast<Derived &>(*this);
+        switch (stmt.kind()) {
+        case StmtKind::Expression:
+            return self.visitExpressionStmt(
+                static_cast<ExpressionStmt &>(stmt));
+        case StmtKind::Print:
+            return self.visitPrintStmt(static_cast<PrintStmt &>(stmt));
+        case StmtKind::Var:
+            return self.visitVarStmt(static_cast<VarStmt &>(stmt));
+        case StmtKind::Block:
+            return self.visitBlockStmt(static_cast<BlockStmt &>(stmt));
+        case StmtKind::If:
+            return self.visitIfStmt(static_cast<IfStmt &>(stmt));
+        case StmtKind::While:
+            return self.visitWhileStmt(static_cast<WhileStmt &>(stmt));
+        case StmtKind::Fun:
+            return self.visitFunStmt(static_cast<FunStmt &>(stmt));
+        case StmtKind::Return:
+            return self.visitReturnStmt(static_cast<ReturnStmt &>(stmt));
+        case StmtKind::Class:
+            return self.visitClassStmt(static_cast<ClassStmt &>(stmt));
+        case StmtKind::Import:
+            return self.visitImportStmt(static_cast<ImportStmt &>(stmt));
+        }
+        throw std::logic_error("StmtVisitor: unknown statement kind");
+    }
+};
 
 } // namespace lox
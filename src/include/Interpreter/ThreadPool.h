@@ -0,0 +1,62 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace lox {
+
+// 固定大小的工作窃取线程池。
+// 每个工作线程有自己的任务队列，从队尾取自己的任务；
+// 自己的队列空了就从其他线程队列的队头偷任务。
+// 提交和完成任务只更新原子计数，互斥锁只用于工作线程的睡眠和唤醒。
+class ThreadPool {
+  public:
+    // threads 为 0 时使用硬件线程数
+    explicit ThreadPool(std::size_t threads = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    auto operator=(const ThreadPool &) -> ThreadPool & = delete;
+
+    auto submit(std::function<void()> task) -> void;
+    // 阻塞直到所有已提交的任务执行完。
+    // 任务抛出的异常在这里重新抛出，有多个时只保留第一个
+    auto wait() -> void;
+    auto size() const -> std::size_t { return m_queues.size(); }
+
+  private:
+    struct WorkQueue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    auto workerLoop(std::size_t index) -> void;
+    auto popLocal(std::size_t index, std::function<void()> &task) -> bool;
+    auto steal(std::size_t thief, std::function<void()> &task) -> bool;
+    // 占一个排队任务的名额，成功后一定能从某个队列里取到任务
+    auto claim() -> bool;
+
+    std::vector<std::unique_ptr<WorkQueue>> m_queues;
+    std::vector<std::thread> m_workers;
+    std::atomic<std::size_t> m_nextQueue{0};
+
+    std::atomic<std::size_t> m_queued{0};     // 已提交但还没被取走的任务
+    std::atomic<std::size_t> m_unfinished{0}; // 已提交但还没执行完的任务
+    std::atomic<std::size_t> m_sleeping{0};   // 正在等任务的工作线程
+
+    std::mutex m_mutex;
+    std::condition_variable m_workAvailable;
+    std::condition_variable m_idle;
+    std::exception_ptr m_error; // 第一个任务抛出的异常，由 m_mutex 保护
+    bool m_stop = false;
+};
+
+} // namespace lox
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "LoxString.h"
 #include "Object.h"
 #include "Tokentype.h"
 #include <memory>
@@ -7,27 +8,70 @@
 namespace lox {
 
 class Token;
+class SourceToken;
 using TokenRef = std::shared_ptr<Token>;
 
+// 扫描器产生的 token。token 不保存能推出来的东西：符号和关键字的词素
+// 由种类决定，字符串的词素由字面量加上引号得到，只有标识符和数字保存词素
+// （扫描器把同名的标识符驻留成同一个 LoxString）；
+// 只有 NUMBER 和 STRING 有字面量。
+// 语法树不引用 Token，而是复制成 SourceToken，解析完之后 token 流就释放了
 class Token {
   public:
-    Token(TokenType type, std::string lexeme, ObjectRef literal, int line) {
-        m_lexeme = lexeme;
-        m_type = type;
-        m_line = line;
-        m_literal = literal;
-    }
-    auto toString() -> std::string;
-    auto getType() -> TokenType;
-    auto getLine() -> int;
-    auto getLiteral() -> ObjectRef;
-    auto getLexeme() -> std::string;
+    // column 是词素第一个字节在行内的位置，从 1 开始；0 表示不知道
+    Token(TokenType type, LoxStringRef text, ObjectRef literal, int line,
+          int column = 0);
+    Token(TokenType type, const std::string &lexeme, ObjectRef literal,
+          int line, int column = 0);
+    auto toString() const -> std::string;
+    auto getType() const -> TokenType;
+    auto getLine() const -> int;
+    auto getColumn() const -> int { return m_column; }
+    // 前面插入或者删除了行之后移动 token（见 Document）
+    auto shiftLine(int delta) -> void { m_line += delta; }
+    // 没有字面量时为空
+    auto getLiteral() const -> ObjectRef;
+    auto getLexeme() const -> std::string;
 
   private:
-    TokenType m_type;     // token 种类
-    std::string m_lexeme; // 词素，源代码的原始字符串
-    ObjectRef m_literal;  // 子面量
-    int m_line;           // 行号
+    friend class SourceToken;
+
+    LoxStringRef m_text; // 标识符和数字的词素
+    ObjectRef m_literal; // 字面量
+    TokenType m_type;    // token 种类
+    int m_line;          // 行号
+    int m_column;        // 列号
+};
+
+// 语法树、字节码和运行时错误里的 token，只用来报告名字和位置：
+// 种类、行列号和驻留的词素，按值保存，不带字面量。
+// 字符串的词素在转换时拼出来，其余与 Token 相同。
+// 默认构造的是没有名字的 EOF_TOKEN，表示“没有 token”
+class SourceToken {
+  public:
+    SourceToken() = default;
+    // 解析器把 Token 直接传给语法树节点，所以允许隐式转换
+    SourceToken(const Token &token);
+    SourceToken(const TokenRef &token) : SourceToken(*token) {}
+    // text 是驻留的词素，拼写固定的 token 为 nullptr（见 Snapshot::load）
+    SourceToken(TokenType type, LoxStringRef text, int line, int column)
+        : m_text(std::move(text)), m_type(type), m_line(line),
+          m_column(column) {}
+
+    auto getType() const -> TokenType { return m_type; }
+    auto getLine() const -> int { return m_line; }
+    auto getColumn() const -> int { return m_column; }
+    auto getLexeme() const -> std::string;
+    // 驻留的词素，符号和关键字是 nullptr
+    auto getText() const -> const LoxStringRef & { return m_text; }
+    // 前面插入或者删除了行之后移动 token（见 Document）
+    auto shiftLine(int delta) -> void { m_line += delta; }
+
+  private:
+    LoxStringRef m_text;
+    TokenType m_type = EOF_TOKEN;
+    int m_line = 0;
+    int m_column = 0;
 };
 
 } // namespace lox
@@ -1,130 +1,220 @@
 #pragma once
-#include "tools/enum2string.h"
+#include <cstddef>
+#include <string_view>
 
 namespace lox {
 
+#define LOX_TOKEN_TYPES(X)                                                     \
+    X(LEFT_PAREN)                                                              \
+    X(RIGHT_PAREN)                                                             \
+    X(LEFT_BRACE)                                                              \
+    X(RIGHT_BRACE)                                                             \
+    X(COMMA)                                                                   \
+    X(DOT)                                                                     \
+    X(MINUS)                                                                   \
+    X(PLUS)                                                                    \
+    X(SEMICOLON)                                                               \
+    X(SLASH)                                                                   \
+    X(STAR)                                                                    \
+    X(BANG)                                                                    \
+    X(BANG_EQUAL)                                                              \
+    X(EQUAL)                                                                   \
+    X(EQUAL_EQUAL)                                                             \
+    X(GREATER)                                                                 \
+    X(GREATER_EQUAL)                                                           \
+    X(LESS)                                                                    \
+    X(LESS_EQUAL)                                                              \
+    X(IDENTIFIER)                                                              \
+    X(STRING)                                                                  \
+    X(NUMBER)                                                                  \
+    X(AND)                                                                     \
+    X(CLASS)                                                                   \
+    X(ELSE)                                                                    \
+    X(FALSE)                                                                   \
+    X(FUN)                                                                     \
+    X(FOR)                                                                     \
+    X(IF)                                                                      \
+    X(IMPORT)                                                                  \
+    X(NIL)                                                                     \
+    X(OR)                                                                      \
+    X(PRINT)                                                                   \
+    X(RETURN)                                                                  \
+    X(SUPER)                                                                   \
+    X(THIS)                                                                    \
+    X(TRUE)                                                                    \
+    X(VAR)                                                                     \
+    X(WHILE)                                                                   \
+    X(EOF_TOKEN)
+
 enum TokenType {
-    LEFT_PAREN,
-    RIGHT_PAREN,
-    LEFT_BRACE,
-    RIGHT_BRACE,
-    COMMA,
-    DOT,
-    MINUS,
-    PLUS,
-    SEMICOLON,
-    SLASH,
-    STAR,
-    BANG,
-    BANG_EQUAL,
-    EQUAL,
-    EQUAL_EQUAL,
-    GREATER,
-    GREATER_EQUAL,
-    LESS,
-    LESS_EQUAL,
-    IDENTIFIER,
-    STRING,
-    NUMBER,
-    AND,
-    CLASS,
-    ELSE,
-    FALSE,
-    FUN,
-    FOR,
-    IF,
-    NIL,
-    OR,
-    PRINT,
-    RETURN,
-    SUPER,
-    THIS,
-    TRUE,
-    VAR,
-    WHILE,
-    EOF_TOKEN
+#define LOX_TOKEN_TYPE_ENUM(name) name,
+    LOX_TOKEN_TYPES(LOX_TOKEN_TYPE_ENUM)
+#undef LOX_TOKEN_TYPE_ENUM
+};
+
+// 按 TokenType 下标排列的名字，如 LEFT_PAREN -> "LEFT_PAREN"
+inline constexpr std::string_view kTokenTypeNames[] = {
+#define LOX_TOKEN_TYPE_NAME(name) #name,
+    LOX_TOKEN_TYPES(LOX_TOKEN_TYPE_NAME)
+#undef LOX_TOKEN_TYPE_NAME
 };
 
-static std::unordered_map<TokenType, std::string> tokenTypeToString = {
-    {LEFT_PAREN, "LEFT_PAREN"},
-    {RIGHT_PAREN, "RIGHT_PAREN"},
-    {LEFT_BRACE, "LEFT_BRACE"},
-    {RIGHT_BRACE, "RIGHT_BRACE"},
-    {COMMA, "COMMA"},
-    {DOT, "DOT"},
-    {MINUS, "MINUS"},
-    {PLUS, "PLUS"},
-    {SEMICOLON, "SEMICOLON"},
-    {SLASH, "SLASH"},
-    {STAR, "STAR"},
-    {BANG, "BANG"},
-    {BANG_EQUAL, "BANG_EQUAL"},
-    {EQUAL, "EQUAL"},
-    {EQUAL_EQUAL, "EQUAL_EQUAL"},
-    {GREATER, "GREATER"},
-    {GREATER_EQUAL, "GREATER_EQUAL"},
-    {LESS, "LESS"},
-    {LESS_EQUAL, "LESS_EQUAL"},
-    {IDENTIFIER, "IDENTIFIER"},
-    {STRING, "STRING"},
-    {NUMBER, "NUMBER"},
-    {AND, "AND"},
-    {CLASS, "CLASS"},
-    {ELSE, "ELSE"},
-    {FALSE, "FALSE"},
-    {FUN, "FUN"},
-    {FOR, "FOR"},
-    {IF, "IF"},
-    {NIL, "NIL"},
-    {OR, "OR"},
-    {PRINT, "PRINT"},
-    {RETURN, "RETURN"},
-    {SUPER, "SUPER"},
-    {THIS, "THIS"},
-    {TRUE, "TRUE"},
-    {VAR, "VAR"},
-    {WHILE, "WHILE"},
-    {EOF_TOKEN, "EOF_TOKEN"}};
+constexpr auto tokenTypeName(TokenType type) -> std::string_view {
+    auto index = static_cast<std::size_t>(type);
+    return index < std::size(kTokenTypeNames) ? kTokenTypeNames[index]
+                                              : "UNKNOWN";
+}
+
+// 拼写固定的 token（符号和关键字）的词素，其余的（标识符、字面量、
+// EOF_TOKEN）返回空串，词素要另外保存
+constexpr auto tokenSpelling(TokenType type) -> std::string_view {
+    switch (type) {
+    case LEFT_PAREN:
+        return "(";
+    case RIGHT_PAREN:
+        return ")";
+    case LEFT_BRACE:
+        return "{";
+    case RIGHT_BRACE:
+        return "}";
+    case COMMA:
+        return ",";
+    case DOT:
+        return ".";
+    case MINUS:
+        return "-";
+    case PLUS:
+        return "+";
+    case SEMICOLON:
+        return ";";
+    case SLASH:
+        return "/";
+    case STAR:
+        return "*";
+    case BANG:
+        return "!";
+    case BANG_EQUAL:
+        return "!=";
+    case EQUAL:
+        return "=";
+    case EQUAL_EQUAL:
+        return "==";
+    case GREATER:
+        return ">";
+    case GREATER_EQUAL:
+        return ">=";
+    case LESS:
+        return "<";
+    case LESS_EQUAL:
+        return "<=";
+    case AND:
+        return "and";
+    case CLASS:
+        return "class";
+    case ELSE:
+        return "else";
+    case FALSE:
+        return "false";
+    case FUN:
+        return "fun";
+    case FOR:
+        return "for";
+    case IF:
+        return "if";
+    case IMPORT:
+        return "import";
+    case NIL:
+        return "nil";
+    case OR:
+        return "or";
+    case PRINT:
+        return "print";
+    case RETURN:
+        return "return";
+    case SUPER:
+        return "super";
+    case THIS:
+        return "this";
+    case TRUE:
+        return "true";
+    case VAR:
+        return "var";
+    case WHILE:
+        return "while";
+    default:
+        return "";
+    }
+}
+
+namespace detail {
+
+// text 从 start 开始的部分正好是 rest 时是关键字 type
+constexpr auto checkKeyword(std::string_view text, std::size_t start,
+                            std::string_view rest, TokenType type)
+    -> TokenType {
+    return text.size() == start + rest.size() && text.substr(start) == rest
+               ? type
+               : IDENTIFIER;
+}
+
+} // namespace detail
+
+// 标识符是关键字时返回对应的种类，否则返回 IDENTIFIER。
+// 按首字母（有共同首字母时再按第二个字母）分支，最多比较一次剩下的字符，
+// 不分配内存，也不计算哈希
+constexpr auto keywordType(std::string_view text) -> TokenType {
+    using detail::checkKeyword;
+    if (text.size() < 2)
+        return IDENTIFIER;
+    switch (text[0]) {
+    case 'a':
+        return checkKeyword(text, 1, "nd", AND);
+    case 'c':
+        return checkKeyword(text, 1, "lass", CLASS);
+    case 'e':
+        return checkKeyword(text, 1, "lse", ELSE);
+    case 'f':
+        switch (text[1]) {
+        case 'a':
+            return checkKeyword(text, 2, "lse", FALSE);
+        case 'o':
+            return checkKeyword(text, 2, "r", FOR);
+        case 'u':
+            return checkKeyword(text, 2, "n", FUN);
+        }
+        return IDENTIFIER;
+    case 'i':
+        switch (text[1]) {
+        case 'f':
+            return checkKeyword(text, 2, "", IF);
+        case 'm':
+            return checkKeyword(text, 2, "port", IMPORT);
+        }
+        return IDENTIFIER;
+    case 'n':
+        return checkKeyword(text, 1, "il", NIL);
+    case 'o':
+        return checkKeyword(text, 1, "r", OR);
+    case 'p':
+        return checkKeyword(text, 1, "rint", PRINT);
+    case 'r':
+        return checkKeyword(text, 1, "eturn", RETURN);
+    case 's':
+        return checkKeyword(text, 1, "uper", SUPER);
+    case 't':
+        switch (text[1]) {
+        case 'h':
+            return checkKeyword(text, 2, "is", THIS);
+        case 'r':
+            return checkKeyword(text, 2, "ue", TRUE);
+        }
+        return IDENTIFIER;
+    case 'v':
+        return checkKeyword(text, 1, "ar", VAR);
+    case 'w':
+        return checkKeyword(text, 1, "hile", WHILE);
+    }
+    return IDENTIFIER;
+}
 
-// String to TokenType map
-static std::unordered_map<std::string, TokenType> stringToTokenType = {
-    {"LEFT_PAREN", LEFT_PAREN},
-    {"RIGHT_PAREN", RIGHT_PAREN},
-    {"LEFT_BRACE", LEFT_BRACE},
-    {"RIGHT_BRACE", RIGHT_BRACE},
-    {"COMMA", COMMA},
-    {"DOT", DOT},
-    {"MINUS", MINUS},
-    {"PLUS", PLUS},
-    {"SEMICOLON", SEMICOLON},
-    {"SLASH", SLASH},
-    {"STAR", STAR},
-    {"BANG", BANG},
-    {"BANG_EQUAL", BANG_EQUAL},
-    {"EQUAL", EQUAL},
-    {"EQUAL_EQUAL", EQUAL_EQUAL},
-    {"GREATER", GREATER},
-    {"GREATER_EQUAL", GREATER_EQUAL},
-    {"LESS", LESS},
-    {"LESS_EQUAL", LESS_EQUAL},
-    {"IDENTIFIER", IDENTIFIER},
-    {"STRING", STRING},
-    {"NUMBER", NUMBER},
-    {"AND", AND},
-    {"CLASS", CLASS},
-    {"ELSE", ELSE},
-    {"FALSE", FALSE},
-    {"FUN", FUN},
-    {"FOR", FOR},
-    {"IF", IF},
-    {"NIL", NIL},
-    {"OR", OR},
-    {"PRINT", PRINT},
-    {"RETURN", RETURN},
-    {"SUPER", SUPER},
-    {"THIS", THIS},
-    {"TRUE", TRUE},
-    {"VAR", VAR},
-    {"WHILE", WHILE},
-    {"EOF_TOKEN", EOF_TOKEN}};
 } // namespace lox
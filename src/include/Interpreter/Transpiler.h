@@ -0,0 +1,36 @@
+#pragma once
+
+#include "Program.h"
+#include <string>
+
+namespace lox {
+
+// 预先（AOT）编译：把解析和作用域解析之后的程序翻译成 C++ 源码，
+// 链接 Runtime/Runtime.h 中的运行时库，再用系统的 C++ 编译器
+// 编译成独立的可执行文件或者可以被宿主程序加载的共享库。
+//
+// 局部变量翻译成 C++ 局部变量，只有被内层函数捕获的变量才放进堆上的
+// Cell；函数翻译成 lambda，全局变量按名字晚绑定。生成的程序与解释器的
+// 输出、运行时错误信息和退出码（运行时错误为 70）一致。
+class Transpiler {
+  public:
+    enum class Output {
+        Executable,   // 独立的可执行文件
+        SharedObject, // 导出 extern "C" int lox_main() 的共享库
+    };
+
+    // 把程序翻译成一个完整的 C++ 翻译单元。
+    // 模块在运行时才加载，程序里有 import 时抛出 std::runtime_error
+    static auto translate(const Program &program) -> std::string;
+
+    // 调用系统编译器（默认 c++，可用环境变量 LOX_CXX 指定）生成 output。
+    // 失败时返回 false，编译器的输出写入 errors
+    static auto build(const std::string &source, const std::string &output,
+                      Output kind, std::string &errors) -> bool;
+
+    // 加载 build 生成的共享库并运行其中的程序，返回程序的退出码。
+    // 无法加载时抛出 std::runtime_error
+    static auto runShared(const std::string &path) -> int;
+};
+
+} // namespace lox
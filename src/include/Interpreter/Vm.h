@@ -0,0 +1,106 @@
+#pragma once
+
+#include "Bytecode.h"
+#include "Environment.h"
+#include "Object.h"
+#include "Token.h"
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <vector>
+
+namespace lox {
+
+class Interpreter;
+class LoxFunction;
+using LoxFunctionRef = std::shared_ptr<LoxFunction>;
+
+// 字节码虚拟机。
+//
+// 在 GCC/Clang 上用 computed goto 做直接线索化分派：编译器把每条指令
+// 处理代码的地址写进指令，执行完一条指令后直接跳到下一条的处理代码，
+// 每条指令都有自己的间接跳转，分支预测器可以按指令对学习。
+// 其他编译器（或定义了 LOX_VM_SWITCH_DISPATCH）时退化成 switch 分派。
+// 两种分派共用同一份指令实现，可以用 setThreaded 在运行时切换以便比较。
+//
+// 局部变量、函数、类和实例与解释器共用同一套运行时对象，
+// 字节码函数可以和按 AST 执行的函数互相调用，快照和 JIT 照常工作。
+// 每个 Interpreter 持有一个 Vm，操作数栈在嵌套调用之间复用。
+//
+// 字节码函数调用字节码函数时不递归进入 execute：调用者的状态保存在
+// 堆上的帧栈里，在同一个分派循环中接着执行被调用者，返回时再恢复。
+// 这样的递归不占用原生栈，深度只受 Interpreter 的最大调用深度限制；
+// 尾调用直接替换当前帧。
+class Vm {
+  public:
+    explicit Vm(Interpreter &interpreter) : m_interpreter(&interpreter) {}
+
+    Vm(const Vm &) = delete;
+    auto operator=(const Vm &) -> Vm & = delete;
+
+    // 直接线索化分派是否可用
+    static auto hasThreadedDispatch() -> bool;
+    // 每种指令处理代码的地址，按 OpCode 排列；不可用时返回 nullptr
+    static auto dispatchTable() -> const void *const *;
+
+    auto setThreaded(bool threaded) -> void {
+        m_threaded = threaded && hasThreadedDispatch();
+    }
+    auto isThreaded() const -> bool { return m_threaded; }
+    auto setSuperinstructions(bool enabled) -> void {
+        m_superinstructions = enabled;
+    }
+    auto superinstructions() const -> bool { return m_superinstructions; }
+
+    // 在 env 中执行 chunk。执行了 return 时返回 true，返回值写入 result
+    auto run(const Chunk &chunk, EnvironmentRef env, Object &result) -> bool;
+
+  private:
+    // 一次字节码函数调用（或入口 chunk）的执行状态
+    struct Frame {
+        const Chunk *chunk;
+        // 调用其他函数时保存返回后继续执行的指令，以及放返回值的栈顶
+        const Instruction *ip;
+        Object *sp;
+        Object *stack; // 这一帧操作数栈的起点
+        EnvironmentRef env;
+        LoxFunctionRef function; // 入口帧为空，由调用者负责初始化方法的返回值
+    };
+
+    template <bool Threaded>
+    static auto execute(Vm *vm, Frame *entry, Object *result,
+                        const void *const **table) -> bool;
+
+    // [被调用者 参数...] -> [返回值]；name 不为空时先从被调用者上取出这个方法。
+    // 被调用者是字节码函数时压入（尾调用时替换）帧并返回 true，
+    // 否则就地完成调用，返回 false
+    template <bool Tail>
+    auto call(Frame *frame, const Frame *entry, const Instruction *ip,
+              Object *sp, const SourceToken *name) -> bool;
+    // 当前帧执行 return，value 为空时是执行到了末尾。
+    // 入口帧把返回值写入 result 并返回 true；其余的帧出栈，返回值交给调用者
+    auto leave(const Frame *entry, Object *value, Object *result) -> bool;
+    // 出错时弹出 entry 及其之上的帧
+    auto unwind(const Frame *entry) -> void;
+
+    // 操作数栈按段分配，嵌套调用按后进先出的顺序占用和归还
+    struct Segment {
+        std::unique_ptr<Object[]> slots;
+        std::size_t size = 0;
+        std::size_t used = 0;
+    };
+    static constexpr std::size_t kSegmentSize = 4096;
+
+    auto acquire(std::size_t count) -> Object *;
+    auto release(std::size_t count) -> void;
+
+    Interpreter *m_interpreter;
+    bool m_threaded = hasThreadedDispatch();
+    bool m_superinstructions = true;
+    std::vector<Segment> m_segments;
+    std::size_t m_current = 0;
+    // deque 保证嵌套的 run 压入新帧时，已有帧的地址不变
+    std::deque<Frame> m_frames;
+};
+
+} // namespace lox
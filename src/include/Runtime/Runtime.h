@@ -0,0 +1,303 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+// 预先编译（AOT）的 Lox 程序使用的运行时库。
+//
+// Transpiler 把解析好的 AST 翻译成调用这里的 C++ 代码，再由系统的 C++
+// 编译器编译成独立的可执行文件或共享库。值、类、闭包、错误信息和输出格式
+// 都与解释器保持一致，同一个程序两种方式执行的输出相同。
+//
+// 这个库不依赖解释器，生成的程序只需要链接 liblox_runtime。
+namespace lox::runtime {
+
+class Value;
+class String;
+class Function;
+class Class;
+class Instance;
+
+using FunctionRef = std::shared_ptr<Function>;
+using ClassRef = std::shared_ptr<Class>;
+using InstanceRef = std::shared_ptr<Instance>;
+// 被闭包捕获的局部变量放在堆上的格子里，内外两层函数共享同一个格子
+using Cell = std::shared_ptr<Value>;
+
+// 运行时错误，对应解释器的 RuntimeError
+class RuntimeError : public std::exception {
+  public:
+    RuntimeError(std::string message, int line)
+        : m_message(std::move(message)), m_line(line) {}
+
+    auto getLine() const -> int { return m_line; }
+    const char *what() const noexcept override { return m_message.c_str(); }
+
+  private:
+    std::string m_message;
+    int m_line;
+};
+
+[[noreturn]] auto error(const std::string &message, int line) -> void;
+
+// 所有堆上对象的基类
+class HeapObject {
+  public:
+    virtual ~HeapObject() = default;
+};
+
+class Value {
+  public:
+    enum class Type : std::uint8_t {
+        Nil,
+        Bool,
+        Number,
+        String,
+        Function,
+        Class,
+        Instance,
+    };
+
+    Value() = default;
+    explicit Value(bool boolean) : m_type(Type::Bool), m_bool(boolean) {}
+    explicit Value(double number) : m_type(Type::Number), m_number(number) {}
+    explicit Value(FunctionRef function);
+    explicit Value(ClassRef klass);
+    explicit Value(InstanceRef instance);
+
+    static auto string(std::string text) -> Value;
+
+    auto getType() const -> Type { return m_type; }
+    auto isNumber() const -> bool { return m_type == Type::Number; }
+    auto asBool() const -> bool { return m_bool; }
+    auto asNumber() const -> double { return m_number; }
+    auto asString() const -> const std::string &;
+    auto asFunction() const -> Function *;
+    auto asClass() const -> ClassRef;
+    auto asInstance() const -> Instance *;
+    auto getObject() const -> const std::shared_ptr<HeapObject> & {
+        return m_object;
+    }
+
+    auto toString() const -> std::string;
+
+  private:
+    Type m_type = Type::Nil;
+    union {
+        bool m_bool;
+        double m_number = 0;
+    };
+    std::shared_ptr<HeapObject> m_object;
+};
+
+class String : public HeapObject {
+  public:
+    explicit String(std::string text) : m_text(std::move(text)) {}
+    auto getText() const -> const std::string & { return m_text; }
+
+  private:
+    std::string m_text;
+};
+
+// 函数体是一段编译好的代码；方法绑定到实例时共享代码，只替换 self
+class Function : public HeapObject {
+  public:
+    using Code = std::function<Value(const Value &self, Value *args)>;
+
+    Function(std::string name, int arity, bool initializer,
+             std::shared_ptr<const Code> code, Value self = Value())
+        : m_name(std::move(name)), m_arity(arity), m_initializer(initializer),
+          m_code(std::move(code)), m_self(std::move(self)) {}
+
+    auto getName() const -> const std::string & { return m_name; }
+    auto arity() const -> int { return m_arity; }
+    auto bind(const Value &instance) const -> FunctionRef;
+    auto call(Value *args) const -> Value { return (*m_code)(m_self, args); }
+
+  private:
+    std::string m_name;
+    int m_arity;
+    bool m_initializer;
+    std::shared_ptr<const Code> m_code;
+    Value m_self;
+};
+
+class Class : public HeapObject {
+  public:
+    Class(std::string name, ClassRef superclass)
+        : m_name(std::move(name)), m_superclass(std::move(superclass)) {}
+
+    auto getName() const -> const std::string & { return m_name; }
+    auto addMethod(const std::string &name, const Value &method) -> void {
+        m_methods[name] = std::static_pointer_cast<Function>(method.getObject());
+    }
+    auto findMethod(const std::string &name) const -> Function *;
+    auto arity() const -> int;
+
+  private:
+    std::string m_name;
+    ClassRef m_superclass;
+    std::unordered_map<std::string, FunctionRef> m_methods;
+};
+
+class Instance : public HeapObject {
+  public:
+    explicit Instance(ClassRef klass) : m_class(std::move(klass)) {}
+
+    auto getClass() const -> const ClassRef & { return m_class; }
+    auto get(const Value &self, const std::string &name, int line) const
+        -> Value;
+    auto set(const std::string &name, Value value) -> void {
+        m_fields[name] = std::move(value);
+    }
+
+  private:
+    ClassRef m_class;
+    std::unordered_map<std::string, Value> m_fields;
+};
+
+// 全局变量按名字晚绑定：函数可以引用在它之后才定义的全局变量
+class Global {
+  public:
+    explicit Global(const char *name) : m_name(name) {}
+
+    auto get(int line) const -> const Value & {
+        if (!m_defined)
+            undefined(line);
+        return m_value;
+    }
+    auto define(Value value) -> void {
+        m_value = std::move(value);
+        m_defined = true;
+    }
+    auto assign(Value value, int line) -> const Value & {
+        if (!m_defined)
+            undefined(line);
+        m_value = std::move(value);
+        return m_value;
+    }
+    // 共享库可能被多次运行，每次运行前清空全局变量
+    auto reset() -> void {
+        m_value = Value();
+        m_defined = false;
+    }
+
+  private:
+    [[noreturn]] auto undefined(int line) const -> void;
+
+    const char *m_name;
+    Value m_value;
+    bool m_defined = false;
+};
+
+inline auto makeCell(Value value = Value()) -> Cell {
+    return std::make_shared<Value>(std::move(value));
+}
+
+inline auto makeFunction(std::string name, int arity, bool initializer,
+                         Function::Code code) -> Value {
+    return Value(std::make_shared<Function>(
+        std::move(name), arity, initializer,
+        std::make_shared<const Function::Code>(std::move(code))));
+}
+
+auto makeClass(std::string name, const Value &superclass, int line) -> ClassRef;
+
+inline auto truthy(const Value &value) -> bool {
+    switch (value.getType()) {
+    case Value::Type::Nil:
+        return false;
+    case Value::Type::Bool:
+        return value.asBool();
+    default:
+        return true;
+    }
+}
+
+auto equal(const Value &left, const Value &right) -> bool;
+
+// 二元运算的两个操作数用花括号传入，保证按从左到右的顺序求值
+using Operands = Value[2];
+
+[[noreturn]] auto numberOperandError(int line) -> void;
+auto addSlow(const Operands &operands, int line) -> Value;
+
+inline auto add(const Operands &operands, int line) -> Value {
+    if (operands[0].isNumber() && operands[1].isNumber())
+        return Value(operands[0].asNumber() + operands[1].asNumber());
+    return addSlow(operands, line);
+}
+
+#define LOX_RUNTIME_NUMBER_OP(name, op, Result)                                \
+    inline auto name(const Operands &operands, int line) -> Value {            \
+        if (!operands[0].isNumber() || !operands[1].isNumber())                \
+            numberOperandError(line);                                          \
+        return Value(static_cast<Result>(operands[0].asNumber() op             \
+                                         operands[1].asNumber()));             \
+    }
+
+LOX_RUNTIME_NUMBER_OP(subtract, -, double)
+LOX_RUNTIME_NUMBER_OP(multiply, *, double)
+LOX_RUNTIME_NUMBER_OP(divide, /, double)
+LOX_RUNTIME_NUMBER_OP(less, <, bool)
+LOX_RUNTIME_NUMBER_OP(lessEqual, <=, bool)
+LOX_RUNTIME_NUMBER_OP(greater, >, bool)
+LOX_RUNTIME_NUMBER_OP(greaterEqual, >=, bool)
+
+#undef LOX_RUNTIME_NUMBER_OP
+
+inline auto equalOp(const Operands &operands) -> Value {
+    return Value(equal(operands[0], operands[1]));
+}
+inline auto notEqualOp(const Operands &operands) -> Value {
+    return Value(!equal(operands[0], operands[1]));
+}
+
+inline auto negate(const Value &operand, int line) -> Value {
+    if (!operand.isNumber())
+        numberOperandError(line);
+    return Value(-operand.asNumber());
+}
+
+// Lox 调用的最大嵌套深度，默认与解释器相同（见 Interpreter::setMaxCallDepth）。
+// 超过时报告 "Stack overflow."；原生栈快要用完时也一样
+auto getMaxCallDepth() -> std::size_t;
+auto setMaxCallDepth(std::size_t depth) -> void;
+
+// 调用 callee(args...)，values[0] 是被调用者，其余是参数
+auto callValue(const Value &callee, Value *args, std::size_t argc, int line)
+    -> Value;
+
+// 尾位置上的调用。被调用者是 Lox 函数时只做同样的检查，记下这次调用并
+// 返回 nil，由正在返回的 callValue 取走后在同一个原生栈帧里接着执行
+// （见 Interpreter::tailCall）；其余的可调用对象照常调用
+auto tailCallValue(const Value &callee, Value *args, std::size_t argc,
+                   int line) -> Value;
+
+template <std::size_t N>
+inline auto call(Value (&&values)[N], int line) -> Value {
+    return callValue(values[0], values + 1, N - 1, line);
+}
+
+template <std::size_t N>
+inline auto tailCall(Value (&&values)[N], int line) -> Value {
+    return tailCallValue(values[0], values + 1, N - 1, line);
+}
+
+auto getProperty(const Value &object, const std::string &name, int line)
+    -> Value;
+auto requireInstance(const Value &object, int line) -> Instance &;
+auto superMethod(const Value &superclass, const Value &self,
+                 const std::string &name, int line) -> Value;
+
+auto print(const Value &value) -> void;
+
+// 执行生成的程序。运行时错误按解释器的格式写到标准错误，返回 70
+auto runProgram(void (*program)()) -> int;
+
+} // namespace lox::runtime
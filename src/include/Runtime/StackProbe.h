@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#ifdef __linux__
+#include <pthread.h>
+#endif
+
+// 原生栈的余量检查，解释器和 AOT 运行时共用。
+// 只有头文件，生成的程序仍然只需要链接 liblox_runtime。
+namespace lox {
+
+// Lox 调用默认的最大嵌套深度
+inline constexpr std::size_t kDefaultMaxCallDepth = 100000;
+
+// 一层 Lox 调用之内（求值嵌套的表达式、抛出错误等）最多用到的原生栈。
+// 未优化、带 sanitizer 的构建里栈帧要大得多，这里留得比较宽裕
+inline constexpr std::uintptr_t kStackReserve = 256 * 1024;
+
+// 当前线程的原生栈低于这个地址时就算用完了；拿不到栈的范围时为 0，不做检查
+inline auto stackLimit() -> std::uintptr_t {
+    thread_local const std::uintptr_t limit = [] {
+        std::uintptr_t low = 0;
+#ifdef __linux__
+        pthread_attr_t attr;
+        if (pthread_getattr_np(pthread_self(), &attr) == 0) {
+            void *address = nullptr;
+            std::size_t size = 0;
+            if (pthread_attr_getstack(&attr, &address, &size) == 0 &&
+                size > kStackReserve) {
+                low = reinterpret_cast<std::uintptr_t>(address) + kStackReserve;
+            }
+            pthread_attr_destroy(&attr);
+        }
+#endif
+        return low;
+    }();
+    return limit;
+}
+
+// 当前线程剩下的原生栈是否已经不到 kStackReserve
+inline auto stackExhausted() -> bool {
+#if defined(__GNUC__) || defined(__clang__)
+    auto here = reinterpret_cast<std::uintptr_t>(__builtin_frame_address(0));
+#else
+    char marker;
+    auto here = reinterpret_cast<std::uintptr_t>(&marker);
+#endif
+    return here < stackLimit();
+}
+
+} // namespace lox
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "Interpreter/ErrorReporter.h"
+#include "Interpreter/Program.h"
+#include "Interpreter/Transpiler.h"
+#include "gtest/gtest.h"
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+#include <string>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace lox {
+
+// 同一个测试可能在两种配置下并行运行，文件名里带上进程号
+inline auto tempPath(const std::string &name) -> std::string {
+    return testing::TempDir() + name + "_" + std::to_string(getpid());
+}
+
+inline auto compilerAvailable() -> bool {
+    return std::system("c++ --version > /dev/null 2>&1") == 0;
+}
+
+// 把 source 预先编译成 output
+inline auto build(const std::string &source, const std::string &output,
+                  Transpiler::Output kind) -> bool {
+    std::ostringstream err;
+    ErrorReporter reporter(err);
+    auto program = Program::compile(source, reporter);
+    EXPECT_NE(nullptr, program);
+    if (program == nullptr)
+        return false;
+    std::string errors;
+    bool ok = Transpiler::build(Transpiler::translate(*program), output, kind,
+                                errors);
+    EXPECT_TRUE(ok) << errors;
+    return ok;
+}
+
+// 运行生成的可执行文件，返回退出码
+inline auto runExecutable(const std::string &path, std::string &output)
+    -> int {
+    FILE *pipe = popen((path + " 2>&1").c_str(), "r");
+    char buf[4096];
+    for (std::size_t n; (n = std::fread(buf, 1, sizeof(buf), pipe)) > 0;) {
+        output.append(buf, n);
+    }
+    auto status = pclose(pipe);
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+} // namespace lox
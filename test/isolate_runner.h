@@ -0,0 +1,111 @@
+#pragma once
+
+#include "Interpreter/Interpreter.h"
+#include "Interpreter/Isolate.h"
+#include "Interpreter/Jit.h"
+#include "gtest/gtest.h"
+#include <functional>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace lox {
+
+// 在一个新的 Isolate 上执行一段代码的结果
+struct RunResult {
+    Isolate::Status status;
+    std::string output;
+    std::string errors;
+};
+
+// 执行之前调整 Isolate：执行方式、JIT、VM 选项、模块根目录等
+using IsolateConfig = std::function<void(Isolate &)>;
+
+// 新建一个 Isolate，先交给 configure，再用 run 执行，收集输出和错误
+inline auto runIsolate(const IsolateConfig &configure,
+                       const std::function<Isolate::Status(Isolate &)> &run)
+    -> RunResult {
+    std::ostringstream out, err;
+    Isolate isolate(out, err);
+    if (configure)
+        configure(isolate);
+    auto status = run(isolate);
+    return {status, out.str(), err.str()};
+}
+
+inline auto runIsolate(const std::string &source,
+                       const IsolateConfig &configure = nullptr) -> RunResult {
+    return runIsolate(configure,
+                      [&](Isolate &isolate) { return isolate.run(source); });
+}
+
+using Mode = Interpreter::ExecutionMode;
+
+inline constexpr Mode kAllModes[] = {Mode::TreeWalk, Mode::Closure,
+                                     Mode::Bytecode};
+
+// 一种执行配置：执行方式，以及是否启用 JIT（平台不支持时总是关闭）
+struct Tier {
+    Mode mode = Mode::TreeWalk;
+    bool jit = false;
+};
+
+// 每种执行方式分别关闭和启用 JIT
+inline auto allTiers() -> std::vector<Tier> {
+    std::vector<Tier> tiers;
+    for (auto mode : kAllModes) {
+        tiers.push_back({mode, false});
+        tiers.push_back({mode, true});
+    }
+    return tiers;
+}
+
+// 断言失败时说明是哪种配置
+inline auto describe(Tier tier) -> std::string {
+    static const char *names[] = {"tree-walk", "closure", "bytecode"};
+    return std::string(names[static_cast<int>(tier.mode)]) +
+           (tier.jit ? " + jit" : "");
+}
+
+// 按 tier 设置 Isolate，再交给 configure 做其余的调整
+inline auto tierConfig(Tier tier, IsolateConfig configure = nullptr)
+    -> IsolateConfig {
+    return [tier, configure = std::move(configure)](Isolate &isolate) {
+        auto interpreter = isolate.getInterpreter();
+        interpreter->setExecutionMode(tier.mode);
+        interpreter->getJit().setEnabled(tier.jit && Jit::isSupported());
+        if (configure)
+            configure(isolate);
+    };
+}
+
+inline auto runInTier(const std::string &source, Tier tier,
+                      const IsolateConfig &configure = nullptr) -> RunResult {
+    return runIsolate(source, tierConfig(tier, configure));
+}
+
+// 两次执行的状态、输出和错误必须完全相同
+inline auto expectSameRun(const RunResult &expected, const RunResult &actual,
+                          const std::string &where) -> void {
+    EXPECT_EQ(expected.status, actual.status) << where << "\n"
+                                              << actual.errors;
+    EXPECT_EQ(expected.output, actual.output) << where;
+    EXPECT_EQ(expected.errors, actual.errors) << where;
+}
+
+// 在 tiers 的每一种配置下执行 source，结果都必须和按 AST 执行、
+// 不启用 JIT 时完全相同。返回按 AST 执行的结果
+inline auto expectSameAcrossTiers(const std::string &source,
+                                  const std::vector<Tier> &tiers,
+                                  const IsolateConfig &configure = nullptr)
+    -> RunResult {
+    auto expected = runInTier(source, Tier{}, configure);
+    for (auto tier : tiers) {
+        expectSameRun(expected, runInTier(source, tier, configure),
+                      describe(tier) + ":\n" + source);
+    }
+    return expected;
+}
+
+} // namespace lox
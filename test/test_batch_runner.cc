@@ -0,0 +1,73 @@
+#include "Interpreter/BatchRunner.h"
+#include "Interpreter/ThreadPool.h"
+#include "gtest/gtest.h"
+#include <atomic>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace lox {
+
+TEST(BatchRunnerTest, ResultsInInputOrder) {
+    constexpr int kJobs = 200;
+    std::vector<BatchJob> jobs;
+    for (int i = 0; i < kJobs; i++) {
+        // 前面的任务更重，完成顺序与提交顺序不同
+        auto n = std::to_string((kJobs - i) % 18);
+        jobs.push_back(BatchJob::fromSource(
+            "job" + std::to_string(i),
+            "fun fib(n) { if (n < 2) return n; return fib(n - 1) + "
+            "fib(n - 2); }\nfib(" +
+                n + ");\nprint " + std::to_string(i) + ";"));
+    }
+    auto results = BatchRunner(4).run(jobs);
+    ASSERT_EQ(jobs.size(), results.size());
+    for (int i = 0; i < kJobs; i++) {
+        EXPECT_EQ("job" + std::to_string(i), results[i].name);
+        EXPECT_EQ(std::to_string(i) + "\n", results[i].output);
+        EXPECT_EQ(0, results[i].exitCode);
+    }
+}
+
+TEST(BatchRunnerTest, ExitStatuses) {
+    std::vector<BatchJob> jobs = {
+        BatchJob::fromSource("ok", "var a = 1; print a;"),
+        BatchJob::fromSource("compile", "var = ;"),
+        BatchJob::fromSource("runtime", "print a;"),
+        BatchJob::fromFile("/nonexistent/script.lox"),
+    };
+    auto results = BatchRunner(2).run(jobs);
+    ASSERT_EQ(4u, results.size());
+    EXPECT_EQ(0, results[0].exitCode);
+    EXPECT_EQ("1\n", results[0].output);
+    EXPECT_EQ(65, results[1].exitCode);
+    EXPECT_FALSE(results[1].errors.empty());
+    // 每个脚本有自己的全局作用域，看不到 "ok" 定义的 a
+    EXPECT_EQ(70, results[2].exitCode);
+    EXPECT_EQ(66, results[3].exitCode);
+}
+
+// 任务抛出的异常不会终止进程，而是由 wait 重新抛出；之后线程池照常可用
+TEST(ThreadPoolTest, RethrowsTaskErrors) {
+    ThreadPool pool(4);
+    std::atomic<int> done{0};
+    for (int i = 0; i < 100; i++) {
+        pool.submit([&, i] {
+            if (i % 10 == 3)
+                throw std::runtime_error("task failed");
+            done++;
+        });
+    }
+    EXPECT_THROW(pool.wait(), std::runtime_error);
+    EXPECT_EQ(90, done.load());
+    pool.submit([&] { done++; });
+    EXPECT_NO_THROW(pool.wait());
+    EXPECT_EQ(91, done.load());
+}
+
+} // namespace lox
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS(); // Runs all the tests
+}
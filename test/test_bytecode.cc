@@ -0,0 +1,237 @@
+#include "Interpreter/Bytecode.h"
+#include "Interpreter/Interpreter.h"
+#include "Interpreter/Isolate.h"
+#include "Interpreter/Program.h"
+#include "Interpreter/Vm.h"
+#include "gtest/gtest.h"
+#include "isolate_runner.h"
+#include <sstream>
+#include <string>
+
+namespace lox {
+
+// 字节码执行的几种配置：分派方式 × 是否使用超级指令
+struct VmConfig {
+    bool threaded;
+    bool superinstructions;
+};
+
+static const VmConfig kConfigs[] = {
+    {false, false}, {false, true}, {true, false}, {true, true}};
+
+static auto vmOptions(VmConfig config) -> IsolateConfig {
+    return [config](Isolate &isolate) {
+        auto &vm = isolate.getInterpreter()->getVm();
+        vm.setThreaded(config.threaded);
+        vm.setSuperinstructions(config.superinstructions);
+    };
+}
+
+// 每种配置的字节码执行结果都必须和按 AST 执行完全相同
+static auto expectSameAsTreeWalker(const std::string &source) -> RunResult {
+    auto walked = runInTier(source, {Mode::TreeWalk});
+    for (auto config : kConfigs) {
+        expectSameRun(walked,
+                      runInTier(source, {Mode::Bytecode}, vmOptions(config)),
+                      source);
+    }
+    return walked;
+}
+
+static auto disassemble(const std::string &source, bool superinstructions)
+    -> std::string {
+    std::ostringstream err;
+    ErrorReporter reporter(err);
+    auto program = Program::compile(source, reporter);
+    EXPECT_NE(nullptr, program) << err.str();
+    return BytecodeCompiler::compile(program->getStatements(),
+                                     superinstructions)
+        ->disassemble();
+}
+
+TEST(BytecodeTest, MatchesTreeWalker) {
+    auto result = expectSameAsTreeWalker(R"(
+fun fib(n) { if (n < 2) return n; return fib(n - 1) + fib(n - 2); }
+print fib(15);
+fun makeCounter() {
+  var i = 0;
+  fun count() { i = i + 1; return i; }
+  return count;
+}
+var counter = makeCounter();
+counter();
+print counter();
+class A {
+  init(x) { this.x = x; }
+  get() { return this.x; }
+  say() { return "A" + this.name(); }
+  name() { return "a"; }
+}
+class B < A {
+  init(x) { super.init(x * 2); return; }
+  name() { return "b"; }
+  say() { return super.say() + "!"; }
+}
+var b = B(21);
+print b.get();
+print b.say();
+print b;
+print B;
+print b.get;
+print b.init(5).get();
+print 1 / 3;
+print -0;
+print 0 / 0 == 0 / 0;
+print nil or "d";
+print 1 and 2;
+print !nil;
+print "a" != "b";
+var s = "";
+for (var i = 0; i < 5; i = i + 1) s = s + "x";
+print s;
+fun noReturn() { var unused; }
+print noReturn();
+fun early(n) {
+  while (true) {
+    { if (n > 3) return n; }
+    n = n + 1;
+  }
+}
+print early(0);
+fun sum(a, b) { return a + b; }
+print sum(1, 2) + sum(3, 4);
+print sum("a", "b");
+fun pick(x) {
+  var n = 0;
+  if (x == 1) n = n + 1;
+  if (x != 1) n = n + 10;
+  if (x <= 1) n = n + 100;
+  if (x >= 1) n = n + 1000;
+  if (x > 1) n = n - 1;
+  return n;
+}
+print pick(0) + pick(1) * 3 - pick(2) / 2;
+)");
+    EXPECT_EQ(Isolate::Status::OK, result.status);
+    EXPECT_EQ(0u, result.output.find("610\n2\n42\nAb!\nB instance\n"));
+}
+
+TEST(BytecodeTest, RuntimeErrors) {
+    const char *sources[] = {
+        "print 1;\nprint -\"x\";\n",
+        "print 1 < \"x\";\n",
+        "print 1 + nil;\n",
+        "var a = 1;\nprint a + nil;\n",
+        "fun f(a, b) { return a + b; }\nf(1, nil);\n",
+        "fun f(a) { if (a < nil) return 1; }\nf(1);\n",
+        "fun f(a) { return a * \"x\"; }\nf(1);\n",
+        "print undefined;\n",
+        "undefined = 1;\n",
+        "var x = 1;\nx();\n",
+        "fun f(a) { return a; }\nprint f();\n",
+        "var x = 1;\nprint x.y;\n",
+        "var x = 1;\nx.y = 2;\n",
+        "var x = 1;\nx.y();\n",
+        "class A {}\nprint A().missing;\n",
+        "class A {}\nA().missing(1);\n",
+        "var NotAClass = 1;\nclass B < NotAClass {}\n",
+        "class A {}\nclass B < A { m() { return super.missing; } }\nB().m();\n",
+        "fun f(n) {\n  if (n == 0) return nil + 1;\n  return f(n - 1);\n}\nf(3);\n",
+    };
+    for (auto *source : sources) {
+        auto result = expectSameAsTreeWalker(source);
+        EXPECT_EQ(Isolate::Status::RUNTIME_ERROR, result.status) << source;
+        EXPECT_NE(std::string::npos, result.errors.find("[line")) << source;
+    }
+}
+
+// 设置属性时先检查对象，再对右边求值；方法调用的参数有副作用时不能合并成 INVOKE
+TEST(BytecodeTest, EvaluationOrder) {
+    expectSameAsTreeWalker(R"(
+fun side() { print "side"; return 1; }
+var x = 1;
+x.y = side();
+)");
+    expectSameAsTreeWalker(R"(
+class A { m(v) { return v; } }
+var a = A();
+fun swap() { a.m = nil; return 2; }
+print a.m(swap());
+)");
+}
+
+TEST(BytecodeTest, Superinstructions) {
+    const char *source = R"(
+fun add(a, b) { return a + b; }
+fun loop() {
+  var total = 0;
+  for (var i = 0; i < 10; i = i + 1) total = total + 2;
+  return total;
+}
+fun less(a, b) { if (a < b) return 1; return 0; }
+class A { m() { return 1; } }
+print A().m();
+)";
+    auto fused = disassemble(source, true);
+    for (auto *op : {"ADD_LOCALS", "ADD_K", "JUMP_UNLESS_LESS_K",
+                     "JUMP_UNLESS_LESS ", "INVOKE"}) {
+        EXPECT_NE(std::string::npos, fused.find(op)) << op << "\n" << fused;
+    }
+    auto plain = disassemble(source, false);
+    for (auto *op : {"ADD_LOCALS", "_K ", "JUMP_UNLESS", "INVOKE"}) {
+        EXPECT_EQ(std::string::npos, plain.find(op)) << op << "\n" << plain;
+    }
+}
+
+// 跳转目标落在两条指令之间时不能把它们合并
+TEST(BytecodeTest, JumpTargetsBlockFusion) {
+    auto result = expectSameAsTreeWalker(R"(
+fun f(a, b) {
+  var x = a and b;
+  if (x) return x + 1;
+  return x;
+}
+print f(1, 2);
+print f(false, 2);
+var i = 0;
+while (i < 3 or i == 5) i = i + 1;
+print i;
+)");
+    EXPECT_EQ("3\nfalse\n3\n", result.output);
+}
+
+TEST(BytecodeTest, DispatchModes) {
+    std::ostringstream out, err;
+    Isolate isolate(out, err);
+    auto &vm = isolate.getInterpreter()->getVm();
+    EXPECT_EQ(Vm::hasThreadedDispatch(), vm.isThreaded());
+    EXPECT_EQ(Vm::hasThreadedDispatch(), Vm::dispatchTable() != nullptr);
+    vm.setThreaded(false);
+    EXPECT_FALSE(vm.isThreaded());
+    vm.setThreaded(true);
+    EXPECT_EQ(Vm::hasThreadedDispatch(), vm.isThreaded());
+}
+
+// 深递归时操作数栈跨越多个段。按 AST 执行这么深的递归会耗尽原生栈，
+// 这里只检查字节码的结果
+TEST(BytecodeTest, DeepRecursion) {
+    const char *source = R"(
+fun down(n) {
+  if (n <= 0) return 0;
+  return 0 + (0 + (0 + (0 + (0 + (1 + down(n - 1))))));
+}
+print down(900);
+)";
+    for (auto config : kConfigs) {
+        auto result = runInTier(source, {Mode::Bytecode}, vmOptions(config));
+        EXPECT_EQ(Isolate::Status::OK, result.status) << result.errors;
+        EXPECT_EQ("900\n", result.output);
+    }
+}
+
+} // namespace lox
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS(); // Runs all the tests
+}
@@ -0,0 +1,140 @@
+#include "Interpreter/Interpreter.h"
+#include "Interpreter/Isolate.h"
+#include "gtest/gtest.h"
+#include "isolate_runner.h"
+#include <string>
+
+namespace lox {
+
+// 数值函数会被 JIT 编译成机器码，机器码之间的调用不计入调用深度，
+// 所以这里都在不启用 JIT 的配置下执行（Tier 的默认值）
+
+// 无限递归得到运行时错误而不是崩溃，之后解释器还能接着用
+TEST(CallDepthTest, StackOverflowIsRuntimeError) {
+    for (auto mode : kAllModes) {
+        auto result = runIsolate(tierConfig({mode}), [](Isolate &isolate) {
+            EXPECT_EQ(Isolate::Status::RUNTIME_ERROR,
+                      isolate.run("fun f(n) { return 1 + f(n + 1); }\n"
+                                  "f(0);\n"));
+            EXPECT_EQ(0u, isolate.getInterpreter()->getCallDepth());
+            return isolate.run("print f;\n");
+        });
+        EXPECT_EQ(Isolate::Status::OK, result.status);
+        EXPECT_EQ("Stack overflow.\n[line 1]\n", result.errors);
+        EXPECT_EQ("<fn f>\n", result.output);
+    }
+}
+
+// 各种执行方式按同样的规则计算深度
+TEST(CallDepthTest, MaxCallDepth) {
+    const char *source = R"(
+fun down(n) { if (n <= 0) return "end"; return "" + down(n - 1); }
+class Node {
+  init(n) { if (n > 0) this.next = Node(n - 1); }
+}
+)";
+    for (auto mode : kAllModes) {
+        auto result = runIsolate(tierConfig({mode}), [&](Isolate &isolate) {
+            isolate.getInterpreter()->setMaxCallDepth(100);
+            EXPECT_EQ(Isolate::Status::OK, isolate.run(source));
+            EXPECT_EQ(Isolate::Status::OK, isolate.run("print down(99);\n"));
+            EXPECT_EQ(Isolate::Status::RUNTIME_ERROR,
+                      isolate.run("print down(100);\n"));
+            EXPECT_EQ(Isolate::Status::OK, isolate.run("Node(99);\n"));
+            return isolate.run("Node(100);\n");
+        });
+        EXPECT_EQ(Isolate::Status::RUNTIME_ERROR, result.status);
+        EXPECT_EQ("end\n", result.output);
+        EXPECT_EQ("Stack overflow.\n[line 2]\nStack overflow.\n[line 4]\n",
+                  result.errors);
+    }
+}
+
+// 按 AST 执行和字节码函数之间的调用都不占用原生栈，深度只受最大调用深度限制
+TEST(CallDepthTest, RecursionUsesHeapFrames) {
+    for (auto mode : {Mode::TreeWalk, Mode::Bytecode}) {
+        auto result = runIsolate(tierConfig({mode}), [](Isolate &isolate) {
+            EXPECT_EQ(Isolate::Status::OK, isolate.run(R"(
+fun down(n) { if (n <= 0) return 0; return 1 + down(n - 1); }
+print down(50000);
+class Counter {
+  init() { this.n = 0; }
+  count(k) {
+    if (k == 0) return this.n;
+    this.n = this.n + 1;
+    return 0 + this.count(k - 1);
+  }
+}
+print Counter().count(20000);
+)"));
+
+            // 深处出错时所有帧都被弹出
+            EXPECT_EQ(Isolate::Status::RUNTIME_ERROR, isolate.run(R"(
+fun fail(n) { if (n == 0) return nil + 1; return 1 + fail(n - 1); }
+fail(10000);
+)"));
+            EXPECT_EQ(0u, isolate.getInterpreter()->getCallDepth());
+            return isolate.run("print down(3);\n");
+        });
+        EXPECT_EQ(Isolate::Status::OK, result.status);
+        EXPECT_NE(std::string::npos, result.errors.find("[line 2]"));
+        EXPECT_EQ("50000\n20000\n3\n", result.output);
+    }
+}
+
+// 向右嵌套太深的源码是语法错误，不会在解析或者执行时耗尽原生栈
+TEST(CallDepthTest, DeepNestingIsSyntaxError) {
+    auto nested = [](int depth) {
+        return "print " + std::string(depth, '(') + "1" +
+               std::string(depth, ')') + ";\n";
+    };
+    for (auto mode : kAllModes) {
+        auto result = runIsolate(tierConfig({mode}), [&](Isolate &isolate) {
+            EXPECT_EQ(Isolate::Status::OK, isolate.run(nested(500)));
+            EXPECT_EQ(Isolate::Status::COMPILE_ERROR,
+                      isolate.run(nested(3000)));
+            return isolate.run("print " + std::string(100000, '-') + "1;\n");
+        });
+        EXPECT_EQ(Isolate::Status::COMPILE_ERROR, result.status);
+        EXPECT_EQ("1\n", result.output);
+        EXPECT_NE(std::string::npos, result.errors.find("Too much nesting."));
+    }
+}
+
+// 左结合的长运算链和长 else if 链不受嵌套限制，各种执行方式都能编译执行
+TEST(CallDepthTest, LongFlatChains) {
+    auto chain = [](int terms, const std::string &term, const char *op) {
+        std::string text = term;
+        for (int i = 1; i < terms; i++)
+            text += op + term;
+        return text;
+    };
+    std::string source = "var s = " + chain(1500, "\"a\"", " + ") + ";\n" +
+                         "print s == \"" + std::string(1500, 'a') + "\";\n" +
+                         "print " + chain(1500, "1", " - ") + ";\n" +
+                         "print " + chain(1500, "false", " or ") + ";\n";
+    source += "fun pick(n) {\n  if (n == 0) return 0;\n";
+    for (int i = 1; i < 1200; i++) {
+        source += "  else if (n == " + std::to_string(i) + ") return " +
+                  std::to_string(i * 2) + ";\n";
+    }
+    source += "  else return -1;\n}\n"
+              "print pick(0);\nprint pick(1199);\nprint pick(5000);\n";
+    for (auto mode : kAllModes) {
+        auto result = runInTier(source, {mode});
+        EXPECT_EQ(Isolate::Status::OK, result.status) << result.errors;
+        EXPECT_EQ("true\n-1498\nfalse\n0\n2398\n-1\n", result.output);
+    }
+
+    // 高到原生栈放不下的语法树是编译错误，释放时也不会耗尽原生栈
+    auto result = runInTier("print " + chain(300000, "1", "+") + ";\n", {});
+    EXPECT_EQ(Isolate::Status::COMPILE_ERROR, result.status);
+    EXPECT_NE(std::string::npos, result.errors.find("Too much nesting."));
+}
+
+} // namespace lox
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS(); // Runs all the tests
+}
@@ -0,0 +1,116 @@
+#include "Interpreter/Interpreter.h"
+#include "Interpreter/Isolate.h"
+#include "gtest/gtest.h"
+#include "isolate_runner.h"
+#include <sstream>
+#include <string>
+
+namespace lox {
+
+// 分别按 AST 和闭包树执行，两者的输出和错误必须完全相同
+TEST(ClosureCompilerTest, MatchesTreeWalker) {
+    auto result = expectSameAcrossTiers(R"(
+fun fib(n) { if (n < 2) return n; return fib(n - 1) + fib(n - 2); }
+print fib(15);
+fun makeCounter() {
+  var i = 0;
+  fun count() { i = i + 1; return i; }
+  return count;
+}
+var counter = makeCounter();
+counter();
+print counter();
+class A {
+  init(x) { this.x = x; }
+  get() { return this.x; }
+  say() { return "A" + this.name(); }
+  name() { return "a"; }
+}
+class B < A {
+  init(x) { super.init(x * 2); return; }
+  name() { return "b"; }
+  say() { return super.say() + "!"; }
+}
+var b = B(21);
+print b.get();
+print b.say();
+print b;
+print B;
+print b.get;
+print b.init(5).get();
+print 1 / 3;
+print -0;
+print 0 / 0 == 0 / 0;
+print nil or "d";
+print 1 and 2;
+print !nil;
+print "a" != "b";
+var s = "";
+for (var i = 0; i < 5; i = i + 1) s = s + "x";
+print s;
+fun noReturn() { var unused; }
+print noReturn();
+fun early(n) {
+  while (true) {
+    { if (n > 3) return n; }
+    n = n + 1;
+  }
+}
+print early(0);
+)",
+                                        {{Mode::Closure}});
+    EXPECT_EQ(Isolate::Status::OK, result.status);
+    EXPECT_EQ(0u, result.output.find("610\n2\n42\nAb!\nB instance\n"));
+}
+
+TEST(ClosureCompilerTest, RuntimeErrors) {
+    const char *sources[] = {
+        "print 1;\nprint -\"x\";\n",
+        "print 1 < \"x\";\n",
+        "print 1 + nil;\n",
+        "print undefined;\n",
+        "undefined = 1;\n",
+        "var x = 1;\nx();\n",
+        "fun f(a) { return a; }\nprint f();\n",
+        "var x = 1;\nprint x.y;\n",
+        "var x = 1;\nx.y = 2;\n",
+        "class A {}\nprint A().missing;\n",
+        "var NotAClass = 1;\nclass B < NotAClass {}\n",
+        "class A {}\nclass B < A { m() { return super.missing; } }\nB().m();\n",
+        "fun f(n) {\n  if (n == 0) return nil + 1;\n  return f(n - 1);\n}\nf(3);\n",
+    };
+    for (auto *source : sources) {
+        auto result = expectSameAcrossTiers(source, {{Mode::Closure}});
+        EXPECT_EQ(Isolate::Status::RUNTIME_ERROR, result.status) << source;
+        EXPECT_NE(std::string::npos, result.errors.find("[line")) << source;
+    }
+}
+
+TEST(ClosureCompilerTest, SnapshotKeepsMode) {
+    std::ostringstream out, err;
+    Isolate isolate(out, err);
+    isolate.getInterpreter()->setExecutionMode(Mode::Closure);
+    ASSERT_EQ(Isolate::Status::OK, isolate.run("var total = 1;\n"
+                                               "fun add(n) {\n"
+                                               "  total = total + n;\n"
+                                               "  return total;\n"
+                                               "}\n"));
+    auto snapshot = isolate.snapshot();
+    EXPECT_EQ(Mode::Closure, isolate.getInterpreter()->getExecutionMode());
+
+    // fork 出来的 Isolate 按 AST 执行，调用快照中编译好的函数
+    std::ostringstream forkOut, forkErr;
+    Isolate fork(snapshot, forkOut, forkErr);
+    ASSERT_EQ(Isolate::Status::OK, fork.run("print add(2);\nprint total;\n"));
+    EXPECT_EQ("3\n3\n", forkOut.str());
+
+    ASSERT_EQ(Isolate::Status::OK, isolate.run("print add(10);\n"));
+    EXPECT_EQ("11\n", out.str());
+}
+
+} // namespace lox
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS(); // Runs all the tests
+}
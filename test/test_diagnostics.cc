@@ -0,0 +1,176 @@
+#include "Interpreter/ErrorReporter.h"
+#include "Interpreter/Parser.h"
+#include "Interpreter/Program.h"
+#include "Interpreter/Scanner.h"
+#include "gtest/gtest.h"
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace lox {
+
+static auto parse(const std::string &source, ErrorReporter &reporter)
+    -> std::vector<StmtRef> {
+    Scanner scanner(source, nullptr, &reporter);
+    Parser parser(scanner.scanTokens(), &reporter);
+    return parser.parse();
+}
+
+// 每个 token 的列号是它第一个字符在行内的位置，从 1 开始
+TEST(DiagnosticsTest, TokenColumns) {
+    std::string source = "var a = 1;\n  print \"two\nlines\" + a;\n";
+    Scanner scanner(source);
+    auto tokens = scanner.scanTokens();
+    std::vector<std::pair<int, int>> expected = {
+        {1, 1}, {1, 5}, {1, 7}, {1, 9}, {1, 10}, // var a = 1 ;
+        {2, 3}, {3, 9}, {3, 8}, {3, 10}, {3, 11}, {4, 1}};
+    ASSERT_EQ(expected.size(), tokens.size());
+    for (std::size_t i = 0; i < tokens.size(); i++) {
+        // 跨行的字符串记在结束的行上，列号是开始的位置
+        EXPECT_EQ(expected[i].first, tokens[i]->getLine()) << i;
+        EXPECT_EQ(expected[i].second, tokens[i]->getColumn()) << i;
+    }
+}
+
+// 并行扫描和流式扫描得到的列号与顺序扫描相同
+TEST(DiagnosticsTest, ColumnsMatchAcrossScanners) {
+    std::string source;
+    for (int i = 0; i < 300; i++) {
+        source += "fun f" + std::to_string(i) + "(a) {\n  return \"s\n" +
+                  std::string(i % 7, ' ') + "\" + a @ " + std::to_string(i) +
+                  ";\n}\n";
+    }
+    std::ostringstream seqErr, parErr, streamErr;
+    ErrorReporter seqReporter(seqErr), parReporter(parErr),
+        streamReporter(streamErr);
+    auto sequential = Scanner(source, nullptr, &seqReporter).scanTokens();
+    auto parallel = Scanner(source, nullptr, &parReporter)
+                        .scanTokensParallel(3, 512);
+    std::istringstream input(source);
+    Scanner stream(input, nullptr, &streamReporter, 64);
+    std::vector<TokenRef> streamed;
+    for (auto token = stream.nextToken(); token->getType() != EOF_TOKEN;
+         token = stream.nextToken()) {
+        streamed.push_back(token);
+    }
+    streamed.push_back(stream.nextToken());
+
+    ASSERT_EQ(sequential.size(), parallel.size());
+    ASSERT_EQ(sequential.size(), streamed.size());
+    for (std::size_t i = 0; i < sequential.size(); i++) {
+        EXPECT_EQ(sequential[i]->getColumn(), parallel[i]->getColumn()) << i;
+        EXPECT_EQ(sequential[i]->getColumn(), streamed[i]->getColumn()) << i;
+    }
+    EXPECT_EQ(seqErr.str(), parErr.str());
+    EXPECT_EQ(seqErr.str(), streamErr.str());
+    ASSERT_EQ(300u, seqReporter.getDiagnostics().size());
+    auto &first = seqReporter.getDiagnostics().front();
+    EXPECT_EQ(3, first.line);
+    EXPECT_EQ(7, first.column);
+    EXPECT_EQ("Unexpected character.", first.message);
+}
+
+// 出错之后同步到下一条语句继续解析，输出的文本和以前一样。
+// 同步只看语句关键字，所以方法体里的错误会把后面的顶层声明吞进方法体
+TEST(DiagnosticsTest, Recovery) {
+    std::ostringstream err;
+    ErrorReporter reporter(err);
+    reporter.setFileName("a.lox");
+    auto statements = parse("var = 1;\n"
+                            "print 1 + ;\n"
+                            "fun f(a, { return (a; }\n"
+                            "var ok = 2;\n"
+                            "class C { m() { return 1 } }\n"
+                            "print",
+                            reporter);
+    EXPECT_TRUE(reporter.hadError());
+    EXPECT_EQ("a.lox: [line 1] Error at '=': Expect variable name.\n"
+              "a.lox: [line 2] Error at ';': Expect expression.\n"
+              "a.lox: [line 3] Error at '{': Expect parameter name.\n"
+              "a.lox: [line 3] Error at ';': Expect ')' after expression.\n"
+              "a.lox: [line 3] Error at '}': Expect expression.\n"
+              "a.lox: [line 5] Error at '}': Expect ';' after return value.\n"
+              "a.lox: [line 6] Error at end: Expect expression.\n"
+              "a.lox: [line 6] Error at end: Expect '}' after block.\n",
+              err.str());
+    auto &diagnostics = reporter.getDiagnostics();
+    ASSERT_EQ(8u, diagnostics.size());
+    std::vector<std::pair<int, int>> positions = {
+        {1, 5}, {2, 11}, {3, 10}, {3, 21}, {3, 23}, {5, 26}, {6, 6}, {6, 6}};
+    for (std::size_t i = 0; i < diagnostics.size(); i++) {
+        EXPECT_EQ("a.lox", diagnostics[i].file);
+        EXPECT_EQ(positions[i].first, diagnostics[i].line) << i;
+        EXPECT_EQ(positions[i].second, diagnostics[i].column) << i;
+    }
+    EXPECT_EQ("Expect variable name.", diagnostics[0].message);
+
+    // 出错的语句被丢掉，后面正确的语句照常解析
+    int parsed = 0;
+    for (auto &stmt : statements) {
+        parsed += stmt != nullptr;
+    }
+    EXPECT_EQ(1, parsed);
+}
+
+// 不会中断解析的错误之后仍然报告后面的错误
+TEST(DiagnosticsTest, NonFatalErrors) {
+    std::ostringstream err;
+    ErrorReporter reporter(err);
+    parse("1 = 2;\nprint ;\n", reporter);
+    ASSERT_EQ(2u, reporter.getDiagnostics().size());
+    EXPECT_EQ("Invalid assignment target.",
+              reporter.getDiagnostics()[0].message);
+    EXPECT_EQ("Expect expression.", reporter.getDiagnostics()[1].message);
+}
+
+TEST(DiagnosticsTest, MaxErrors) {
+    std::string source;
+    for (int i = 0; i < 100; i++) {
+        source += "print ;\n";
+    }
+    std::ostringstream err;
+    ErrorReporter reporter(err);
+    reporter.setMaxErrors(3);
+    parse(source, reporter);
+    EXPECT_TRUE(reporter.hadError());
+    EXPECT_EQ(3u, reporter.getDiagnostics().size());
+    EXPECT_EQ(3, reporter.getDiagnostics().back().line);
+
+    // 扫描错误也计数
+    std::ostringstream scanErr;
+    ErrorReporter scanReporter(scanErr);
+    scanReporter.setMaxErrors(2);
+    parse("@ @ @ @;", scanReporter);
+    EXPECT_EQ(2u, scanReporter.getDiagnostics().size());
+    EXPECT_EQ("[line 1] Error: Unexpected character.\n"
+              "[line 1] Error: Unexpected character.\n",
+              scanErr.str());
+}
+
+// 编译多个文件时上限对每个文件分别生效
+TEST(DiagnosticsTest, MaxErrorsPerFile) {
+    std::ostringstream err;
+    ErrorReporter reporter(err);
+    reporter.setMaxErrors(2);
+    auto program = Program::compileFiles(
+        {{"a.lox", "print ;\nprint ;\nprint ;\n"},
+         {"b.lox", "var ok = 1;\n"},
+         {"c.lox", "var = 1;\nvar = 2;\nvar = 3;\n"}},
+        reporter);
+    EXPECT_EQ(nullptr, program);
+    auto &diagnostics = reporter.getDiagnostics();
+    ASSERT_EQ(4u, diagnostics.size());
+    EXPECT_EQ("a.lox", diagnostics[1].file);
+    EXPECT_EQ(2, diagnostics[1].line);
+    EXPECT_EQ("c.lox", diagnostics[2].file);
+    EXPECT_EQ(1, diagnostics[2].line);
+    EXPECT_EQ("c.lox", diagnostics[3].file);
+    EXPECT_EQ(2, diagnostics[3].line);
+}
+
+} // namespace lox
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS(); // Runs all the tests
+}
@@ -0,0 +1,190 @@
+#include "Interpreter/Document.h"
+#include "Interpreter/Parser.h"
+#include "Interpreter/Scanner.h"
+#include "gtest/gtest.h"
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace lox {
+
+static auto source(int functions) -> std::string {
+    std::string text = "var count = 0;\n";
+    for (int i = 0; i < functions; i++) {
+        auto n = std::to_string(i);
+        text += "fun f" + n + "(a) {\n  var s = \"line\n" + n +
+                "\";\n  if (a > " + n + ") return a; // comment\n"
+                "  count = count + 1; return s;\n}\n";
+        if (i % 3 == 0)
+            text += "class C" + n + " { m() { return this; } } print f" + n +
+                    "(1);\n";
+    }
+    return text;
+}
+
+static auto kinds(const std::vector<StmtRef> &statements) -> std::string {
+    std::string result;
+    for (auto &stmt : statements) {
+        result += stmt == nullptr ? "-" : std::to_string(int(stmt->kind()));
+        result += ' ';
+    }
+    return result;
+}
+
+// 增量的结果和从头扫描、解析的结果相同
+static auto expectFresh(Document &document) -> void {
+    Document fresh(document.getSource(), "doc.lox");
+    auto tokens = document.getTokens();
+    std::ostringstream err;
+    ErrorReporter reporter(err);
+    auto expected =
+        Scanner(document.getSource(), nullptr, &reporter).scanTokens();
+    ASSERT_EQ(expected.size(), tokens.size());
+    for (std::size_t i = 0; i < tokens.size(); i++) {
+        ASSERT_EQ(expected[i]->getType(), tokens[i]->getType()) << i;
+        ASSERT_EQ(expected[i]->getLexeme(), tokens[i]->getLexeme()) << i;
+        ASSERT_EQ(expected[i]->getLine(), tokens[i]->getLine()) << i;
+        ASSERT_EQ(expected[i]->getColumn(), tokens[i]->getColumn()) << i;
+    }
+    auto parsed = Parser(expected, &reporter).parse();
+    EXPECT_EQ(kinds(parsed), kinds(document.getStatements()));
+
+    auto diagnostics = document.getDiagnostics();
+    auto freshDiagnostics = fresh.getDiagnostics();
+    ASSERT_EQ(freshDiagnostics.size(), diagnostics.size());
+    for (std::size_t i = 0; i < diagnostics.size(); i++) {
+        EXPECT_EQ(freshDiagnostics[i].file, diagnostics[i].file);
+        EXPECT_EQ(freshDiagnostics[i].line, diagnostics[i].line) << i;
+        EXPECT_EQ(freshDiagnostics[i].column, diagnostics[i].column) << i;
+        EXPECT_EQ(freshDiagnostics[i].message, diagnostics[i].message) << i;
+    }
+}
+
+// 编辑一个函数只重新解析它和它前面的声明，其余的语法树原样复用，
+// 后面的 token 和语法树的行号跟着平移
+TEST(DocumentTest, ReusesUnchangedDeclarations) {
+    auto text = source(100);
+    Document document(text, "doc.lox");
+    EXPECT_TRUE(document.getDiagnostics().empty());
+    auto before = document.getStatements();
+
+    auto at = text.find("count = count + 1;", text.find("fun f50("));
+    document.edit(at, 0, "\n\n");
+    EXPECT_LE(document.getReparsed(), 2u);
+    EXPECT_LT(document.getRescannedBytes(), 300u);
+    auto after = document.getStatements();
+    ASSERT_EQ(before.size(), after.size());
+    std::size_t reused = 0;
+    for (std::size_t i = 0; i < before.size(); i++) {
+        reused += before[i] == after[i];
+    }
+    EXPECT_EQ(before.size() - document.getReparsed(), reused);
+    expectFresh(document);
+
+    Document fresh(document.getSource(), "doc.lox");
+    auto expected = fresh.getStatements();
+    for (std::size_t i = 0; i < after.size(); i++) {
+        if (after[i]->kind() != StmtKind::Fun)
+            continue;
+        auto &fun = static_cast<FunStmt &>(*after[i]);
+        auto &freshFun = static_cast<FunStmt &>(*expected[i]);
+        EXPECT_EQ(freshFun.getName().getLine(), fun.getName().getLine()) << i;
+        auto &ret = static_cast<ReturnStmt &>(*fun.getBody().back());
+        auto &freshRet = static_cast<ReturnStmt &>(*freshFun.getBody().back());
+        EXPECT_EQ(freshRet.getKeyword().getLine(), ret.getKeyword().getLine())
+            << i;
+    }
+}
+
+// 语法错误和变量解析错误随编辑出现和消失
+TEST(DocumentTest, Diagnostics) {
+    Document document("var a = 1;\nfun f() { return a; }\nprint a;\n",
+                      "doc.lox");
+    EXPECT_TRUE(document.getDiagnostics().empty());
+
+    document.edit(8, 1, "");
+    auto diagnostics = document.getDiagnostics();
+    ASSERT_EQ(1u, diagnostics.size());
+    EXPECT_EQ("doc.lox", diagnostics[0].file);
+    EXPECT_EQ(1, diagnostics[0].line);
+    EXPECT_EQ(9, diagnostics[0].column);
+    EXPECT_EQ("Expect expression.", diagnostics[0].message);
+
+    document.edit(8, 0, "2");
+    EXPECT_TRUE(document.getDiagnostics().empty());
+
+    auto body = document.getSource().find("return a;");
+    document.edit(body, 0, "var b = b; ");
+    diagnostics = document.getDiagnostics();
+    ASSERT_EQ(1u, diagnostics.size());
+    EXPECT_EQ(2, diagnostics[0].line);
+    EXPECT_EQ("Can't read local variable in its own initializer.",
+              diagnostics[0].message);
+
+    // 前面插入行之后，保留下来的诊断信息的行号也跟着平移
+    document.edit(0, 0, "\n\n@\n");
+    diagnostics = document.getDiagnostics();
+    ASSERT_EQ(2u, diagnostics.size());
+    EXPECT_EQ(3, diagnostics[0].line);
+    EXPECT_EQ("Unexpected character.", diagnostics[0].message);
+    EXPECT_EQ(5, diagnostics[1].line);
+    expectFresh(document);
+}
+
+// 没有结束的字符串和删掉的花括号会影响到编辑位置后面的所有声明
+TEST(DocumentTest, EditsThatSpread) {
+    auto text = source(20);
+    Document document(text, "doc.lox");
+    auto at = text.find("fun f10(");
+    document.edit(at, 0, "\"");
+    expectFresh(document);
+    document.edit(at, 1, "");
+    expectFresh(document);
+    EXPECT_TRUE(document.getDiagnostics().empty());
+
+    auto brace = text.find("}\n", text.find("fun f5("));
+    document.edit(brace, 1, "");
+    expectFresh(document);
+    EXPECT_FALSE(document.getDiagnostics().empty());
+    document.edit(brace, 0, "}");
+    expectFresh(document);
+    EXPECT_TRUE(document.getDiagnostics().empty());
+}
+
+// 随机的插入、删除和替换之后，结果总是和从头解析的相同
+TEST(DocumentTest, RandomEdits) {
+    const std::vector<std::string> pieces = {
+        "",  "\n", " ",  "}",      "{",       "(",         ")",
+        ";", "\"", "@",  "fun g(", "var x = ", "return 1;", "class D {",
+        "a", "+",  "//", "\n}\n",  "print 1;\n"};
+    std::mt19937 random(42);
+    Document document(source(30), "doc.lox");
+    for (int i = 0; i < 300; i++) {
+        auto size = document.getSource().size();
+        auto offset = random() % (size + 1);
+        auto length = random() % 4 == 0 ? random() % 40 : random() % 3;
+        document.edit(offset, length, pieces[random() % pieces.size()]);
+        if (i % 10 == 0)
+            expectFresh(document);
+    }
+    expectFresh(document);
+}
+
+TEST(DocumentTest, EmptyDocument) {
+    Document document("");
+    EXPECT_TRUE(document.getStatements().empty());
+    document.edit(0, 0, "print 1;");
+    EXPECT_EQ(1u, document.getStatements().size());
+    document.edit(0, 8, "");
+    EXPECT_TRUE(document.getStatements().empty());
+    EXPECT_EQ(1u, document.getTokens().size());
+    expectFresh(document);
+}
+
+} // namespace lox
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS(); // Runs all the tests
+}
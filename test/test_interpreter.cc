@@ -0,0 +1,82 @@
+#include "Interpreter/Lox.h"
+#include "gtest/gtest.h"
+#include <string>
+
+namespace lox {
+
+static auto runAndCapture(Lox &lox, const std::string &source)
+    -> std::string {
+    testing::internal::CaptureStdout();
+    lox.run(source);
+    return testing::internal::GetCapturedStdout();
+}
+
+TEST(InterpreterTest, Statements) {
+    Lox lox;
+    EXPECT_EQ("3\n0.5\nhello world\ntrue\nnil\n",
+              runAndCapture(lox, "print 1 + 2;"
+                                 "print 1 / 2;"
+                                 "print \"hello\" + \" world\";"
+                                 "print !nil and 1 < 2;"
+                                 "var u; print u;"));
+    EXPECT_EQ("0\n1\n2\n6\n",
+              runAndCapture(lox, "for (var i = 0; i < 3; i = i + 1) print i;"
+                                 "var n = 0; var i = 0;"
+                                 "while (i < 4) { n = n + i; i = i + 1; }"
+                                 "print n;"));
+}
+
+TEST(InterpreterTest, FunctionsAndClosures) {
+    Lox lox;
+    EXPECT_EQ("55\n1\n2\n",
+              runAndCapture(lox, "fun fib(n) {"
+                                 "  if (n < 2) return n;"
+                                 "  return fib(n - 1) + fib(n - 2);"
+                                 "}"
+                                 "print fib(10);"
+                                 "fun counter() {"
+                                 "  var i = 0;"
+                                 "  fun inc() { i = i + 1; return i; }"
+                                 "  return inc;"
+                                 "}"
+                                 "var c = counter(); print c(); print c();"));
+}
+
+TEST(InterpreterTest, Classes) {
+    Lox lox;
+    EXPECT_EQ("Point instance\n3\nA.hi from B\n",
+              runAndCapture(lox, "class Point {"
+                                 "  init(x, y) { this.x = x; this.y = y; }"
+                                 "  sum() { return this.x + this.y; }"
+                                 "}"
+                                 "var p = Point(1, 2);"
+                                 "print p; print p.sum();"
+                                 "class A { hi() { return \"A.hi\"; } }"
+                                 "class B < A {"
+                                 "  hi() { return super.hi() + \" from B\"; }"
+                                 "}"
+                                 "print B().hi();"));
+}
+
+TEST(InterpreterTest, SessionKeepsStateAcrossRuns) {
+    Lox lox;
+    runAndCapture(lox, "var total = 1;");
+    runAndCapture(lox, "fun add(n) { total = total + n; }");
+    runAndCapture(lox, "class Box { get() { return total; } }");
+    runAndCapture(lox, "add(41);");
+    EXPECT_EQ("42\n", runAndCapture(lox, "print Box().get();"));
+
+    // 相同的字符串字面量在整个会话中只驻留一份
+    runAndCapture(lox, "var a = \"shared\";");
+    auto before = lox.getStrings().size();
+    runAndCapture(lox, "var b = \"shared\";");
+    EXPECT_EQ(before, lox.getStrings().size());
+    EXPECT_EQ("true\n", runAndCapture(lox, "print a == b;"));
+}
+
+} // namespace lox
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS(); // Runs all the tests
+}
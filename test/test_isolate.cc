@@ -0,0 +1,317 @@
+#include "Interpreter/Isolate.h"
+#include "Interpreter/Program.h"
+#include "Interpreter/Snapshot.h"
+#include "gtest/gtest.h"
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace lox {
+
+static const char *kScript = R"(
+fun fib(n) {
+  if (n < 2) return n;
+  return fib(n - 1) + fib(n - 2);
+}
+class Acc {
+  init() { this.text = ""; }
+  add(s) { this.text = this.text + s; return this; }
+}
+var acc = Acc();
+for (var i = 0; i < 20; i = i + 1) acc.add("x");
+print fib(15);
+print acc.text;
+)";
+
+TEST(IsolateTest, OwnsItsState) {
+    std::ostringstream out1, out2, err;
+    Isolate a(out1, err), b(out2, err);
+    EXPECT_EQ(Isolate::Status::OK, a.run("var x = 1; print x;"));
+    // 另一个 Isolate 看不到 a 的全局变量，也不会被 a 的错误影响
+    EXPECT_EQ(Isolate::Status::RUNTIME_ERROR, b.run("print x;"));
+    EXPECT_EQ(Isolate::Status::COMPILE_ERROR, b.run("var = ;"));
+    EXPECT_EQ(Isolate::Status::OK, a.run("print x + 1;"));
+    EXPECT_EQ("1\n2\n", out1.str());
+    EXPECT_EQ("", out2.str());
+}
+
+// 多个线程各自创建并运行 Isolate；用 -DLOX_SANITIZER=thread 构建时
+// 由 ThreadSanitizer 检查数据竞争
+TEST(IsolateTest, ConcurrentIsolates) {
+    constexpr int kThreads = 8;
+    constexpr int kRunsPerThread = 4;
+    std::vector<std::string> outputs(kThreads);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreads; t++) {
+        threads.emplace_back([t, &outputs] {
+            for (int run = 0; run < kRunsPerThread; run++) {
+                std::ostringstream out, err;
+                Isolate isolate(out, err);
+                if (isolate.run(kScript) != Isolate::Status::OK) {
+                    return;
+                }
+                outputs[t] += out.str();
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    std::string expected;
+    for (int run = 0; run < kRunsPerThread; run++) {
+        expected += "610\n" + std::string(20, 'x') + "\n";
+    }
+    for (const auto &output : outputs) {
+        EXPECT_EQ(expected, output);
+    }
+}
+
+// 同一个 Program 编译一次，被多个线程上的 Isolate 同时执行
+TEST(IsolateTest, SharedProgram) {
+    constexpr int kThreads = 8;
+    std::ostringstream compileErr;
+    ErrorReporter reporter(compileErr);
+    auto program = Program::compile(kScript, reporter);
+    ASSERT_NE(nullptr, program);
+
+    std::vector<std::string> outputs(kThreads);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreads; t++) {
+        threads.emplace_back([t, &outputs, &program] {
+            std::ostringstream out, err;
+            Isolate isolate(out, err);
+            // 同一个 Isolate 重复执行也不会互相干扰
+            for (int run = 0; run < 2; run++) {
+                if (isolate.run(program) != Isolate::Status::OK) {
+                    return;
+                }
+            }
+            outputs[t] = out.str();
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    std::string once = "610\n" + std::string(20, 'x') + "\n";
+    for (const auto &output : outputs) {
+        EXPECT_EQ(once + once, output);
+    }
+    EXPECT_EQ(nullptr, Program::compile("var = ;", reporter));
+    EXPECT_TRUE(reporter.hadError());
+}
+
+static const char *kPrelude = R"(
+class Table {
+  init() { this.size = 0; }
+  add() { this.size = this.size + 1; return this; }
+}
+fun makeCounter() {
+  var n = 0;
+  fun next() { n = n + 1; return n; }
+  return next;
+}
+var table = Table().add().add();
+var counter = makeCounter();
+var limit = 10;
+)";
+
+// 每次 fork 都从快照的状态开始，请求里的修改不会泄漏回快照
+TEST(IsolateTest, ForkFromSnapshot) {
+    std::ostringstream out, err;
+    Isolate prelude(out, err);
+    ASSERT_EQ(Isolate::Status::OK, prelude.run(kPrelude));
+    auto snapshot = prelude.snapshot();
+
+    const char *request = R"(
+table.add();
+limit = limit + 1;
+var fresh = "new";
+print table.size;
+print counter();
+print limit;
+)";
+    for (int i = 0; i < 3; i++) {
+        std::ostringstream forkOut;
+        Isolate fork(snapshot, forkOut, err);
+        EXPECT_EQ(Isolate::Status::OK, fork.run(request));
+        EXPECT_EQ("3\n1\n11\n", forkOut.str());
+        // fork 里定义的全局变量只属于这个 fork
+        EXPECT_EQ(Isolate::Status::OK, fork.run("print fresh;"));
+    }
+    Isolate fork(snapshot, out, err);
+    EXPECT_EQ(Isolate::Status::RUNTIME_ERROR, fork.run("print fresh;"));
+    // 做快照的 Isolate 自己也从快照继续运行
+    EXPECT_EQ(Isolate::Status::OK,
+              prelude.run("print table.size; print counter();"));
+    EXPECT_EQ("2\n1\n", out.str());
+    EXPECT_THROW(fork.snapshot(), std::logic_error);
+}
+
+// 程序不保留源码，快照文件保存的是语法树，从文件加载的快照照常执行
+TEST(IsolateTest, ReleasedSource) {
+    std::ostringstream out, err;
+    Isolate isolate(out, err);
+    ASSERT_EQ(Isolate::Status::OK, isolate.run(kScript));
+    EXPECT_EQ("610\nxxxxxxxxxxxxxxxxxxxx\n", out.str());
+    auto path = ::testing::TempDir() + "isolate_released.snapshot";
+    isolate.snapshot()->save(path);
+    std::ostringstream forkOut;
+    Isolate fork(Snapshot::load(path), forkOut, err);
+    std::remove(path.c_str());
+    EXPECT_EQ(Isolate::Status::OK, fork.run("print fib(10); print acc.text;"));
+    EXPECT_EQ("55\nxxxxxxxxxxxxxxxxxxxx\n", forkOut.str());
+}
+
+// 没有声明函数的程序执行完就释放，只有声明了函数的程序留给快照
+TEST(IsolateTest, KeepsOnlyProgramsWithFunctions) {
+    std::ostringstream out, err;
+    Isolate isolate(out, err);
+    auto run = [&](const char *source) -> std::weak_ptr<const Program> {
+        auto program = Program::compile(source, isolate.getReporter(),
+                                        &isolate.getStrings());
+        EXPECT_EQ(Isolate::Status::OK, isolate.run(program));
+        return program;
+    };
+    auto plain = run("var x = 1;\nwhile (x < 8) x = x * 2;");
+    auto classOnly = run("class Empty {}");
+    auto withFunction = run("fun get() { return x; }");
+    auto withMethod = run("class Box { get() { return x; } }");
+    EXPECT_TRUE(plain.expired());
+    EXPECT_TRUE(classOnly.expired());
+    EXPECT_FALSE(withFunction.expired());
+    EXPECT_FALSE(withMethod.expired());
+
+    std::ostringstream forkOut;
+    Isolate fork(isolate.snapshot(), forkOut, err);
+    EXPECT_EQ(Isolate::Status::OK, fork.run("print get(); print Box().get();"));
+    EXPECT_EQ("8\n8\n", forkOut.str());
+}
+
+TEST(IsolateTest, ConcurrentForks) {
+    constexpr int kThreads = 8;
+    std::ostringstream out, err;
+    Isolate prelude(out, err);
+    ASSERT_EQ(Isolate::Status::OK, prelude.run(kPrelude));
+    auto snapshot = prelude.snapshot();
+
+    std::vector<std::string> outputs(kThreads);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreads; t++) {
+        threads.emplace_back([t, &outputs, &snapshot] {
+            for (int run = 0; run < 4; run++) {
+                std::ostringstream forkOut, forkErr;
+                Isolate fork(snapshot, forkOut, forkErr);
+                fork.run("table.add(); print table.size + counter();");
+                outputs[t] += forkOut.str();
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    for (const auto &output : outputs) {
+        EXPECT_EQ("4\n4\n4\n4\n", output);
+    }
+}
+
+// 快照保存到文件再加载，效果与内存中的快照相同
+TEST(IsolateTest, SnapshotFile) {
+    std::ostringstream out, err;
+    Isolate prelude(out, err);
+    ASSERT_EQ(Isolate::Status::OK, prelude.run(kPrelude));
+    ASSERT_EQ(Isolate::Status::OK, prelude.run(R"(
+class Named < Table {
+  init(name) { super.init(); this.name = name; }
+  describe() { return this.name + ":" + this.name; }
+  grow() { return super.add().size; }
+}
+var named = Named("rows");
+var add = named.add;
+var pi = 3.5;
+var flag = true;
+var nothing;
+counter();
+)"));
+    auto path = ::testing::TempDir() + "isolate_test.snapshot";
+    prelude.snapshot()->save(path);
+    auto loaded = Snapshot::load(path);
+
+    std::ostringstream forkOut;
+    Isolate fork(loaded, forkOut, err);
+    EXPECT_EQ(Isolate::Status::OK, fork.run(R"(
+print table.size;
+print counter();
+print named.describe();
+print named.grow();
+print add == add;
+print add().name;
+print pi + limit;
+print flag;
+print nothing;
+print Named("x") != nil;
+)"));
+    EXPECT_EQ(
+        "2\n2\nrows:rows\n1\ntrue\nrows\n13.5\ntrue\nnil\ntrue\n",
+        forkOut.str());
+
+    Isolate second(loaded, forkOut, err);
+    EXPECT_EQ(Isolate::Status::OK, second.run("print named.size;"));
+    EXPECT_EQ("0\n", forkOut.str().substr(forkOut.str().size() - 2));
+    std::remove(path.c_str());
+
+    EXPECT_THROW(Snapshot::load(path), std::runtime_error);
+}
+
+// 快照文件带着语法树：行号和 Resolver 的结果原样恢复；
+// 截断的文件报告错误而不是崩溃
+TEST(IsolateTest, SnapshotFileKeepsTree) {
+    std::ostringstream out, err;
+    Isolate prelude(out, err);
+    ASSERT_EQ(Isolate::Status::OK, prelude.run(R"(
+var base = 10;
+fun outer(a) {
+  var local = a;
+  {
+    var inner = local + base;
+    return inner;
+  }
+}
+fun bad() {
+  return -"text";
+}
+)"));
+    auto path = ::testing::TempDir() + "isolate_tree.snapshot";
+    prelude.snapshot()->save(path);
+
+    std::ostringstream forkOut, forkErr;
+    Isolate fork(Snapshot::load(path), forkOut, forkErr);
+    EXPECT_EQ(Isolate::Status::OK, fork.run("print outer(5);"));
+    EXPECT_EQ("15\n", forkOut.str());
+    EXPECT_EQ(Isolate::Status::RUNTIME_ERROR, fork.run("bad();"));
+    EXPECT_NE(std::string::npos, forkErr.str().find("[line 11]"))
+        << forkErr.str();
+
+    std::string bytes;
+    {
+        std::ifstream file(path, std::ios::binary);
+        bytes.assign(std::istreambuf_iterator<char>(file), {});
+    }
+    for (auto size : {bytes.size() / 3, bytes.size() / 2, bytes.size() - 1}) {
+        std::ofstream(path, std::ios::binary | std::ios::trunc)
+            .write(bytes.data(), size);
+        EXPECT_THROW(Snapshot::load(path), std::runtime_error) << size;
+    }
+    std::remove(path.c_str());
+}
+
+} // namespace lox
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS(); // Runs all the tests
+}
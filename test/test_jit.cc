@@ -0,0 +1,128 @@
+#include "Interpreter/Interpreter.h"
+#include "Interpreter/Isolate.h"
+#include "Interpreter/Jit.h"
+#include "gtest/gtest.h"
+#include "isolate_runner.h"
+#include <string>
+
+namespace lox {
+
+// 分别用 JIT 和解释器执行 source，返回输出、错误和 JIT 的计数
+struct JitResult : RunResult {
+    std::size_t compiled;
+    std::size_t bailouts;
+};
+
+static auto runWith(const std::string &source, bool jit) -> JitResult {
+    std::size_t compiled = 0, bailouts = 0;
+    auto result = runIsolate(
+        tierConfig({Mode::TreeWalk, jit},
+                   [](Isolate &isolate) {
+                       isolate.getInterpreter()->getJit().setThreshold(2);
+                   }),
+        [&](Isolate &isolate) {
+            auto status = isolate.run(source);
+            auto &engine = isolate.getInterpreter()->getJit();
+            compiled = engine.compiledCount();
+            bailouts = engine.bailoutCount();
+            return status;
+        });
+    return {std::move(result), compiled, bailouts};
+}
+
+static auto expectSameAsInterpreter(const std::string &source) -> JitResult {
+    auto jit = runWith(source, true);
+    expectSameRun(runWith(source, false), jit, source);
+    return jit;
+}
+
+TEST(JitTest, NumericFunctions) {
+    if (!Jit::isSupported())
+        GTEST_SKIP() << "JIT is not supported on this platform";
+    auto result = expectSameAsInterpreter(R"(
+fun fib(n) { if (n < 2) return n; return fib(n - 1) + fib(n - 2); }
+print fib(20);
+fun sum(n) {
+  var s = 0;
+  for (var i = 0; i < n; i = i + 1) {
+    if (i == 3 or !(i >= 5) and i != 1) s = s + i * 2;
+    else s = s - i / 4;
+  }
+  return s;
+}
+print sum(1000);
+fun cmp(a, b) {
+  var r = 0;
+  if (a < b) r = r + 1;
+  if (a <= b) r = r + 10;
+  if (a > b) r = r + 100;
+  if (a >= b) r = r + 1000;
+  if (a == b) r = r + 10000;
+  return -r;
+}
+var nan = 0 / 0;
+for (var i = 0; i < 5; i = i + 1) print cmp(i, 2) + cmp(nan, i) + cmp(nan, nan);
+)");
+    EXPECT_GE(result.compiled, 2u);
+}
+
+TEST(JitTest, Bailouts) {
+    if (!Jit::isSupported())
+        GTEST_SKIP() << "JIT is not supported on this platform";
+    auto result = expectSameAsInterpreter(R"(
+fun add(a, b) { return a + b; }
+for (var i = 0; i < 10; i = i + 1) add(i, 1);
+print add("a", "b");
+fun half(x) { if (x > 5) return x / 2; }
+for (var i = 0; i < 10; i = i + 1) print half(i);
+fun g(a) { return a + 1; }
+fun h(a) { return g(a); }
+for (var i = 0; i < 10; i = i + 1) h(i);
+fun g(a) { return a + 100; }
+print h(1);
+fun g(a) { return "s"; }
+print h(1);
+)");
+    EXPECT_GT(result.bailouts, 0u);
+    // 参数不是数字时报告与解释器相同的错误
+    expectSameAsInterpreter(R"(
+fun inc(x) { return x + 1; }
+for (var i = 0; i < 10; i = i + 1) inc(i);
+inc("a");
+)");
+}
+
+// 有副作用或者用到闭包的函数不会被编译
+TEST(JitTest, UnsupportedFunctions) {
+    if (!Jit::isSupported())
+        GTEST_SKIP() << "JIT is not supported on this platform";
+    auto result = expectSameAsInterpreter(R"(
+fun show(x) { print x; return x; }
+for (var i = 0; i < 5; i = i + 1) show(i);
+fun counter() {
+  var n = 0;
+  fun next(step) { n = n + step; return n; }
+  return next;
+}
+var next = counter();
+for (var i = 0; i < 5; i = i + 1) print next(i);
+)");
+    EXPECT_EQ(0u, result.compiled);
+}
+
+TEST(JitTest, DeepRecursion) {
+    if (!Jit::isSupported())
+        GTEST_SKIP() << "JIT is not supported on this platform";
+    expectSameAsInterpreter(R"(
+fun down(n) { if (n <= 0) return 0; return down(n - 1) + 1; }
+for (var i = 0; i < 5; i = i + 1) down(10);
+print down(1000);
+)");
+}
+
+} // namespace lox
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS(); // Runs all the tests
+}
@@ -0,0 +1,151 @@
+#include "Interpreter/Interpreter.h"
+#include "Interpreter/Isolate.h"
+#include "Interpreter/Program.h"
+#include "Interpreter/Snapshot.h"
+#include "gtest/gtest.h"
+#include "isolate_runner.h"
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace lox {
+
+static auto lazyParsing(bool lazy) -> IsolateConfig {
+    return [lazy](Isolate &isolate) { isolate.setLazyParsing(lazy); };
+}
+
+static const char *kLibrary = R"(
+var calls = 0;
+fun fib(n) { calls = calls + 1; if (n < 2) return n; return fib(n - 1) + fib(n - 2); }
+fun makeCounter() {
+  var i = 0;
+  fun count() { i = i + 1; return i; }
+  return count;
+}
+class Shape {
+  init(name) { this.name = name; }
+  describe() { return this.name + " with sides"; }
+  area() { return 0; }
+}
+class Square < Shape {
+  init(side) { super.init("square"); this.side = side; }
+  area() { return this.side * this.side; }
+  describe() { return "[" + super.describe() + "]"; }
+}
+fun unused(a, b) { { var nested = a; } while (b) { b = false; } return a; }
+print fib(12);
+var counter = makeCounter();
+counter();
+print counter();
+print Square(3).describe();
+print Square(4).area();
+print calls;
+)";
+
+// 延迟解析与预先解析的输出完全相同
+TEST(LazyParseTest, MatchesEager) {
+    for (auto mode : kAllModes) {
+        auto eager = runInTier(kLibrary, {mode}, lazyParsing(false));
+        auto lazy = runInTier(kLibrary, {mode}, lazyParsing(true));
+        EXPECT_EQ(Isolate::Status::OK, lazy.status);
+        EXPECT_EQ(eager.output, lazy.output);
+        EXPECT_EQ("", lazy.errors);
+    }
+}
+
+// 没有调用过的函数体里的语法错误只在预先解析时报告
+TEST(LazyParseTest, UncalledSyntaxError) {
+    const char *source = "fun broken() { print ; }\nprint \"ok\";\n";
+    for (auto mode : kAllModes) {
+        auto eager = runInTier(source, {mode}, lazyParsing(false));
+        EXPECT_EQ(Isolate::Status::COMPILE_ERROR, eager.status);
+        EXPECT_EQ("", eager.output);
+        auto lazy = runInTier(source, {mode}, lazyParsing(true));
+        EXPECT_EQ(Isolate::Status::OK, lazy.status);
+        EXPECT_EQ("ok\n", lazy.output);
+    }
+}
+
+// 调用时才报告，诊断信息与预先解析时相同
+TEST(LazyParseTest, CalledSyntaxError) {
+    const char *source = "print 1;\nfun broken() {\n  print ;\n}\nbroken();\n"
+                         "print 2;\n";
+    auto eager = runInTier(source, {}, lazyParsing(false));
+    for (auto mode : kAllModes) {
+        auto lazy = runInTier(source, {mode}, lazyParsing(true));
+        EXPECT_EQ(Isolate::Status::RUNTIME_ERROR, lazy.status);
+        EXPECT_EQ("1\n", lazy.output);
+        EXPECT_EQ(eager.errors + "[line 2]\n", lazy.errors);
+    }
+}
+
+TEST(LazyParseTest, CalledResolveError) {
+    auto result = runInTier("class A { init() { return 1; } }\nA();\n", {},
+                            lazyParsing(true));
+    EXPECT_EQ(Isolate::Status::RUNTIME_ERROR, result.status);
+    EXPECT_NE(std::string::npos,
+              result.errors.find("Can't return a value from an initializer."));
+    result = runInTier("fun f() { print this; }\nf();\n", {},
+                       lazyParsing(true));
+    EXPECT_EQ(Isolate::Status::RUNTIME_ERROR, result.status);
+    EXPECT_NE(std::string::npos,
+              result.errors.find("Can't use 'this' outside of a class."));
+}
+
+// 花括号不配对时预解析就报告；块里的函数不延迟解析
+TEST(LazyParseTest, StillCheckedAtCompileTime) {
+    auto result = runInTier("fun f() { if (true) { print 1; }\n", {},
+                            lazyParsing(true));
+    EXPECT_EQ(Isolate::Status::COMPILE_ERROR, result.status);
+    EXPECT_NE(std::string::npos, result.errors.find("Expect '}' after block."));
+    result = runInTier("{ fun g() { print ; } }\n", {}, lazyParsing(true));
+    EXPECT_EQ(Isolate::Status::COMPILE_ERROR, result.status);
+}
+
+// 同一个 Program 在多个线程上执行，第一次调用时的解析只发生一次
+TEST(LazyParseTest, SharedProgram) {
+    std::ostringstream errors;
+    ErrorReporter reporter(errors);
+    auto program = Program::compile(kLibrary, reporter, nullptr, true);
+    ASSERT_NE(nullptr, program);
+    auto expected = runInTier(kLibrary, {}, lazyParsing(false)).output;
+    constexpr int kThreads = 4;
+    std::vector<std::string> outputs(kThreads);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreads; t++) {
+        threads.emplace_back([&, t] {
+            std::ostringstream out, err;
+            Isolate isolate(out, err);
+            if (isolate.run(program) == Isolate::Status::OK)
+                outputs[t] = out.str();
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    for (auto &output : outputs) {
+        EXPECT_EQ(expected, output);
+    }
+}
+
+// 快照需要所有函数，没有调用过的函数体这时也会解析
+TEST(LazyParseTest, Snapshot) {
+    std::ostringstream out, err;
+    Isolate isolate(out, err);
+    isolate.setLazyParsing(true);
+    ASSERT_EQ(Isolate::Status::OK, isolate.run(kLibrary));
+    auto snapshot = isolate.snapshot();
+    std::ostringstream forkOut;
+    Isolate fork(snapshot, forkOut, err);
+    EXPECT_EQ(Isolate::Status::OK,
+              fork.run("print unused(7, true); print counter();"));
+    EXPECT_EQ("7\n3\n", forkOut.str());
+}
+
+} // namespace lox
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS(); // Runs all the tests
+}
@@ -0,0 +1,233 @@
+#include "Interpreter/Interpreter.h"
+#include "Interpreter/Isolate.h"
+#include "Interpreter/ModuleCache.h"
+#include "gtest/gtest.h"
+#include "isolate_runner.h"
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <unistd.h>
+
+namespace lox {
+
+// 每个测试在自己的临时目录里写模块文件
+class ModuleTest : public ::testing::Test {
+  protected:
+    void SetUp() override {
+        auto *test = ::testing::UnitTest::GetInstance()->current_test_info();
+        m_root = std::filesystem::temp_directory_path() /
+                 ("lox_modules_" + std::to_string(::getpid()) + "_" +
+                  test->name());
+        std::filesystem::create_directories(m_root);
+    }
+    void TearDown() override { std::filesystem::remove_all(m_root); }
+
+    auto write(const std::string &name, const std::string &source) -> void {
+        auto path = m_root / name;
+        std::filesystem::create_directories(path.parent_path());
+        std::ofstream(path) << source;
+    }
+
+    auto run(const std::string &source, Mode mode,
+             ModuleCacheRef cache = std::make_shared<ModuleCache>())
+        -> RunResult {
+        return runInTier(source, {mode}, [&](Isolate &isolate) {
+            auto interpreter = isolate.getInterpreter();
+            interpreter->setModuleRoot(m_root.string());
+            interpreter->setModuleCache(std::move(cache));
+        });
+    }
+
+    std::filesystem::path m_root;
+};
+
+// 菱形依赖：common 只执行一次，两条路径得到同一个模块对象
+TEST_F(ModuleTest, LoadsOnce) {
+    write("common.lox", "print \"loading common\";\nvar answer = 42;\n");
+    write("lib/left.lox", "import \"../common.lox\";\nvar shared = common;\n");
+    write("lib/right.lox", "import \"../common.lox\";\nvar shared = common;\n");
+    const char *source = R"(
+import "lib/left.lox";
+import "lib/right.lox";
+import "common.lox";
+print left.shared == right.shared;
+print common == left.shared;
+print common.answer;
+)";
+    for (auto mode : kAllModes) {
+        auto result = run(source, mode);
+        EXPECT_EQ(Isolate::Status::OK, result.status);
+        EXPECT_EQ("loading common\ntrue\ntrue\n42\n", result.output);
+        EXPECT_EQ("", result.errors);
+    }
+}
+
+// 模块的顶层名字不进入全局环境；模块里的函数按词法作用域看到它们，
+// 包括后面才声明的函数
+TEST_F(ModuleTest, OwnScope) {
+    write("parity.lox", R"(
+var calls = 0;
+fun isEven(n) { calls = calls + 1; if (n == 0) return true; return isOdd(n - 1); }
+fun isOdd(n) { if (n == 0) return false; return isEven(n - 1); }
+fun count() { return calls; }
+class Pair {
+  init(a, b) { this.a = a; this.b = b; }
+  sum() { return this.a + this.b; }
+}
+)");
+    const char *source = R"(
+import "parity.lox" as p;
+print p.isEven(10);
+print p.isOdd(7);
+print p.count();
+print p.Pair(3, 4).sum();
+print p;
+print calls;
+)";
+    for (auto mode : kAllModes) {
+        auto result = run(source, mode);
+        EXPECT_EQ(Isolate::Status::RUNTIME_ERROR, result.status);
+        EXPECT_EQ("true\ntrue\n10\n7\nparity instance\n", result.output);
+        EXPECT_NE(std::string::npos,
+                  result.errors.find("Undefined variable 'calls'."));
+    }
+}
+
+// 模块对象上的字段就是模块的顶层变量：模块里的函数改了它们，
+// 从模块对象上读到的是新值；给模块对象的字段赋值，模块里的函数也能看到
+TEST_F(ModuleTest, LiveExports) {
+    write("counter.lox", R"(
+var count = 0;
+fun inc() { count = count + 1; return count; }
+)");
+    const char *source = R"(
+import "counter.lox" as m;
+m.inc();
+m.inc();
+print m.count;
+m.count = 10;
+print m.inc();
+)";
+    for (auto mode : kAllModes) {
+        auto result = run(source, mode);
+        EXPECT_EQ(Isolate::Status::OK, result.status) << result.errors;
+        EXPECT_EQ("2\n11\n", result.output);
+    }
+}
+
+// 模块能看到全局变量，对全局变量的赋值也作用在全局环境上
+TEST_F(ModuleTest, SeesGlobals) {
+    write("uses.lox", "var seen = config;\nconfig = \"release\";\n");
+    for (auto mode : kAllModes) {
+        auto result = run("var config = \"debug\";\nimport \"uses.lox\";\n"
+                          "print uses.seen;\nprint config;\n",
+                          mode);
+        EXPECT_EQ(Isolate::Status::OK, result.status);
+        EXPECT_EQ("debug\nrelease\n", result.output);
+    }
+}
+
+// 块和函数里的 import 只在局部作用域里绑定名字
+TEST_F(ModuleTest, LocalImport) {
+    write("math.lox", "fun square(x) { return x * x; }\n");
+    const char *source = R"(
+fun area(r) {
+  import "math.lox" as m;
+  return 3 * m.square(r);
+}
+print area(2);
+{ import "math.lox"; print math.square(5); }
+)";
+    for (auto mode : kAllModes) {
+        auto result = run(source, mode);
+        EXPECT_EQ(Isolate::Status::OK, result.status);
+        EXPECT_EQ("12\n25\n", result.output);
+    }
+}
+
+TEST_F(ModuleTest, CircularImport) {
+    write("a.lox", "import \"b.lox\";\n");
+    write("b.lox", "import \"a.lox\";\n");
+    for (auto mode : kAllModes) {
+        auto result = run("import \"a.lox\";\n", mode);
+        EXPECT_EQ(Isolate::Status::RUNTIME_ERROR, result.status);
+        EXPECT_NE(std::string::npos, result.errors.find("Circular import"));
+    }
+}
+
+TEST_F(ModuleTest, Errors) {
+    write("broken.lox", "var x = ;\n");
+    write("fails.lox", "print \"before\";\nprint -\"x\";\n");
+    for (auto mode : kAllModes) {
+        auto missing = run("import \"missing.lox\";\n", mode);
+        EXPECT_EQ(Isolate::Status::RUNTIME_ERROR, missing.status);
+        EXPECT_NE(std::string::npos, missing.errors.find("Can't open module"));
+
+        // 模块的编译错误带上模块的路径
+        auto broken = run("import \"broken.lox\";\n", mode);
+        EXPECT_EQ(Isolate::Status::RUNTIME_ERROR, broken.status);
+        EXPECT_NE(std::string::npos,
+                  broken.errors.find("broken.lox: [line 1] Error at ';'"));
+
+        // 执行失败的模块不算导入过，下次导入时重新执行
+        auto fails =
+            run("fun load() { import \"fails.lox\"; }\nload();\n", mode);
+        EXPECT_EQ(Isolate::Status::RUNTIME_ERROR, fails.status);
+        EXPECT_EQ("before\n", fails.output);
+    }
+}
+
+TEST_F(ModuleTest, ParseErrors) {
+    for (const char *source :
+         {"import 42;", "import \"m.lox\" as;", "import \"m.lox\"",
+          "import \"1st.lox\";", "import \"my-lib.lox\";",
+          "import \"class.lox\";", "import \"\";"}) {
+        auto result = run(source, Mode::TreeWalk);
+        EXPECT_EQ(Isolate::Status::COMPILE_ERROR, result.status) << source;
+    }
+}
+
+// 编译好的模块在共享同一个缓存的 Isolate 之间复用，修改文件之后重新编译
+TEST_F(ModuleTest, SharedCache) {
+    auto cache = std::make_shared<ModuleCache>();
+    write("value.lox", "var v = 1;\n");
+    std::string errors;
+    auto path = (m_root / "value.lox").string();
+    auto program = cache->load(path, errors);
+    ASSERT_NE(nullptr, program);
+    EXPECT_EQ(program, cache->load(path, errors));
+    for (auto mode : kAllModes) {
+        auto result =
+            run("import \"value.lox\";\nprint value.v;\n", mode, cache);
+        EXPECT_EQ("1\n", result.output);
+    }
+    EXPECT_EQ(1u, cache->size());
+    EXPECT_EQ(program, cache->load(path, errors));
+
+    write("value.lox", "var v = 2;\n");
+    std::filesystem::last_write_time(
+        path, std::filesystem::last_write_time(path) + std::chrono::seconds(1));
+    EXPECT_NE(program, cache->load(path, errors));
+    auto result = run("import \"value.lox\";\nprint value.v;\n",
+                      Mode::TreeWalk, cache);
+    EXPECT_EQ("2\n", result.output);
+}
+
+TEST_F(ModuleTest, NoSnapshot) {
+    write("m.lox", "var x = 1;\n");
+    std::ostringstream out, err;
+    Isolate isolate(out, err);
+    isolate.getInterpreter()->setModuleRoot(m_root.string());
+    ASSERT_EQ(Isolate::Status::OK, isolate.run("import \"m.lox\";"));
+    EXPECT_THROW(isolate.snapshot(), std::logic_error);
+}
+
+} // namespace lox
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS(); // Runs all the tests
+}
@@ -0,0 +1,114 @@
+#include "Interpreter/Isolate.h"
+#include "Interpreter/LoxString.h"
+#include "Interpreter/Program.h"
+#include "gtest/gtest.h"
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace lox {
+
+static const std::vector<SourceFile> kFiles = {
+    {"lib/shapes.lox", R"(
+class Shape {
+  init(name) { this.name = name; }
+  describe() { return this.name + ": " + this.kind(); }
+}
+fun square(x) { return x * x; }
+var registry = "shapes";
+)"},
+    {"team/circle.lox", R"(
+class Circle < Shape {
+  init(r) { super.init("circle"); this.r = r; }
+  kind() { return "round"; }
+  area() { return 3 * square(this.r); }
+}
+)"},
+    {"team/main.lox", R"(
+var c = Circle(2);
+print c.describe();
+print c.area();
+print registry;
+)"},
+};
+
+static auto concatenate(const std::vector<SourceFile> &files) -> std::string {
+    std::string source;
+    for (auto &file : files) {
+        source += file.source + "\n";
+    }
+    return source;
+}
+
+// 按顺序编译多个文件与编译把它们拼起来的源码结果相同
+TEST(MultiFileTest, MatchesConcatenatedSource) {
+    std::ostringstream expected, err;
+    Isolate single(expected, err);
+    ASSERT_EQ(Isolate::Status::OK, single.run(concatenate(kFiles)));
+    for (bool lazy : {false, true}) {
+        std::ostringstream out;
+        Isolate isolate(out, err);
+        isolate.setLazyParsing(lazy);
+        EXPECT_EQ(Isolate::Status::OK, isolate.runFiles(kFiles));
+        EXPECT_EQ(expected.str(), out.str());
+    }
+    EXPECT_EQ("", err.str());
+    EXPECT_EQ("circle: round\n12\nshapes\n", expected.str());
+}
+
+// 诊断信息带文件名，按文件顺序输出，与线程数无关
+TEST(MultiFileTest, DiagnosticsInFileOrder) {
+    std::vector<SourceFile> files = {
+        {"a.lox", "print 1;\nvar = 2;\n"},
+        {"b.lox", "print \"fine\";\n"},
+        {"c.lox", "@\nprint (;\n"},
+        {"d.lox", "fun f() { var x = x; }\n"},
+    };
+    const std::string expected =
+        "a.lox: [line 2] Error at '=': Expect variable name.\n"
+        "c.lox: [line 1] Error: Unexpected character.\n"
+        "c.lox: [line 2] Error at ';': Expect expression.\n"
+        "d.lox: [line 1] Error at 'x': Can't read local variable in its own "
+        "initializer.\n";
+    for (std::size_t threads : {1, 2, 4, 8}) {
+        for (int round = 0; round < 5; round++) {
+            std::ostringstream err;
+            ErrorReporter reporter(err);
+            auto program = Program::compileFiles(files, reporter, nullptr,
+                                                 false, threads);
+            EXPECT_EQ(nullptr, program);
+            EXPECT_TRUE(reporter.hadError());
+            EXPECT_EQ(expected, err.str()) << threads;
+        }
+    }
+}
+
+// 所有文件的字面量驻留到同一张表里
+TEST(MultiFileTest, InternsAcrossFiles) {
+    std::vector<SourceFile> files;
+    for (int i = 0; i < 20; i++) {
+        files.push_back({"f" + std::to_string(i) + ".lox",
+                         "print \"shared\"; print \"only" +
+                             std::to_string(i % 3) + "\";\n"});
+    }
+    std::ostringstream err;
+    ErrorReporter reporter(err);
+    StringTable strings;
+    auto program = Program::compileFiles(files, reporter, &strings, false, 4);
+    ASSERT_NE(nullptr, program);
+    EXPECT_EQ(4u, strings.size());
+    EXPECT_EQ(20u * 2, program->getStatements().size());
+}
+
+TEST(MultiFileTest, NoFiles) {
+    std::ostringstream out, err;
+    Isolate isolate(out, err);
+    EXPECT_EQ(Isolate::Status::OK, isolate.runFiles({}));
+}
+
+} // namespace lox
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS(); // Runs all the tests
+}
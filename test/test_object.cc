@@ -0,0 +1,63 @@
+#include "Interpreter/LoxString.h"
+#include "Interpreter/Object.h"
+#include "gtest/gtest.h"
+#include <string>
+
+namespace lox {
+
+static auto format(double num) -> std::string {
+    char buf[Object::kNumberBufferSize];
+    return std::string(buf, Object::formatNumber(num, buf));
+}
+
+TEST(ObjectTest, FormatNumber) {
+    EXPECT_EQ("0", format(0));
+    EXPECT_EQ("-0", format(-0.0));
+    EXPECT_EQ("123", format(123));
+    EXPECT_EQ("-7", format(-7));
+    EXPECT_EQ("0.1", format(0.1));
+    EXPECT_EQ("0.30000000000000004", format(0.1 + 0.2));
+    EXPECT_EQ("3.5", format(3.5));
+    EXPECT_EQ("10000000000000000", format(1e16));
+    EXPECT_EQ("1e+21", format(1e21));
+    EXPECT_EQ("1.5e-07", format(1.5e-7));
+    EXPECT_EQ("nan", format(0.0 / 0.0));
+    EXPECT_EQ("-inf", format(-1.0 / 0.0));
+    EXPECT_EQ("0.1", Object::make_num_obj(0.1).toString());
+}
+
+TEST(ObjectTest, RopeAndSlice) {
+    auto piece = LoxString::make(std::string(40, 'a'));
+    auto rope = LoxString::concat(piece, LoxString::make(std::string(40, 'b')));
+    EXPECT_EQ(LoxString::Rope, rope->getKind());
+    EXPECT_EQ(80u, rope->length());
+
+    auto slice = LoxString::slice(rope, 38, 4);
+    EXPECT_EQ(LoxString::Slice, slice->getKind());
+    EXPECT_EQ("aabb", slice->view());
+    EXPECT_EQ("ab", LoxString::slice(slice, 1, 2)->view());
+
+    EXPECT_TRUE(rope->equals(*LoxString::make(std::string(40, 'a') +
+                                              std::string(40, 'b'))));
+    EXPECT_EQ(LoxString::Flat, rope->getKind());
+
+    // 很深的左偏 Rope 展平和析构都不能爆栈
+    auto acc = LoxString::make("");
+    for (int i = 0; i < 200000; i++) {
+        acc = LoxString::concat(acc, piece);
+    }
+    EXPECT_EQ(200000u * 40, acc->length());
+    EXPECT_EQ(std::string(40, 'a'), LoxString::slice(acc, 40, 40)->view());
+    acc = LoxString::make("");
+    for (int i = 0; i < 200000; i++) {
+        acc = LoxString::concat(acc, piece);
+    }
+    acc.reset();
+}
+
+} // namespace lox
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS(); // Runs all the tests
+}
@@ -0,0 +1,115 @@
+#include "Interpreter/LoxString.h"
+#include "Interpreter/Scanner.h"
+#include "gtest/gtest.h"
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace lox {
+
+struct ScanResult {
+    std::vector<TokenRef> tokens;
+    std::string errors;
+};
+
+static auto scan(const std::string &source, StringTable *strings,
+                 std::size_t threads, std::size_t minChunk) -> ScanResult {
+    std::ostringstream err;
+    ErrorReporter reporter(err);
+    Scanner scanner(source, strings, &reporter);
+    auto tokens = threads == 0 ? scanner.scanTokens()
+                               : scanner.scanTokensParallel(threads, minChunk);
+    return {tokens, err.str()};
+}
+
+// 各种线程数和块大小下，并行扫描的 token 和错误与顺序扫描完全相同
+static auto expectSameAsSequential(const std::string &source) -> void {
+    auto expected = scan(source, nullptr, 0, 0);
+    for (std::size_t threads : {1, 2, 4, 8}) {
+        for (std::size_t minChunk : {1, 7, 64, 1000}) {
+            auto result = scan(source, nullptr, threads, minChunk);
+            EXPECT_EQ(expected.errors, result.errors)
+                << threads << " " << minChunk;
+            ASSERT_EQ(expected.tokens.size(), result.tokens.size())
+                << threads << " " << minChunk;
+            for (std::size_t i = 0; i < result.tokens.size(); i++) {
+                auto &a = expected.tokens[i];
+                auto &b = result.tokens[i];
+                EXPECT_EQ(a->getType(), b->getType()) << i;
+                EXPECT_EQ(a->getLexeme(), b->getLexeme()) << i;
+                EXPECT_EQ(a->getLine(), b->getLine()) << i;
+                ASSERT_EQ(a->getLiteral() == nullptr,
+                          b->getLiteral() == nullptr)
+                    << i;
+                if (a->getLiteral() != nullptr) {
+                    EXPECT_EQ(a->getLiteral()->toString(),
+                              b->getLiteral()->toString())
+                        << i;
+                }
+            }
+        }
+    }
+}
+
+TEST(ParallelScanTest, MatchesSequential) {
+    std::string source;
+    for (int i = 0; i < 200; i++) {
+        source += "var row" + std::to_string(i) + " = \"cell " +
+                  std::to_string(i) + "\"; // \"quoted\" in a comment\n";
+        if (i % 7 == 0) {
+            // 跨很多行、会越过好几个块边界的字符串，里面有 // 和 "
+            source += "print \"line one\n// not a comment\n" +
+                      std::string(i, 'x') + "\n\n\";\n";
+        }
+        if (i % 11 == 0)
+            source += "fun f" + std::to_string(i) + "(a) { return a * 1.5; }\n";
+    }
+    expectSameAsSequential(source);
+}
+
+TEST(ParallelScanTest, Errors) {
+    expectSameAsSequential("var a = 1;\n@\nvar b = 2;\n# $\nprint a;\n");
+    expectSameAsSequential("var a = 1;\nprint \"unterminated\nstring\n\n");
+    expectSameAsSequential("\"a\"\n\"b\n\"\n\"c");
+    expectSameAsSequential("");
+    expectSameAsSequential("\n\n\n");
+}
+
+// 随机拼接各种片段，块边界会落在各种 token 附近
+TEST(ParallelScanTest, RandomSources) {
+    const char *pieces[] = {"var ", "x", " = ", "1.25", ";", "\n", "\"",
+                            "// c\n", "  ", "\t", "print", "(", ")", "@",
+                            "/", "!=", "\r\n"};
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<int> pick(0, std::size(pieces) - 1);
+    for (int round = 0; round < 30; round++) {
+        std::string source;
+        for (int i = 0; i < 300; i++)
+            source += pieces[pick(rng)];
+        expectSameAsSequential(source);
+    }
+}
+
+// 字符串字面量与顺序扫描一样放进驻留表
+TEST(ParallelScanTest, InternsStrings) {
+    std::string source;
+    for (int i = 0; i < 100; i++)
+        source += "print \"same\";\nprint \"other\n\";\n";
+    StringTable strings;
+    auto result = scan(source, &strings, 4, 16);
+    EXPECT_EQ(2u, strings.size());
+    auto first = result.tokens[1]->getLiteral()->getString();
+    for (auto &token : result.tokens) {
+        if (token->getType() == STRING && token->getLexeme() == "\"same\"") {
+            EXPECT_EQ(first, token->getLiteral()->getString());
+        }
+    }
+}
+
+} // namespace lox
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS(); // Runs all the tests
+}
@@ -0,0 +1,110 @@
+#include "Interpreter/ScanKernels.h"
+#include "Interpreter/Scanner.h"
+#include "gtest/gtest.h"
+#include <random>
+#include <sstream>
+#include <initializer_list>
+#include <string>
+#include <vector>
+
+namespace lox {
+
+using Path = ScanKernels::Path;
+
+static auto availableKernels() -> std::vector<const ScanKernels *> {
+    std::vector<const ScanKernels *> kernels;
+    for (auto path : {Path::Scalar, Path::Sse2, Path::Avx2}) {
+        if (auto *k = ScanKernels::get(path))
+            kernels.push_back(k);
+    }
+    return kernels;
+}
+
+// 由少数几种字符组成的随机输入，让各种边界（块的开头、中间、结尾）都出现
+static auto randomInput(std::mt19937 &rng, std::size_t size) -> std::string {
+    static const char alphabet[] = " \t\r\n\"ab_Z09/.\x80\xff";
+    std::uniform_int_distribution<int> pick(0, sizeof(alphabet) - 2);
+    std::uniform_int_distribution<int> run(1, 40);
+    std::string input;
+    while (input.size() < size)
+        input.append(run(rng), alphabet[pick(rng)]);
+    input.resize(size);
+    return input;
+}
+
+TEST(ScanKernelsTest, MatchScalar) {
+    const auto &scalar = *ScanKernels::get(Path::Scalar);
+    std::mt19937 rng(42);
+    for (int round = 0; round < 200; round++) {
+        auto input = randomInput(rng, round % 100);
+        const char *begin = input.data();
+        const char *end = begin + input.size();
+        for (auto *kernels : availableKernels()) {
+            for (const char *p = begin; p <= end; p++) {
+                int expectedLines = 0, lines = 0;
+                EXPECT_EQ(scalar.skipWhitespace(p, end, &expectedLines),
+                          kernels->skipWhitespace(p, end, &lines));
+                EXPECT_EQ(expectedLines, lines);
+                EXPECT_EQ(scalar.findNewline(p, end),
+                          kernels->findNewline(p, end));
+                expectedLines = lines = 0;
+                EXPECT_EQ(scalar.findQuote(p, end, &expectedLines),
+                          kernels->findQuote(p, end, &lines));
+                EXPECT_EQ(expectedLines, lines);
+                EXPECT_EQ(scalar.skipIdentifier(p, end),
+                          kernels->skipIdentifier(p, end));
+            }
+        }
+    }
+}
+
+// 每种实现扫描出的 token（种类、词素、行号）和错误都相同
+TEST(ScanKernelsTest, ScannerMatchesScalar) {
+    std::string source;
+    for (int i = 0; i < 30; i++) {
+        source += "        // comment number " + std::to_string(i) +
+                  " with some padding text\n"
+                  "    var long_identifier_name_" +
+                  std::to_string(i) + " = \"a string literal that spans\n" +
+                  std::string(i, ' ') + "several lines\";\n\t\r\n";
+    }
+    source += "print @ \"unterminated\n string";
+
+    auto scan = [&](const ScanKernels &kernels, std::string &errors) {
+        std::ostringstream err;
+        ErrorReporter reporter(err);
+        Scanner scanner(source, nullptr, &reporter);
+        scanner.setKernels(kernels);
+        auto tokens = scanner.scanTokens();
+        errors = err.str();
+        return tokens;
+    };
+    std::string expectedErrors;
+    auto expected = scan(*ScanKernels::get(Path::Scalar), expectedErrors);
+    EXPECT_NE(std::string::npos, expectedErrors.find("Unterminated string."));
+    for (auto *kernels : availableKernels()) {
+        std::string errors;
+        auto tokens = scan(*kernels, errors);
+        EXPECT_EQ(expectedErrors, errors);
+        ASSERT_EQ(expected.size(), tokens.size());
+        for (std::size_t i = 0; i < tokens.size(); i++) {
+            EXPECT_EQ(expected[i]->getType(), tokens[i]->getType()) << i;
+            EXPECT_EQ(expected[i]->getLexeme(), tokens[i]->getLexeme()) << i;
+            EXPECT_EQ(expected[i]->getLine(), tokens[i]->getLine()) << i;
+        }
+    }
+}
+
+TEST(ScanKernelsTest, Selection) {
+    EXPECT_NE(nullptr, ScanKernels::get(Path::Scalar));
+    auto &best = ScanKernels::best();
+    EXPECT_EQ(&best, ScanKernels::get(best.path));
+    EXPECT_STREQ("avx2", ScanKernels::pathName(Path::Avx2));
+}
+
+} // namespace lox
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS(); // Runs all the tests
+}
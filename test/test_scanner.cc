@@ -1,12 +1,15 @@
 #include "Interpreter/Scanner.h"
+#include "Interpreter/Tokentype.h"
 #include "gtest/gtest.h"
+#include <memory>
 #include <ostream>
+#include <string>
 
 namespace lox {
 
 TEST(ScannerTest, BasicTest1) {
     std::string source = "var a = 123;";
-    auto scan = new Scanner(source);
+    auto scan = std::make_unique<Scanner>(source);
     scan->scanTokens();
     auto token_vec = scan->getTokens();
     for (const auto &t : token_vec) {
@@ -17,6 +20,70 @@ TEST(ScannerTest, BasicTest1) {
     // EXPECT_EQ("var", token_vec[2]->getLexeme());
 }
 
+// 关键字识别在编译期就能求值
+static_assert(keywordType("while") == WHILE);
+static_assert(keywordType("whilst") == IDENTIFIER);
+static_assert(tokenTypeName(EOF_TOKEN) == "EOF_TOKEN");
+static_assert(tokenSpelling(GREATER_EQUAL) == ">=");
+static_assert(tokenSpelling(IDENTIFIER).empty());
+
+TEST(ScannerTest, Keywords) {
+    const std::pair<const char *, TokenType> keywords[] = {
+        {"and", AND},       {"class", CLASS}, {"else", ELSE},
+        {"false", FALSE},   {"for", FOR},     {"fun", FUN},
+        {"if", IF},         {"import", IMPORT}, {"nil", NIL},
+        {"or", OR},         {"print", PRINT}, {"return", RETURN},
+        {"super", SUPER},   {"this", THIS},   {"true", TRUE},
+        {"var", VAR},       {"while", WHILE}};
+    for (const auto &[text, type] : keywords) {
+        EXPECT_EQ(type, keywordType(text)) << text;
+        // 关键字的前缀、加长以及只差一个字母的标识符都不是关键字
+        std::string word = text;
+        EXPECT_EQ(IDENTIFIER, keywordType(word.substr(0, word.size() - 1)));
+        EXPECT_EQ(IDENTIFIER, keywordType(word + "s"));
+        EXPECT_EQ(IDENTIFIER, keywordType("_" + word));
+        word.back() = 'X';
+        EXPECT_EQ(IDENTIFIER, keywordType(word));
+    }
+    for (const char *text : {"", "a", "f", "t", "fa", "th", "tr", "fx", "tx",
+                             "AND", "For", "variable", "thiss"}) {
+        EXPECT_EQ(IDENTIFIER, keywordType(text)) << text;
+    }
+}
+
+TEST(ScannerTest, IdentifiersAndKeywords) {
+    Scanner scanner("var fortune = this.orchid or nil;");
+    auto tokens = scanner.scanTokens();
+    const TokenType expected[] = {VAR, IDENTIFIER, EQUAL, THIS, DOT,
+                                  IDENTIFIER, OR, NIL, SEMICOLON, EOF_TOKEN};
+    ASSERT_EQ(std::size(expected), tokens.size());
+    for (std::size_t i = 0; i < tokens.size(); i++) {
+        EXPECT_EQ(expected[i], tokens[i]->getType())
+            << i << " " << tokenTypeName(tokens[i]->getType());
+    }
+    EXPECT_EQ("fortune", tokens[1]->getLexeme());
+    EXPECT_EQ("orchid", tokens[5]->getLexeme());
+}
+
+// 只有字面量有字面量对象，不保存的词素推出来和源码中的一样
+TEST(ScannerTest, CompactTokens) {
+    Scanner scanner("var count = count + 1.50; print \"a\nb\" >= count;");
+    auto tokens = scanner.scanTokens();
+    const char *lexemes[] = {"var",  "count",      "=",  "count", "+",
+                             "1.50", ";",          "print", "\"a\nb\"",
+                             ">=",   "count",      ";",  ""};
+    ASSERT_EQ(std::size(lexemes), tokens.size());
+    for (std::size_t i = 0; i < tokens.size(); i++) {
+        EXPECT_EQ(lexemes[i], tokens[i]->getLexeme()) << i;
+        auto type = tokens[i]->getType();
+        EXPECT_EQ(type == NUMBER || type == STRING,
+                  tokens[i]->getLiteral() != nullptr)
+            << i;
+    }
+    EXPECT_EQ(1.5, tokens[5]->getLiteral()->getNum());
+    EXPECT_EQ("a\nb", tokens[8]->getLiteral()->getString()->str());
+}
+
 } // namespace lox
 
 int main(int argc, char **argv) {
@@ -0,0 +1,142 @@
+#include "Interpreter/Interpreter.h"
+#include "Interpreter/Isolate.h"
+#include "Interpreter/Scanner.h"
+#include "gtest/gtest.h"
+#include "isolate_runner.h"
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace lox {
+
+// 按流执行 source，整体执行用 runInTier
+static auto runStreamed(const std::string &source, Tier tier = {})
+    -> RunResult {
+    return runIsolate(tierConfig(tier), [&](Isolate &isolate) {
+        std::istringstream input(source);
+        return isolate.runStream(input);
+    });
+}
+
+static auto scanAll(Scanner &scanner) -> std::vector<TokenRef> {
+    std::vector<TokenRef> tokens;
+    do {
+        tokens.push_back(scanner.nextToken());
+    } while (tokens.back()->getType() != EOF_TOKEN);
+    return tokens;
+}
+
+// 各种块大小下，流式扫描的 token 和错误与一次扫描整个源码完全相同
+static auto expectSameTokens(const std::string &source) -> void {
+    std::ostringstream expectedErr;
+    ErrorReporter expectedReporter(expectedErr);
+    Scanner whole(source, nullptr, &expectedReporter);
+    auto expected = whole.scanTokens();
+    for (std::size_t block : {1, 3, 16, 4096}) {
+        std::istringstream input(source);
+        std::ostringstream err;
+        ErrorReporter reporter(err);
+        Scanner scanner(input, nullptr, &reporter, block);
+        auto tokens = scanAll(scanner);
+        EXPECT_EQ(expectedErr.str(), err.str()) << block;
+        ASSERT_EQ(expected.size(), tokens.size()) << block;
+        for (std::size_t i = 0; i < tokens.size(); i++) {
+            EXPECT_EQ(expected[i]->getType(), tokens[i]->getType()) << i;
+            EXPECT_EQ(expected[i]->getLexeme(), tokens[i]->getLexeme()) << i;
+            EXPECT_EQ(expected[i]->getLine(), tokens[i]->getLine()) << i;
+        }
+        // 到达末尾后一直返回 EOF
+        EXPECT_EQ(EOF_TOKEN, scanner.nextToken()->getType());
+    }
+}
+
+TEST(StreamingTest, TokensMatchScanTokens) {
+    expectSameTokens("var a = 1;\nprint \"multi\nline\n\nstring\";\n"
+                     "// comment\nfun f(x) { return x >= 2.5; }\n");
+    expectSameTokens("print \"unterminated\nstring\n");
+    expectSameTokens("var a = @;\n# $\nprint a;");
+    expectSameTokens("");
+    expectSameTokens("\n\n\n");
+}
+
+TEST(StreamingTest, RandomSources) {
+    const char *pieces[] = {"var ", "x", " = ", "1.25", ";", "\n", "\"",
+                            "// c\n", "  ", "\t", "print", "(", ")", "@",
+                            "/", "!=", "\r\n"};
+    std::mt19937 rng(11);
+    std::uniform_int_distribution<int> pick(0, std::size(pieces) - 1);
+    for (int round = 0; round < 20; round++) {
+        std::string source;
+        for (int i = 0; i < 200; i++)
+            source += pieces[pick(rng)];
+        expectSameTokens(source);
+    }
+}
+
+// 正确的程序按流执行与整体执行的输出相同
+TEST(StreamingTest, MatchesRun) {
+    const char *source = R"(
+fun fib(n) { if (n < 2) return n; return fib(n - 1) + fib(n - 2); }
+class Point {
+  init(x, y) { this.x = x; this.y = y; }
+  sum() { return this.x + this.y; }
+}
+fun makeAdder(n) { fun add(x) { return x + n; } return add; }
+var add2 = makeAdder(2);
+var text = "a
+b";
+for (var i = 0; i < 5; i = i + 1) {
+  print fib(i + 10) + Point(i, 1).sum() + add2(i);
+}
+print text;
+{ var shadow = 1; { var shadow = 2; print shadow; } print shadow; }
+)";
+    for (auto mode : kAllModes) {
+        auto streamed = runStreamed(source, {mode});
+        EXPECT_EQ(Isolate::Status::OK, streamed.status);
+        expectSameRun(runInTier(source, {mode}), streamed, describe({mode}));
+    }
+}
+
+// 语法错误之前的声明已经执行过；之后只报告错误，不再执行
+TEST(StreamingTest, CompileErrorStopsExecution) {
+    const char *source = "print 1;\nprint 2;\nvar = 3;\nprint 4;\n"
+                         "print (;\n";
+    auto whole = runInTier(source, {});
+    auto streamed = runStreamed(source);
+    EXPECT_EQ(Isolate::Status::COMPILE_ERROR, streamed.status);
+    EXPECT_EQ("", whole.output);
+    EXPECT_EQ("1\n2\n", streamed.output);
+    EXPECT_EQ(whole.errors, streamed.errors);
+
+    auto resolveError = runStreamed("print 1;\nreturn 2;\nprint 3;\n");
+    EXPECT_EQ(Isolate::Status::COMPILE_ERROR, resolveError.status);
+    EXPECT_EQ("1\n", resolveError.output);
+}
+
+TEST(StreamingTest, RuntimeErrorStopsExecution) {
+    auto result = runStreamed("print 1;\nprint -\"x\";\nprint 2;\n");
+    EXPECT_EQ(Isolate::Status::RUNTIME_ERROR, result.status);
+    EXPECT_EQ("1\n", result.output);
+    EXPECT_NE(std::string::npos, result.errors.find("[line 2]"));
+}
+
+// 之后在同一个 Isolate 上还能继续 run，但不能再做快照
+TEST(StreamingTest, IsolateKeepsState) {
+    std::ostringstream out, err;
+    Isolate isolate(out, err);
+    std::istringstream input("var x = 40;\nfun f() { return x + 1; }\n");
+    EXPECT_EQ(Isolate::Status::OK, isolate.runStream(input));
+    EXPECT_EQ(Isolate::Status::OK, isolate.run("print f() + 1;"));
+    EXPECT_EQ("42\n", out.str());
+    EXPECT_THROW(isolate.snapshot(), std::logic_error);
+}
+
+} // namespace lox
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS(); // Runs all the tests
+}
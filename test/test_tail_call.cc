@@ -0,0 +1,169 @@
+#include "Interpreter/Interpreter.h"
+#include "Interpreter/Isolate.h"
+#include "Interpreter/Jit.h"
+#include "gtest/gtest.h"
+#include "aot_runner.h"
+#include "isolate_runner.h"
+#include <cstdio>
+#include <functional>
+#include <pthread.h>
+#include <string>
+
+namespace lox {
+
+// 三种执行方式、开关 JIT 的结果都必须相同
+static auto expectEverywhere(const std::string &source,
+                             const std::string &output,
+                             Isolate::Status status = Isolate::Status::OK)
+    -> void {
+    for (auto tier : allTiers()) {
+        auto result = runInTier(source, tier);
+        EXPECT_EQ(status, result.status) << describe(tier) << "\n"
+                                         << result.errors;
+        EXPECT_EQ(output, result.output) << describe(tier);
+    }
+}
+
+// 在原生栈只有 size 字节的新线程上执行 body
+static auto onSmallStack(std::size_t size, std::function<void()> body)
+    -> void {
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setstacksize(&attr, size);
+    pthread_t thread;
+    auto start = [](void *arg) -> void * {
+        (*static_cast<std::function<void()> *>(arg))();
+        return nullptr;
+    };
+    ASSERT_EQ(0, pthread_create(&thread, &attr, start, &body));
+    pthread_join(thread, nullptr);
+    pthread_attr_destroy(&attr);
+}
+
+// 尾递归的深度不随递归次数增长：最大调用深度只有 8、原生栈只有 1 MB 时
+// 照样能递归下去。JIT 编译的机器码不计调用深度，直接递归 10^7 次
+TEST(TailCallTest, SelfRecursion) {
+    const char *source = R"(
+fun count(n, acc) {
+  if (n == 0) return acc;
+  return count(n - 1, acc + 1);
+}
+)";
+    onSmallStack(1024 * 1024, [&] {
+        for (auto tier : allTiers()) {
+            // 不开 JIT 时每次调用都要解释执行，带 sanitizer 的构建里
+            // 10^7 次要几分钟；深度不增长已经由调用深度的上限保证
+            std::string n = tier.jit && Jit::isSupported() ? "10000000"
+                                                           : "100000";
+            auto program = source + ("print count(" + n + ", 0);\n");
+            auto result = runInTier(program, tier, [](Isolate &isolate) {
+                isolate.getInterpreter()->setMaxCallDepth(8);
+            });
+            EXPECT_EQ(Isolate::Status::OK, result.status)
+                << describe(tier) << "\n"
+                << result.errors;
+            EXPECT_EQ(n + "\n", result.output) << describe(tier);
+        }
+    });
+}
+
+TEST(TailCallTest, MutualRecursion) {
+    expectEverywhere(R"(
+fun even(n) { if (n == 0) return true; return odd(n - 1); }
+fun odd(n) { if (n == 0) return false; return even(n - 1); }
+print even(100001);
+print odd(100001);
+)",
+                     "false\ntrue\n");
+}
+
+// 方法和绑定方法的尾调用同样不占栈
+TEST(TailCallTest, Methods) {
+    expectEverywhere(R"(
+class Counter {
+  run(n) { if (n == 0) return "done"; return this.run(n - 1); }
+}
+print Counter().run(50000);
+class Greeter {
+  init(name) { this.name = name; }
+  greet() { return "hi " + this.name; }
+}
+fun apply(n, f) { if (n == 0) return f(); return apply(n - 1, f); }
+print apply(50000, Greeter("lox").greet);
+)",
+                     "done\nhi lox\n");
+}
+
+// 尾位置上的类调用和错误照常处理
+TEST(TailCallTest, OtherCallees) {
+    expectEverywhere(R"(
+class A { init(x) { this.x = x; } }
+fun make() { return A(3); }
+print make().x;
+fun chain(n) { if (n == 0) return make; return chain(n - 1); }
+print chain(3)().x;
+)",
+                     "3\n3\n");
+    expectEverywhere("fun f(a) { return a; }\nfun g() { return f(); }\ng();\n",
+                     "", Isolate::Status::RUNTIME_ERROR);
+    expectEverywhere("fun g() { return 1(); }\ng();\n", "",
+                     Isolate::Status::RUNTIME_ERROR);
+}
+
+// 初始化方法总是返回 this，其中的 return 不能当作尾调用
+TEST(TailCallTest, Initializer) {
+    expectEverywhere(R"(
+fun f() { return 1; }
+class A {
+  init() { this.v = f(); }
+  again() { return this.init(); }
+}
+print A().again().v;
+)",
+                     "1\n");
+}
+
+// 非尾调用的结果仍然参与后续计算
+TEST(TailCallTest, NonTailCalls) {
+    expectEverywhere(R"(
+fun fib(n) { if (n < 2) return n; return fib(n - 1) + fib(n - 2); }
+print fib(15);
+fun twice(n) { return (twice1(n)); }
+fun twice1(n) { return n * 2; }
+print twice(21);
+)",
+                     "610\n42\n");
+}
+
+// 预先编译的程序同样在原地执行尾调用
+TEST(TailCallTest, AheadOfTime) {
+    if (!compilerAvailable())
+        GTEST_SKIP() << "no system C++ compiler";
+    const std::string source = R"(
+fun loop(n, acc) { if (n == 0) return acc; return loop(n - 1, acc + 1); }
+print loop(1000000, 0);
+fun even(n) { if (n == 0) return true; return odd(n - 1); }
+fun odd(n) { if (n == 0) return false; return even(n - 1); }
+print even(1000001);
+class Counter {
+  run(n) { if (n == 0) return "done"; return this.run(n - 1); }
+}
+print Counter().run(1000000);
+class A { init(x) { this.x = x; } }
+fun make(x) { return A(x); }
+print make(3).x;
+)";
+    auto path = tempPath("lox_aot_tail_call");
+    ASSERT_TRUE(build(source, path, Transpiler::Output::Executable));
+    std::string output;
+    EXPECT_EQ(0, runExecutable(path, output));
+    EXPECT_EQ("1000000\nfalse\ndone\n3\n", output);
+    std::remove(path.c_str());
+}
+
+} // namespace lox
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS(); // Runs all the tests
+}
@@ -0,0 +1,142 @@
+#include "Interpreter/Isolate.h"
+#include "Interpreter/Program.h"
+#include "Interpreter/Transpiler.h"
+#include "gtest/gtest.h"
+#include "aot_runner.h"
+#include <cstdio>
+#include <sstream>
+#include <string>
+
+namespace lox {
+
+static const char *kScript = R"(
+fun fib(n) { if (n < 2) return n; return fib(n - 1) + fib(n - 2); }
+print fib(15);
+fun makeCounter() {
+  var i = 0;
+  fun count() { i = i + 1; return i; }
+  return count;
+}
+var counter = makeCounter();
+counter();
+print counter();
+class A {
+  init(x) { this.x = x; }
+  get() { return this.x; }
+  say() { return "A" + this.name(); }
+  name() { return "a"; }
+}
+class B < A {
+  init(x) { super.init(x * 2); }
+  name() { return "b"; }
+  say() { return super.say() + "!"; }
+}
+var b = B(21);
+print b.get();
+print b.say();
+print b;
+print B;
+print b.get;
+print b.init(5).get();
+print 1 / 3;
+print -0;
+print 0 / 0 == 0 / 0;
+print nil or "d";
+print 1 and 2;
+print !nil;
+var s = "";
+for (var i = 0; i < 5; i = i + 1) s = s + "x";
+print s;
+var first;
+var second;
+for (var i = 0; i < 2; i = i + 1) {
+  var j = i;
+  fun f() { return j; }
+  if (i == 0) first = f; else second = f;
+}
+print first();
+print second();
+)";
+
+// 解释执行，返回标准输出和标准错误拼在一起的结果
+static auto interpret(const std::string &source, Isolate::Status &status)
+    -> std::string {
+    std::ostringstream out, err;
+    Isolate isolate(out, err);
+    status = isolate.run(source);
+    return out.str() + err.str();
+}
+
+TEST(TranspilerTest, MatchesInterpreter) {
+    if (!compilerAvailable())
+        GTEST_SKIP() << "no system C++ compiler";
+    auto path = tempPath("lox_aot_script");
+    ASSERT_TRUE(build(kScript, path, Transpiler::Output::Executable));
+    Isolate::Status status;
+    auto expected = interpret(kScript, status);
+    ASSERT_EQ(Isolate::Status::OK, status);
+    std::string output;
+    EXPECT_EQ(0, runExecutable(path, output));
+    EXPECT_EQ(expected, output);
+    std::remove(path.c_str());
+}
+
+TEST(TranspilerTest, RuntimeError) {
+    if (!compilerAvailable())
+        GTEST_SKIP() << "no system C++ compiler";
+    const std::string source = "print 1;\n"
+                               "fun f(a) { return a + 1; }\n"
+                               "print f(\"x\");\n";
+    auto path = tempPath("lox_aot_error");
+    ASSERT_TRUE(build(source, path, Transpiler::Output::Executable));
+    Isolate::Status status;
+    auto expected = interpret(source, status);
+    ASSERT_EQ(Isolate::Status::RUNTIME_ERROR, status);
+    std::string output;
+    EXPECT_EQ(70, runExecutable(path, output));
+    EXPECT_EQ(expected, output);
+    std::remove(path.c_str());
+}
+
+// 无限递归与解释器一样报告 "Stack overflow."，而不是让进程崩溃
+TEST(TranspilerTest, StackOverflow) {
+    if (!compilerAvailable())
+        GTEST_SKIP() << "no system C++ compiler";
+    const std::string source = "fun f(n) { return 1 + f(n + 1); }\n"
+                               "f(0);\n";
+    auto path = tempPath("lox_aot_overflow");
+    ASSERT_TRUE(build(source, path, Transpiler::Output::Executable));
+    Isolate::Status status;
+    auto expected = interpret(source, status);
+    ASSERT_EQ(Isolate::Status::RUNTIME_ERROR, status);
+    std::string output;
+    EXPECT_EQ(70, runExecutable(path, output));
+    EXPECT_EQ(expected, output);
+    std::remove(path.c_str());
+}
+
+TEST(TranspilerTest, SharedObject) {
+    if (!compilerAvailable())
+        GTEST_SKIP() << "no system C++ compiler";
+    const std::string source = "var total = 0;\n"
+                               "for (var i = 1; i <= 10; i = i + 1) {\n"
+                               "  total = total + i;\n"
+                               "}\n"
+                               "print total;\n";
+    auto path = tempPath("lox_aot_shared") + ".so";
+    ASSERT_TRUE(build(source, path, Transpiler::Output::SharedObject));
+    // 每次运行都从干净的全局状态开始
+    for (int run = 0; run < 2; run++) {
+        testing::internal::CaptureStdout();
+        EXPECT_EQ(0, Transpiler::runShared(path));
+        EXPECT_EQ("55\n", testing::internal::GetCapturedStdout());
+    }
+    std::remove(path.c_str());
+}
+
+} // namespace lox
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS(); // Runs all the tests
+}
@@ -0,0 +1,75 @@
+#include "Interpreter/Interpreter.h"
+#include "Interpreter/Isolate.h"
+#include "Interpreter/Program.h"
+#include "Interpreter/Transpiler.h"
+#include "lox_bench.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+#include <string>
+#include <unistd.h>
+
+namespace lox::bench {
+
+// 同一个程序解释执行（关闭和开启 JIT）与预先编译成本地可执行文件的对比。
+// 本地版本单独报告编译耗时，运行耗时包括进程启动
+auto benchAot() -> void {
+    struct Case {
+        const char *name;
+        const char *source;
+        std::size_t ops;
+    };
+    const Case cases[] = {
+        {"fib",
+         "fun fib(n) { if (n < 2) return n; return fib(n - 1) + fib(n - 2); }\n"
+         "print fib(25);\n",
+         242785},
+        {"objects",
+         "class Point {\n"
+         "  init(x, y) { this.x = x; this.y = y; }\n"
+         "  add(other) { return Point(this.x + other.x, this.y + other.y); }\n"
+         "}\n"
+         "var p = Point(0, 0);\n"
+         "for (var i = 0; i < 100000; i = i + 1) p = p.add(Point(1, 2));\n"
+         "print p.x + p.y;\n",
+         100000},
+    };
+    for (const auto &c : cases) {
+        for (bool jit : {false, true}) {
+            std::ostringstream out, err;
+            auto seconds = timeIt([&] {
+                Isolate isolate(out, err);
+                isolate.getInterpreter()->getJit().setEnabled(jit);
+                isolate.run(c.source);
+            });
+            consume(out.str().size());
+            report(std::string("aot/") + c.name,
+                   jit ? "interpreter_jit" : "interpreter", seconds, c.ops);
+        }
+
+        std::ostringstream err;
+        ErrorReporter reporter(err);
+        auto program = Program::compile(c.source, reporter);
+        auto path = "/tmp/lox_bench_aot_" + std::to_string(getpid());
+        std::string errors;
+        bool built = false;
+        auto build = timeIt([&] {
+            built = Transpiler::build(Transpiler::translate(*program), path,
+                                      Transpiler::Output::Executable, errors);
+        });
+        if (!built) {
+            std::fprintf(stderr, "aot/%s: build failed\n%s", c.name,
+                         errors.c_str());
+            continue;
+        }
+        report(std::string("aot/") + c.name, "build", build, 1);
+        auto native = timeIt([&] {
+            consume(std::system((path + " > /dev/null").c_str()));
+        });
+        report(std::string("aot/") + c.name, "native", native, c.ops);
+        std::remove(path.c_str());
+    }
+}
+
+} // namespace lox::bench
@@ -0,0 +1,88 @@
+#include "Interpreter/BatchRunner.h"
+#include "Interpreter/Program.h"
+#include "lox_bench.h"
+
+#include <algorithm>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace lox::bench {
+
+// 一万个小规则脚本，按 1, 2, 4 ... 个工作线程测吞吐
+auto benchBatch() -> void {
+    constexpr std::size_t kScripts = 10000;
+    std::vector<BatchJob> jobs;
+    jobs.reserve(kScripts);
+    for (std::size_t i = 0; i < kScripts; i++) {
+        jobs.push_back(BatchJob::fromSource(
+            "rule" + std::to_string(i),
+            "var limit = " + std::to_string(i % 100) +
+                ";\n"
+                "fun check(x) { return x * 2 > limit; }\n"
+                "var hits = 0;\n"
+                "for (var i = 0; i < 10; i = i + 1) {\n"
+                "  if (check(i)) hits = hits + 1;\n"
+                "}\n"
+                "print hits;\n"));
+    }
+    std::size_t cores = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<std::size_t> workerCounts;
+    for (std::size_t workers = 1; workers < cores; workers *= 2) {
+        workerCounts.push_back(workers);
+    }
+    workerCounts.push_back(cores);
+    for (auto workers : workerCounts) {
+        std::size_t failed = 0;
+        auto seconds = timeIt([&] {
+            for (const auto &result : BatchRunner(workers).run(jobs)) {
+                failed += result.exitCode != 0;
+            }
+        });
+        consume(failed);
+        report("batch", std::to_string(workers) + "_workers", seconds,
+               kScripts);
+    }
+}
+
+// 64 个工作任务执行同一个大脚本：每个任务各自编译 vs 共享一个 Program。
+// 共享时 AST 只有一份，任务只需要创建自己的全局环境
+auto benchSharedProgram() -> void {
+    constexpr std::size_t kJobs = 64;
+    constexpr int kFunctions = 2000;
+    std::string source;
+    for (int i = 0; i < kFunctions; i++) {
+        auto n = std::to_string(i);
+        source += "fun f" + n + "(a, b) { var c = a * " + n +
+                  "; if (c > b) return c - b; return b - c; }\n";
+    }
+    source += "print f1999(3, 4);\n";
+
+    std::vector<BatchJob> perJob;
+    for (std::size_t i = 0; i < kJobs; i++) {
+        perJob.push_back(
+            BatchJob::fromSource("job" + std::to_string(i), source));
+    }
+    auto compileEach = timeIt([&] {
+        for (const auto &result : BatchRunner().run(perJob)) {
+            consume(result.output.size());
+        }
+    });
+    report("shared_program", "compile_each", compileEach, kJobs);
+
+    auto shared = timeIt([&] {
+        ErrorReporter reporter;
+        auto program = Program::compile(source, reporter);
+        std::vector<BatchJob> jobs;
+        for (std::size_t i = 0; i < kJobs; i++) {
+            jobs.push_back(
+                BatchJob::fromProgram("job" + std::to_string(i), program));
+        }
+        for (const auto &result : BatchRunner().run(jobs)) {
+            consume(result.output.size());
+        }
+    });
+    report("shared_program", "compile_once", shared, kJobs);
+}
+
+} // namespace lox::bench
@@ -0,0 +1,149 @@
+#include "Interpreter/Interpreter.h"
+#include "Interpreter/Isolate.h"
+#include "Interpreter/Vm.h"
+#include "lox_bench.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <sstream>
+#include <string>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace lox::bench {
+
+// 用 perf_event_open 统计本线程的分支预测失败次数；
+// 不支持（非 Linux、容器里没有权限等）时 valid() 为 false
+class BranchMisses {
+  public:
+    BranchMisses() {
+#ifdef __linux__
+        perf_event_attr attr{};
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.size = sizeof(attr);
+        attr.config = PERF_COUNT_HW_BRANCH_MISSES;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        m_fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+#endif
+    }
+    ~BranchMisses() {
+#ifdef __linux__
+        if (m_fd >= 0)
+            close(m_fd);
+#endif
+    }
+    BranchMisses(const BranchMisses &) = delete;
+    auto operator=(const BranchMisses &) -> BranchMisses & = delete;
+
+    auto valid() const -> bool { return m_fd >= 0; }
+
+    auto start() -> void {
+#ifdef __linux__
+        if (valid()) {
+            ioctl(m_fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(m_fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+#endif
+    }
+
+    auto stop() -> std::uint64_t {
+        std::uint64_t count = 0;
+#ifdef __linux__
+        if (valid()) {
+            ioctl(m_fd, PERF_EVENT_IOC_DISABLE, 0);
+            if (read(m_fd, &count, sizeof(count)) != sizeof(count))
+                count = 0;
+        }
+#endif
+        return count;
+    }
+
+  private:
+    int m_fd = -1;
+};
+
+// 同样的程序按 AST 执行，以及用 switch 分派、直接线索化分派、
+// 直接线索化加超级指令三种方式执行字节码。关闭 JIT，
+// 除了耗时还输出每种方式的分支预测失败次数
+auto benchBytecode() -> void {
+    using Mode = Interpreter::ExecutionMode;
+    struct Case {
+        const char *name;
+        const char *source;
+        std::size_t ops;
+    };
+    const Case cases[] = {
+        {"fib",
+         "fun fib(n) { if (n < 2) return n; return fib(n - 1) + fib(n - 2); }\n"
+         "print fib(25);\n",
+         242785},
+        {"loop",
+         "var s = 0;\n"
+         "for (var i = 0; i < 1000000; i = i + 1) {\n"
+         "  if (i / 2 > 100 and s >= 0) s = s + i * 0.5; else s = s - 1;\n"
+         "}\n"
+         "print s;\n",
+         1000000},
+        {"objects",
+         "class Point {\n"
+         "  init(x, y) { this.x = x; this.y = y; }\n"
+         "  add(other) { return Point(this.x + other.x, this.y + other.y); }\n"
+         "}\n"
+         "var p = Point(0, 0);\n"
+         "var d = Point(1, 2);\n"
+         "for (var i = 0; i < 100000; i = i + 1) p = p.add(d);\n"
+         "print p.x + p.y;\n",
+         100000},
+    };
+    struct Variant {
+        const char *name;
+        Mode mode;
+        bool threaded;
+        bool superinstructions;
+    };
+    const Variant variants[] = {
+        {"tree_walk", Mode::TreeWalk, false, false},
+        {"switch", Mode::Bytecode, false, false},
+        {"threaded", Mode::Bytecode, true, false},
+        {"threaded_super", Mode::Bytecode, true, true},
+    };
+    BranchMisses misses;
+    for (const auto &c : cases) {
+        for (const auto &variant : variants) {
+            if (variant.threaded && !Vm::hasThreadedDispatch())
+                continue;
+            std::ostringstream out, err;
+            std::uint64_t missCount = 0;
+            auto seconds = timeIt([&] {
+                Isolate isolate(out, err);
+                auto interpreter = isolate.getInterpreter();
+                interpreter->getJit().setEnabled(false);
+                interpreter->setExecutionMode(variant.mode);
+                interpreter->getVm().setThreaded(variant.threaded);
+                interpreter->getVm().setSuperinstructions(
+                    variant.superinstructions);
+                misses.start();
+                isolate.run(c.source);
+                missCount = misses.stop();
+            });
+            consume(out.str().size());
+            report(std::string("bytecode/") + c.name, variant.name, seconds,
+                   c.ops);
+            if (misses.valid()) {
+                std::printf("%-32s %14llu branch-misses\n", "",
+                            static_cast<unsigned long long>(missCount));
+            }
+        }
+    }
+    if (!misses.valid())
+        std::printf("bytecode: branch-misses n/a (perf_event_open failed)\n");
+}
+
+} // namespace lox::bench
@@ -0,0 +1,58 @@
+#include "Interpreter/Interpreter.h"
+#include "Interpreter/Isolate.h"
+#include "lox_bench.h"
+
+#include <sstream>
+#include <string>
+
+namespace lox::bench {
+
+// 同样的程序分别按 AST 和闭包树执行。关闭 JIT，只比较两种执行方式本身
+auto benchClosure() -> void {
+    using Mode = Interpreter::ExecutionMode;
+    struct Case {
+        const char *name;
+        const char *source;
+        std::size_t ops;
+    };
+    const Case cases[] = {
+        {"fib",
+         "fun fib(n) { if (n < 2) return n; return fib(n - 1) + fib(n - 2); }\n"
+         "print fib(25);\n",
+         242785},
+        {"loop",
+         "var s = 0;\n"
+         "for (var i = 0; i < 1000000; i = i + 1) {\n"
+         "  if (i / 2 > 100 and s >= 0) s = s + i * 0.5; else s = s - 1;\n"
+         "}\n"
+         "print s;\n",
+         1000000},
+        {"objects",
+         "class Point {\n"
+         "  init(x, y) { this.x = x; this.y = y; }\n"
+         "  add(other) { return Point(this.x + other.x, this.y + other.y); }\n"
+         "}\n"
+         "var p = Point(0, 0);\n"
+         "var d = Point(1, 2);\n"
+         "for (var i = 0; i < 100000; i = i + 1) p = p.add(d);\n"
+         "print p.x + p.y;\n",
+         100000},
+    };
+    for (const auto &c : cases) {
+        for (auto mode : {Mode::TreeWalk, Mode::Closure}) {
+            std::ostringstream out, err;
+            auto seconds = timeIt([&] {
+                Isolate isolate(out, err);
+                isolate.getInterpreter()->getJit().setEnabled(false);
+                isolate.getInterpreter()->setExecutionMode(mode);
+                isolate.run(c.source);
+            });
+            consume(out.str().size());
+            report(std::string("closure/") + c.name,
+                   mode == Mode::Closure ? "closure" : "tree_walk", seconds,
+                   c.ops);
+        }
+    }
+}
+
+} // namespace lox::bench
@@ -0,0 +1,58 @@
+#include "Interpreter/Document.h"
+#include "Interpreter/ErrorReporter.h"
+#include "Interpreter/Parser.h"
+#include "Interpreter/Resolver.h"
+#include "Interpreter/Scanner.h"
+#include "lox_bench.h"
+
+#include <sstream>
+#include <string>
+
+namespace lox::bench {
+
+// 语言服务器每次按键之后重新得到诊断信息的延迟：在一个 2 万行文件
+// 中间的函数里逐个字符地敲进一条语句。
+// 从头扫描、解析并解析变量，和只更新受影响的顶层声明相比
+auto benchDocument() -> void {
+    std::string source;
+    for (int i = 0; i < 2500; i++) {
+        auto n = std::to_string(i);
+        source += "fun f" + n + "(a, b) {\n"
+                  "  var s = \"" + n + "\";\n"
+                  "  while (a > b) { a = a - 1; if (a == 3) return s; }\n"
+                  "  for (var i = 0; i < b; i = i + 1) print i;\n"
+                  "  return a * b + " + n + ";\n"
+                  "}\n"
+                  "class C" + n + " { m() { return this; } }\n"
+                  "print f" + n + "(1, 2);\n";
+    }
+    const std::string typed = "var total = a + b * (s + \"x\");\n  ";
+    auto at = source.find("  return a * b + 1250;");
+
+    auto fullText = source;
+    auto full = timeIt([&] {
+        for (std::size_t i = 0; i < typed.size(); i++) {
+            fullText.insert(at + i, 1, typed[i]);
+            std::ostringstream err;
+            ErrorReporter reporter(err);
+            Scanner scanner(fullText, nullptr, &reporter);
+            auto statements = Parser(scanner.scanTokens(), &reporter).parse();
+            if (!reporter.hadError())
+                Resolver(reporter).resolve(statements);
+            consume(reporter.getDiagnostics().size());
+        }
+    });
+    report("document", "full_reparse", full, typed.size());
+
+    Document document(source, "big.lox");
+    auto incremental = timeIt([&] {
+        for (std::size_t i = 0; i < typed.size(); i++) {
+            document.edit(at + i, 0, std::string(1, typed[i]));
+            consume(document.getDiagnostics().size());
+        }
+    });
+    report("document", "incremental", incremental, typed.size());
+    consume(document.getSource() == fullText);
+}
+
+} // namespace lox::bench
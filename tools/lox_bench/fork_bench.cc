@@ -0,0 +1,116 @@
+#include "Interpreter/Isolate.h"
+#include "Interpreter/Snapshot.h"
+#include "lox_bench.h"
+
+#include <cstdio>
+#include <sstream>
+#include <string>
+
+namespace lox::bench {
+
+// 生成一个定义 classes 个类、functions 个函数和一张查找表的 prelude
+static auto makePrelude(int classes, int functions) -> std::string {
+    std::string source;
+    for (int i = 0; i < classes; i++) {
+        auto n = std::to_string(i);
+        source += "class C" + n + " { init() { this.v = " + n +
+                  "; } get() { return this.v; } }\n";
+    }
+    for (int i = 0; i < functions; i++) {
+        auto n = std::to_string(i);
+        source += "fun f" + n + "(x) { return x + " + n + "; }\n";
+    }
+    source += "class Table { init() { this.hits = 0; } }\n"
+              "var table = Table();\n";
+    for (int i = 0; i < classes; i++) {
+        auto n = std::to_string(i);
+        source += "table.k" + n + " = C" + n + "();\n";
+    }
+    return source;
+}
+
+// 每个请求重新执行 prelude vs 从快照 fork，请求脚本本身很小
+auto benchFork() -> void {
+    constexpr std::size_t kRequests = 200;
+    const std::string request = "table.hits = table.hits + 1;\n"
+                                "print f0(table.k0.get()) + table.hits;\n";
+    for (int size : {10, 100, 1000}) {
+        auto prelude = makePrelude(size, size);
+        auto variant = std::to_string(size) + "_defs";
+
+        auto rerun = timeIt([&] {
+            for (std::size_t i = 0; i < kRequests; i++) {
+                std::ostringstream out;
+                Isolate isolate(out);
+                isolate.run(prelude);
+                isolate.run(request);
+                consume(out.str().size());
+            }
+        });
+        report("fork/rerun_prelude", variant, rerun, kRequests);
+
+        std::ostringstream templateOut;
+        Isolate base(templateOut);
+        base.run(prelude);
+        auto snapshot = base.snapshot();
+        auto fork = timeIt([&] {
+            for (std::size_t i = 0; i < kRequests; i++) {
+                std::ostringstream out;
+                Isolate isolate(snapshot, out);
+                isolate.run(request);
+                consume(out.str().size());
+            }
+        });
+        report("fork/from_snapshot", variant, fork, kRequests);
+
+        // 只测 fork 本身
+        constexpr std::size_t kClones = 100000;
+        std::ostringstream sink;
+        auto clone = timeIt([&] {
+            for (std::size_t i = 0; i < kClones; i++) {
+                Isolate isolate(snapshot, sink);
+            }
+        });
+        report("fork/clone_only", variant, clone, kClones);
+    }
+}
+
+// 冷启动：重新执行 prelude vs 从快照文件加载后 fork。
+// prelude 每一项初始化都多做一些计算，模拟真实的标准库初始化
+auto benchSnapshotLoad() -> void {
+    constexpr std::size_t kStarts = 20;
+    const std::string path = "lox_bench.snapshot";
+    for (int size : {100, 1000}) {
+        auto prelude = makePrelude(size, size) +
+                       "var warm = 0;\n"
+                       "for (var i = 0; i < 20000; i = i + 1) {\n"
+                       "  warm = warm + f1(i);\n"
+                       "}\n";
+        auto variant = std::to_string(size) + "_defs";
+        std::ostringstream out;
+        {
+            Isolate base(out);
+            base.run(prelude);
+            base.snapshot()->save(path);
+        }
+
+        auto rerun = timeIt([&] {
+            for (std::size_t i = 0; i < kStarts; i++) {
+                Isolate isolate(out);
+                isolate.run(prelude);
+            }
+        });
+        report("snapshot_load/rerun_prelude", variant, rerun, kStarts);
+
+        auto load = timeIt([&] {
+            for (std::size_t i = 0; i < kStarts; i++) {
+                Isolate isolate(Snapshot::load(path), out);
+                isolate.run("print table.k0.get() + warm;");
+            }
+        });
+        report("snapshot_load/load_file", variant, load, kStarts);
+    }
+    std::remove(path.c_str());
+}
+
+} // namespace lox::bench
@@ -0,0 +1,47 @@
+#include "Interpreter/Interpreter.h"
+#include "Interpreter/Isolate.h"
+#include "lox_bench.h"
+
+#include <sstream>
+#include <string>
+
+namespace lox::bench {
+
+// 递归调用和紧凑循环，分别在开启和关闭 JIT 时执行
+auto benchJit() -> void {
+    struct Case {
+        const char *name;
+        const char *source;
+        std::size_t ops;
+    };
+    const Case cases[] = {
+        {"fib",
+         "fun fib(n) { if (n < 2) return n; return fib(n - 1) + fib(n - 2); }\n"
+         "print fib(25);\n",
+         242785},
+        {"loop",
+         "fun sum(n) {\n"
+         "  var s = 0;\n"
+         "  for (var i = 0; i < n; i = i + 1) s = s + i * 0.5;\n"
+         "  return s;\n"
+         "}\n"
+         "for (var i = 0; i < 100; i = i + 1) sum(10000);\n"
+         "print sum(10000);\n",
+         1010000},
+    };
+    for (const auto &c : cases) {
+        for (bool enabled : {false, true}) {
+            std::ostringstream out, err;
+            auto seconds = timeIt([&] {
+                Isolate isolate(out, err);
+                isolate.getInterpreter()->getJit().setEnabled(enabled);
+                isolate.run(c.source);
+            });
+            consume(out.str().size());
+            report(std::string("jit/") + c.name,
+                   enabled ? "jit" : "interpreter", seconds, c.ops);
+        }
+    }
+}
+
+} // namespace lox::bench
@@ -0,0 +1,48 @@
+#include "Interpreter/Isolate.h"
+#include "lox_bench.h"
+
+#include <sstream>
+#include <string>
+
+namespace lox::bench {
+
+// 声明了几千个函数和方法、只调用其中几个的库脚本：
+// 预先解析全部函数体与延迟到第一次调用时解析的启动时间
+auto benchLazyParse() -> void {
+    std::string source;
+    for (int i = 0; i < 4000; i++) {
+        auto n = std::to_string(i);
+        source += "fun helper" + n + "(a, b) {\n"
+                  "  var total = 0;\n"
+                  "  for (var i = 0; i < a; i = i + 1) {\n"
+                  "    if (i > b and total < 100) total = total + i * 2;\n"
+                  "    else total = total - 1;\n"
+                  "  }\n"
+                  "  return total + " + n + ";\n"
+                  "}\n";
+        if (i % 10 == 0) {
+            source += "class Widget" + n + " {\n"
+                      "  init(x) { this.x = x; this.label = \"w" + n + "\"; }\n"
+                      "  grow(d) { this.x = this.x + d; return this; }\n"
+                      "  show() { print this.label; }\n"
+                      "}\n";
+        }
+    }
+    source += "print helper7(10, 3) + helper42(5, 1);\n"
+              "Widget10(1).grow(2).show();\n";
+    for (bool lazy : {false, true}) {
+        const int rounds = 5;
+        auto seconds = timeIt([&] {
+            for (int r = 0; r < rounds; r++) {
+                std::ostringstream out, err;
+                Isolate isolate(out, err);
+                isolate.setLazyParsing(lazy);
+                consume(static_cast<std::size_t>(isolate.run(source)));
+            }
+        });
+        report("lazy_parse/startup", lazy ? "lazy" : "eager", seconds,
+               rounds);
+    }
+}
+
+} // namespace lox::bench
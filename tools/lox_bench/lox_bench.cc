@@ -0,0 +1,69 @@
+#include "lox_bench.h"
+
+#include <cstdio>
+#include <cstring>
+#include <iterator>
+
+namespace lox::bench {
+
+static volatile std::size_t sink;
+
+auto report(const std::string &bench, const std::string &variant,
+            double seconds, std::size_t ops) -> void {
+    std::printf("%-32s %10.4f s %14.0f ops/s\n",
+                (bench + "/" + variant).c_str(), seconds,
+                seconds > 0 ? static_cast<double>(ops) / seconds : 0.0);
+}
+
+auto consume(std::size_t value) -> void { sink = sink + value; }
+
+static const Benchmark kBenchmarks[] = {
+    {"number_format", benchNumberFormat},
+    {"string_concat", benchStringConcat},
+    {"batch", benchBatch},
+    {"shared_program", benchSharedProgram},
+    {"fork", benchFork},
+    {"snapshot_load", benchSnapshotLoad},
+    {"jit", benchJit},
+    {"aot", benchAot},
+    {"closure", benchClosure},
+    {"bytecode", benchBytecode},
+    {"scanner", benchScanner},
+    {"parallel_scan", benchParallelScan},
+    {"stream", benchStream},
+    {"lazy_parse", benchLazyParse},
+    {"multi_file", benchMultiFile},
+    {"modules", benchModules},
+    {"parse_errors", benchParseErrors},
+    {"document", benchDocument},
+    {"memory", benchMemory},
+};
+
+} // namespace lox::bench
+
+// 用法: lox_bench [name...]，不带参数时运行全部基准
+int main(int argc, char **argv) {
+    using lox::bench::kBenchmarks;
+    int ran = 0;
+    for (const auto &benchmark : kBenchmarks) {
+        bool selected = argc < 2;
+        for (int i = 1; i < argc; i++) {
+            if (std::strcmp(argv[i], benchmark.name) == 0) {
+                selected = true;
+            }
+        }
+        if (selected) {
+            benchmark.run();
+            ran++;
+        }
+    }
+    if (ran == 0) {
+        std::fprintf(stderr, "unknown benchmark; available:");
+        for (const auto &benchmark : kBenchmarks) {
+            std::fprintf(stderr, " %s", benchmark.name);
+        }
+        std::fprintf(stderr, "\n");
+        return 1;
+    }
+    return 0;
+}
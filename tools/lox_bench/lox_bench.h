@@ -0,0 +1,52 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+
+namespace lox::bench {
+
+using Clock = std::chrono::steady_clock;
+
+// 一个基准用例：name 用于命令行选择
+struct Benchmark {
+    const char *name;
+    void (*run)();
+};
+
+// 执行 fn 并返回耗时（秒）
+template <class Fn> auto timeIt(Fn &&fn) -> double {
+    auto start = Clock::now();
+    fn();
+    std::chrono::duration<double> elapsed = Clock::now() - start;
+    return elapsed.count();
+}
+
+// 输出一行结果：<bench>/<variant>  <seconds>  <ops/s>
+auto report(const std::string &bench, const std::string &variant,
+            double seconds, std::size_t ops) -> void;
+
+// 防止编译器把基准中的计算优化掉
+auto consume(std::size_t value) -> void;
+
+auto benchNumberFormat() -> void;
+auto benchStringConcat() -> void;
+auto benchBatch() -> void;
+auto benchSharedProgram() -> void;
+auto benchFork() -> void;
+auto benchSnapshotLoad() -> void;
+auto benchJit() -> void;
+auto benchAot() -> void;
+auto benchClosure() -> void;
+auto benchBytecode() -> void;
+auto benchScanner() -> void;
+auto benchParallelScan() -> void;
+auto benchStream() -> void;
+auto benchLazyParse() -> void;
+auto benchMultiFile() -> void;
+auto benchModules() -> void;
+auto benchParseErrors() -> void;
+auto benchDocument() -> void;
+auto benchMemory() -> void;
+
+} // namespace lox::bench
@@ -0,0 +1,61 @@
+#include "Interpreter/ErrorReporter.h"
+#include "Interpreter/Program.h"
+#include "Interpreter/Scanner.h"
+#include "lox_bench.h"
+
+#include <cstdio>
+#include <malloc.h>
+#include <sstream>
+#include <string>
+
+namespace lox::bench {
+
+// 堆上正在使用的字节数
+static auto heapInUse() -> std::size_t { return mallinfo2().uordblks; }
+
+static auto reportMemory(const std::string &variant, std::size_t bytes,
+                         std::size_t lines) -> void {
+    std::printf("%-32s %10.1f bytes/line %10.2f MB\n",
+                ("memory/" + variant).c_str(),
+                static_cast<double>(bytes) / lines, bytes / 1048576.0);
+}
+
+// 编译之后常驻内存的部分：每个工作进程都持有一份编译好的程序。
+// 2 万行的程序，按源码行数平均
+auto benchMemory() -> void {
+    std::string source;
+    std::size_t lines = 0;
+    for (int i = 0; lines < 20000; i++) {
+        auto n = std::to_string(i);
+        source += "fun handler" + n + "(request, response) {\n"
+                  "  var status = request.status;\n"
+                  "  if (status == " + n + ") {\n"
+                  "    response.body = \"handled " + n + "\";\n"
+                  "    return response;\n"
+                  "  }\n"
+                  "  for (var i = 0; i < status; i = i + 1)"
+                  " status = status - 1;\n"
+                  "  return handler" + n + "(request, response);\n"
+                  "}\n"
+                  "class Route" + n + " { init(path) { this.path = path; } }\n";
+        lines += 10;
+    }
+
+    auto before = heapInUse();
+    {
+        Scanner scanner(source);
+        auto tokens = scanner.scanTokens();
+        reportMemory("tokens", heapInUse() - before, lines);
+        consume(tokens.size());
+    }
+
+    std::ostringstream err;
+    ErrorReporter reporter(err);
+    // 编译之后只剩语法树，源码和扫描出来的 token 都已经释放
+    before = heapInUse();
+    auto program = Program::compile(source, reporter);
+    reportMemory("program", heapInUse() - before, lines);
+    consume(program->getStatements().size());
+}
+
+} // namespace lox::bench
@@ -0,0 +1,74 @@
+#include "Interpreter/Interpreter.h"
+#include "Interpreter/Isolate.h"
+#include "Interpreter/ModuleCache.h"
+#include "lox_bench.h"
+
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <unistd.h>
+
+namespace lox::bench {
+
+static auto importIn(const std::filesystem::path &root,
+                     const ModuleCacheRef &cache, const std::string &source)
+    -> void {
+    std::ostringstream out, err;
+    Isolate isolate(out, err);
+    isolate.getInterpreter()->setModuleRoot(root.string());
+    isolate.getInterpreter()->setModuleCache(cache);
+    isolate.run(source);
+    consume(out.str().size() + err.str().size());
+}
+
+// 一个 1500 个函数的模块：每个 Isolate 第一次导入时编译，
+// 共享缓存之后只需要执行；同一个 Isolate 里重复导入只是查表
+auto benchModules() -> void {
+    auto root = std::filesystem::temp_directory_path() /
+                ("lox_bench_modules_" + std::to_string(::getpid()));
+    std::filesystem::create_directories(root);
+    {
+        std::ofstream lib(root / "lib.lox");
+        for (int i = 0; i < 1500; i++) {
+            auto name = "f" + std::to_string(i);
+            lib << "fun " << name << "(a, b) {\n"
+                << "  var s = \"" << name << "\";\n"
+                << "  while (a > b) { a = a - 1; if (a == 3) return s; }\n"
+                << "  return a * b + " << i << ";\n"
+                << "}\n";
+        }
+    }
+    const std::string importOnce = "import \"lib.lox\";\nprint lib.f7(2, 3);\n";
+    constexpr int kIsolates = 20;
+
+    auto cold = timeIt([&] {
+        for (int i = 0; i < kIsolates; i++) {
+            importIn(root, std::make_shared<ModuleCache>(), importOnce);
+        }
+    });
+    report("modules", "compile_each_isolate", cold, kIsolates);
+
+    auto cache = std::make_shared<ModuleCache>();
+    importIn(root, cache, importOnce);
+    auto warm = timeIt([&] {
+        for (int i = 0; i < kIsolates; i++) {
+            importIn(root, cache, importOnce);
+        }
+    });
+    report("modules", "shared_cache", warm, kIsolates);
+
+    constexpr int kImports = 200000;
+    auto repeated = timeIt([&] {
+        importIn(root, cache,
+                 "fun load() { import \"lib.lox\"; return lib; }\n"
+                 "for (var i = 0; i < " +
+                     std::to_string(kImports) + "; i = i + 1) load();\n");
+    });
+    report("modules", "repeated_import", repeated, kImports);
+
+    std::filesystem::remove_all(root);
+}
+
+} // namespace lox::bench
@@ -0,0 +1,49 @@
+#include "Interpreter/ErrorReporter.h"
+#include "Interpreter/Program.h"
+#include "lox_bench.h"
+
+#include <cstdio>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace lox::bench {
+
+// 400 个模块组成的程序，只编译不执行：前端分别用 1/2/4/8 个线程
+auto benchMultiFile() -> void {
+    std::vector<SourceFile> files;
+    for (int f = 0; f < 400; f++) {
+        std::string source;
+        for (int i = 0; i < 60; i++) {
+            auto name = "m" + std::to_string(f) + "_" + std::to_string(i);
+            source += "fun " + name + "(a, b) {\n"
+                      "  var s = \"" + name + "\";\n"
+                      "  while (a > b) { a = a - 1; if (a == 3) return s; }\n"
+                      "  return a * b + " + std::to_string(i) + ";\n"
+                      "}\n";
+        }
+        files.push_back({"module" + std::to_string(f) + ".lox", source});
+    }
+    double base = 0;
+    for (std::size_t threads : {1, 2, 4, 8}) {
+        std::size_t statements = 0;
+        auto seconds = timeIt([&] {
+            std::ostringstream err;
+            ErrorReporter reporter(err);
+            auto program =
+                Program::compileFiles(files, reporter, nullptr, false, threads);
+            statements = program->getStatements().size();
+        });
+        consume(statements);
+        if (threads == 1)
+            base = seconds;
+        report("multi_file", std::to_string(threads) + "_threads", seconds,
+               files.size());
+        std::printf("%-32s %6.2fx\n", "", base / seconds);
+    }
+    std::printf("multi_file: %u hardware threads\n",
+                std::thread::hardware_concurrency());
+}
+
+} // namespace lox::bench
@@ -0,0 +1,46 @@
+#include "Interpreter/Object.h"
+#include "lox_bench.h"
+
+#include <string>
+#include <vector>
+
+namespace lox::bench {
+
+// 旧实现：std::to_string 固定六位小数，再去掉 ".000000" 后缀
+static auto legacyFormat(double num) -> std::string {
+    auto text = std::to_string(num);
+    std::string suffix = ".000000";
+    if (text.length() >= suffix.length() &&
+        text.substr(text.length() - suffix.length()) == suffix) {
+        return text.erase(text.size() - suffix.size());
+    }
+    return text;
+}
+
+auto benchNumberFormat() -> void {
+    constexpr std::size_t kCount = 1 << 20;
+    std::vector<double> values;
+    values.reserve(kCount);
+    for (std::size_t i = 0; i < kCount; i++) {
+        // 一半整数，一半带小数，模拟数值输出脚本
+        values.push_back(i % 2 == 0 ? static_cast<double>(i)
+                                    : static_cast<double>(i) / 7.0);
+    }
+
+    auto legacy = timeIt([&] {
+        for (auto value : values) {
+            consume(legacyFormat(value).size());
+        }
+    });
+    report("number_format", "to_string+strip", legacy, kCount);
+
+    auto shortest = timeIt([&] {
+        char buf[Object::kNumberBufferSize];
+        for (auto value : values) {
+            consume(Object::formatNumber(value, buf));
+        }
+    });
+    report("number_format", "formatNumber", shortest, kCount);
+}
+
+} // namespace lox::bench
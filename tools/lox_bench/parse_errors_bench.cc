@@ -0,0 +1,54 @@
+#include "Interpreter/ErrorReporter.h"
+#include "Interpreter/Parser.h"
+#include "Interpreter/Scanner.h"
+#include "lox_bench.h"
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace lox::bench {
+
+// 编辑器和检查工具面对的是写了一半的代码：2 万行里每两行就有一个语法错误。
+// 只计解析的时间，扫描在计时之外完成
+auto benchParseErrors() -> void {
+    std::string source;
+    for (int i = 0; i < 10000; i++) {
+        auto n = std::to_string(i);
+        switch (i % 4) {
+        case 0:
+            source += "var = " + n + ";\n";
+            break;
+        case 1:
+            source += "print (" + n + " + ;\n";
+            break;
+        case 2:
+            source += "fun f" + n + "(a, { return a; }\n";
+            break;
+        default:
+            source += "if (x > " + n + " print x;\n";
+            break;
+        }
+        source += "var ok" + n + " = " + n + " * 2;\n";
+    }
+    std::ostringstream scanErrors;
+    ErrorReporter scanReporter(scanErrors);
+    Scanner scanner(source, nullptr, &scanReporter);
+    auto tokens = scanner.scanTokens();
+
+    constexpr int kRounds = 5;
+    std::size_t errors = 0;
+    auto seconds = timeIt([&] {
+        for (int round = 0; round < kRounds; round++) {
+            std::ostringstream err;
+            ErrorReporter reporter(err);
+            Parser parser(tokens, &reporter);
+            auto statements = parser.parse();
+            errors += reporter.getDiagnostics().size() + statements.size();
+        }
+    });
+    consume(errors);
+    report("parse_errors", "20k_lines", seconds, kRounds * 10000);
+}
+
+} // namespace lox::bench
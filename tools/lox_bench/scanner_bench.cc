@@ -0,0 +1,187 @@
+#include "Interpreter/ScanKernels.h"
+#include "Interpreter/Scanner.h"
+#include "Interpreter/Tokentype.h"
+#include "lox_bench.h"
+
+#include <cctype>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace lox::bench {
+
+// 以标识符和关键字为主的源码：许多标识符与关键字有共同前缀
+static auto identifierHeavySource(int lines) -> std::string {
+    std::string source;
+    for (int i = 0; i < lines; i++) {
+        source += "var fortune" + std::to_string(i % 97) +
+                  " = this.orchid or classic and superb;\n"
+                  "while (returned) { print variable; fun_ = nilly; }\n";
+    }
+    return source;
+}
+
+// 机器生成的脚本：大段缩进、注释和很长的字符串字面量
+static auto generatedSource(int lines) -> std::string {
+    std::string source;
+    for (int i = 0; i < lines; i++) {
+        source += "                // generated from template block " +
+                  std::to_string(i) + ", do not edit by hand\n"
+                  "                var text" +
+                  std::to_string(i % 13) + " = \"" + std::string(120, 'x') +
+                  "\n" + std::string(60, 'y') + "\";\n\n";
+    }
+    return source;
+}
+
+// 只用 ScanKernels 走一遍源码、不建 token，数出行数：
+// 去掉分配 token 的开销后各个实现本身的吞吐量
+static auto skim(const ScanKernels &kernels, const std::string &source)
+    -> int {
+    int lines = 1;
+    const char *p = source.data();
+    const char *end = p + source.size();
+    while (p < end) {
+        auto c = *p;
+        if (c == ' ' || c == '\t' || c == '\r' || c == '\n') {
+            p = kernels.skipWhitespace(p, end, &lines);
+        } else if (c == '/' && p + 1 < end && p[1] == '/') {
+            p = kernels.findNewline(p, end);
+        } else if (c == '"') {
+            p = kernels.findQuote(p + 1, end, &lines);
+            p += p < end;
+        } else if (std::isalpha(static_cast<unsigned char>(c)) || c == '_') {
+            p = kernels.skipIdentifier(p, end);
+        } else {
+            p++;
+        }
+    }
+    return lines;
+}
+
+// 关键字识别本身：改用首字母分支之前的做法是截出 std::string 再查
+// unordered_map，这里把两者放在一起比较；scan 是完整的词法分析
+auto benchScanner() -> void {
+    auto source = identifierHeavySource(20000);
+    std::vector<std::string_view> words;
+    for (std::size_t i = 0; i < source.size();) {
+        auto c = source[i];
+        if (std::isalpha(static_cast<unsigned char>(c)) || c == '_') {
+            auto start = i;
+            while (i < source.size() &&
+                   (std::isalnum(static_cast<unsigned char>(source[i])) ||
+                    source[i] == '_'))
+                i++;
+            words.push_back(std::string_view(source).substr(start, i - start));
+        } else {
+            i++;
+        }
+    }
+
+    const std::unordered_map<std::string, TokenType> keywords = {
+        {"and", AND},   {"class", CLASS}, {"else", ELSE},     {"false", FALSE},
+        {"for", FOR},   {"fun", FUN},     {"if", IF},         {"nil", NIL},
+        {"or", OR},     {"print", PRINT}, {"return", RETURN}, {"super", SUPER},
+        {"this", THIS}, {"true", TRUE},   {"var", VAR},       {"while", WHILE}};
+    const int rounds = 20;
+    std::size_t hits = 0;
+    auto seconds = timeIt([&] {
+        for (int r = 0; r < rounds; r++) {
+            for (auto word : words) {
+                auto iter = keywords.find(std::string(word));
+                hits += iter == keywords.end() ? IDENTIFIER : iter->second;
+            }
+        }
+    });
+    report("scanner/keywords", "unordered_map", seconds, words.size() * rounds);
+    seconds = timeIt([&] {
+        for (int r = 0; r < rounds; r++) {
+            for (auto word : words)
+                hits += keywordType(word);
+        }
+    });
+    report("scanner/keywords", "switch_trie", seconds, words.size() * rounds);
+    consume(hits);
+
+    std::size_t tokens = 0;
+    seconds = timeIt([&] {
+        Scanner scanner(source);
+        tokens = scanner.scanTokens().size();
+    });
+    report("scanner/scan", "identifiers", seconds, tokens);
+    consume(tokens);
+
+    // 各个实现扫描同样两段源码的吞吐量：simd 是完整的词法分析，
+    // kernels 只包括 ScanKernels 本身
+    const std::pair<const char *, std::string> inputs[] = {
+        {"generated", generatedSource(20000)}, {"identifiers", source}};
+    for (const auto &[name, input] : inputs) {
+        for (auto path : {ScanKernels::Path::Scalar, ScanKernels::Path::Sse2,
+                          ScanKernels::Path::Avx2}) {
+            auto *kernels = ScanKernels::get(path);
+            if (kernels == nullptr)
+                continue;
+            seconds = timeIt([&] {
+                Scanner scanner(input);
+                scanner.setKernels(*kernels);
+                tokens = scanner.scanTokens().size();
+            });
+            consume(tokens);
+            auto variant = std::string(name) + "/" +
+                           ScanKernels::pathName(path);
+            report("scanner/simd", variant, seconds, tokens);
+            std::printf("%-32s %10.1f MB/s\n", "",
+                        static_cast<double>(input.size()) / 1e6 / seconds);
+
+            int lines = 0;
+            const int rounds = 20;
+            seconds = timeIt([&] {
+                for (int r = 0; r < rounds; r++)
+                    lines += skim(*kernels, input);
+            });
+            consume(lines);
+            report("scanner/kernels", variant, seconds,
+                   input.size() * rounds);
+            std::printf("%-32s %10.1f MB/s\n", "",
+                        static_cast<double>(input.size()) * rounds / 1e6 /
+                            seconds);
+        }
+    }
+}
+
+// 以数据表为主的大脚本（约 32MB），分别用 1/2/4/8 个线程扫描
+auto benchParallelScan() -> void {
+    std::string source;
+    for (int i = 0; source.size() < (32u << 20); i++) {
+        source += "table.add(" + std::to_string(i) + ", \"row " +
+                  std::to_string(i) + "\", " + std::to_string(i * 0.25) +
+                  ", true); // generated\n";
+        if (i % 1000 == 0)
+            source += "var note" + std::to_string(i) +
+                      " = \"multi-line\nnote\n\";\n";
+    }
+    double base = 0;
+    for (std::size_t threads : {1, 2, 4, 8}) {
+        std::size_t tokens = 0;
+        auto seconds = timeIt([&] {
+            Scanner scanner(source);
+            tokens = threads == 1 ? scanner.scanTokens().size()
+                                  : scanner.scanTokensParallel(threads).size();
+        });
+        consume(tokens);
+        if (threads == 1)
+            base = seconds;
+        report("parallel_scan", std::to_string(threads) + "_threads", seconds,
+               tokens);
+        std::printf("%-32s %10.1f MB/s %6.2fx\n", "",
+                    static_cast<double>(source.size()) / 1e6 / seconds,
+                    base / seconds);
+    }
+    std::printf("parallel_scan: %u hardware threads\n",
+                std::thread::hardware_concurrency());
+}
+
+} // namespace lox::bench
@@ -0,0 +1,82 @@
+#include "Interpreter/Isolate.h"
+#include "lox_bench.h"
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <streambuf>
+#include <string>
+
+namespace lox::bench {
+
+// 丢掉输出，只记下第一次写入的时刻
+class FirstOutputBuf : public std::streambuf {
+  public:
+    Clock::time_point first{};
+    bool written = false;
+
+  protected:
+    auto overflow(int_type c) -> int_type override {
+        mark();
+        return c;
+    }
+    auto xsputn(const char *, std::streamsize n) -> std::streamsize override {
+        mark();
+        return n;
+    }
+
+  private:
+    auto mark() -> void {
+        if (!written) {
+            written = true;
+            first = Clock::now();
+        }
+    }
+};
+
+// 进程到目前为止的峰值常驻内存（MB），读不到时为 0
+static auto peakRssMb() -> double {
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.rfind("VmHWM:", 0) == 0)
+            return std::stod(line.substr(6)) / 1024;
+    }
+    return 0;
+}
+
+// 约 24MB 的生成脚本，边读边执行与整体编译后执行的对比：
+// 第一行输出出现的时间和峰值内存。峰值只增不减，所以先测流式执行
+auto benchStream() -> void {
+    std::string source = "var total = 0;\nprint \"start\";\n";
+    for (int i = 0; source.size() < (24u << 20); i++) {
+        source += "var row = \"row " + std::to_string(i) +
+                  "\"; total = total + " + std::to_string(i % 7) +
+                  "; // generated\n";
+        if (i % 100000 == 0)
+            source += "print total;\n";
+    }
+    auto before = peakRssMb();
+    for (bool stream : {true, false}) {
+        FirstOutputBuf buf;
+        std::ostream out(&buf);
+        std::ostringstream err;
+        Isolate isolate(out, err);
+        auto start = Clock::now();
+        auto seconds = timeIt([&] {
+            if (stream) {
+                std::istringstream input(source);
+                isolate.runStream(input);
+            } else {
+                isolate.run(source);
+            }
+        });
+        std::chrono::duration<double> first = buf.first - start;
+        auto variant = stream ? "stream" : "whole";
+        report("stream/total", variant, seconds, source.size());
+        std::printf("%-32s first output %8.3f s, peak RSS +%.1f MB\n", "",
+                    first.count(), peakRssMb() - before);
+    }
+}
+
+} // namespace lox::bench
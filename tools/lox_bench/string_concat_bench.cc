@@ -0,0 +1,41 @@
+#include "Interpreter/LoxString.h"
+#include "Interpreter/Object.h"
+#include "lox_bench.h"
+
+#include <string>
+
+namespace lox::bench {
+
+// 模拟脚本中 `s = s + chunk;` 的循环拼接
+auto benchStringConcat() -> void {
+    const std::string chunk(64, 'x');
+    constexpr std::size_t kRopeBytes = 10 << 20;
+    // 旧的实现每次都复制两边，是 O(n^2)，只能跑小得多的规模
+    constexpr std::size_t kLegacyBytes = 256 << 10;
+
+    auto legacy = timeIt([&] {
+        std::string acc;
+        auto piece = chunk;
+        while (acc.size() < kLegacyBytes) {
+            std::string left = acc;
+            std::string right = piece;
+            acc = left + right;
+        }
+        consume(acc.size());
+    });
+    report("string_concat", "flat_copy_256KB", legacy, kLegacyBytes / 64);
+
+    auto rope = timeIt([&] {
+        auto acc = Object::make_str_obj("");
+        auto piece = Object::make_str_obj(chunk);
+        while (acc.getString()->length() < kRopeBytes) {
+            acc = Object::make_str_obj(
+                LoxString::concat(acc.getString(), piece.getString()));
+        }
+        // 输出时才展平
+        consume(acc.getString()->view().size());
+    });
+    report("string_concat", "rope_10MB", rope, kRopeBytes / 64);
+}
+
+} // namespace lox::bench
@@ -0,0 +1,108 @@
+#include "Interpreter/Lox.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <memory>
+#include <string>
+#include <vector>
+
+static auto usage() -> int {
+    std::fprintf(stderr,
+                 "Usage: lox_shell [--snapshot file] [script...]\n"
+                 "       lox_shell [--snapshot file] --stream script|-\n"
+                 "       lox_shell --save-snapshot file prelude\n"
+                 "       lox_shell --batch [--jobs N] script...\n"
+                 "       lox_shell --compile [--shared] -o output script\n"
+                 "       lox_shell --run-native library\n");
+    return 64;
+}
+
+// 用法: lox_shell [script...]，多个脚本按顺序组成一个程序，
+// 不带参数时进入 REPL；
+// --batch 模式下并行执行多个脚本；--stream 边读边执行；
+// --compile 把脚本预先编译成本地代码
+int main(int argc, char **argv) {
+    if (argc >= 2 && std::strcmp(argv[1], "--batch") == 0) {
+        std::size_t jobs = 0;
+        std::vector<std::string> paths;
+        for (int i = 2; i < argc; i++) {
+            if (std::strcmp(argv[i], "--jobs") == 0 && i + 1 < argc) {
+                jobs = std::strtoul(argv[++i], nullptr, 10);
+            } else {
+                paths.emplace_back(argv[i]);
+            }
+        }
+        if (paths.empty()) {
+            return usage();
+        }
+        return lox::Lox::runBatch(paths, jobs);
+    }
+
+    try {
+        // 预先编译成本地可执行文件或共享库
+        if (argc >= 2 && std::strcmp(argv[1], "--compile") == 0) {
+            auto kind = lox::Transpiler::Output::Executable;
+            std::string output, script;
+            for (int i = 2; i < argc; i++) {
+                if (std::strcmp(argv[i], "--shared") == 0) {
+                    kind = lox::Transpiler::Output::SharedObject;
+                } else if (std::strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+                    output = argv[++i];
+                } else {
+                    script = argv[i];
+                }
+            }
+            if (output.empty() || script.empty()) {
+                return usage();
+            }
+            return lox::Lox::compileFile(script, output, kind);
+        }
+        if (argc >= 2 && std::strcmp(argv[1], "--run-native") == 0) {
+            if (argc != 3) {
+                return usage();
+            }
+            return lox::Transpiler::runShared(argv[2]);
+        }
+        // 执行 prelude 后把堆保存成快照文件
+        if (argc >= 2 && std::strcmp(argv[1], "--save-snapshot") == 0) {
+            if (argc != 4) {
+                return usage();
+            }
+            lox::Lox lox;
+            lox.runFile(argv[3]);
+            lox.getIsolate().snapshot()->save(argv[2]);
+            return 0;
+        }
+        lox::SnapshotRef snapshot;
+        if (argc >= 3 && std::strcmp(argv[1], "--snapshot") == 0) {
+            snapshot = lox::Snapshot::load(argv[2]);
+            argc -= 2;
+            argv += 2;
+        }
+        bool stream = argc >= 2 && std::strcmp(argv[1], "--stream") == 0;
+        if (stream) {
+            if (argc != 3) {
+                return usage();
+            }
+            argc--;
+            argv++;
+        }
+        auto lox = snapshot != nullptr ? std::make_unique<lox::Lox>(snapshot)
+                                       : std::make_unique<lox::Lox>();
+        if (stream) {
+            lox->streamFile(argv[1]);
+        } else if (argc == 2) {
+            lox->runFile(argv[1]);
+        } else if (argc > 2) {
+            lox->runFiles(std::vector<std::string>(argv + 1, argv + argc));
+        } else {
+            lox->runPrompt();
+        }
+    } catch (const std::exception &e) {
+        std::fprintf(stderr, "%s\n", e.what());
+        return 66;
+    }
+    return 0;
+}